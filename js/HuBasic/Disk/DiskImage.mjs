@@ -47,6 +47,22 @@ export class DiskImage {
 	 */
 	#Sectors = new Array();
 
+	/**
+	 * セクタを作り直した回数
+	 * 
+	 * 読み込みやフォーマットで、セクタの配列が入れ替わると増える。
+	 * @type {number}
+	 */
+	#Generation = 0;
+
+	/**
+	 * 書き込み用としてセクタのデータを取得した回数
+	 * 
+	 * WASM側でディレクトリとFATをキャッシュしているので、JavaScript側で書き換えたことを知らせるのに使う。
+	 * @type {number}
+	 */
+	#WriteCount = 0;
+
 	/**
 	 * フォーマットする
 	 * @param {number} TrackMax ディスクの最大トラック数
@@ -151,6 +167,45 @@ export class DiskImage {
 	 */
 	GetSectors() { return this.#Sectors; }
 
+	/**
+	 * セクタを作り直した回数を取得する
+	 * @returns {number} セクタを作り直した回数
+	 */
+	GetGeneration() { return this.#Generation; }
+
+	/**
+	 * 書き込み用としてセクタのデータを取得した回数を取得する
+	 * @returns {number} 書き込み用としてセクタのデータを取得した回数
+	 */
+	GetWriteCount() { return this.#WriteCount; }
+
+	/**
+	 * 全セクタのデータ部分を、外部のメモリと共有する
+	 * @param {function(number):Uint8Array} getData セクタ番号から、共有するメモリを取得する関数
+	 * @returns {boolean} 共有できたら true を返す(サイズが違うセクタがあれば、何もしないで false を返す)
+	 */
+	BindSectorData(getData) {
+		const data = this.#Sectors.map((sector, i) => getData(i));
+		for(let i = 0; i < this.#Sectors.length; ++i) {
+			if(data[i].length != this.#Sectors[i].GetDataForRead().length) {
+				return false;
+			}
+		}
+		for(let i = 0; i < this.#Sectors.length; ++i) {
+			this.#Sectors[i].BindData(data[i]);
+		}
+		return true;
+	}
+
+	/**
+	 * 全セクタのデータ部分の共有をやめる
+	 */
+	UnbindSectorData() {
+		for(const sector of this.#Sectors) {
+			sector.UnbindData();
+		}
+	}
+
 	/**
 	 * ログ管理を取得する
 	 * @returns {Log} ログ管理
@@ -166,6 +221,7 @@ export class DiskImage {
 	 * @returns {DataController} データコントローラ
 	 */
 	GetDataControllerForWrite(Sector) {
+		this.#WriteCount++;
 		return new DataController(this.#Sectors[Sector].GetDataForWrite());
 	}
 
@@ -184,6 +240,7 @@ export class DiskImage {
 	 * @returns {Uint8Array} セクタのデータ部分
 	 */
 	GetSectorDataForWrite(Sector) {
+		this.#WriteCount++;
 		return this.#Sectors[Sector].GetDataForWrite();
 	}
 
@@ -194,6 +251,7 @@ export class DiskImage {
 	 * @returns {boolean} 処理結果
 	 */
 	Read(fs, isPlainFormat) {
+		this.#Generation++;
 		// イメージ読み込む
 		let diskImageReader = this.#createDiskImageReader(isPlainFormat);
 		return diskImageReader.read(fs, this);
@@ -215,6 +273,7 @@ export class DiskImage {
 	 * 物理フォーマット
 	 */
 	Format() {
+		this.#Generation++;
 		this.#TrackFormat(this.DiskType.GetMaxTrackSize(), this.DiskType.GetTrackPerSector(), this.DiskType.GetDataSize());
 	}
 
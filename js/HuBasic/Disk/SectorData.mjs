@@ -261,6 +261,21 @@ export class SectorData {
 	 */
 	GetDataForRead() { return this.#Data; }
 
+	/**
+	 * データ部分を、外部のメモリ(WASM側のディスクイメージなど)と共有する
+	 * 
+	 * 以降の読み書きは、共有したメモリに対して行う。
+	 * @param {Uint8Array} Data 共有するメモリ(同じ内容で、同じサイズであること)
+	 */
+	BindData(Data) { this.#Data = Data; }
+
+	/**
+	 * データ部分の共有をやめる
+	 * 
+	 * 共有していたメモリの内容をコピーして、以降はそちらを使う。
+	 */
+	UnbindData() { this.#Data = this.#Data.slice(); }
+
 	/**
 	 * データ部分全体を指定された値で埋める
 	 * @param {number} Value 埋める値
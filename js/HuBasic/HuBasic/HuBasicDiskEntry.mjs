@@ -788,4 +788,45 @@ export default class {
 	{
 		return this.DiskImage.GetDiskImageFileSize(IsPlainFormat);
 	}
+
+	/**
+	 * セクタの数を取得する
+	 * @returns {number} セクタの数
+	 */
+	GetSectorCount() { return this.DiskImage.GetSectors().length; }
+
+	/**
+	 * セクタを作り直した回数を取得する
+	 * @returns {number} セクタを作り直した回数
+	 */
+	GetGeneration() { return this.DiskImage.GetGeneration(); }
+
+	/**
+	 * 書き込み用としてセクタのデータを取得した回数を取得する
+	 * @returns {number} 書き込み用としてセクタのデータを取得した回数
+	 */
+	GetWriteCount() { return this.DiskImage.GetWriteCount(); }
+
+	/**
+	 * 全セクタのデータ部分を、外部のメモリと共有する
+	 * @param {function(number):Uint8Array} getData セクタ番号から、共有するメモリを取得する関数
+	 * @returns {boolean} 共有できたら true を返す
+	 */
+	BindSectorData(getData) {
+		if(!this.DiskImage.BindSectorData(getData)) {
+			return false;
+		}
+		// FAT領域のキャッシュは前のデータを指しているので作り直す
+		if(this.DiskParameter) { this.#SetAllocateController(); }
+		return true;
+	}
+
+	/**
+	 * 全セクタのデータ部分の共有をやめる
+	 */
+	UnbindSectorData() {
+		this.DiskImage.UnbindSectorData();
+		// FAT領域のキャッシュは前のデータを指しているので作り直す
+		if(this.DiskParameter) { this.#SetAllocateController(); }
+	}
 };
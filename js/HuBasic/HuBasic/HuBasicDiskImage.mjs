@@ -109,6 +109,40 @@ export default class {
 		return fs.GetBuffer();
 	}
 
+	/**
+	 * セクタの数を取得する
+	 * @returns {number} セクタの数
+	 */
+	GetSectorCount() { return this.#DiskEntry.GetSectorCount(); }
+
+	/**
+	 * セクタを作り直した回数を取得する
+	 * 
+	 * ディスクを読み込んだり、フォーマットすると増える。
+	 * @returns {number} セクタを作り直した回数
+	 */
+	GetGeneration() { return this.#DiskEntry.GetGeneration(); }
+
+	/**
+	 * 書き込み用としてセクタのデータを取得した回数を取得する
+	 * 
+	 * ファイルを書き込んだり消したりすると増える。
+	 * @returns {number} 書き込み用としてセクタのデータを取得した回数
+	 */
+	GetWriteCount() { return this.#DiskEntry.GetWriteCount(); }
+
+	/**
+	 * 全セクタのデータ部分を、外部のメモリ(WASM側のディスクイメージ)と共有する
+	 * @param {function(number):Uint8Array} getData セクタ番号から、共有するメモリを取得する関数
+	 * @returns {boolean} 共有できたら true を返す
+	 */
+	BindSectorData(getData) { return this.#DiskEntry.BindSectorData(getData); }
+
+	/**
+	 * 全セクタのデータ部分の共有をやめる
+	 */
+	UnbindSectorData() { this.#DiskEntry.UnbindSectorData(); }
+
 	/**
 	 * マウント
 	 */
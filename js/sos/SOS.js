@@ -157,6 +157,30 @@ class SOS {
 		this.#memWriteU16(this.wrkReadXYADR(), (position.x & 0xFF) | ((position.y & 0xFF) << 8));
 	}
 
+	/**
+	 * WASM側のリングバッファにためておいたコンソールへの出力を表示する
+	 * 
+	 * 0x00の後ろの2バイトはカーソル位置(x,y)の設定、それ以外はPRINTする文字コード
+	 * @param {TaskContext} ctx 
+	 * @param {Uint8Array} data リングバッファのデータ(サイズは2のべき乗)
+	 * @param {number} read 読み込み位置
+	 * @param {number} write 書き込み位置
+	 */
+	drainConsole(ctx, data, read, write)
+	{
+		const mask = data.length - 1;
+		const size = (write - read) >>> 0;
+		for(let i = 0; i < size; ++i) {
+			const code = data[(read + i) & mask];
+			if(code == 0x00) {
+				ctx.setScreenLocate({x: data[(read + i + 1) & mask], y: data[(read + i + 2) & mask]});
+				i += 2;
+			} else {
+				ctx.PRINT(code);
+			}
+		}
+	}
+
 	/**
 	 * 文字が16進数で使用されている文字列かどうかを調べる
 	 * @param {number} value 文字
@@ -2145,7 +2169,7 @@ class SOS {
 		} else {
 			// 見つからなかった 新しくファイルを作成する
 			res = this.#dos_fresch(ctx); // 空き見つける
-			if(res.result != 0) {
+			if(res.result != 0 || !res.found) {
 				this.#setA(SOSErrorCode.DeviceFull); // Device full ディスクが一杯
 				this.#setCY();
 				return false; // エラー
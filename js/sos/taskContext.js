@@ -267,6 +267,11 @@ class TaskContext {
 	 */
 	changeScreenSize(width, height) {
 		this.catTextScreen.changeScreenSize(width, height);
+		// 画面範囲は全面に戻っている
+		this.z80Emu.setConsoleWindow({
+			top: 0, left: 0,
+			bottom: this.catTextScreen.getScreenHeight(), right: this.catTextScreen.getScreenWidth()
+		});
 		// スタイルを変更して、スケーリング
 		const elem = document.getElementById("sos_output");
 		elem.style.transform = "scale("
@@ -334,6 +339,7 @@ class TaskContext {
 			};
 		}
 		this.catTextScreen.setWindowRange(range);
+		this.z80Emu.setConsoleWindow(range);
 	}
 
 	// 漢字モード　トグル
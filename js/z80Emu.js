@@ -22,6 +22,18 @@ class Z80Emu {
 	 */
 	#Z80Regs;
 
+	/**
+	 * ペアのレジスタの中で、上位のレジスタ(A, B, D, H)のバイトの位置
+	 * @type {number}
+	 */
+	#pairHigh;
+
+	/**
+	 * ペアのレジスタの中で、下位のレジスタ(F, C, E, L)のバイトの位置
+	 * @type {number}
+	 */
+	#pairLow;
+
 	/**
 	 * メインメモリ
 	 * @type {Uint8Array}
@@ -34,6 +46,28 @@ class Z80Emu {
 	 */
 	#IO8;
 
+	/**
+	 * コンソールへの出力のリングバッファ(読み込み位置,書き込み位置)
+	 * @type {Uint32Array}
+	 */
+	#consoleRing;
+
+	/**
+	 * コンソールへの出力のリングバッファのデータ
+	 * 
+	 * サイズはsos.hのSOS_CONSOLE_RING_SIZEと同じ
+	 * @type {Uint8Array}
+	 */
+	#consoleData;
+
+	/**
+	 * WASM側にマウントしたディスク
+	 * 
+	 * ドライブ(A～E)ごとに、マウントしたディスクイメージと、その時のセクタを作り直した回数
+	 * @type {{image:HuBasicDiskImage, generation:number, mounted:boolean}[]}
+	 */
+	#nativeDisks = [];
+
 	/**
 	 * 外部とのアクセス用
 	 */
@@ -74,7 +108,11 @@ class Z80Emu {
 			// メモリ
 			env: { memory: this.#memory },
 			// S-OSのサブルーチン群
+			// メモ）レジスタとRAMしか使わないもの(#PRINT、#MSG、#HEX、#PEEKなど)はWASM側で処理しているが、
+			//       作り直す前のsos.wasmはまだ呼び出すので残しておく(使われないものは無視される)
 			sos: {
+				// WASM側でためておいたコンソールへの出力
+				flushConsole:(ring)=>{ this.drainConsole(this.#ctx); },
 				cold  :()=>{ this.#sos.sos_cold  (this.#ctx); },
 				hot   :()=>{ this.#sos.sos_hot   (this.#ctx); },
 				ver   :()=>{ this.#sos.sos_ver   (this.#ctx); },
@@ -210,8 +248,12 @@ class Z80Emu {
 		this.#gamePad = gamePad;
 
 		this.#Z80Regs = null;
+		this.#pairHigh = 0;
+		this.#pairLow  = 1;
 		this.#RAM8    = null;
 		this.#IO8     = null;
+		this.#consoleRing = null;
+		this.#consoleData = null;
 	}
 
 	/**
@@ -219,6 +261,8 @@ class Z80Emu {
 	 * @param {number} platformID 機種ID
 	 */
 	reset(ctx, platformID) {
+		// WASM側のディスクイメージはリセットで解放されるので、先に共有をやめておく
+		this.#unmountNativeDisks();
 		// リセット
 		this.wasm.z80Reset(platformID);
 		// 各種アドレスをキャッシュしておく
@@ -226,8 +270,17 @@ class Z80Emu {
 		const memPtrRAM  = this.wasm.getRAM();
 		const memPtrIO   = this.wasm.getIO();
 		this.#Z80Regs    = new Uint8Array(this.#memory.buffer, memPtrRegs, this.wasm.getZ80RegsSize());
+		// メモ）作り直す前のsos.wasmは、ペアの上位のレジスタが先に並んでいる
+		this.#pairHigh   = this.wasm.getZ80PairHighOffset ? this.wasm.getZ80PairHighOffset() : 0;
+		this.#pairLow    = this.#pairHigh ^ 1;
 		this.#RAM8       = new Uint8Array(this.#memory.buffer, memPtrRAM, 0x10000);
 		this.#IO8        = new Uint8Array(this.#memory.buffer, memPtrIO, 0x10000);
+		// メモ）作り直す前のsos.wasmにはリングバッファがない(表示はJavaScript側で直接している)
+		if(this.wasm.getConsoleRing) {
+			const memPtrConsole = this.wasm.getConsoleRing();
+			this.#consoleRing = new Uint32Array(this.#memory.buffer, memPtrConsole, 2);
+			this.#consoleData = new Uint8Array(this.#memory.buffer, memPtrConsole + 8, 0x4000);
+		}
 
 		// CGROM
 		{
@@ -250,8 +303,134 @@ class Z80Emu {
 	update(ctx, clock) {
 		this.#ctx = ctx;
 		this.#audio.reset(); // 音の生成側と同期
+		this.#syncNativeDisks(ctx);
 		this.wasm.exeute(-1);
-		return this.wasm.exeute(clock | 0);
+		if(this.wasm.getStatus() == 2 && this.wasm.resumeFromHost) {
+			// フックの処理を待っている間はCPUが止まっているので、1フレームに1回だけフックを呼び出して完了したか確認させる
+			// メモ）2はsos.hのSOS_STATUS_WAIT_HOST。作り直す前のsos.wasmは、止まらずにフックを呼び出し続けるので2にならない
+			this.wasm.resumeFromHost();
+		}
+		const result = this.wasm.exeute(clock | 0);
+		// 1フレーム分のコンソールへの出力をまとめて表示する
+		this.drainConsole(ctx);
+		this.#notifyNativeDiskWrites(ctx);
+		return result;
+	}
+
+	/**
+	 * マウントされているディスクを、WASM側にもマウントする
+	 * 
+	 * WASM側にマウントしたドライブの#DREAD、#DWRITE、#DRDSB、#DWTSBは、JavaScript側を呼び出さずにWASM側で処理される。
+	 * セクタのデータはWASM側のディスクイメージと共有するので、JavaScript側でファイルを書き込んでも内容は一致している。
+	 * @param {*} ctx 
+	 */
+	#syncNativeDisks(ctx) {
+		if(!this.wasm.mountDisk) {
+			return; // 作り直す前のsos.wasmなので、今まで通り全てJavaScript側で処理する
+		}
+		const diskManager = ctx.diskManager;
+		for(let drive = 0; drive < diskManager.length && drive < 5; ++drive) {
+			const disk = diskManager[drive];
+			const native = this.#nativeDisks[drive];
+			if(!disk.isMount()) {
+				if(native) { this.#unmountNativeDisk(drive); }
+				continue;
+			}
+			const image = disk.Image;
+			if(native && native.image === image && native.generation == image.GetGeneration()) {
+				if(native.writeCount != image.GetWriteCount()) {
+					// JavaScript側でファイルを書き換えたので、WASM側のディレクトリとFATのキャッシュを作り直させる
+					native.writeCount = image.GetWriteCount();
+					// メモ）touchDisk()がないsos.wasmは、ファイルの#ROPEN、#RDD、#WOPEN、#WRDをJavaScript側で処理しているので知らせなくてよい
+					if(native.mounted && this.wasm.touchDisk) { this.wasm.touchDisk(drive); }
+				}
+				continue; // 変わっていない
+			}
+			// 読み込み直したりフォーマットしたので、マウントし直す
+			if(native) { this.#unmountNativeDisk(drive); }
+			this.#nativeDisks[drive] = { image: image, generation: image.GetGeneration(), writeCount: image.GetWriteCount(), mounted: this.#mountNativeDisk(drive, image) };
+		}
+	}
+
+	/**
+	 * ディスクイメージをWASM側にマウントして、セクタのデータを共有する
+	 * @param {number} drive ドライブ(0:A ～ 4:E)
+	 * @param {HuBasicDiskImage} image ディスクイメージ
+	 * @returns {boolean} マウントできたら true を返す(できなければ、今まで通りJavaScript側で処理する)
+	 */
+	#mountNativeDisk(drive, image) {
+		const data = image.WriteImage(false); // D88形式
+		const imagePtr = this.wasm.allocateDiskImage(data.length);
+		new Uint8Array(this.#memory.buffer, imagePtr, data.length).set(data);
+		if(!this.wasm.mountDisk(drive, imagePtr, data.length)) {
+			return false;
+		}
+		// レコード番号とセクタの並びが一致していることを確認してから共有する
+		if(this.wasm.getDiskRecordCount(drive) != image.GetSectorCount()
+			|| !image.BindSectorData((record)=>new Uint8Array(this.#memory.buffer, this.wasm.getDiskRecord(drive, record), this.wasm.getDiskRecordSize(drive, record)))) {
+			this.wasm.unmountDisk(drive);
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * ディスクイメージをWASM側からアンマウントする
+	 * @param {number} drive ドライブ(0:A ～ 4:E)
+	 */
+	#unmountNativeDisk(drive) {
+		const native = this.#nativeDisks[drive];
+		if(native.mounted) {
+			native.image.UnbindSectorData();
+			this.wasm.unmountDisk(drive);
+		}
+		this.#nativeDisks[drive] = null;
+	}
+
+	/**
+	 * 全てのディスクイメージをWASM側からアンマウントする
+	 */
+	#unmountNativeDisks() {
+		for(let drive = 0; drive < this.#nativeDisks.length; ++drive) {
+			if(this.#nativeDisks[drive]) { this.#unmountNativeDisk(drive); }
+		}
+		this.#nativeDisks = [];
+	}
+
+	/**
+	 * WASM側で書き込んだレコードを、ディスクに書き込んだことにする
+	 * 
+	 * データは共有しているので同じ内容を書き込み直して、保存が必要になったことを知らせる。
+	 * @param {*} ctx 
+	 */
+	#notifyNativeDiskWrites(ctx) {
+		for(let drive = 0; drive < this.#nativeDisks.length; ++drive) {
+			const native = this.#nativeDisks[drive];
+			if(!native || !native.mounted || this.wasm.getDiskDirtyCount(drive) == 0) {
+				continue;
+			}
+			const disk = ctx.diskManager[drive];
+			const recordCount = this.wasm.getDiskRecordCount(drive);
+			for(let record = 0; record < recordCount; ++record) {
+				if(this.wasm.isDiskRecordDirty(drive, record)) {
+					disk.WriteRecord(record, new Uint8Array(this.#memory.buffer, this.wasm.getDiskRecord(drive, record), 0x100).slice());
+				}
+			}
+			this.wasm.clearDiskDirty(drive);
+			native.writeCount = native.image.GetWriteCount(); // WASM側で書き込んだものなので、知らせなくてよい
+		}
+	}
+
+	/**
+	 * WASM側のリングバッファにたまっているコンソールへの出力を表示する
+	 * @param {*} ctx 
+	 */
+	drainConsole(ctx) {
+		const ring = this.#consoleRing;
+		if(ring && ring[0] != ring[1]) {
+			this.#sos.drainConsole(ctx, this.#consoleData, ring[0], ring[1]);
+			ring[0] = ring[1];
+		}
 	}
 
 	/**
@@ -341,6 +520,20 @@ class Z80Emu {
 		return 0;
 	}
 
+	/**
+	 * 理論画面範囲を設定する
+	 * 
+	 * WASM側で表示系のサブルーチンのカーソル位置を進める時に使う
+	 * @param {{left: number, top: number, right: number, bottom: number}} range 理論画面範囲
+	 */
+	setConsoleWindow(range)
+	{
+		// メモ）作り直す前のsos.wasmにはないので、その時はJavaScript側だけで処理する
+		if(this.wasm && this.wasm.setConsoleWindow) {
+			this.wasm.setConsoleWindow(range.left, range.top, range.right, range.bottom);
+		}
+	}
+
 	setPCG(codePoint, data)
 	{
 		const scratchMemory   = this.wasm.getScratchMemory();
@@ -478,36 +671,36 @@ class Z80Emu {
 	//  Z80レジスタアクセス
 	// -------------------------------------------------------------------------------------------------
 	
-	setA(A) { this.#Z80Regs[0] = A; }
-	getA() { return this.#Z80Regs[0]; }
-	setF(F) { this.#Z80Regs[1] = F; }
-	setCY() { this.#Z80Regs[1] |= 1; }
-	clearCY() { this.#Z80Regs[1] &= ~1; }
-	setZ() { this.#Z80Regs[1] |= 0x40; }
-	clearZ() { this.#Z80Regs[1] &= ~0x40; }
-	getF() { return this.#Z80Regs[1]; }
-	getCY() { return (this.#Z80Regs[1] & 1) ? true : false; }
-	setB(B) { this.#Z80Regs[2] = B; }
-	getB() { return this.#Z80Regs[2]; }
-	setC(C) { this.#Z80Regs[3] = C; }
-	getC() { return this.#Z80Regs[3]; }
-	setD(D) { this.#Z80Regs[4] = D; }
-	getD() { return this.#Z80Regs[4]; }
-	setE(E) { this.#Z80Regs[5] = E; }
-	getE() { return this.#Z80Regs[5]; }
-	setH(H) { this.#Z80Regs[6] = H; }
-	getH() { return this.#Z80Regs[6]; }
-	setL(L) { this.#Z80Regs[7] = L; }
-	getL() { return this.#Z80Regs[7]; }
-
-	setAF(AF) { this.#Z80Regs[0] = AF >> 8; this.#Z80Regs[1] = AF; }
-	getAF() { return (this.#Z80Regs[0] << 8) | this.#Z80Regs[1]; }
-	setBC(BC) { this.#Z80Regs[2] = BC >> 8; this.#Z80Regs[3] = BC; }
-	getBC() { return (this.#Z80Regs[2] << 8) | this.#Z80Regs[3]; }
-	setDE(DE) { this.#Z80Regs[4] = DE >> 8; this.#Z80Regs[5] = DE; }
-	getDE() { return (this.#Z80Regs[4] << 8) | this.#Z80Regs[5]; }
-	setHL(HL) { this.#Z80Regs[6] = HL >> 8; this.#Z80Regs[7] = HL; }
-	getHL() { return (this.#Z80Regs[6] << 8) | this.#Z80Regs[7]; }
+	setA(A) { this.#Z80Regs[this.#pairHigh] = A; }
+	getA() { return this.#Z80Regs[this.#pairHigh]; }
+	setF(F) { this.#Z80Regs[this.#pairLow] = F; }
+	setCY() { this.#Z80Regs[this.#pairLow] |= 1; }
+	clearCY() { this.#Z80Regs[this.#pairLow] &= ~1; }
+	setZ() { this.#Z80Regs[this.#pairLow] |= 0x40; }
+	clearZ() { this.#Z80Regs[this.#pairLow] &= ~0x40; }
+	getF() { return this.#Z80Regs[this.#pairLow]; }
+	getCY() { return (this.#Z80Regs[this.#pairLow] & 1) ? true : false; }
+	setB(B) { this.#Z80Regs[2 + this.#pairHigh] = B; }
+	getB() { return this.#Z80Regs[2 + this.#pairHigh]; }
+	setC(C) { this.#Z80Regs[2 + this.#pairLow] = C; }
+	getC() { return this.#Z80Regs[2 + this.#pairLow]; }
+	setD(D) { this.#Z80Regs[4 + this.#pairHigh] = D; }
+	getD() { return this.#Z80Regs[4 + this.#pairHigh]; }
+	setE(E) { this.#Z80Regs[4 + this.#pairLow] = E; }
+	getE() { return this.#Z80Regs[4 + this.#pairLow]; }
+	setH(H) { this.#Z80Regs[6 + this.#pairHigh] = H; }
+	getH() { return this.#Z80Regs[6 + this.#pairHigh]; }
+	setL(L) { this.#Z80Regs[6 + this.#pairLow] = L; }
+	getL() { return this.#Z80Regs[6 + this.#pairLow]; }
+
+	setAF(AF) { this.setA(AF >> 8); this.setF(AF); }
+	getAF() { return (this.getA() << 8) | this.getF(); }
+	setBC(BC) { this.setB(BC >> 8); this.setC(BC); }
+	getBC() { return (this.getB() << 8) | this.getC(); }
+	setDE(DE) { this.setD(DE >> 8); this.setE(DE); }
+	getDE() { return (this.getD() << 8) | this.getE(); }
+	setHL(HL) { this.setH(HL >> 8); this.setL(HL); }
+	getHL() { return (this.getH() << 8) | this.getL(); }
 	setPC(PC) { this.#Z80Regs[16] = PC; this.#Z80Regs[17] = PC >> 8; }
 	getPC() { return (this.#Z80Regs[17] << 8) | this.#Z80Regs[16]; }
 	setSP(SP) { this.#Z80Regs[18] = SP; this.#Z80Regs[19] = SP >> 8; }
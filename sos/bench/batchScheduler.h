@@ -0,0 +1,131 @@
+﻿#pragma once
+
+#include "../src/cat/low/catLowBasicTypes.h"
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief ワークスティーリングのジョブスケジューラ
+ *
+ * ジョブの番号を連続した塊にして各スレッドのキューに配り、各スレッドは自分のキューの先頭から順に処理する。
+ * 自分のキューが空になったら、他のスレッドのキューの末尾から1つずつ盗んで処理する。
+ * タイトルごとに実行時間がばらばらでも、最後まで全てのスレッドが働くようにしている。
+ */
+class BatchScheduler {
+	/**
+	 * @brief スレッドごとのジョブのキュー
+	 */
+	struct Queue {
+		std::mutex mutex;
+		std::deque<u32> jobs;
+	};
+
+	/**
+	 * @brief スレッドごとのジョブのキュー
+	 */
+	std::vector<Queue> queues;
+	/**
+	 * @brief 他のスレッドから盗んだジョブの数
+	 */
+	std::atomic<u32> stealCount;
+
+	/**
+	 * @brief 自分のキューの先頭からジョブを取り出す
+	 * @param[in]	worker	スレッドの番号
+	 * @param[out]	job		ジョブの番号
+	 * @return 取り出せたらtrue
+	 */
+	bool pop(const u32 worker, u32& job)
+	{
+		Queue& queue = queues[worker];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if(queue.jobs.empty()) {
+			return false;
+		}
+		job = queue.jobs.front();
+		queue.jobs.pop_front();
+		return true;
+	}
+	/**
+	 * @brief 他のスレッドのキューの末尾からジョブを盗む
+	 * @param[in]	worker	スレッドの番号
+	 * @param[out]	job		ジョブの番号
+	 * @return 盗めたらtrue(false:全てのキューが空)
+	 */
+	bool steal(const u32 worker, u32& job)
+	{
+		const u32 count = (u32)queues.size();
+		for(u32 i = 1; i < count; ++i) {
+			Queue& queue = queues[(worker + i) % count];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if(!queue.jobs.empty()) {
+				job = queue.jobs.back();
+				queue.jobs.pop_back();
+				stealCount++;
+				return true;
+			}
+		}
+		return false;
+	}
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param[in]	threadCount	スレッド数(0:コア数)
+	 */
+	explicit BatchScheduler(u32 threadCount)
+		: queues(threadCount ? threadCount : (std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1))
+		, stealCount(0)
+	{
+	}
+
+	/**
+	 * @brief スレッド数を取得する
+	 * @return スレッド数
+	 */
+	u32 getThreadCount() const noexcept { return (u32)queues.size(); }
+	/**
+	 * @brief 他のスレッドから盗んだジョブの数を取得する
+	 * @return 盗んだジョブの数
+	 */
+	u32 getStealCount() const noexcept { return stealCount; }
+
+	/**
+	 * @brief 全てのジョブを処理する
+	 *
+	 * 全てのジョブが終わるまで戻らない。
+	 * @param[in]	jobCount	ジョブの数(ジョブの番号は0～jobCount-1)
+	 * @param[in]	func		ジョブの処理 void(u32 job, u32 worker)
+	 */
+	template<typename Functor>
+	void run(const u32 jobCount, Functor func)
+	{
+		const u32 threadCount = getThreadCount();
+		for(u32 i = 0; i < threadCount; ++i) {
+			// 連続した塊で配る(スレッドiには[jobCount*i/threadCount, jobCount*(i+1)/threadCount))
+			const u32 begin = (u32)((u64)jobCount * i / threadCount);
+			const u32 end = (u32)((u64)jobCount * (i + 1) / threadCount);
+			for(u32 job = begin; job < end; ++job) {
+				queues[i].jobs.push_back(job);
+			}
+		}
+		auto worker = [this, &func](const u32 index) {
+			u32 job;
+			while(pop(index, job) || steal(index, job)) {
+				func(job, index);
+			}
+		};
+		std::vector<std::thread> threads;
+		for(u32 i = 1; i < threadCount; ++i) {
+			threads.emplace_back(worker, i);
+		}
+		// 呼び出したスレッドも0番として働く
+		worker(0);
+		for(auto& it : threads) {
+			it.join();
+		}
+	}
+};
@@ -0,0 +1,40 @@
+﻿#include "benchAudio.h"
+#include "../src/emu2413/emu2149.h"
+
+// メモ）sos.hのSoundDeviceNoはPSGという名前がemu2149と衝突するので、ここでは番号で扱う
+static constexpr s32 SOUND_DEVICE_PSG = 0;
+
+BenchAudio::BenchAudio(const u32 sampleRate)
+	: psg(PSG_new(PSG_CLOCK, sampleRate))
+	, checksum(0)
+	, writeCount(0)
+{
+	// js/cat/catAudioWorkletProcessor.jsと同じ設定
+	PSG_setVolumeMode((PSG*)psg, 2);
+	PSG_reset((PSG*)psg);
+}
+
+BenchAudio::~BenchAudio()
+{
+	if(psg) {
+		PSG_delete((PSG*)psg);
+		psg = nullptr;
+	}
+}
+
+void
+BenchAudio::writeRegister(const s32 no, const u8 reg, const u8 value)
+{
+	if(no == SOUND_DEVICE_PSG) {
+		PSG_writeReg((PSG*)psg, reg, value);
+		writeCount++;
+	}
+}
+
+void
+BenchAudio::generate(const u32 samples)
+{
+	for(u32 i = 0; i < samples; ++i) {
+		checksum += PSG_calc((PSG*)psg);
+	}
+}
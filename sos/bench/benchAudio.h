@@ -0,0 +1,64 @@
+﻿#pragma once
+
+#include "../src/cat/low/catLowBasicTypes.h"
+
+/**
+ * @brief ベンチマーク用の音の生成
+ *
+ * Web版ではJavaScript側(psg.wasm)で行っている音の生成を、同じPSGのエミュレータで行い、負荷を測る。
+ * OPMはfmgenがWindows専用なので対象外。
+ */
+class BenchAudio {
+	/**
+	 * @brief PSGのエミュレータ
+	 */
+	void* psg;
+	/**
+	 * @brief 生成したサンプルの合計(最適化で生成が省かれないように)
+	 */
+	s64 checksum;
+	/**
+	 * @brief PSGに書き込んだ回数(0なら、チェックサムは何も確かめていない)
+	 */
+	u32 writeCount;
+public:
+	/**
+	 * @brief PSGに供給されているクロックの周波数(Hz)
+	 */
+	static constexpr u32 PSG_CLOCK = 2000000;
+
+	/**
+	 * @brief コンストラクタ
+	 * @param[in]	sampleRate	サンプリングレート(Hz)
+	 */
+	BenchAudio(const u32 sampleRate);
+	/**
+	 * @brief デストラクタ
+	 */
+	~BenchAudio();
+
+	/**
+	 * @brief サウンドチップのレジスタに書き込む
+	 * @param[in]	no		サウンドデバイスの番号(SoundDeviceNo)
+	 * @param[in]	reg		レジスタ番号
+	 * @param[in]	value	書き込む値
+	 */
+	void writeRegister(const s32 no, const u8 reg, const u8 value);
+	/**
+	 * @brief 音を生成する
+	 * @param[in]	samples	生成するサンプル数
+	 */
+	void generate(const u32 samples);
+	/**
+	 * @brief 生成したサンプルの合計を取得する
+	 * @return 生成したサンプルの合計
+	 */
+	s64 getChecksum() const noexcept { return checksum; }
+	/**
+	 * @brief PSGに書き込んだ回数を取得する
+	 *
+	 * PSG以外(OPM、MZ-700の8253など)への書き込みは、音を生成しないので数えない。
+	 * @return PSGに書き込んだ回数
+	 */
+	u32 getWriteCount() const noexcept { return writeCount; }
+};
@@ -0,0 +1,273 @@
+﻿#include "benchUtil.h"
+#include "../src/z80/z80.hpp"
+#include "../src/sos.h"
+#include "../src/sosMachine.h"
+#include "../src/platform/catPlatformFactory.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	/**
+	 * @brief 機種の名前
+	 */
+	struct PlatformName {
+		const char* name;
+		CatPlatformFactory::PlatformID id;
+	};
+	constexpr PlatformName platformNames[] = {
+		{ "MZ700",				CatPlatformFactory::PlatformID::MZ700 },
+		{ "MZ1500",				CatPlatformFactory::PlatformID::MZ1500 },
+		{ "X1",					CatPlatformFactory::PlatformID::X1 },
+		{ "X1TURBO",			CatPlatformFactory::PlatformID::X1TURBO },
+		{ "X1TURBO_SPEEDUP",	CatPlatformFactory::PlatformID::X1TURBO_SPEEDUP },
+	};
+} // namespace
+
+u64
+bench::fnv1a(const void* data, size_t size, u64 hash)
+{
+	const u8* p = (const u8*)data;
+	for(size_t i = 0; i < size; ++i) {
+		hash ^= p[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+u64
+bench::hashMachine(SOS_Machine& machine)
+{
+	u64 hash = fnv1a(machine.getRAM(), 0x10000);
+	hash = fnv1a(machine.getIO(), 0x20000, hash);
+	return fnv1a(machine.getZ80Regs(), machine.getZ80RegsSize(), hash);
+}
+
+bool
+bench::readFile(const char* path, std::vector<u8>& data)
+{
+	FILE* fp = fopen(path, "rb");
+	if(!fp) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return false;
+	}
+	data.clear();
+	for(int ch; (ch = fgetc(fp)) != EOF; ) {
+		data.push_back((u8)ch);
+	}
+	fclose(fp);
+	return true;
+}
+
+bool
+bench::writeFile(const char* path, const void* data, size_t size)
+{
+	FILE* fp = fopen(path, "wb");
+	if(!fp) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return false;
+	}
+	const bool result = fwrite(data, 1, size, fp) == size;
+	fclose(fp);
+	return result;
+}
+
+bool
+bench::writeScreenshot(const char* path, const void* image)
+{
+	FILE* fp = fopen(path, "wb");
+	if(!fp) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return false;
+	}
+	fprintf(fp, "P6\n%u %u\n255\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+	const u8* src = (const u8*)image;
+	bool result = true;
+	for(u32 i = 0; i < SCREEN_WIDTH * SCREEN_HEIGHT && result; ++i, src += 4) {
+		// RGBAのAは捨てる
+		result = fwrite(src, 1, 3, fp) == 3;
+	}
+	fclose(fp);
+	return result;
+}
+
+bool
+bench::equalsIgnoreCase(const char* a, const char* b)
+{
+	for(; *a && *b; ++a, ++b) {
+		if(toupper((u8)*a) != toupper((u8)*b)) { return false; }
+	}
+	return *a == *b;
+}
+
+const char*
+bench::getPlatformName(const s32 platformID)
+{
+	for(const auto& it : platformNames) {
+		if((s32)it.id == platformID) { return it.name; }
+	}
+	return "?";
+}
+
+bool
+bench::parsePlatform(const char* text, s32& platformID)
+{
+	for(const auto& it : platformNames) {
+		if(equalsIgnoreCase(it.name, text)) {
+			platformID = (s32)it.id;
+			return true;
+		}
+	}
+	char* end;
+	const long value = strtol(text, &end, 0);
+	if(*end) {
+		return false;
+	}
+	platformID = (s32)value;
+	return true;
+}
+
+bool
+bench::loadProgram(const char* path, const u16 address, SOS_Machine& machine)
+{
+	std::vector<u8> data;
+	if(!readFile(path, data)) {
+		return false;
+	}
+
+	const char* ext = strrchr(path, '.');
+	if(ext && equalsIgnoreCase(ext, ".d88")) {
+		// メモ）ディスクイメージはプログラムではないので、-dでドライブにマウントしてから、ディスクを読むプログラムを実行する
+		fprintf(stderr, "D88 images cannot be run directly: mount them with -d <drive>:<image>\n");
+		return false;
+	}
+
+	u16 loadAddress = address;
+	u16 execAddress = address;
+	size_t offset = 0;
+	if(data.size() >= 18 && memcmp(data.data(), "_SOS", 4) == 0) {
+		loadAddress = (u16)strtol((const char*)data.data() + 8, nullptr, 16);
+		execAddress = (u16)strtol((const char*)data.data() + 13, nullptr, 16);
+		offset = 18;
+	}
+	u8* ram = machine.getRAM();
+	for(size_t i = offset; i < data.size(); ++i) {
+		ram[(u16)(loadAddress + i - offset)] = data[i];
+	}
+	// 0x0003はCALL #HOT
+	Z80::Register* reg = machine.getZ80Regs();
+	reg->SP = ADDRESS_STKAD - 2;
+	ram[reg->SP    ] = 0x03;
+	ram[reg->SP + 1] = 0x00;
+	reg->PC = execAddress;
+	return true;
+}
+
+bool
+bench::readStateFile(const char* path, std::vector<u8>& data, s32& platformID)
+{
+	if(!readFile(path, data)) {
+		return false;
+	}
+	if(data.size() < 16) {
+		fprintf(stderr, "invalid state %s\n", path);
+		return false;
+	}
+	memcpy(&platformID, data.data() + 8, sizeof(platformID));
+	return true;
+}
+
+bool
+bench::parseDriveFile(const char* text, s32& drive, const char*& path)
+{
+	const s32 letter = toupper((u8)text[0]);
+	if(letter < 'A' || 'A' + (s32)SOS_DISK_DRIVE_MAX <= letter || text[1] != ':' || !text[2]) {
+		return false;
+	}
+	drive = letter - 'A';
+	path = text + 2;
+	return true;
+}
+
+bool
+bench::MappedFile::open(const char* path)
+{
+	close();
+#ifdef _WIN32
+	HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(handle == INVALID_HANDLE_VALUE) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return false;
+	}
+	file = handle;
+	LARGE_INTEGER fileSize;
+	if(!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart == 0) {
+		fprintf(stderr, "cannot map %s\n", path);
+		close();
+		return false;
+	}
+	mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	data = mapping ? (const u8*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if(!data) {
+		fprintf(stderr, "cannot map %s\n", path);
+		close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+#else
+	const int fd = ::open(path, O_RDONLY);
+	if(fd < 0) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return false;
+	}
+	struct stat st;
+	void* mapped = MAP_FAILED;
+	if(fstat(fd, &st) == 0 && 0 < st.st_size) {
+		mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	// メモ）マップしたらファイルは閉じてよい
+	::close(fd);
+	if(mapped == MAP_FAILED) {
+		fprintf(stderr, "cannot map %s\n", path);
+		return false;
+	}
+	data = (const u8*)mapped;
+	size = (size_t)st.st_size;
+#endif
+	return true;
+}
+
+void
+bench::MappedFile::close()
+{
+#ifdef _WIN32
+	if(data) {
+		UnmapViewOfFile(data);
+	}
+	if(mapping) {
+		CloseHandle(mapping);
+		mapping = nullptr;
+	}
+	if(file) {
+		CloseHandle(file);
+		file = nullptr;
+	}
+#else
+	if(data) {
+		munmap((void*)data, size);
+	}
+#endif
+	data = nullptr;
+	size = 0;
+}
@@ -0,0 +1,148 @@
+﻿#pragma once
+
+#include "../src/cat/low/catLowBasicTypes.h"
+
+#include <vector>
+
+class SOS_Machine;
+
+/**
+ * @brief ベンチマークとバッチ実行で共通の処理
+ */
+namespace bench {
+	/**
+	 * @brief 1秒あたりのフレーム数
+	 */
+	constexpr s32 FRAME_RATE = 60;
+	/**
+	 * @brief 音のサンプリングレート(Hz)
+	 */
+	constexpr u32 SAMPLE_RATE = 48000;
+	/**
+	 * @brief 表示用に変換されたVRAMイメージの幅と高さ(RGBA)
+	 *
+	 * どの機種でも同じ(js/z80Emu.jsのgetVRAMImage()参照)。
+	 */
+	constexpr u32 SCREEN_WIDTH = 640;
+	constexpr u32 SCREEN_HEIGHT = 200;
+
+	/**
+	 * @brief FNV-1aでハッシュを計算する
+	 * @param[in]	data	データ
+	 * @param[in]	size	データのサイズ
+	 * @param[in]	hash	続けて計算する時は、前のハッシュ
+	 * @return ハッシュ
+	 */
+	u64 fnv1a(const void* data, size_t size, u64 hash = 1469598103934665603ull);
+	/**
+	 * @brief マシンのRAM・IO・レジスタのハッシュを計算する
+	 * @param[in]	machine	マシン
+	 * @return ハッシュ
+	 */
+	u64 hashMachine(SOS_Machine& machine);
+
+	/**
+	 * @brief ファイルを読み込む
+	 * @param[in]	path	ファイル名
+	 * @param[out]	data	読み込んだデータ
+	 * @return 読み込めたらtrue
+	 */
+	bool readFile(const char* path, std::vector<u8>& data);
+	/**
+	 * @brief ファイルに書き込む
+	 * @param[in]	path	ファイル名
+	 * @param[in]	data	データ
+	 * @param[in]	size	データのサイズ
+	 * @return 書き込めたらtrue
+	 */
+	bool writeFile(const char* path, const void* data, size_t size);
+	/**
+	 * @brief 表示用に変換されたVRAMイメージをPPM形式で書き込む
+	 * @param[in]	path	ファイル名
+	 * @param[in]	image	VRAMイメージ(SCREEN_WIDTH x SCREEN_HEIGHTのRGBA)
+	 * @return 書き込めたらtrue
+	 */
+	bool writeScreenshot(const char* path, const void* image);
+
+	/**
+	 * @brief 大文字と小文字を区別せずに比較する
+	 * @return 同じならtrue
+	 */
+	bool equalsIgnoreCase(const char* a, const char* b);
+	/**
+	 * @brief 機種の名前を取得する
+	 * @param[in]	platformID	機種の識別子
+	 * @return 機種の名前("?":知らない機種)
+	 */
+	const char* getPlatformName(const s32 platformID);
+	/**
+	 * @brief 機種の名前か番号から、機種の識別子を取得する
+	 * @param[in]	text		機種の名前か番号
+	 * @param[out]	platformID	機種の識別子
+	 * @return 取得できたらtrue
+	 */
+	bool parsePlatform(const char* text, s32& platformID);
+
+	/**
+	 * @brief プログラムを読み込んで、実行できる状態にする
+	 *
+	 * _SOSヘッダ("_SOS aa llll eeee\n")があれば、その読み込みアドレスと実行アドレスを使う。
+	 * 実行したプログラムから戻ったら、S-OSの#HOTに戻るようにしておく。
+	 * @param[in]		path	ファイル名
+	 * @param[in]		address	_SOSヘッダがない時の読み込み・実行アドレス
+	 * @param[in,out]	machine	読み込むマシン
+	 * @return 読み込めたらtrue
+	 */
+	bool loadProgram(const char* path, const u16 address, SOS_Machine& machine);
+	/**
+	 * @brief 保存した状態のファイルを読み込む
+	 *
+	 * 機種は保存したデータのヘッダ(magic,version,platformID,size)から取得する。
+	 * @param[in]	path		ファイル名
+	 * @param[out]	data		保存した状態
+	 * @param[out]	platformID	保存した時の機種
+	 * @return 読み込めたらtrue
+	 */
+	bool readStateFile(const char* path, std::vector<u8>& data, s32& platformID);
+
+	/**
+	 * @brief ドライブとファイル名("A:file")を分ける
+	 * @param[in]	text	ドライブとファイル名
+	 * @param[out]	drive	ドライブ(0:A ～ 4:E)
+	 * @param[out]	path	ファイル名(textの中を指す)
+	 * @return 分けられたらtrue
+	 */
+	bool parseDriveFile(const char* text, s32& drive, const char*& path);
+
+	/**
+	 * @brief 読み込み専用でメモリマップしたファイル
+	 *
+	 * ディスクイメージを、コピーせずに何台ものマシンで共有するのに使う(SOS_Machine::mountDiskCopyOnWrite())。
+	 */
+	class MappedFile {
+		const u8* data = nullptr;
+		size_t size = 0;
+#ifdef _WIN32
+		void* file = nullptr;
+		void* mapping = nullptr;
+#endif
+	public:
+		MappedFile() = default;
+		~MappedFile() { close(); }
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		/**
+		 * @brief ファイルをメモリマップする
+		 * @param[in]	path	ファイル名
+		 * @return マップできたらtrue
+		 */
+		bool open(const char* path);
+		/**
+		 * @brief マップを解除する
+		 */
+		void close();
+		const u8* getData() const noexcept { return data; }
+		size_t getSize() const noexcept { return size; }
+	};
+} // namespace bench
@@ -0,0 +1,543 @@
+﻿#include "../src/cat/low/catLowBasicTypes.h"
+#include "../src/z80/z80.hpp"
+#include "../src/sos.h"
+#include "../src/sosMachine.h"
+#include "../src/platform/catPlatformFactory.h"
+#include "benchAudio.h"
+#include "benchUtil.h"
+#include "batchScheduler.h"
+
+#include <chrono>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief ヘッドレスのバッチ実行
+ *
+ * ジョブのリスト(1行に1つ、SOSBenchと同じオプション)を読み込んで、全てのコアで並列に実行し、
+ * ジョブごとにRAM・IO・レジスタのハッシュ、最後の画面のハッシュ、生成した音のチェックサムを表示する。
+ * 画面と音は、ネイティブで扱っているものだけしか確かめられないので、何も出ていなければ"n/a"を表示する。
+ * (テキストはJavaScript側で描いているので画面に出ない。音はPSGだけで、MZ-700の8253などは含まない)
+ * 結果はジョブのリストの順に、実行時間を含めずに出力するので、ビルドごとの結果をそのままdiffで比較できる。
+ *
+ * スレッドごとに機種ごとのマシンを1台ずつ持っておき、作った直後の状態に戻して使い回す。
+ * ディスクイメージは1回だけメモリマップして全てのマシンで共有し、書き込みはマシンごとのオーバーレイに入れる。
+ */
+namespace {
+	using namespace bench;
+
+	/**
+	 * @brief ジョブ
+	 */
+	struct Job {
+		std::string file;			// 実行するファイル
+		std::string state;			// 読み込む状態のファイル(saveState()で保存したもの)
+		std::string replay;			// 再生する入力のファイル(getInputTimeline()で取得したもの)
+		std::string screenshot;		// 最後の画面を書き出すファイル(PPM)
+		std::string disks[SOS_DISK_DRIVE_MAX];		// ドライブ(A～E)にマウントするディスクイメージのファイル
+		std::string commits[SOS_DISK_DRIVE_MAX];	// 書き込んだ内容も入れたディスクイメージを書き出すファイル
+		const MappedFile* diskFiles[SOS_DISK_DRIVE_MAX] = {};	// メモリマップしたディスクイメージ(DiskCacheが持っている)
+		s32 platformID = (s32)CatPlatformFactory::PlatformID::X1;
+		s32 frames = 600;			// 実行するフレーム数
+		s32 clock = 4000000;		// CPUのクロック(Hz)
+		u16 address = 0x3000;		// _SOSヘッダがない時の読み込み・実行アドレス
+		bool render = true;			// VRAMのイメージを変換するか
+		bool audio = true;			// 音を生成するか
+	};
+
+	/**
+	 * @brief ジョブの結果
+	 */
+	struct Result {
+		enum class Status : u8 {
+			OK,			// 最後まで実行した
+			ERROR,		// 読み込めなかった
+			DESYNCED,	// 入力の再生で同期がずれた
+		};
+		Status status = Status::ERROR;
+		s32 platformID = 0;
+		u64 clocks = 0;				// 実行したクロック数
+		u64 hash = 0;				// RAM・IO・レジスタ(と、書き込んだディスクイメージ)のハッシュ
+		u64 screenHash = 0;			// 最後の画面のハッシュ
+		bool screenDrawn = false;	// 最後の画面に、ネイティブで描画したものがあるか(falseならscreenHashは使わない)
+		s64 audioChecksum = 0;		// 生成した音のチェックサム
+		bool audioWritten = false;	// PSGに書き込みがあったか(falseならaudioChecksumは使わない)
+		s64 elapsedNs = 0;			// 掛かった時間
+	};
+
+	/**
+	 * @brief 設定
+	 */
+	struct Options {
+		const char* jobList = nullptr;	// ジョブのリストのファイル
+		const char* output = nullptr;	// 結果を書き出すファイル(nullptr:標準出力)
+		u32 threads = 0;				// スレッド数(0:コア数)
+		bool reuse = true;				// マシンを使い回すか
+	};
+
+	/**
+	 * @brief スレッドごとのマシンのプール
+	 *
+	 * 機種ごとにマシンを1台ずつ持っておき、作った直後に保存した状態に戻して使い回す。
+	 */
+	class MachinePool {
+		struct Entry {
+			s32 platformID;
+			SOS_Machine* machine;
+			std::vector<u8> initialState;	// 作った直後の状態
+		};
+		std::vector<Entry> entries;
+		bool reuse;
+	public:
+		explicit MachinePool(const bool reuse) : reuse(reuse) {}
+		~MachinePool()
+		{
+			for(auto& it : entries) {
+				delete it.machine;
+			}
+		}
+		MachinePool(const MachinePool&) = delete;
+		MachinePool& operator=(const MachinePool&) = delete;
+
+		/**
+		 * @brief 作った直後の状態のマシンを取得する
+		 * @param[in]	platformID	機種の識別子
+		 * @return マシン(nullptr:作れなかった)
+		 */
+		SOS_Machine* acquire(const s32 platformID)
+		{
+			for(auto it = entries.begin(); it != entries.end(); ++it) {
+				if(it->platformID != platformID) {
+					continue;
+				}
+				if(reuse) {
+					it->machine->stopInputTimeline();
+					for(s32 drive = 0; drive < (s32)SOS_DISK_DRIVE_MAX; ++drive) {
+						it->machine->unmountDisk(drive);
+					}
+					if(it->machine->loadState(it->initialState.data(), (u32)it->initialState.size())) {
+						return it->machine;
+					}
+				}
+				delete it->machine;
+				entries.erase(it);
+				break;
+			}
+			SOS_Machine* machine = new SOS_Machine(platformID);
+			if(!machine || !machine->isValid()) {
+				delete machine;
+				return nullptr;
+			}
+			Entry entry { platformID, machine, std::vector<u8>(machine->getStateSize()) };
+			entry.initialState.resize(machine->saveState(entry.initialState.data(), (u32)entry.initialState.size()));
+			entries.push_back(std::move(entry));
+			return machine;
+		}
+	};
+
+	/**
+	 * @brief 共有するディスクイメージ
+	 *
+	 * ジョブで使うディスクイメージを、実行する前に1回ずつメモリマップしておき、全てのスレッドのマシンで共有する。
+	 * 書き込みはマシンごとのオーバーレイに入るので、イメージは書き換わらない。
+	 */
+	class DiskCache {
+		struct Entry {
+			std::string path;
+			MappedFile* file;
+		};
+		std::vector<Entry> entries;
+	public:
+		DiskCache() = default;
+		~DiskCache()
+		{
+			for(auto& it : entries) {
+				delete it.file;
+			}
+		}
+		DiskCache(const DiskCache&) = delete;
+		DiskCache& operator=(const DiskCache&) = delete;
+
+		/**
+		 * @brief ディスクイメージを取得する
+		 * @param[in]	path	ファイル名
+		 * @return メモリマップしたディスクイメージ(nullptr:マップできなかった)
+		 */
+		const MappedFile* open(const std::string& path)
+		{
+			for(const auto& it : entries) {
+				if(it.path == path) {
+					return it.file;
+				}
+			}
+			MappedFile* file = new MappedFile();
+			if(!file->open(path.c_str())) {
+				delete file;
+				file = nullptr;
+			}
+			// メモ）マップできなかったことも覚えておく
+			entries.push_back({ path, file });
+			return file;
+		}
+	};
+
+	using Clock = std::chrono::steady_clock;
+
+	void usage()
+	{
+		fprintf(stderr,
+			"usage: SOSBatch [options] joblist\n"
+			"  -j <threads>   worker threads (default: number of cores)\n"
+			"  -n             create a new machine for every job instead of reusing one per thread\n"
+			"  -o <file>      write the results to a file instead of stdout\n"
+			"joblist: one job per line ('#' starts a comment)\n"
+			"  [-p platform] [-f frames] [-c clock] [-l address] [-r] [-a] [-s state] [-i input] [-d drive:image] [-w drive:image] [-shot ppm] file\n"
+			"  the options are the same as SOSBench, -shot writes the last screen as a PPM image\n"
+			"  the screen hash and -shot cover only what the native build draws (X1 graphics and PCG, not the text layer)\n"
+			"  the audio checksum covers only the PSG, 'n/a' is shown when nothing was drawn or written\n"
+			"  each disk image is memory-mapped once and shared by all jobs, writes go to a per-job overlay\n");
+	}
+
+	bool parseOptions(int argc, char** argv, Options& options)
+	{
+		for(int i = 1; i < argc; ++i) {
+			const char* arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+			if(strcmp(arg, "-j") == 0 && hasValue) {
+				options.threads = (u32)atoi(argv[++i]);
+			} else if(strcmp(arg, "-n") == 0) {
+				options.reuse = false;
+			} else if(strcmp(arg, "-o") == 0 && hasValue) {
+				options.output = argv[++i];
+			} else if(arg[0] != '-' && !options.jobList) {
+				options.jobList = arg;
+			} else {
+				return false;
+			}
+		}
+		return options.jobList != nullptr;
+	}
+
+	/**
+	 * @brief ジョブのリストの1行を読み込む
+	 * @param[in]	line	1行
+	 * @param[out]	job		ジョブ
+	 * @return 読み込めたらtrue
+	 */
+	bool parseJob(const char* line, Job& job)
+	{
+		std::vector<std::string> args;
+		for(const char* p = line; *p && *p != '#'; ) {
+			if(isspace((u8)*p)) {
+				++p;
+				continue;
+			}
+			const char* start = p;
+			while(*p && !isspace((u8)*p)) { ++p; }
+			args.emplace_back(start, p);
+		}
+		const u32 count = (u32)args.size();
+		for(u32 i = 0; i < count; ++i) {
+			const char* arg = args[i].c_str();
+			const bool hasValue = i + 1 < count;
+			if(strcmp(arg, "-p") == 0 && hasValue) {
+				if(!parsePlatform(args[++i].c_str(), job.platformID)) { return false; }
+			} else if(strcmp(arg, "-f") == 0 && hasValue) {
+				job.frames = atoi(args[++i].c_str());
+			} else if(strcmp(arg, "-c") == 0 && hasValue) {
+				job.clock = atoi(args[++i].c_str());
+			} else if(strcmp(arg, "-l") == 0 && hasValue) {
+				job.address = (u16)strtol(args[++i].c_str(), nullptr, 16);
+			} else if(strcmp(arg, "-r") == 0) {
+				job.render = false;
+			} else if(strcmp(arg, "-a") == 0) {
+				job.audio = false;
+			} else if(strcmp(arg, "-s") == 0 && hasValue) {
+				job.state = args[++i];
+			} else if(strcmp(arg, "-i") == 0 && hasValue) {
+				job.replay = args[++i];
+			} else if(strcmp(arg, "-shot") == 0 && hasValue) {
+				job.screenshot = args[++i];
+			} else if((strcmp(arg, "-d") == 0 || strcmp(arg, "-w") == 0) && hasValue) {
+				s32 drive;
+				const char* path;
+				if(!parseDriveFile(args[++i].c_str(), drive, path)) { return false; }
+				(arg[1] == 'd' ? job.disks : job.commits)[drive] = path;
+			} else if(arg[0] != '-' && job.file.empty()) {
+				job.file = arg;
+			} else {
+				return false;
+			}
+		}
+		return (!job.file.empty() || !job.state.empty()) && 0 < job.frames && FRAME_RATE <= job.clock;
+	}
+
+	/**
+	 * @brief ジョブのリストを読み込む
+	 * @param[in]	path	ファイル名
+	 * @param[out]	jobs	ジョブ
+	 * @return 読み込めたらtrue
+	 */
+	bool readJobList(const char* path, std::vector<Job>& jobs)
+	{
+		FILE* fp = fopen(path, "r");
+		if(!fp) {
+			fprintf(stderr, "cannot open %s\n", path);
+			return false;
+		}
+		bool result = true;
+		char line[1024];
+		for(u32 lineNo = 1; fgets(line, sizeof(line), fp); ++lineNo) {
+			const char* p = line;
+			while(isspace((u8)*p)) { ++p; }
+			if(!*p || *p == '#') {
+				continue;
+			}
+			Job job;
+			if(!parseJob(p, job)) {
+				fprintf(stderr, "%s:%u: invalid job\n", path, lineNo);
+				result = false;
+				continue;
+			}
+			jobs.push_back(std::move(job));
+		}
+		fclose(fp);
+		return result;
+	}
+
+	/**
+	 * @brief サウンドチップへの書き込みを音の生成に渡す
+	 */
+	void writeSoundRegister(void* arg, s32 clock, s32 no, u8 reg, u8 value)
+	{
+		((BenchAudio*)arg)->writeRegister(no, reg, value);
+	}
+
+	/**
+	 * @brief 画面に、ネイティブで描画したものがあるかどうか
+	 *
+	 * テキストとCGのフォントはJavaScript側で描いているので、テキストだけのプログラムは全て背景の色になる。
+	 * @param[in]	image	VRAMイメージ(SCREEN_WIDTH x SCREEN_HEIGHTのRGBA)
+	 * @return 1つでも他と違う色の画素があればtrue
+	 */
+	bool isScreenDrawn(const void* image)
+	{
+		const u32* pixel = (const u32*)image;
+		for(u32 i = 1; i < SCREEN_WIDTH * SCREEN_HEIGHT; ++i) {
+			if(pixel[i] != pixel[0]) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * @brief ジョブを実行する
+	 * @param[in]		job		ジョブ
+	 * @param[in,out]	pool	実行するスレッドのマシンのプール
+	 * @param[out]		result	結果
+	 */
+	void runJob(const Job& job, MachinePool& pool, Result& result)
+	{
+		const auto start = Clock::now();
+		result.platformID = job.platformID;
+		std::vector<u8> state;
+		if(!job.state.empty() && !readStateFile(job.state.c_str(), state, result.platformID)) {
+			return;
+		}
+		SOS_Machine* machine = pool.acquire(result.platformID);
+		if(!machine) {
+			fprintf(stderr, "cannot create the machine\n");
+			return;
+		}
+		if(!job.state.empty()) {
+			if(!machine->loadState(state.data(), (u32)state.size())) {
+				fprintf(stderr, "cannot load state %s\n", job.state.c_str());
+				return;
+			}
+		} else if(!loadProgram(job.file.c_str(), job.address, *machine)) {
+			return;
+		}
+		for(s32 drive = 0; drive < (s32)SOS_DISK_DRIVE_MAX; ++drive) {
+			if(job.disks[drive].empty()) {
+				continue;
+			}
+			const MappedFile* disk = job.diskFiles[drive];
+			if(!disk || !machine->mountDiskCopyOnWrite(drive, disk->getData(), (u32)disk->getSize())) {
+				fprintf(stderr, "invalid disk image %s\n", job.disks[drive].c_str());
+				return;
+			}
+		}
+		if(!job.replay.empty()) {
+			std::vector<u8> data;
+			if(!readFile(job.replay.c_str(), data)) {
+				return;
+			}
+			if(!machine->startInputReplay(data.data(), (u32)data.size())) {
+				fprintf(stderr, "invalid input timeline %s\n", job.replay.c_str());
+				return;
+			}
+		}
+		BenchAudio* audio = nullptr;
+		if(job.audio) {
+			audio = new BenchAudio(SAMPLE_RATE);
+			machine->setSoundCallback(writeSoundRegister, audio);
+		}
+
+		const s32 frameClock = job.clock / FRAME_RATE;
+		const u32 frameSamples = SAMPLE_RATE / FRAME_RATE;
+		const void* image = nullptr;
+		for(s32 frame = 0; frame < job.frames; ++frame) {
+			machine->execute(-1);
+			if(machine->getStatus() == SOS_STATUS_WAIT_HOST) {
+				// js/z80Emu.jsと同じく、1フレームに1回だけフックを呼び出して完了したか確認させる
+				machine->resumeFromHost();
+			}
+			result.clocks += machine->execute(frameClock);
+			// プログラムが表示した文字は、複数のマシンで混ざるので捨てる
+			// メモ）フレームの途中で表示しなければならない分も、setConsoleCallback()を設定していないので捨てられている
+			SOS_ConsoleRing* console = machine->getConsoleRing();
+			console->read = console->write;
+			if(job.render) {
+				if(const void* updated = machine->getVRAMImage()) {
+					image = updated;
+				}
+			}
+			if(audio) {
+				audio->generate(frameSamples);
+			}
+		}
+
+		result.status = machine->isInputReplayDesynced() ? Result::Status::DESYNCED : Result::Status::OK;
+		result.hash = hashMachine(*machine);
+		for(s32 drive = 0; drive < (s32)SOS_DISK_DRIVE_MAX; ++drive) {
+			if(!machine->isDiskMounted(drive) || (machine->getDiskOverlayCount(drive) == 0 && job.commits[drive].empty())) {
+				continue;
+			}
+			std::vector<u8> image(machine->getDiskImageSize(drive));
+			machine->copyDiskImage(drive, image.data(), (u32)image.size());
+			if(machine->getDiskOverlayCount(drive)) {
+				result.hash = fnv1a(image.data(), image.size(), result.hash);
+			}
+			if(!job.commits[drive].empty() && !writeFile(job.commits[drive].c_str(), image.data(), image.size())) {
+				result.status = Result::Status::ERROR;
+			}
+		}
+		if(image && isScreenDrawn(image)) {
+			result.screenHash = fnv1a(image, SCREEN_WIDTH * SCREEN_HEIGHT * 4);
+			result.screenDrawn = true;
+			if(!job.screenshot.empty() && !writeScreenshot(job.screenshot.c_str(), image)) {
+				result.status = Result::Status::ERROR;
+			}
+		} else if(!job.screenshot.empty()) {
+			// 真っ黒な画像を書き出しても、何も確かめられないので
+			fprintf(stderr, "%s: nothing was drawn natively, %s is not written\n", job.file.c_str(), job.screenshot.c_str());
+		}
+		machine->setSoundCallback(nullptr, nullptr);
+		if(audio) {
+			result.audioChecksum = audio->getChecksum();
+			result.audioWritten = audio->getWriteCount() != 0;
+			delete audio;
+			audio = nullptr;
+		}
+		result.elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+	}
+
+	const char* getStatusName(const Result::Status status)
+	{
+		switch(status) {
+			case Result::Status::OK:		return "ok";
+			case Result::Status::DESYNCED:	return "desync";
+			case Result::Status::ERROR:
+			default:						return "error";
+		}
+	}
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+	Options options;
+	if(!parseOptions(argc, argv, options)) {
+		usage();
+		return 1;
+	}
+	std::vector<Job> jobs;
+	if(!readJobList(options.jobList, jobs)) {
+		return 1;
+	}
+	DiskCache diskCache;
+	for(auto& job : jobs) {
+		for(s32 drive = 0; drive < (s32)SOS_DISK_DRIVE_MAX; ++drive) {
+			if(!job.disks[drive].empty()) {
+				job.diskFiles[drive] = diskCache.open(job.disks[drive]);
+			}
+		}
+	}
+
+	BatchScheduler scheduler(options.threads);
+	const u32 threadCount = scheduler.getThreadCount();
+	// 2つ以上のスレッドでマシンを作る時だけ、ヒープの確保と解放を排他する(スレッドを起動する前に設定しておく)
+	catLowHeapSetThreaded(threadCount > 1);
+	std::vector<Result> results(jobs.size());
+	std::vector<MachinePool*> pools;
+	for(u32 i = 0; i < threadCount; ++i) {
+		pools.push_back(new MachinePool(options.reuse));
+	}
+	const auto start = Clock::now();
+	scheduler.run((u32)jobs.size(), [&](const u32 job, const u32 worker) {
+		runJob(jobs[job], *pools[worker], results[job]);
+	});
+	const s64 wallNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+	for(auto* it : pools) {
+		delete it;
+	}
+
+	FILE* fp = stdout;
+	if(options.output) {
+		fp = fopen(options.output, "w");
+		if(!fp) {
+			fprintf(stderr, "cannot open %s\n", options.output);
+			return 1;
+		}
+	}
+	u32 failed = 0;
+	u64 clocks = 0;
+	s64 busyNs = 0;
+	for(size_t i = 0; i < jobs.size(); ++i) {
+		const Job& job = jobs[i];
+		const Result& result = results[i];
+		char screen[17] = "n/a";
+		if(result.screenDrawn) {
+			snprintf(screen, sizeof(screen), "%016llx", (unsigned long long)result.screenHash);
+		}
+		char audio[17] = "n/a";
+		if(result.audioWritten) {
+			snprintf(audio, sizeof(audio), "%016llx", (unsigned long long)result.audioChecksum);
+		}
+		fprintf(fp, "%-6s %-15s %6d %016llx %-16s %-16s %s\n",
+			getStatusName(result.status),
+			getPlatformName(result.platformID),
+			job.frames,
+			(unsigned long long)result.hash,
+			screen,
+			audio,
+			job.state.empty() ? job.file.c_str() : job.state.c_str());
+		failed += result.status != Result::Status::OK;
+		clocks += result.clocks;
+		busyNs += result.elapsedNs;
+	}
+	if(fp != stdout) {
+		fclose(fp);
+	}
+	// 実行時間は比較の邪魔になるので、標準エラーに出す
+	fprintf(stderr, "jobs      : %zu (%u failed)\n", jobs.size(), failed);
+	fprintf(stderr, "threads   : %u (%u jobs stolen, machines %s)\n", threadCount, scheduler.getStealCount(), options.reuse ? "reused" : "not reused");
+	fprintf(stderr, "wall      : %.3f s (%.1f jobs/s, %.1fx parallel)\n", wallNs / 1e9, wallNs ? jobs.size() / (wallNs / 1e9) : 0.0, wallNs ? (double)busyNs / wallNs : 0.0);
+	fprintf(stderr, "emulated  : %.1f MHz total\n", wallNs ? clocks / (wallNs / 1e3) : 0.0);
+	return failed ? 1 : 0;
+}
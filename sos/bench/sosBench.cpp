@@ -0,0 +1,262 @@
+﻿#include "../src/cat/low/catLowBasicTypes.h"
+#include "../src/z80/z80.hpp"
+#include "../src/sos.h"
+#include "../src/sosMachine.h"
+#include "../src/platform/catPlatformFactory.h"
+#include "benchAudio.h"
+#include "benchUtil.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/**
+ * @brief ヘッドレスのベンチマーク
+ *
+ * S-OSのプログラム(_SOSヘッダ付き、またはベタのバイナリ)を読み込んで、
+ * 描画も音の生成もホスト側に出さずに指定したフレーム数だけ実行し、
+ * エミュレートできた速度と、ホストで掛かった時間をサブシステム毎に表示する。
+ * 最後にRAM・IO・レジスタのハッシュを表示するので、高速化の前後で結果が変わっていないことも確認できる。
+ * ブラウザで保存した状態と、そこから記録した入力を読み込めば、遊んだ内容をそのまま再生して計測できる。
+ */
+namespace {
+	using namespace bench;
+
+	/**
+	 * @brief 設定
+	 */
+	struct Options {
+		const char* file = nullptr;	// 実行するファイル
+		const char* state = nullptr;	// 読み込む状態のファイル(saveState()で保存したもの)
+		const char* replay = nullptr;	// 再生する入力のファイル(getInputTimeline()で取得したもの)
+		const char* record = nullptr;	// 入力を記録するファイル
+		const char* disks[SOS_DISK_DRIVE_MAX] = {};	// ドライブ(A～E)にマウントするディスクイメージのファイル
+		const char* commits[SOS_DISK_DRIVE_MAX] = {};	// 書き込んだ内容も入れたディスクイメージを書き出すファイル
+		s32 platformID = (s32)CatPlatformFactory::PlatformID::X1;
+		s32 frames = 600;			// 実行するフレーム数
+		s32 clock = 4000000;		// CPUのクロック(Hz)
+		u16 address = 0x3000;		// _SOSヘッダがない時の読み込み・実行アドレス
+		bool render = true;			// VRAMのイメージを変換するか
+		bool audio = true;			// 音を生成するか
+	};
+
+	using Clock = std::chrono::steady_clock;
+	inline s64 elapsedNs(const Clock::time_point& start, const Clock::time_point& end)
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+	}
+
+	void usage()
+	{
+		fprintf(stderr,
+			"usage: SOSBench [options] file\n"
+			"       SOSBench [options] -s <state>\n"
+			"  -p <platform>  MZ700 / MZ1500 / X1 / X1TURBO / X1TURBO_SPEEDUP or ID (default: X1)\n"
+			"  -f <frames>    frames to run (default: 600)\n"
+			"  -c <clock>     CPU clock in Hz (default: 4000000)\n"
+			"  -l <address>   load/exec address in hex for files without an _SOS header (default: 3000)\n"
+			"  -r             disable rendering (VRAM image conversion)\n"
+			"  -a             disable audio (PSG sample generation)\n"
+			"  -s <state>     start from a saved state instead of a program (platform is taken from the state)\n"
+			"  -i <input>     replay a recorded input timeline\n"
+			"  -o <input>     record the input timeline to a file\n"
+			"  -d <drive>:<image>  mount a D88 or raw 2D disk image on drive A-E (repeatable)\n"
+			"                      the image is memory-mapped and never modified, writes go to an overlay\n"
+			"  -w <drive>:<image>  write the disk image with the overlay applied to a new file at the end\n");
+	}
+
+	bool parseOptions(int argc, char** argv, Options& options)
+	{
+		for(int i = 1; i < argc; ++i) {
+			const char* arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+			if(strcmp(arg, "-p") == 0 && hasValue) {
+				if(!parsePlatform(argv[++i], options.platformID)) { return false; }
+			} else if(strcmp(arg, "-f") == 0 && hasValue) {
+				options.frames = atoi(argv[++i]);
+			} else if(strcmp(arg, "-c") == 0 && hasValue) {
+				options.clock = atoi(argv[++i]);
+			} else if(strcmp(arg, "-l") == 0 && hasValue) {
+				options.address = (u16)strtol(argv[++i], nullptr, 16);
+			} else if(strcmp(arg, "-r") == 0) {
+				options.render = false;
+			} else if(strcmp(arg, "-a") == 0) {
+				options.audio = false;
+			} else if(strcmp(arg, "-s") == 0 && hasValue) {
+				options.state = argv[++i];
+			} else if(strcmp(arg, "-i") == 0 && hasValue) {
+				options.replay = argv[++i];
+			} else if(strcmp(arg, "-o") == 0 && hasValue) {
+				options.record = argv[++i];
+			} else if((strcmp(arg, "-d") == 0 || strcmp(arg, "-w") == 0) && hasValue) {
+				s32 drive;
+				const char* path;
+				if(!parseDriveFile(argv[++i], drive, path)) { return false; }
+				(arg[1] == 'd' ? options.disks : options.commits)[drive] = path;
+			} else if(arg[0] != '-' && !options.file) {
+				options.file = arg;
+			} else {
+				return false;
+			}
+		}
+		return (options.file || options.state) && 0 < options.frames && FRAME_RATE <= options.clock;
+	}
+
+	/**
+	 * @brief サウンドチップへの書き込みを音の生成に渡す
+	 */
+	void writeSoundRegister(void* arg, s32 clock, s32 no, u8 reg, u8 value)
+	{
+		((BenchAudio*)arg)->writeRegister(no, reg, value);
+	}
+	/**
+	 * @brief プログラムが表示した文字を、標準出力に出す
+	 */
+	void flushConsole(void* arg, SOS_ConsoleRing* ring)
+	{
+		sos_flushConsole(ring);
+	}
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+	Options options;
+	if(!parseOptions(argc, argv, options)) {
+		usage();
+		return 1;
+	}
+	std::vector<u8> state;
+	if(options.state && !readStateFile(options.state, state, options.platformID)) {
+		return 1;
+	}
+	// メモ）マウントしたディスクイメージは、マシンより後に解放する
+	MappedFile disks[SOS_DISK_DRIVE_MAX];
+	SOS_Machine machine(options.platformID);
+	if(!machine.isValid()) {
+		fprintf(stderr, "cannot create the machine\n");
+		return 1;
+	}
+	if(options.state) {
+		if(!machine.loadState(state.data(), (u32)state.size())) {
+			fprintf(stderr, "cannot load state %s\n", options.state);
+			return 1;
+		}
+	} else if(!loadProgram(options.file, options.address, machine)) {
+		return 1;
+	}
+	for(s32 drive = 0; drive < (s32)SOS_DISK_DRIVE_MAX; ++drive) {
+		if(!options.disks[drive]) {
+			continue;
+		}
+		if(!disks[drive].open(options.disks[drive])) {
+			return 1;
+		}
+		if(!machine.mountDiskCopyOnWrite(drive, disks[drive].getData(), (u32)disks[drive].getSize())) {
+			fprintf(stderr, "invalid disk image %s\n", options.disks[drive]);
+			return 1;
+		}
+	}
+	if(options.replay) {
+		std::vector<u8> data;
+		if(!readFile(options.replay, data)) {
+			return 1;
+		}
+		if(!machine.startInputReplay(data.data(), (u32)data.size())) {
+			fprintf(stderr, "invalid input timeline %s\n", options.replay);
+			return 1;
+		}
+	} else if(options.record) {
+		machine.startInputRecord();
+	}
+	machine.setConsoleCallback(flushConsole, nullptr);
+	BenchAudio* audio = nullptr;
+	if(options.audio) {
+		audio = new BenchAudio(SAMPLE_RATE);
+		machine.setSoundCallback(writeSoundRegister, audio);
+	}
+
+	const s32 frameClock = options.clock / FRAME_RATE;
+	const u32 frameSamples = SAMPLE_RATE / FRAME_RATE;
+	u64 clocks = 0;
+	s64 emulateNs = 0;
+	s64 renderNs = 0;
+	s64 audioNs = 0;
+	u32 renderCount = 0;
+	for(s32 frame = 0; frame < options.frames; ++frame) {
+		const auto t0 = Clock::now();
+		machine.execute(-1);
+		if(machine.getStatus() == SOS_STATUS_WAIT_HOST) {
+			// js/z80Emu.jsと同じく、1フレームに1回だけフックを呼び出して完了したか確認させる
+			machine.resumeFromHost();
+		}
+		clocks += machine.execute(frameClock);
+		// プログラムが表示した文字を、標準出力に出しておく
+		sos_flushConsole(machine.getConsoleRing());
+		const auto t1 = Clock::now();
+		if(options.render && machine.getVRAMImage()) {
+			renderCount++;
+		}
+		const auto t2 = Clock::now();
+		if(audio) {
+			audio->generate(frameSamples);
+		}
+		const auto t3 = Clock::now();
+		emulateNs += elapsedNs(t0, t1);
+		renderNs += elapsedNs(t1, t2);
+		audioNs += elapsedNs(t2, t3);
+	}
+
+	const Z80::Register* reg = machine.getZ80Regs();
+	const u64 hash = hashMachine(machine);
+
+	const s64 totalNs = emulateNs + renderNs + audioNs;
+	const double frames = options.frames;
+	// メモ）プログラムが表示した文字の後ろに続くので、改行しておく
+	printf("\n");
+	printf("file      : %s\n", options.state ? options.state : options.file);
+	printf("platform  : %s (0x%02X)\n", getPlatformName(options.platformID), options.platformID);
+	printf("frames    : %d (%d clocks/frame, render %s, audio %s)\n", options.frames, frameClock, options.render ? "on" : "off", audio ? "on" : "off");
+	printf("clocks    : %llu\n", (unsigned long long)clocks);
+	printf("emulated  : %.1f MHz (%.1fx real time)\n", clocks / (totalNs / 1e3), (frames / FRAME_RATE) / (totalNs / 1e9));
+	printf("host      : %.0f ns/frame\n", totalNs / frames);
+	printf("  emulate : %.0f ns/frame (%.1f%%)\n", emulateNs / frames, totalNs ? emulateNs * 100.0 / totalNs : 0.0);
+	printf("  render  : %.0f ns/frame (%.1f%%, %u images)\n", renderNs / frames, totalNs ? renderNs * 100.0 / totalNs : 0.0, renderCount);
+	printf("  audio   : %.0f ns/frame (%.1f%%)\n", audioNs / frames, totalNs ? audioNs * 100.0 / totalNs : 0.0);
+	printf("idle loop : %u detected, %u iterations skipped\n", machine.getIdleLoopDetectCount(), machine.getIdleLoopSkipCount());
+	if(options.replay) {
+		printf("input     : replay %s (%s, %s)\n", options.replay, machine.isInputReplayEnd() ? "end" : "not end", machine.isInputReplayDesynced() ? "desynced" : "in sync");
+	}
+	for(s32 drive = 0; drive < (s32)SOS_DISK_DRIVE_MAX; ++drive) {
+		if(machine.isDiskMounted(drive)) {
+			printf("disk %c    : %s (%u records written)\n", 'A' + drive, options.disks[drive], machine.getDiskOverlayCount(drive));
+		}
+	}
+	printf("PC        : %04X\n", reg->PC);
+	printf("hash      : %016llx\n", (unsigned long long)hash);
+
+	for(s32 drive = 0; drive < (s32)SOS_DISK_DRIVE_MAX; ++drive) {
+		if(!options.commits[drive] || !machine.isDiskMounted(drive)) {
+			continue;
+		}
+		std::vector<u8> image(machine.getDiskImageSize(drive));
+		if(!machine.copyDiskImage(drive, image.data(), (u32)image.size()) || !writeFile(options.commits[drive], image.data(), image.size())) {
+			fprintf(stderr, "cannot write %s\n", options.commits[drive]);
+		}
+	}
+	if(options.record && !options.replay) {
+		machine.stopInputTimeline();
+		if(!writeFile(options.record, machine.getInputTimeline(), machine.getInputTimelineSize())) {
+			fprintf(stderr, "cannot write %s\n", options.record);
+		}
+	}
+
+	machine.setSoundCallback(nullptr, nullptr);
+	if(audio) {
+		delete audio;
+		audio = nullptr;
+	}
+	return 0;
+}
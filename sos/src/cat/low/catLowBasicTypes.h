@@ -113,7 +113,7 @@ inline void catHalt()
 #define catAssert(EXPR,fmt, ...) \
 do { \
 	if(!(EXPR)) { \
-		std::printf(fmt, __VA_ARGS__); \
+		std::printf(fmt __VA_OPT__(,) __VA_ARGS__); \
 		catHalt(); \
 	} \
 } while(false)
@@ -0,0 +1,47 @@
+﻿#if !BUILD_WASM
+#include <mutex>
+
+namespace {
+/**
+ * @brief ヒープの排他制御に使うミューテックス
+ */
+std::mutex heapMutex;
+/**
+ * @brief 複数のスレッドで使うかどうか(falseの時はロックしない)
+ *
+ * メモ）他のスレッドを起動する前に設定するので、アトミックにする必要はない
+ */
+bool heapThreaded = false;
+}
+
+void
+catLowHeapSetThreaded(bool threaded)
+{
+	heapThreaded = threaded;
+}
+
+/**
+ * @brief ヒープをロックする
+ *
+ * catLowMemAlloc()とcatLowMemFree()から呼び出す。
+ * @return ロックしたらtrue(シングルスレッドの時はロックしない)
+ */
+bool
+catLowHeapLock()
+{
+	if(!heapThreaded) {
+		return false;
+	}
+	heapMutex.lock();
+	return true;
+}
+
+/**
+ * @brief ヒープのロックを解除する
+ */
+void
+catLowHeapUnlock()
+{
+	heapMutex.unlock();
+}
+#endif // !BUILD_WASM
@@ -389,10 +389,15 @@ struct HeapManager {
 	 * @brief 可変長のメモリブロック
 	 */
 	//catLowAllocator<128*1024*1024> blockMemory;
+#if BUILD_WASM
 	catLowAllocator<4*1024*1024> blockMemory;
+#else
+	// ネイティブは1つのプロセスで複数のマシン(SOS_Machine)を動かせるように大きくしておく
+	catLowAllocator<256*1024*1024> blockMemory;
+#endif
 };
 
-#if DEBUG_MEM_LEAK
+#if DEBUG_MEM_LEAK || !BUILD_WASM
 static_assert(sizeof(HeapManager) <= 512*1024*1024);
 #else
 //static_assert(sizeof(HeapManager) <= 256*1024*1024);
@@ -400,6 +405,25 @@ static_assert(sizeof(HeapManager) <= 16*1024*1024);
 #endif
 
 #if !BUILD_WASM
+// catLowHeapLock.cpp
+// メモ）<mutex>は配置newを定義しているので、このファイルではインクルードできない
+bool catLowHeapLock();
+void catLowHeapUnlock();
+
+namespace {
+/**
+ * @brief ヒープの排他制御
+ *
+ * ネイティブでは複数のスレッドでマシンを動かす(SOSBatch)ので、確保と解放を排他する。
+ * catLowHeapSetThreaded()で複数のスレッドを使うと設定されるまでは、ロックしない。
+ */
+struct HeapLock {
+	const bool locked;
+	HeapLock() : locked(catLowHeapLock()) {}
+	~HeapLock() { if(locked) { catLowHeapUnlock(); } }
+};
+}
+
 void* getHeapBase() {
 	static u8 heapBase[512*1024*1024] = {0};
 	static bool first = false;
@@ -410,6 +434,13 @@ void* getHeapBase() {
 	return heapBase;
 }
 #else
+namespace {
+/**
+ * @brief ヒープの排他制御(WebAssemblyはシングルスレッドなので何もしない)
+ */
+struct HeapLock {};
+}
+
 extern "C" void* __heap_base;
 void* getHeapBase() { return __heap_base; }
 
@@ -429,6 +460,7 @@ catLowMemAlloc(size_t size)
 {
 	if(size == 0) { size = 16; }
 	size = (size + 15) & ~15;
+	[[maybe_unused]] HeapLock lock;
 
 #if DEBUG_MEM_LEAK
 	alloc_counter++;
@@ -463,6 +495,7 @@ void
 catLowMemFree(void* ptr)
 {
 	if(!ptr) [[unlikely]] { return; }
+	[[maybe_unused]] HeapLock lock;
 	HeapManager* heapMan = (HeapManager*)getHeapBase();
 	// 小さいサイズのメモリを扱うもの
 	if(heapMan->smallBlockMemory1a.isMine(ptr)) { return heapMan->smallBlockMemory1a.free(ptr); }
@@ -47,6 +47,17 @@ void operator delete(void* ptr) noexcept;
  */
 void operator delete[](void*ptr) noexcept;
 
+#if !BUILD_WASM
+/**
+ * @brief ヒープを複数のスレッドで使うかどうかを設定する
+ *
+ * trueにすると、catLowMemAlloc()とcatLowMemFree()を排他する(SOSBatchで2つ以上のスレッドを動かす時)。
+ * 他のスレッドを起動する前に設定すること。
+ * @param[in]	threaded	複数のスレッドで使うならtrue
+ */
+void catLowHeapSetThreaded(bool threaded);
+#endif // !BUILD_WASM
+
 /**
  * @brief 配置new
  * 
@@ -26,6 +26,22 @@ void sos_putchar(int ch)
 	putchar(ch);
 }
 
+void
+sos_flushConsole(SOS_ConsoleRing* ring)
+{
+	while(ring->read != ring->write) {
+		const u8 ch = ring->data[ring->read++ & (SOS_CONSOLE_RING_SIZE - 1)];
+		if(ch == SOS_CONSOLE_LOCATE) {
+			// カーソル位置の設定は読み飛ばす
+			ring->read += 2;
+		} else if(ch == 0x0D) {
+			sos_putchar('\n');
+		} else if(ch >= 0x20) {
+			sos_putchar(ch);
+		}
+	}
+}
+
 void
 writeSoundRegister(s32 clock, s32 no, u8 reg, u8 value)
 {
@@ -40,7 +56,9 @@ readGamePad(u8 index)
 void*
 scanKey()
 {
-	return nullptr;
+	// キーは何も押されていない(MZ-700のキーボードマトリクス10行分)
+	static u8 keyMatrix[10] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+	return keyMatrix;
 }
 
 
@@ -78,65 +96,6 @@ SOS_FUNC(hot  )
 //	z80Regs->PC += 3;
 }
 
-SOS_FUNC(ver  )
-{
-	z80Regs->pair.H = 0x00;
-	z80Regs->pair.L = 0x00;
-}
-
-SOS_FUNC(print)
-{
-	sos_putchar(z80Regs->pair.A);
-}
-
-SOS_FUNC(prnts)
-{
-	sos_putchar(0x20);
-}
-
-SOS_FUNC(ltnl )
-{
-}
-
-SOS_FUNC(nl   )
-{
-}
-
-SOS_FUNC(msg  )
-{
-}
-
-SOS_FUNC(msx  )
-{
-}
-
-SOS_FUNC(mprnt)
-{
-	// 戻るアドレスを取得
-	u16 retAddress = READ_U16(z80Regs->SP);
-	u8* src = &ram[retAddress];
-	u8 ch;
-	while((ch = *src++) != 0) { sos_putchar(ch); }
-	// 戻るアドレスを書き換える
-	WRITE_U16(z80Regs->SP, src - &ram[0]);
-}
-
-SOS_FUNC(tab  )
-{
-}
-
-SOS_FUNC(lprnt)
-{
-}
-
-SOS_FUNC(lpton)
-{
-}
-
-SOS_FUNC(lptof)
-{
-}
-
 SOS_FUNC(getl )
 {
 }
@@ -161,30 +120,6 @@ SOS_FUNC(bell )
 {
 }
 
-SOS_FUNC(prthx)
-{
-}
-
-SOS_FUNC(prthl)
-{
-}
-
-SOS_FUNC(asc  )
-{
-}
-
-SOS_FUNC(hex  )
-{
-}
-
-SOS_FUNC(_2hex)
-{
-}
-
-SOS_FUNC(hlhex)
-{
-}
-
 SOS_FUNC(wopen)
 {
 }
@@ -205,30 +140,6 @@ SOS_FUNC(file )
 {
 }
 
-SOS_FUNC(fsame)
-{
-}
-
-SOS_FUNC(fprnt)
-{
-}
-
-SOS_FUNC(poke )
-{
-}
-
-SOS_FUNC(poke_)
-{
-}
-
-SOS_FUNC(peek )
-{
-}
-
-SOS_FUNC(peek_)
-{
-}
-
 SOS_FUNC(mon  )
 {
 }
@@ -277,30 +188,14 @@ SOS_FUNC(kill )
 {
 }
 
-SOS_FUNC(csr  )
-{
-}
-
 SOS_FUNC(scrn )
 {
 }
 
-SOS_FUNC(loc  )
-{
-}
-
 SOS_FUNC(flget)
 {
 }
 
-SOS_FUNC(rdvsw)
-{
-}
-
-SOS_FUNC(sdvsw)
-{
-}
-
 SOS_FUNC(inp  )
 {
 }
@@ -365,6 +260,7 @@ SOS_FUNC(dwrite)
 {
 }
 
+#ifndef SOS_BENCH
 int main()
 {
 	initialize(0, 0, 0x20);
@@ -376,5 +272,6 @@ int main()
 	
 	return 0;
 }
+#endif // SOS_BENCH
 
 #endif // BUILD_WASM
@@ -0,0 +1,262 @@
+﻿#include "catDiskImage.h"
+
+namespace disk {
+
+namespace {
+
+inline u32
+readU16(const u8* p)
+{
+	return (u32)p[0] | ((u32)p[1] << 8);
+}
+
+inline u32
+readU32(const u8* p)
+{
+	return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+/**
+ * @brief D88形式のイメージかどうか
+ *
+ * ディスクの種類(2D:0x00 2DD:0x10 2HD:0x20 1D:0x30 1DD:0x40)と、イメージのサイズを確認する。
+ */
+inline bool
+isD88Header(const u8* data, const u32 size)
+{
+	if(size < D88_HEADER_SIZE) {
+		return false;
+	}
+	const u8 diskType = data[0x1B];
+	if(diskType != 0x00 && diskType != 0x10 && diskType != 0x20 && diskType != 0x30 && diskType != 0x40) {
+		return false;
+	}
+	const u32 imageSize = readU32(data + 0x1C);
+	return D88_HEADER_SIZE <= imageSize && imageSize <= size;
+}
+
+} // namespace
+
+s32
+CatDiskImage::scanD88(Sector* table) const
+{
+	// メモ）ヘッダのイメージのサイズより後ろは見ない
+	const u32 size = readU32(image + 0x1C);
+	s32 count = 0;
+	for(u32 track = 0; track < D88_MAX_TRACK; ++track) {
+		u32 offset = readU32(image + D88_TRACK_OFFSET + track * 4);
+		if(!offset) {
+			// トラックが無い
+			continue;
+		}
+		if(offset < D88_HEADER_SIZE || size <= offset) {
+			return -1;
+		}
+		// 表、裏で1シリンダ(DiskImageReaderD88.mjsと同じ確認をしておく)
+		const u32 cylinder = track / 2;
+		u32 sectorsInTrack = 0;
+		for(u32 i = 0; i == 0 || i < sectorsInTrack; ++i) {
+			if(size < offset + D88_SECTOR_HEADER_SIZE) {
+				return -1;
+			}
+			const u8* header = image + offset;
+			if(header[0] != cylinder) {
+				return -1;
+			}
+			if(i == 0) {
+				// 最初のセクタの情報で、トラック内のセクタを読み込む
+				sectorsInTrack = readU16(header + 4);
+			} else if(readU16(header + 4) != sectorsInTrack) {
+				return -1;
+			}
+			const u32 dataSize = readU16(header + 0x0E);
+			offset += D88_SECTOR_HEADER_SIZE;
+			if(size < offset + dataSize) {
+				return -1;
+			}
+			if(table) {
+				table[count] = { offset, dataSize };
+			}
+			count++;
+			offset += dataSize;
+		}
+	}
+	return count;
+}
+
+void
+CatDiskImage::scanRaw2D(Sector* table)
+{
+	for(u32 i = 0; i < RAW_2D_TRACK * RAW_2D_SECTOR; ++i) {
+		table[i] = { i * RECORD_SIZE, RECORD_SIZE };
+	}
+}
+
+bool
+CatDiskImage::setup(const u8* data, const u32 size)
+{
+	image = data;
+	imageSize = size;
+	serial++;
+	s32 count = -1;
+	const bool d88 = isD88Header(data, size);
+	if(d88) {
+		count = scanD88(nullptr);
+		writeProtect = data[0x1A] != 0x00;
+		diskType = data[0x1B];
+	} else if(size == RAW_2D_SIZE) {
+		count = RAW_2D_TRACK * RAW_2D_SECTOR;
+		writeProtect = false;
+		diskType = 0x00;
+	}
+	if(count <= 0) {
+		return false;
+	}
+	sectorCount = (u32)count;
+	sectors = new Sector[sectorCount];
+	dirty = new u32[(sectorCount + 31) / 32];
+	if(!sectors || !dirty) {
+		return false;
+	}
+	if(d88) {
+		scanD88(sectors);
+	} else {
+		scanRaw2D(sectors);
+	}
+	clearDirty();
+	return true;
+}
+
+bool
+CatDiskImage::mount(u8* data, const u32 size)
+{
+	unmount();
+	if(!data) {
+		return false;
+	}
+	ownedImage = data;
+	if(!setup(data, size)) {
+		unmount();
+		return false;
+	}
+	return true;
+}
+
+bool
+CatDiskImage::mountCopyOnWrite(const u8* data, const u32 size)
+{
+	unmount();
+	if(!data || !setup(data, size)) {
+		unmount();
+		return false;
+	}
+	overlay = new u8*[sectorCount];
+	if(!overlay) {
+		unmount();
+		return false;
+	}
+	for(u32 i = 0; i < sectorCount; ++i) {
+		overlay[i] = nullptr;
+	}
+	return true;
+}
+
+void
+CatDiskImage::unmount()
+{
+	if(overlay) {
+		discardOverlay();
+		delete[] overlay;
+		overlay = nullptr;
+	}
+	delete[] ownedImage;
+	delete[] sectors;
+	delete[] dirty;
+	ownedImage = nullptr;
+	image = nullptr;
+	imageSize = 0;
+	sectors = nullptr;
+	sectorCount = 0;
+	dirty = nullptr;
+	dirtyCount = 0;
+	writeProtect = false;
+	diskType = 0x00;
+	serial++;
+}
+
+u8*
+CatDiskImage::writeRecord(const u32 record) noexcept
+{
+	if(record >= sectorCount || sectors[record].size < RECORD_SIZE) {
+		return nullptr;
+	}
+	u8* data = ownedImage ? &ownedImage[sectors[record].offset] : overlay[record];
+	if(!data) {
+		// 初めて書き込むので、オーバーレイにコピーする
+		const u8* src = &image[sectors[record].offset];
+		data = new u8[sectors[record].size];
+		if(!data) {
+			return nullptr;
+		}
+		for(u32 i = 0; i < sectors[record].size; ++i) {
+			data[i] = src[i];
+		}
+		overlay[record] = data;
+		overlayCount++;
+	}
+	u32& bits = dirty[record >> 5];
+	const u32 bit = 1u << (record & 31);
+	if(!(bits & bit)) {
+		bits |= bit;
+		dirtyCount++;
+	}
+	return data;
+}
+
+void
+CatDiskImage::discardOverlay() noexcept
+{
+	if(!overlay) {
+		return;
+	}
+	for(u32 i = 0; i < sectorCount; ++i) {
+		delete[] overlay[i];
+		overlay[i] = nullptr;
+	}
+	overlayCount = 0;
+	clearDirty();
+	serial++;
+}
+
+bool
+CatDiskImage::copyImage(u8* buffer, const u32 size) const noexcept
+{
+	if(!image || size < imageSize) {
+		return false;
+	}
+	for(u32 i = 0; i < imageSize; ++i) {
+		buffer[i] = image[i];
+	}
+	if(overlay) {
+		for(u32 record = 0; record < sectorCount; ++record) {
+			if(const u8* data = overlay[record]) {
+				u8* dst = &buffer[sectors[record].offset];
+				for(u32 i = 0; i < sectors[record].size; ++i) {
+					dst[i] = data[i];
+				}
+			}
+		}
+	}
+	return true;
+}
+
+void
+CatDiskImage::clearDirty() noexcept
+{
+	for(u32 i = 0; i < (sectorCount + 31) / 32; ++i) {
+		dirty[i] = 0;
+	}
+	dirtyCount = 0;
+}
+
+} // namespace disk
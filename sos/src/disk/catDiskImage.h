@@ -0,0 +1,245 @@
+﻿#pragma once
+
+#include "../cat/low/catLowBasicTypes.h"
+
+namespace disk {
+
+/**
+ * @brief S-OSのレコード(論理セクタ)のサイズ
+ */
+static constexpr u32 RECORD_SIZE = 0x100;
+
+/**
+ * @brief D88形式の定数
+ *
+ * ヘッダ(0x20バイト) ＋ トラックオフセットの配列(4バイト×164個)の後ろに、トラックごとにセクタが並んでいる。
+ * セクタは、セクタヘッダ(0x10バイト) ＋ データ。
+ * https://github.com/jpzm/wii88/blob/master/document/FORMAT.TXT
+ */
+static constexpr u32 D88_HEADER_SIZE = 0x2B0;
+static constexpr u32 D88_TRACK_OFFSET = 0x20;
+static constexpr u32 D88_MAX_TRACK = 164;
+static constexpr u32 D88_SECTOR_HEADER_SIZE = 0x10;
+/**
+ * @brief 2Dの生イメージの構成(40シリンダ×2サイド、16セクタ、256バイト)
+ */
+static constexpr u32 RAW_2D_TRACK = 80;
+static constexpr u32 RAW_2D_SECTOR = 16;
+static constexpr u32 RAW_2D_SIZE = RAW_2D_TRACK * RAW_2D_SECTOR * RECORD_SIZE; // 327680バイト
+
+/**
+ * @brief ディスクイメージ
+ *
+ * D88形式と2Dの生イメージを読み込んで、レコード番号からセクタのデータの位置を引ける表を作っておく。
+ * レコード番号は、イメージに入っているセクタをトラック順(トラック内はイメージに並んでいる順)に数えたもの
+ * (js/HuBasic/Disk/D88/DiskImageReaderD88.mjsと同じ)。
+ * 書き込みはイメージの中のデータを直接書き換えるので、getImage()がそのまま書き戻したイメージになる。
+ * 書き込んだレコードは、ホスト側が保存するまで覚えておく(getDirtyCount()、isDirty())。
+ *
+ * mountCopyOnWrite()でマウントした時は、イメージは共有したまま書き換えずに、
+ * 書き込んだレコードだけをコピーして持っておく(オーバーレイ)。
+ * 同じイメージから何台ものマシンを起動する時に、マシンごとにイメージ全体をコピーしなくて済む。
+ * 書き込んだ内容は、copyImage()で新しいイメージとして取り出すか、discardOverlay()で捨てる。
+ */
+class CatDiskImage {
+	/**
+	 * @brief セクタ
+	 */
+	struct Sector {
+		u32 offset;	// イメージ内のデータの位置
+		u32 size;	// データのサイズ
+	};
+
+	/**
+	 * @brief イメージ
+	 */
+	const u8* image = nullptr;
+	u32 imageSize = 0;
+	/**
+	 * @brief 書き換えられるイメージ(new[]で確保したもの。nullptr:コピーオンライト)
+	 */
+	u8* ownedImage = nullptr;
+	/**
+	 * @brief レコードごとのオーバーレイ(コピーオンライトの時だけ。nullptr:書き込んでいない)
+	 */
+	u8** overlay = nullptr;
+	u32 overlayCount = 0;
+	/**
+	 * @brief レコード番号ごとのセクタ
+	 */
+	Sector* sectors = nullptr;
+	u32 sectorCount = 0;
+	/**
+	 * @brief 書き込んだレコードのビットマップ
+	 */
+	u32* dirty = nullptr;
+	u32 dirtyCount = 0;
+	/**
+	 * @brief ライトプロテクトかどうか
+	 */
+	bool writeProtect = false;
+	/**
+	 * @brief ディスクの種類(D88形式のヘッダの0x1B。2D:0x00 2DD:0x10 2HD:0x20 1D:0x30 1DD:0x40)
+	 */
+	u8 diskType = 0x00;
+	/**
+	 * @brief イメージの内容を入れ替えた回数
+	 */
+	u32 serial = 0;
+
+	/**
+	 * @brief D88形式のセクタを数える、または表に設定する
+	 * @param[in]	table	設定する表(nullptr:数えるだけ)
+	 * @return セクタの数(-1:イメージが不正)
+	 */
+	s32 scanD88(Sector* table) const;
+	/**
+	 * @brief 2Dの生イメージのセクタを表に設定する
+	 * @param[out]	table	設定する表(RAW_2D_TRACK * RAW_2D_SECTOR個)
+	 */
+	static void scanRaw2D(Sector* table);
+	/**
+	 * @brief セクタの表を作る
+	 * @param[in]	data	イメージ
+	 * @param[in]	size	イメージのサイズ
+	 * @return 作れたらtrue
+	 */
+	bool setup(const u8* data, u32 size);
+public:
+	CatDiskImage() = default;
+	CatDiskImage(const CatDiskImage&) = delete;
+	CatDiskImage& operator=(const CatDiskImage&) = delete;
+	~CatDiskImage() { unmount(); }
+
+	/**
+	 * @brief イメージをマウントする
+	 *
+	 * D88形式(ヘッダで判別)か、2Dの生イメージ(RAW_2D_SIZEバイト)に対応。
+	 * @param[in]	data	イメージ(new[]で確保したもの。マウントできなくても、こちらで解放する)
+	 * @param[in]	size	イメージのサイズ
+	 * @return マウントできたらtrue
+	 */
+	bool mount(u8* data, u32 size);
+	/**
+	 * @brief イメージをコピーオンライトでマウントする
+	 *
+	 * イメージは書き換えずに、書き込んだレコードだけをオーバーレイに持つ。
+	 * @param[in]	data	イメージ(アンマウントするまで解放しないこと)
+	 * @param[in]	size	イメージのサイズ
+	 * @return マウントできたらtrue
+	 */
+	bool mountCopyOnWrite(const u8* data, u32 size);
+	/**
+	 * @brief アンマウントする
+	 */
+	void unmount();
+	/**
+	 * @brief マウントしているかどうか
+	 */
+	bool isMounted() const noexcept { return image != nullptr; }
+	/**
+	 * @brief ライトプロテクトかどうか
+	 */
+	bool isWriteProtected() const noexcept { return writeProtect; }
+	/**
+	 * @brief コピーオンライトでマウントしているかどうか
+	 */
+	bool isCopyOnWrite() const noexcept { return overlay != nullptr; }
+	/**
+	 * @brief ディスクの種類を取得する(2D:0x00 2DD:0x10 2HD:0x20 1D:0x30 1DD:0x40。2Dの生イメージは0x00)
+	 */
+	u8 getDiskType() const noexcept { return diskType; }
+	/**
+	 * @brief イメージの内容を入れ替えた回数を取得する
+	 *
+	 * マウント、アンマウント、オーバーレイを捨てた時と、touch()で増える。
+	 * writeRecord()では増えないので、内容から作ったキャッシュは、書き込んだレコードを自分で確認すること。
+	 */
+	u32 getSerial() const noexcept { return serial; }
+	/**
+	 * @brief ホスト側でイメージを書き換えたことを知らせる
+	 */
+	void touch() noexcept { serial++; }
+
+	/**
+	 * @brief レコードの数を取得する
+	 */
+	u32 getRecordCount() const noexcept { return sectorCount; }
+	/**
+	 * @brief レコードのデータのサイズを取得する
+	 * @param[in]	record	レコード番号
+	 * @return データのサイズ(0:範囲外)
+	 */
+	u32 getRecordSize(const u32 record) const noexcept { return record < sectorCount ? sectors[record].size : 0; }
+	/**
+	 * @brief 読み込むレコードのデータを取得する
+	 * @param[in]	record	レコード番号
+	 * @return データ(RECORD_SIZEバイト。nullptr:範囲外か、セクタがRECORD_SIZEより小さい)
+	 */
+	const u8* readRecord(const u32 record) const noexcept
+	{
+		if(record >= sectorCount || sectors[record].size < RECORD_SIZE) {
+			return nullptr;
+		}
+		if(overlay && overlay[record]) {
+			return overlay[record];
+		}
+		return &image[sectors[record].offset];
+	}
+	/**
+	 * @brief 書き込むレコードのデータを取得する
+	 *
+	 * 書き込んだレコードとして覚えておく。コピーオンライトの時は、初めて書き込むレコードをオーバーレイにコピーする。
+	 * @param[in]	record	レコード番号
+	 * @return データ(RECORD_SIZEバイト。nullptr:範囲外か、セクタがRECORD_SIZEより小さい)
+	 */
+	u8* writeRecord(const u32 record) noexcept;
+	/**
+	 * @brief レコードのデータを取得する(書き込んだレコードとしては覚えない)
+	 *
+	 * ホスト側が同じデータを参照する時に使う。
+	 * @param[in]	record	レコード番号
+	 * @return データ(getRecordSize()バイト。nullptr:範囲外か、コピーオンライト)
+	 */
+	u8* getRecordData(const u32 record) noexcept { return (record < sectorCount && ownedImage) ? &ownedImage[sectors[record].offset] : nullptr; }
+
+	/**
+	 * @brief 書き込んだレコードの数を取得する
+	 */
+	u32 getDirtyCount() const noexcept { return dirtyCount; }
+	/**
+	 * @brief 書き込んだレコードかどうか
+	 * @param[in]	record	レコード番号
+	 */
+	bool isDirty(const u32 record) const noexcept { return record < sectorCount && (dirty[record >> 5] & (1u << (record & 31))); }
+	/**
+	 * @brief 書き込んだレコードを忘れる(ホスト側で保存した後に呼び出す)
+	 */
+	void clearDirty() noexcept;
+
+	/**
+	 * @brief オーバーレイに持っているレコードの数を取得する
+	 */
+	u32 getOverlayCount() const noexcept { return overlayCount; }
+	/**
+	 * @brief オーバーレイを捨てて、マウントした時のイメージに戻す
+	 */
+	void discardOverlay() noexcept;
+
+	/**
+	 * @brief イメージを取得する
+	 *
+	 * コピーオンライトの時は、マウントしたイメージのまま(書き込んだ内容はcopyImage()で取り出す)。
+	 */
+	const u8* getImage() const noexcept { return image; }
+	u32 getImageSize() const noexcept { return imageSize; }
+	/**
+	 * @brief 書き込んだ内容も入れたイメージをコピーする
+	 * @param[out]	buffer	コピー先
+	 * @param[in]	size	コピー先のサイズ(getImageSize()以上)
+	 * @return コピーできたらtrue
+	 */
+	bool copyImage(u8* buffer, u32 size) const noexcept;
+};
+
+} // namespace disk
@@ -0,0 +1,141 @@
+﻿#include "catFileIndex.h"
+
+namespace disk {
+
+u32
+CatFileIndex::hashName(const u8* name) noexcept
+{
+	// FNV-1a
+	u32 hash = 0x811C9DC5;
+	for(u32 i = 0; i < NAME_SIZE; ++i) {
+		hash = (hash ^ name[i]) * 0x01000193;
+	}
+	return hash;
+}
+
+u32
+CatFileIndex::getMaxCluster(const u8 diskType) noexcept
+{
+	switch(diskType) {
+		case 0x00: return 80;	// 2D
+		case 0x10: return 160;	// 2DD
+		case 0x20: return 250;	// 2HD
+		case 0x30: return 35;	// 1D
+		default: return 0;		// 1DDはJavaScript側も対応していない
+	}
+}
+
+bool
+CatFileIndex::buildDirectory()
+{
+	for(auto& it : table) {
+		it = 0;
+	}
+	entryCount = ENTRY_MAX;
+	freeEntry = NOT_FOUND;
+	for(u32 entry = 0; entry < ENTRY_MAX; ++entry) {
+		const u32 offset = (entry % ENTRIES_PER_RECORD) * ENTRY_SIZE;
+		const u8* data = disk->readRecord(dirps + entry / ENTRIES_PER_RECORD);
+		if(!data) {
+			return false;
+		}
+		const u8 attribute = data[offset];
+		if(attribute == 0x00 || attribute == 0xFF) {
+			if(freeEntry == NOT_FOUND) {
+				freeEntry = (s32)entry;
+			}
+			if(attribute == 0xFF) {
+				// 終わりのマーカーより後ろは見ない
+				entryCount = entry;
+				break;
+			}
+			continue;
+		}
+		u8* name = names[entry];
+		for(u32 i = 0; i < NAME_SIZE; ++i) {
+			name[i] = data[offset + 1 + i];
+		}
+		if(find(name) != NOT_FOUND) {
+			// 同じ名前は、最初のものだけ
+			continue;
+		}
+		u32 slot = hashName(name);
+		while(table[slot % (ENTRY_MAX * 2)]) {
+			slot++;
+		}
+		table[slot % (ENTRY_MAX * 2)] = (u8)(entry + 1);
+	}
+	return true;
+}
+
+bool
+CatFileIndex::prepare(const CatDiskImage& image, const u32 dirps_, const u32 fatps_, const u32 fatRecords_)
+{
+	if(disk != &image || serial != image.getSerial() || dirps != dirps_ || fatps != fatps_ || fatRecords != fatRecords_) {
+		disk = &image;
+		serial = image.getSerial();
+		dirps = dirps_;
+		fatps = fatps_;
+		fatRecords = fatRecords_;
+		directoryDirty = true;
+		chainDirty = true;
+	}
+	if(directoryDirty) {
+		if(!buildDirectory()) {
+			invalidate();
+			return false;
+		}
+		directoryDirty = false;
+	}
+	if(chainDirty) {
+		for(auto& it : chains) {
+			it.length = 0;
+		}
+		chainDirty = false;
+	}
+	return true;
+}
+
+s32
+CatFileIndex::find(const u8* name) const noexcept
+{
+	for(u32 slot = hashName(name); ; ++slot) {
+		const u32 entry = table[slot % (ENTRY_MAX * 2)];
+		if(!entry) {
+			return NOT_FOUND;
+		}
+		const u8* it = names[entry - 1];
+		u32 i = 0;
+		while(i < NAME_SIZE && it[i] == name[i]) {
+			i++;
+		}
+		if(i == NAME_SIZE) {
+			return (s32)(entry - 1);
+		}
+	}
+}
+
+const u8*
+CatFileIndex::getChain(const u8 start, u32& length)
+{
+	Chain& chain = chains[start];
+	if(!chain.length) {
+		u8 cluster = start;
+		chain.cluster[0] = cluster;
+		u32 count = 1;
+		while(cluster < 0x80 && count < CHAIN_MAX) {
+			// メモ）クラスタは0x80未満なので、FATの最初のレコードにある
+			const u8* fat = disk->readRecord(fatps);
+			if(!fat) {
+				return nullptr;
+			}
+			cluster = fat[cluster];
+			chain.cluster[count++] = cluster;
+		}
+		chain.length = (u8)count;
+	}
+	length = chain.length;
+	return chain.cluster;
+}
+
+} // namespace disk
@@ -0,0 +1,185 @@
+﻿#pragma once
+
+#include "catDiskImage.h"
+
+namespace disk {
+
+/**
+ * @brief S-OS(Hu-BASIC形式)のディレクトリとFATのキャッシュ
+ *
+ * ディレクトリのエントリ(IB)をファイル名で引けるハッシュ表と、FATをたどったクラスタの繋がりを、ディスクごとに持っておく。
+ * #ROPEN、#WOPENでファイルを探す時に、ディレクトリのレコードを毎回読み直さなくて済む。
+ * 検索の規則は、S-OSのDOSモジュール(js/sos/SOS.jsの#dos_fcbsch()、#dos_fresch()、#dos_dload())と同じ。
+ *
+ * ディスクの内容が変わったら作り直す。
+ * ・イメージを入れ替えた(CatDiskImage::getSerial()が変わった)時は、全て作り直す
+ * ・ディレクトリのレコードに書き込んだ(onWrite())時は、ハッシュ表だけを作り直す
+ * ・FATのレコードに書き込んだ(onWrite())時は、クラスタの繋がりだけを捨てる
+ * どれも、次にprepare()を呼び出した時に作り直す。
+ */
+class CatFileIndex {
+public:
+	/**
+	 * @brief ディレクトリのレコード数
+	 */
+	static constexpr u32 DIRECTORY_RECORDS = 16;
+	/**
+	 * @brief エントリ(IB)のサイズ
+	 */
+	static constexpr u32 ENTRY_SIZE = 0x20;
+	/**
+	 * @brief 1レコードのエントリ数
+	 */
+	static constexpr u32 ENTRIES_PER_RECORD = RECORD_SIZE / ENTRY_SIZE;
+	/**
+	 * @brief エントリの最大数
+	 */
+	static constexpr u32 ENTRY_MAX = DIRECTORY_RECORDS * ENTRIES_PER_RECORD;
+	/**
+	 * @brief 比べるファイル名のサイズ(ファイル名13文字＋拡張子3文字)
+	 */
+	static constexpr u32 NAME_SIZE = 16;
+	/**
+	 * @brief 1クラスタのレコード数
+	 */
+	static constexpr u32 CLUSTER_RECORDS = 16;
+	/**
+	 * @brief クラスタの繋がりを覚えておく最大の数
+	 *
+	 * 読み込めるのは64KiBまでなので、16クラスタ分の繋がりと最後のクラスタの値があれば足りる。
+	 */
+	static constexpr u32 CHAIN_MAX = 0x10000 / (CLUSTER_RECORDS * RECORD_SIZE) + 2;
+	/**
+	 * @brief 見つからなかった
+	 */
+	static constexpr s32 NOT_FOUND = -1;
+private:
+	/**
+	 * @brief 作った時のディスク
+	 */
+	const CatDiskImage* disk = nullptr;
+	u32 serial = 0;
+	/**
+	 * @brief 作った時のディレクトリとFATの位置
+	 */
+	u32 dirps = 0;
+	u32 fatps = 0;
+	u32 fatRecords = 0;
+	/**
+	 * @brief ディレクトリを作り直す必要があるかどうか
+	 */
+	bool directoryDirty = true;
+
+	/**
+	 * @brief エントリの数(終わりのマーカー(0xFF)の位置。無ければENTRY_MAX)
+	 */
+	u32 entryCount = 0;
+	/**
+	 * @brief 最初の空きのエントリ(NOT_FOUND:空きが無い)
+	 */
+	s32 freeEntry = NOT_FOUND;
+	/**
+	 * @brief エントリのファイル名
+	 */
+	u8 names[ENTRY_MAX][NAME_SIZE];
+	/**
+	 * @brief ファイル名のハッシュ表(エントリの番号＋1。0:空き)
+	 */
+	u8 table[ENTRY_MAX * 2];
+
+	/**
+	 * @brief 開始クラスタごとのクラスタの繋がり
+	 */
+	struct Chain {
+		u8 length;					// 繋がりの数(0:まだたどっていない)
+		u8 cluster[CHAIN_MAX];		// 開始クラスタから順に、FATの値をたどったもの
+	};
+	Chain chains[0x100];
+	/**
+	 * @brief クラスタの繋がりを捨てる必要があるかどうか
+	 */
+	bool chainDirty = true;
+
+	/**
+	 * @brief ファイル名のハッシュ値を求める
+	 */
+	static u32 hashName(const u8* name) noexcept;
+	/**
+	 * @brief ディレクトリを読み込んで、ハッシュ表を作る
+	 * @return 作れたらtrue(false:終わりのマーカーより前に、読めないレコードがあった)
+	 */
+	bool buildDirectory();
+public:
+	CatFileIndex() = default;
+	CatFileIndex(const CatFileIndex&) = delete;
+	CatFileIndex& operator=(const CatFileIndex&) = delete;
+
+	/**
+	 * @brief ディスクの種類から、FATで管理するクラスタ数を取得する(js/HuBasic/Disk/DiskParameter.mjsと同じ)
+	 * @param[in]	diskType	ディスクの種類(CatDiskImage::getDiskType())
+	 * @return クラスタ数(0:対応していない)
+	 */
+	static u32 getMaxCluster(u8 diskType) noexcept;
+
+	/**
+	 * @brief 使う前に、必要なら作り直す
+	 * @param[in]	image		ディスク
+	 * @param[in]	dirps		ディレクトリの先頭のレコード(#DIRPS)
+	 * @param[in]	fatps		FATの先頭のレコード(#FATPOS)
+	 * @param[in]	fatRecords	FATのレコード数
+	 * @return 使えるならtrue
+	 */
+	bool prepare(const CatDiskImage& image, u32 dirps, u32 fatps, u32 fatRecords);
+	/**
+	 * @brief 全て作り直すようにする
+	 */
+	void invalidate() noexcept { disk = nullptr; }
+	/**
+	 * @brief レコードに書き込んだことを知らせる
+	 * @param[in]	record	書き込んだレコード
+	 */
+	void onWrite(const u32 record) noexcept
+	{
+		if(dirps <= record && record < dirps + DIRECTORY_RECORDS) {
+			directoryDirty = true;
+		}
+		if(fatps <= record && record < fatps + fatRecords) {
+			chainDirty = true;
+		}
+	}
+
+	/**
+	 * @brief ファイル名からエントリを探す(#dos_fcbsch()と同じく、終わりのマーカーより前の最初のもの)
+	 * @param[in]	name	ファイル名(IBの+1から16バイト)
+	 * @return エントリの番号(NOT_FOUND:見つからなかった)
+	 */
+	s32 find(const u8* name) const noexcept;
+	/**
+	 * @brief エントリの数を取得する(終わりのマーカーの位置。無ければENTRY_MAX)
+	 */
+	u32 getEntryCount() const noexcept { return entryCount; }
+	/**
+	 * @brief 最初の空きのエントリを取得する(#dos_fresch()と同じく、未使用か終わりのマーカー)
+	 * @return エントリの番号(NOT_FOUND:空きが無い)
+	 */
+	s32 getFreeEntry() const noexcept { return freeEntry; }
+	/**
+	 * @brief エントリのあるレコードを取得する
+	 * @param[in]	entry	エントリの番号
+	 */
+	u32 getEntryRecord(const u32 entry) const noexcept { return dirps + entry / ENTRIES_PER_RECORD; }
+
+	/**
+	 * @brief クラスタの繋がりを取得する
+	 *
+	 * 開始クラスタから、FATの値を0x80以上(最後のクラスタ)になるまでたどったもの。
+	 * 途中で0x80以上にならなければ(FATが輪になっているなど)、CHAIN_MAX個で打ち切る。
+	 * 打ち切った時は最後の値が0x80未満なので、呼び出し側でデータが残っていないか確認すること。
+	 * @param[in]	start	開始クラスタ
+	 * @param[out]	length	繋がりの数
+	 * @return クラスタの繋がり(nullptr:FATのレコードが読めない)
+	 */
+	const u8* getChain(u8 start, u32& length);
+};
+
+} // namespace disk
@@ -27,8 +27,10 @@ clang -DBUILD_WASM=32 -std=c++20 -O3 -fno-builtin --target=wasm32 -c platform/de
 clang -DBUILD_WASM=32 -std=c++20 -O3 -fno-builtin --target=wasm32 -c platform/device/catIntel8253.cpp -o ./catIntel8253.o
 clang -DBUILD_WASM=32 -std=c++20 -O3 -fno-builtin --target=wasm32 -c platform/device/catTape.cpp -o ./catTape.o
 clang -DBUILD_WASM=32 -std=c++20 -O3 -fno-builtin --target=wasm32 -c platform/device/catTapeImage.cpp -o ./catTapeImage.o
+clang -DBUILD_WASM=32 -std=c++20 -O3 -fno-builtin --target=wasm32 -c disk/catDiskImage.cpp -o ./catDiskImage.o
+clang -DBUILD_WASM=32 -std=c++20 -O3 -fno-builtin --target=wasm32 -c disk/catFileIndex.cpp -o ./catFileIndex.o
 
-clang "-Wl,--no-entry" "-Wl,--export-all" "-Wl,--import-memory" -fno-builtin -nostdlib --target=wasm32 -o sos.wasm sos.o catLowMemory.o clang.o platform.o catPlatformFactory.o catCtc.o catCRTC.o catPCG.o catPlatformX1.o catPlatformMZ700.o cat8253.o catIntel8253.o catTape.o catTapeImage.o
+clang "-Wl,--no-entry" "-Wl,--export-all" "-Wl,--import-memory" -fno-builtin -nostdlib --target=wasm32 -o sos.wasm sos.o catLowMemory.o clang.o platform.o catPlatformFactory.o catCtc.o catCRTC.o catPCG.o catPlatformX1.o catPlatformMZ700.o cat8253.o catIntel8253.o catTape.o catTapeImage.o catDiskImage.o catFileIndex.o
 clang "-Wl,--no-entry" "-Wl,--export-all" "-Wl,--import-memory" -fno-builtin -nostdlib --target=wasm32 -o psg.wasm catPsg.o emu2149.o catLowMemory.o clang.o fmgen.o fmtimer.o opm.o catOPM.o
 
 copy sos.wasm ..\..\sos.wasm
@@ -1,4 +1,5 @@
 ﻿#include "cat8253.h"
+#include "../catSerializer.h"
 #if ENABLE_TARGET_MZ700
 
 namespace Intel8253 {
@@ -45,23 +46,29 @@ CatMZ8253::reset()
 void
 CatMZ8253::tick(s32 tick)
 {
-	// ch0 : 894.88625kHz
-	// ch1 :  15.7kHz
-	constexpr double cpuFeq = 4000000.0;
-	constexpr double ch0    = cpuFeq/(894.88625*1000.0);
-	constexpr double ch1    = cpuFeq/(15.700000*1000.0);
-	tickSum[0] += tick;
-	tickSum[1] += tick;
-	while((tickSum[0] >= ch0) || (tickSum[1] >= ch1)) {
-		if(tickSum[0] >= ch0) {
-			tickSum[0] -= ch0;
-			counters[0]->tick(1);
-		}
-		if(tickSum[1] >= ch1) {
-			tickSum[1] -= ch1;
-			counters[1]->tick(1);
-		}
+	tickSum[0] += (u64)tick * CH0_NUM;
+	tickSum[1] += (u64)tick * CH1_NUM;
+	while(tickSum[0] >= CH0_DEN) {
+		tickSum[0] -= CH0_DEN;
+		counters[0]->tick(1);
 	}
+	while(tickSum[1] >= CH1_DEN) {
+		tickSum[1] -= CH1_DEN;
+		counters[1]->tick(1);
+	}
+}
+
+s32
+CatMZ8253::getEventClock() const noexcept
+{
+	return (s32)((CH1_DEN - tickSum[1] + CH1_NUM - 1) / CH1_NUM);
+}
+
+void
+CatMZ8253::serialize(CatSerializer& serializer)
+{
+	CatIntel8253::serialize(serializer);
+	serializer.value(tickSum);
 }
 
 } // namespace Intel8253
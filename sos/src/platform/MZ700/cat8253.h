@@ -6,7 +6,14 @@
 namespace Intel8253 {
 
 class CatMZ8253 : public CatIntel8253 {
-	s32 tickSum[3];
+	// ch0 : 894.88625kHz (3.579545MHz / 4)
+	// ch1 :  15.7kHz
+	// メモ）誤差が溜まらないように、CPUのクロックとの比を整数で持つ
+	static constexpr u64 CH0_NUM = 3579545;
+	static constexpr u64 CH0_DEN = 16000000;
+	static constexpr u64 CH1_NUM = 157;
+	static constexpr u64 CH1_DEN = 40000;
+	u64 tickSum[2];
 	static void outTriggerCallback(const u8 channel, class Counter* chain, bool out, void* userData);
 public:
 	/**
@@ -16,15 +23,28 @@ public:
 
 	/**
 	 * @brief カウンタを進める
-	 * @param[in]	tick	進める値
-	 * @note	進める値は無視される。常に１つ進める。
+	 * @param[in]	tick	進めるCPUのクロック数
 	 */
 	virtual void tick(s32 tick) override;
 
+	/**
+	 * @brief チャンネル1が次にカウントされるまでのCPUのクロック数を取得する
+	 * 
+	 * チャンネル2と割り込みは、チャンネル1のカウントでしか変化しない。
+	 * @return クロック数
+	 */
+	s32 getEventClock() const noexcept;
+
 	/**
 	 * @brief リセット
 	 */
 	virtual void reset() override;
+
+	/**
+	 * @brief 状態を保存／復元する
+	 * @param[in,out]	serializer	シリアライザ
+	 */
+	virtual void serialize(CatSerializer& serializer) override;
 };
 
 } // namespace Intel8253
@@ -108,39 +108,36 @@ public:
 	}
 
 	/**
-	 * @brief
+	 * @brief 次に状態が変わるまでのクロック数を取得する
+	 * @return 次のHBlankの開始、または、次のラインの開始までのクロック数
 	 */
-	void adjustTick(s32& tick)
+	s64 getEventClock() const noexcept
 	{
 		const auto lineClock = counter % LINE_PER_CLOCK;
 		if(lineClock < HDISPLAY_CLOCK) {
-			tick = min(tick, HDISPLAY_CLOCK - lineClock);
+			return HDISPLAY_CLOCK - lineClock;
 		} else {
-			tick = min(tick, LINE_PER_CLOCK - lineClock);
-		}
-		if(counter < FRAME_DISPLAY_CLOCK) {
-			tick = min(tick, FRAME_DISPLAY_CLOCK - counter);
-		} else if(counter < FRAME_CLOCK) {
-			tick = min(tick, FRAME_CLOCK - counter);
+			return LINE_PER_CLOCK - lineClock;
 		}
 	}
 
 	/**
 	 * @brief
 	 */
-	void tick(s32 tick)
+	void tick(s64 tick)
 	{
-		const auto lineClock = counter % LINE_PER_CLOCK;
-		if(lineClock < HDISPLAY_CLOCK) {
-			// 描画中
-			auto line = counter / LINE_PER_CLOCK;
-			execLine(line); // @todo HBlankに入ったら描画するようにすると、軽くなるはず
-		} else {
-			// HBlank中
-		}
-		counter += tick;
-		while(counter >= FRAME_CLOCK) {
-			counter -= FRAME_CLOCK;
+		while(tick > 0) {
+			const auto lineClock = counter % LINE_PER_CLOCK;
+			const auto step = min(tick, getEventClock());
+			counter += step;
+			tick -= step;
+			if((lineClock < HDISPLAY_CLOCK) && (counter % LINE_PER_CLOCK == HDISPLAY_CLOCK) && (counter < FRAME_DISPLAY_CLOCK)) {
+				// HBlankに入ったので、そのラインを描画する
+				execLine(counter / LINE_PER_CLOCK);
+			}
+			if(counter >= FRAME_CLOCK) {
+				counter -= FRAME_CLOCK;
+			}
 		}
 	}
 
@@ -170,6 +167,17 @@ public:
 	 * @return VBlank期間中なら true を返す
 	 */
 	bool isVBlank() const noexcept { return counter >= FRAME_DISPLAY_CLOCK; }
+	/**
+	 * @brief 状態を保存／復元する
+	 * @param[in,out]	serializer	シリアライザ
+	 */
+	void serialize(CatSerializer& serializer) noexcept
+	{
+		serializer.value(counter);
+		if(serializer.isLoading() && (counter < 0 || FRAME_CLOCK <= counter)) [[unlikely]] {
+			serializer.fail();
+		}
+	}
 };
 
 /**
@@ -202,21 +210,24 @@ public:
 	}
 
 	/**
-	 * @brief
+	 * @brief 次に表示状態が変わるまでのクロック数を取得する
+	 * @return クロック数
 	 */
-	void adjustTick(s32& tick)
+	s32 getEventClock() const noexcept
 	{
+		if(counter <= (CURSOR_BLINK_COUNT / 2)) {
+			return (CURSOR_BLINK_COUNT / 2) + 1 - counter;
+		} else {
+			return CURSOR_BLINK_COUNT - counter;
+		}
 	}
 
 	/**
 	 * @brief
 	 */
-	void tick(s32 tick)
+	void tick(s64 tick)
 	{
-		counter += tick;
-		while(counter >= CURSOR_BLINK_COUNT) {
-			counter -= CURSOR_BLINK_COUNT;
-		}
+		counter = (s32)((counter + tick) % CURSOR_BLINK_COUNT);
 	}
 
 	/**
@@ -224,6 +235,14 @@ public:
 	 * @return カーソル表示状態
 	 */
 	bool isActive() const noexcept { return counter > (CURSOR_BLINK_COUNT / 2); }
+	/**
+	 * @brief 状態を保存／復元する
+	 * @param[in,out]	serializer	シリアライザ
+	 */
+	void serialize(CatSerializer& serializer) noexcept
+	{
+		serializer.value(counter);
+	}
 };
 
 
@@ -399,7 +418,6 @@ CatPlatformMZ700::CatPlatformMZ700()
 	, tape(new tape::CatTape())
 	, tempo(0)
 	, currentTick(0)
-	, counter(0)
 {
 	tape->setConfig({
 		.halfShortPeriod = 200.0
@@ -461,6 +479,16 @@ CatPlatformMZ700::initialize(void* config)
 
 	// 8253タイマの初期化
 	timer8253->reset();
+
+	// イベント
+	scheduler.reset();
+	vhBlankClock = 0;
+	cursorTimerClock = 0;
+	timer8253Clock = 0;
+	sliceGlobalTick = getGlobalTick();
+	scheduler.schedule(EVENT_VHBLANK, vhBlank->getEventClock());
+	scheduler.schedule(EVENT_CURSOR, cursorTimer->getEventClock());
+	scheduler.schedule(EVENT_8253, timer8253->getEventClock());
 	return 0;
 }
 
@@ -479,7 +507,6 @@ CatPlatformMZ700::terminate()
 	priority = false;
 	tempo = 0;
 	currentTick = 0;
-	counter = 0;
 }
 
 void
@@ -491,11 +518,9 @@ CatPlatformMZ700::resetTick()
 bool
 CatPlatformMZ700::adjustTick(s32& tick)
 {
-	vhBlank->adjustTick(tick);
-	cursorTimer->adjustTick(tick);
-	timer8253->adjustTick(tick);
-
-	if(tick > 64) { tick = 64; } // @todo 不要かも？
+	sliceGlobalTick = getGlobalTick();
+	// 次のイベントまで実行する
+	scheduler.adjustTick(tick);
 
 	// HBlank待ちのCPUストール
 	// true を返すと CPUの更新処理がされない
@@ -506,29 +531,69 @@ void
 CatPlatformMZ700::tick(s32 tick)
 {
 	s32 diff = tick - currentTick;
-
-	// VBlankとHBlank進める
-	vhBlank->tick(diff);
-	// HBlankまでストールさせる
-	if(vhBlank->isHBlank()) {
-		waitHBlank = false;
-		// 保留していた書き込みを、ここで書き込む
-		if(writeBufferAddress) {
-			tvram[writeBufferAddress] = writeBufferValue;
-			writeBufferAddress = 0;
-		}
-		setVRAMDirty();
+	if(diff > 0) [[likely]] {
+		currentTick += diff;
+		sliceGlobalTick = getGlobalTick();
+		scheduler.progress(scheduler.getNow() + diff, [this](s32 id) { processEvent(id); });
 	}
+}
 
-	// カーソル点滅
-	cursorTimer->tick(diff);
+u64
+CatPlatformMZ700::getCurrentClock() const noexcept
+{
+	return scheduler.getNow() + (getGlobalTick() - sliceGlobalTick);
+}
 
-	// 8253のタイマー
-	timer8253->tick(diff);
+void
+CatPlatformMZ700::sync8253()
+{
+	const u64 now = getCurrentClock();
+	if(timer8253Clock < now) {
+		timer8253->tick((s32)(now - timer8253Clock));
+		timer8253Clock = now;
+	}
+}
 
-	if(diff > 0) [[likely]] {
-		currentTick += diff;
-		counter += diff;
+void
+CatPlatformMZ700::resetCursorTimer()
+{
+	cursorTimer->reset();
+	cursorTimerClock = getCurrentClock();
+	scheduler.schedule(EVENT_CURSOR, cursorTimerClock + cursorTimer->getEventClock());
+}
+
+void
+CatPlatformMZ700::processEvent(s32 id)
+{
+	const u64 now = scheduler.getNow();
+	switch(id) {
+		case EVENT_VHBLANK:
+			// VBlankとHBlank進める
+			vhBlank->tick(now - vhBlankClock);
+			vhBlankClock = now;
+			// HBlankまでストールさせる
+			if(vhBlank->isHBlank()) {
+				waitHBlank = false;
+				// 保留していた書き込みを、ここで書き込む
+				if(writeBufferAddress) {
+					tvram[writeBufferAddress] = writeBufferValue;
+					writeBufferAddress = 0;
+				}
+				setVRAMDirty();
+			}
+			scheduler.schedule(EVENT_VHBLANK, now + vhBlank->getEventClock());
+			break;
+		case EVENT_CURSOR:
+			// カーソル点滅
+			cursorTimer->tick(now - cursorTimerClock);
+			cursorTimerClock = now;
+			scheduler.schedule(EVENT_CURSOR, now + cursorTimer->getEventClock());
+			break;
+		case EVENT_8253:
+			// 8253のタイマー
+			sync8253();
+			scheduler.schedule(EVENT_8253, timer8253Clock + timer8253->getEventClock());
+			break;
 	}
 }
 
@@ -567,6 +632,10 @@ CatPlatformMZ700::platformOutPort(u8* io, u16 port, u8 value)
 			}
 			break;
 	}
+	if(0xE0 <= (port & 0xFF) && (port & 0xFF) <= 0xE6) {
+		// メモリの割り当てが変わったので
+		updateMemoryMap();
+	}
 }
 
 u8
@@ -614,7 +683,7 @@ CatPlatformMZ700::platformWriteMemoryVRAM_IO_ROM(u8* mem, u16 address, u8 value)
 			case 0xE000: // 8255 ポートA
 				tvram[address] = value;
 				// 556RST
-				if((value & 0x80) == 0) [[unlikely]] { cursorTimer->reset(); }
+				if((value & 0x80) == 0) [[unlikely]] { resetCursorTimer(); }
 				return;
 			case 0xE001: // 8255 ポートB
 				return;
@@ -653,18 +722,23 @@ CatPlatformMZ700::platformWriteMemoryVRAM_IO_ROM(u8* mem, u16 address, u8 value)
 				}
 				return;
 			case 0xE004:
+				sync8253();
 				timer8253->write(0, value);
 				return;
 			case 0xE005:
+				sync8253();
 				timer8253->write(1, value);
 				return;
 			case 0xE006:
+				sync8253();
 				timer8253->write(2, value);
 				return;
 			case 0xE007:
+				sync8253();
 				timer8253->write(3, value);
 				return;
 			case 0xE008:
+				sync8253();
 				timer8253->setGate(0, (value & 1) != 0);
 				return;
 		}
@@ -794,7 +868,7 @@ CatPlatformMZ700::platformReadMemoryVRAM_IO_ROM(u8* mem, u16 address)
 					// キーボードマトリクスのデータ入力
 					u8 strobe = tvram[0xE000] & 0xF; // 0～9
 					if(strobe > 9) { strobe = 9; }
-					u8* scan = (u8*)scanKey();
+					const u8* scan = inputScanKey();
 					return scan[strobe];
 				}
 			case 0xE002: // 8255 ポートC
@@ -808,12 +882,16 @@ CatPlatformMZ700::platformReadMemoryVRAM_IO_ROM(u8* mem, u16 address)
 			case 0xE003: // 
 				return 0xFF;
 			case 0xE004:
+				sync8253();
 				return timer8253->read(0);
 			case 0xE005:
+				sync8253();
 				return timer8253->read(1);
 			case 0xE006:
+				sync8253();
 				return timer8253->read(2);
 			case 0xE007:
+				sync8253();
 				return timer8253->read(3);
 			case 0xE008:
 				{
@@ -848,6 +926,52 @@ CatPlatformMZ700::platformReadMemory(u8* mem, u16 address)
 	return mem[address];
 }
 
+bool
+CatPlatformMZ700::isIdleMemory(u16 address)
+{
+	if(0xE000 <= address && !bankSwitchPCG && (bank1 != 0)) {
+		switch(address) {
+			case 0xE002: // 8255 ポートC
+				// テープの読み込みデータは時間で変わる
+				return !tape->getMotorState();
+			case 0xE004: // 8253
+			case 0xE005:
+			case 0xE006:
+			case 0xE007:
+				// カウンタは時間で変わる
+				return false;
+			case 0xE008:
+				// 読む度にテンポが変わる
+				return false;
+		}
+	}
+	// VBlank・HBlank・カーソル点滅はイベントで、キーボードはjs側でしか変わらない
+	return true;
+}
+
+u8*
+CatPlatformMZ700::getMemoryPage(u8* mem, u16 address, bool write)
+{
+	if(address <= 0x0FFF) {
+		if(bank0 != 0) {
+			return &tvram[address]; // IPL_ROM
+		}
+	} else if(0xD000 <= address) {
+		if(bankSwitchPCG) {
+			// PCG
+			return nullptr;
+		} else if(bank1 != 0) {
+			// VRAMの読み込みは直接行う
+			// メモ）VRAMの書き込みはウェイトと画面の更新があり、E000～はI/Oなので直接アクセスできない
+			if(!write && address <= 0xDFFF) {
+				return &tvram[address];
+			}
+			return nullptr;
+		}
+	}
+	return &mem[address];
+}
+
 void*
 CatPlatformMZ700::render()
 {
@@ -867,6 +991,49 @@ CatPlatformMZ700::readPCG(u32 ch, u8* data)
 {
 }
 
+void
+CatPlatformMZ700::serialize(CatSerializer& serializer)
+{
+	// バンク
+	serializer.value(bank0);
+	serializer.value(bank1);
+	serializer.value(bankPCG);
+	serializer.value(bankSwitchPCG);
+	// テキストVRAMなど
+	serializer.pages(tvram, sizeof(tvram));
+	serializer.value(waitHBlank);
+	serializer.value(writeBufferAddress);
+	serializer.value(writeBufferValue);
+	serializer.value(isTextVRAMDirty);
+	serializer.value(pcgdisp);
+	serializer.value(priority);
+	// パレット
+	serializer.value(paletteR);
+	serializer.value(paletteG);
+	serializer.value(paletteB);
+	// デバイス
+	pcg->serialize(serializer);
+	vhBlank->serialize(serializer);
+	cursorTimer->serialize(serializer);
+	timer8253->serialize(serializer);
+	tape->serialize(serializer);
+	serializer.value(tempo);
+	serializer.value(currentTick);
+	// イベント
+	scheduler.serialize(serializer);
+	serializer.value(vhBlankClock);
+	serializer.value(cursorTimerClock);
+	serializer.value(timer8253Clock);
+	serializer.value(sliceGlobalTick);
+	if(serializer.isLoading() && !serializer.isFailed()) {
+		// 画面のイメージはHBlank毎に1ラインずつ描いているので、全ラインを描き直しておく
+		for(s32 line = 0; line < 200; ++line) {
+			renderLineText(line);
+		}
+		setVRAMDirty();
+	}
+}
+
 void
 CatPlatformMZ700::requestIRQ8253()
 {
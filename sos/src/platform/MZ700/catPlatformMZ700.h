@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "../catPlatformBase.h"
+#include "../catScheduler.h"
 
 #if ENABLE_TARGET_MZ700
 
@@ -176,7 +177,30 @@ class CatPlatformMZ700 : public CatPlatformBase {
 	u8 tempo; // テンポタイマー入力 @todo ?
 
 	s32 currentTick;
-	u64 counter = 0;
+
+	/**
+	 * @brief イベント
+	 */
+	enum Event : s32 {
+		EVENT_VHBLANK,	// HBlankの開始と、ラインの開始
+		EVENT_CURSOR,	// カーソルの点滅
+		EVENT_8253,		// 8253のチャンネル1のカウント
+		EVENT_COUNT,
+	};
+	/**
+	 * @brief イベントのスケジューラ
+	 */
+	CatScheduler<EVENT_COUNT> scheduler;
+	/**
+	 * @brief 各デバイスを進めた時刻(クロック)
+	 */
+	u64 vhBlankClock = 0;
+	u64 cursorTimerClock = 0;
+	u64 timer8253Clock = 0;
+	/**
+	 * @brief CPUの実行を開始した時のグローバルTick
+	 */
+	u64 sliceGlobalTick = 0;
 public:
 	/**
 	 * @brief グラフィックのVRAMのサイズ
@@ -211,6 +235,27 @@ private:
 	u8 platformReadMemoryVRAM_IO_ROM(u8* mem, u16 address);
 	u8 platformReadMemoryPCG(u8* mem, u16 address);
 
+	/**
+	 * @brief 現在の時刻を取得する
+	 * 
+	 * CPUの実行中は、実行したクロック分も含める。
+	 * @return 現在の時刻(クロック)
+	 */
+	u64 getCurrentClock() const noexcept;
+	/**
+	 * @brief 8253を現在の時刻まで進める
+	 */
+	void sync8253();
+	/**
+	 * @brief カーソル点滅のタイマをリセットする
+	 */
+	void resetCursorTimer();
+	/**
+	 * @brief イベントの処理
+	 * @param[in]	id	イベントID
+	 */
+	void processEvent(s32 id);
+
 public:
 	/**
 	 * @brief 8253からの割り込み要請
@@ -246,6 +291,9 @@ public:
 
 	virtual void platformWriteMemory(u8* mem, u16 address, u8 value) override;
 	virtual u8 platformReadMemory(u8* mem, u16 address) override;
+	virtual bool isIdlePort(u16 port) override { return true; }
+	virtual bool isIdleMemory(u16 address) override;
+	virtual u8* getMemoryPage(u8* mem, u16 address, bool write) override;
 
 	/**
 	 * @brief 機種毎のOUT処理
@@ -281,6 +329,12 @@ public:
 	 * @param[out]	data	PCGデータ
 	 */
 	virtual void readPCG(u32 ch, u8* data) override;
+
+	/**
+	 * @brief 機種毎の状態の保存／復元
+	 * @param[in,out]	serializer	シリアライザ
+	 */
+	virtual void serialize(CatSerializer& serializer) override;
 };
 
 #endif // ENABLE_TARGET_MZ700
@@ -1,4 +1,5 @@
 ﻿#include "catCRTC.h"
+#include "../catSerializer.h"
 
 CatCRTC::CatCRTC(const u16 baseAddress)
 	: baseAddress(baseAddress)
@@ -64,3 +65,10 @@ CatCRTC::readRegister(const u8 registerNo) const noexcept
 	}
 	return registers[registerNo];
 }
+
+void
+CatCRTC::serialize(CatSerializer& serializer)
+{
+	serializer.value(accessRegisterNo);
+	serializer.value(registers);
+}
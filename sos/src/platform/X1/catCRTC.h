@@ -2,6 +2,8 @@
 
 #include "../../cat/low/catLowBasicTypes.h"
 
+class CatSerializer;
+
 /**
  * CRTC
  */
@@ -96,4 +98,10 @@ public:
 	 * @return レジスタの値
 	 */
 	u8 readRegister(const u8 registerNo) const noexcept;
+
+	/**
+	 * @brief 状態を保存／復元する
+	 * @param[in,out]	serializer	シリアライザ
+	 */
+	void serialize(CatSerializer& serializer);
 };
@@ -1,4 +1,5 @@
 ﻿#include "catPCG.h"
+#include "../catSerializer.h"
 
 WASM_IMPORT("log", "logHex04")
 extern "C" void jslogHex04(int operandNumber);
@@ -164,3 +165,14 @@ CatPCG::setPCG(u32 ch, u8 p0, u8 p1, u8 p2, u8 p3, u8 p4, u8 p5, u8 p6, u8 p7)
 		pcg[ch * 24 + i*8 + 7] = p7;
 	}
 }
+
+void
+CatPCG::serialize(CatSerializer& serializer)
+{
+	serializer.value(indexB);
+	serializer.value(indexG);
+	serializer.value(indexR);
+	serializer.value(indexROM);
+	serializer.pages(pcg, sizeof(pcg));
+	serializer.value(ch);
+}
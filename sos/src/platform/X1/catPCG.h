@@ -2,6 +2,8 @@
 
 #include "../../cat/low/catLowBasicTypes.h"
 
+class CatSerializer;
+
 class CatPCG {
 	u8 indexB;
 	u8 indexG;
@@ -57,4 +59,10 @@ public:
 
 	void setPCG(u32 ch, u8* data);
 	void setPCG(u32 ch, u8 p0, u8 p1, u8 p2, u8 p3, u8 p4, u8 p5, u8 p6, u8 p7);
+
+	/**
+	 * @brief 状態を保存／復元する
+	 * @param[in,out]	serializer	シリアライザ
+	 */
+	void serialize(CatSerializer& serializer);
 };
@@ -274,6 +274,13 @@ CatPlatformX1::initialize(void* config)
 	ctc_070C->initialize();
 	pcg->initialize();
 
+	// イベント
+	scheduler.reset();
+	ctcClock = 0;
+	sliceGlobalTick = getGlobalTick();
+	vBlank = false;
+	scheduler.schedule(EVENT_VSYNC, diskTick);
+
 	clearTextAndAttribute(0x20, 0x07);
 
 	/*
@@ -324,14 +331,9 @@ CatPlatformX1::resetTick()
 bool
 CatPlatformX1::adjustTick(s32& tick)
 {
-	// CTC
-	ctc->adjustClock(tick);
-	ctc_0704->adjustClock(tick);
-	ctc_070C->adjustClock(tick);
-
-	if(tick > lineTick) {
-		tick = lineTick;
-	}
+	sliceGlobalTick = getGlobalTick();
+	// 次のイベントまで実行する
+	scheduler.adjustTick(tick);
 	return false;
 }
 
@@ -341,32 +343,70 @@ CatPlatformX1::tick(s32 tick)
 	s32 diff = tick - currentTick;
 	if(diff > 0) {
 		currentTick += diff;
-		// CTC
-		if(s32 irq = ctc->execute(diff); irq >= 0) {
+		sliceGlobalTick = getGlobalTick();
+		scheduler.progress(scheduler.getNow() + diff, [this](s32 id) { processEvent(id); });
+	}
+}
+
+u64
+CatPlatformX1::getCurrentClock() const noexcept
+{
+	return scheduler.getNow() + (getGlobalTick() - sliceGlobalTick);
+}
+
+void
+CatPlatformX1::syncCTC()
+{
+	const u64 now = getCurrentClock();
+	while(ctcClock < now) {
+		constexpr u64 MAX_CLOCK = 0x1000'0000;
+		const s32 clock = (s32)((now - ctcClock < MAX_CLOCK) ? (now - ctcClock) : MAX_CLOCK);
+		ctcClock += clock;
+		if(s32 irq = ctc->execute(clock); irq >= 0) {
 			// 必要ならIRQの割り込みを発生させる
 			generateIRQ(irq);
 		}
-		if(s32 irq = ctc_0704->execute(diff); irq >= 0) {
+		if(s32 irq = ctc_0704->execute(clock); irq >= 0) {
 			// 必要ならIRQの割り込みを発生させる
 			generateIRQ(irq);
 		}
-		if(s32 irq = ctc_070C->execute(diff); irq >= 0) {
+		if(s32 irq = ctc_070C->execute(clock); irq >= 0) {
 			// 必要ならIRQの割り込みを発生させる
 			generateIRQ(irq);
 		}
+	}
+}
 
-		// 
-		counter += diff;
-		// VSYNC
-		vBlank = false;
-		if(counterNextVSync <= counter) {
-			if(counter <= counterNextVSyncEnd) {
-				vBlank = true;
-			} else {
-				counterNextVSync    = counter + diskTick;
-				counterNextVSyncEnd = counterNextVSync + vBlankTick;
-			}
-		}
+void
+CatPlatformX1::scheduleCTC()
+{
+	s32 clock = ctc->getEventClock();
+	if(const s32 tmp = ctc_0704->getEventClock(); tmp >= 0 && (clock < 0 || tmp < clock)) {
+		clock = tmp;
+	}
+	if(const s32 tmp = ctc_070C->getEventClock(); tmp >= 0 && (clock < 0 || tmp < clock)) {
+		clock = tmp;
+	}
+	if(clock >= 0) {
+		scheduler.schedule(EVENT_CTC, ctcClock + clock);
+	} else {
+		scheduler.cancel(EVENT_CTC);
+	}
+}
+
+void
+CatPlatformX1::processEvent(s32 id)
+{
+	switch(id) {
+		case EVENT_CTC:
+			syncCTC();
+			scheduleCTC();
+			break;
+		case EVENT_VSYNC:
+			// VBlankの開始と終了
+			vBlank = !vBlank;
+			scheduler.schedule(EVENT_VSYNC, scheduler.getNow() + (vBlank ? vBlankTick : diskTick));
+			break;
 	}
 }
 
@@ -492,36 +532,56 @@ CatPlatformX1::platformOutPort(u8* io, u16 port, u8 value)
 		// PSG Register address set
 		io[0x1C00] = value;
 	} else if(port == 0x1FA0) {
-		//tick(getExecutedClock());
+		syncCTC();
 		ctc->write8(0, value);
+		scheduleCTC();
 	} else if(port == 0x1FA1) {
-		//tick(getExecutedClock());
+		syncCTC();
 		ctc->write8(1, value);
+		scheduleCTC();
 	} else if(port == 0x1FA2) {
-		//tick(getExecutedClock());
+		syncCTC();
 		ctc->write8(2, value);
+		scheduleCTC();
 	} else if(port == 0x1FA3) {
-		//tick(getExecutedClock());
+		syncCTC();
 		ctc->write8(3, value);
+		scheduleCTC();
 #if CTC_0704
 	} else if(port == 0x0704) {
+		syncCTC();
 		ctc_0704->write8(0, value);
+		scheduleCTC();
 	} else if(port == 0x0705) {
+		syncCTC();
 		ctc_0704->write8(1, value);
+		scheduleCTC();
 	} else if(port == 0x0706) {
+		syncCTC();
 		ctc_0704->write8(2, value);
+		scheduleCTC();
 	} else if(port == 0x0707) {
+		syncCTC();
 		ctc_0704->write8(3, value);
+		scheduleCTC();
 #endif
 #if CTC_070C
 	} else if(port == 0x070C) {
+		syncCTC();
 		ctc_070C->write8(0, value);
+		scheduleCTC();
 	} else if(port == 0x070D) {
+		syncCTC();
 		ctc_070C->write8(1, value);
+		scheduleCTC();
 	} else if(port == 0x070E) {
+		syncCTC();
 		ctc_070C->write8(2, value);
+		scheduleCTC();
 	} else if(port == 0x070F) {
+		syncCTC();
 		ctc_070C->write8(3, value);
+		scheduleCTC();
 #endif
 	} else if(pcg->checkAddress(port)) {
 		// PCG
@@ -549,7 +609,10 @@ CatPlatformX1::platformOutPort(u8* io, u16 port, u8 value)
 		io[0x1FD0] = value;
 	} else if(port == 0x0B00) {
 		// メモリ／バンクメモリ切り替え
-		bankMemoryIndex = value & 0x1F;
+		if(bankMemoryIndex != (value & 0x1F)) {
+			bankMemoryIndex = value & 0x1F;
+			updateMemoryMap();
+		}
 	}
 }
 
@@ -582,54 +645,54 @@ CatPlatformX1::platformInPort(u8* io, u16 port)
 		return io[0x1200];
 	} else if(port == 0x1FA0) {
 		// CTC0
-		//tick(getExecutedClock());
+		syncCTC();
 		return ctc->read8(0);
 	} else if(port == 0x1FA1) {
 		// CTC1
-		//tick(getExecutedClock());
+		syncCTC();
 		return ctc->read8(1);
 	} else if(port == 0x1FA2) {
 		// CTC2
-		//tick(getExecutedClock());
+		syncCTC();
 		return ctc->read8(2);
 	} else if(port == 0x1FA3) {
 		// CTC3
-		//tick(getExecutedClock());
+		syncCTC();
 		return ctc->read8(3);
 #if CTC_0704
 	} else if(port == 0x0704) {
 		// CTC0
-		//tick(getExecutedClock());
+		syncCTC();
 		return ctc_0704->read8(0);
 	} else if(port == 0x0705) {
 		// CTC1
-		//tick(getExecutedClock());
+		syncCTC();
 		return ctc_0704->read8(1);
 	} else if(port == 0x0706) {
 		// CTC2
-		//tick(getExecutedClock());
+		syncCTC();
 		return ctc_0704->read8(2);
 	} else if(port == 0x0707) {
 		// CTC3
-		//tick(getExecutedClock());
+		syncCTC();
 		return ctc_0704->read8(3);
 #endif
 #if CTC_070C
 	} else if(port == 0x070C) {
 		// CTC0
-		//tick(getExecutedClock());
+		syncCTC();
 		return ctc_070C->read8(0);
 	} else if(port == 0x070D) {
 		// CTC1
-		//tick(getExecutedClock());
+		syncCTC();
 		return ctc_070C->read8(1);
 	} else if(port == 0x070E) {
 		// CTC2
-		//tick(getExecutedClock());
+		syncCTC();
 		return ctc_070C->read8(2);
 	} else if(port == 0x070F) {
 		// CTC3
-		//tick(getExecutedClock());
+		syncCTC();
 		return ctc_070C->read8(3);
 #endif
 	} else if((port & 0xFF0F) == 0x1A01) {
@@ -644,10 +707,10 @@ CatPlatformX1::platformInPort(u8* io, u16 port)
 		// PSG Data Read
 		if(io[0x1C00] == 14) {
 			// ジョイスティック1
-			return readGamePad(0);
+			return inputGamePad(0);
 		} else if(io[0x1C00] == 15) {
 			// ジョイスティック2
-			return readGamePad(1);
+			return inputGamePad(1);
 		}
 	} else if((port & 0xFF00) == 0x1C00) {
 		// PSG Register address set
@@ -693,4 +756,32 @@ CatPlatformX1::readPCG(u32 ch, u8* data)
 	// @todo
 }
 
+void
+CatPlatformX1::serialize(CatSerializer& serializer)
+{
+	serializer.value(currentTick);
+	// バンクメモリ
+	serializer.pages(bankMemory, sizeof(bankMemory));
+	serializer.value(bankMemoryIndex);
+	// パレット
+	serializer.value(paletteR);
+	serializer.value(paletteG);
+	serializer.value(paletteB);
+	// デバイス
+	ctc->serialize(serializer);
+	ctc_0704->serialize(serializer);
+	ctc_070C->serialize(serializer);
+	pcg->serialize(serializer);
+	crtc->serialize(serializer);
+	serializer.value(isGRAMSyncAccessMode);
+	serializer.value(vBlank);
+	// イベント
+	scheduler.serialize(serializer);
+	serializer.value(ctcClock);
+	serializer.value(sliceGlobalTick);
+	if(serializer.isLoading()) {
+		setVRAMDirty();
+	}
+}
+
 #endif // ENABLE_TARGET_X1
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include "../catPlatformBase.h"
+#include "../catScheduler.h"
 
 #if ENABLE_TARGET_X1
 
@@ -58,12 +59,29 @@ class CatPlatformX1 : public CatPlatformBase {
 
 	bool vBlank = false;
 	static constexpr auto frameTick = (4000000 / 60);
-	static constexpr auto lineTick  = frameTick / (200 + 24);
 	static constexpr auto diskTick  = frameTick * 200 / (200 + 24);
 	static constexpr auto vBlankTick  = frameTick - diskTick;
-	u64 counter = 0;
-	u64 counterNextVSync = diskTick;
-	u64 counterNextVSyncEnd = diskTick + vBlankTick;
+
+	/**
+	 * @brief イベント
+	 */
+	enum Event : s32 {
+		EVENT_CTC,		// CTCの割り込み
+		EVENT_VSYNC,	// VBlankの開始と終了
+		EVENT_COUNT,
+	};
+	/**
+	 * @brief イベントのスケジューラ
+	 */
+	CatScheduler<EVENT_COUNT> scheduler;
+	/**
+	 * @brief CTCを進めた時刻(クロック)
+	 */
+	u64 ctcClock = 0;
+	/**
+	 * @brief CPUの実行を開始した時のグローバルTick
+	 */
+	u64 sliceGlobalTick = 0;
 public:
 	/**
 	 * @brief グラフィックのVRAMのサイズ
@@ -101,6 +119,27 @@ private:
 
 	void renderGraphic();
 	void renderText();
+
+	/**
+	 * @brief 現在の時刻を取得する
+	 * 
+	 * CPUの実行中は、実行したクロック分も含める。
+	 * @return 現在の時刻(クロック)
+	 */
+	u64 getCurrentClock() const noexcept;
+	/**
+	 * @brief CTCを現在の時刻まで進める
+	 */
+	void syncCTC();
+	/**
+	 * @brief CTCの次の割り込みの時刻を登録する
+	 */
+	void scheduleCTC();
+	/**
+	 * @brief イベントの処理
+	 * @param[in]	id	イベントID
+	 */
+	void processEvent(s32 id);
 public:
 	/**
 	 * @brief コンストラクタ
@@ -147,6 +186,25 @@ public:
 		}
 		return mem[address];
 	}
+	virtual bool isIdlePort(u16 port) override {
+		// 8255(VBlankなど)とPSGのデータ(ジョイスティック)は、イベントかjs側でしか値が変わらない
+		// メモ）CTCは読む度にカウンタが進んでいるのでダメ
+		return (port & 0xFF00) == 0x1A00 || (port & 0xFF00) == 0x1B00;
+	}
+	virtual bool isIdleMemory(u16 address) override {
+		// メモリの読み込みに副作用はない
+		return true;
+	}
+	virtual u8* getMemoryPage(u8* mem, u16 address, bool write) override {
+		if(address < 0x8000) {
+			if(bankMemoryIndex < 0x10) {
+				// バンクメモリ 0 ～ 15
+				// メモ）書き込みはメモリとバンクメモリの両方に行うので直接書き込めない
+				return write ? nullptr : &bankMemory[0x8000 * bankMemoryIndex + address];
+			}
+		}
+		return &mem[address];
+	}
 
 	/**
 	 * @brief 機種毎のOUT処理
@@ -182,6 +240,12 @@ public:
 	 * @param[out]	data	PCGデータ
 	 */
 	virtual void readPCG(u32 ch, u8* data) override;
+
+	/**
+	 * @brief 機種毎の状態の保存／復元
+	 * @param[in,out]	serializer	シリアライザ
+	 */
+	virtual void serialize(CatSerializer& serializer) override;
 };
 
 #endif // ENABLE_TARGET_X1
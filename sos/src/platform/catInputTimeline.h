@@ -0,0 +1,278 @@
+﻿#pragma once
+
+#include "../cat/low/catLowBasicTypes.h"
+
+/**
+ * @brief 入力の記録と再生
+ *
+ * ゲームパッド・キーボードマトリクス・S-OSの入力系のフックなど、ホストから入ってくる入力を
+ * 記録を開始した時からのクロック(グローバルTick)と一緒に記録し、同じクロックで再生する。
+ * 同じ状態から再生すれば、毎回同じ命令列が実行される。
+ *
+ * 記録するのは値が変わった時(フックは結果が変わった時)だけで、
+ * 再生する時は、次のイベントが同じクロックの同じ入力の時だけ取り出す。
+ * 記録した時より前のクロックのイベントが残っていたら、同期がずれたことにする。
+ * メモリが確保できなくなったら、そこで記録を止める。
+ */
+class CatInputTimeline {
+public:
+	/**
+	 * @brief モード
+	 */
+	enum class Mode : u8 {
+		Off,	// 何もしない(ホストの入力をそのまま使う)
+		Record,	// 記録する
+		Replay,	// 再生する(ホストの入力は使わない)
+	};
+	/**
+	 * @brief イベントの種類
+	 */
+	enum EventType : u16 {
+		GamePad,	// index:ゲームパッドの番号、データ:状態(1バイト)
+		ScanKey,	// index:0、データ:キーボードマトリクス
+		Hook,		// index:フックのアドレス、データ:フックの結果
+		Execute,	// index:0、データ:exeute()で進めるクロック数(s32)
+	};
+	/**
+	 * @brief イベントのヘッダ(この後ろにデータが続く)
+	 */
+	struct EventHeader {
+		u64 tick;	// 記録を開始してからのクロック
+		u16 type;	// EventType
+		u16 index;	// 入力の番号
+		u32 size;	// データのサイズ
+	};
+	/**
+	 * @brief 記録したデータのヘッダ
+	 */
+	struct Header {
+		u32 magic;		// MAGIC
+		u32 version;	// VERSION
+	};
+	static constexpr u32 MAGIC = 'S' | ('O' << 8) | ('S' << 16) | ('I' << 24);
+	static constexpr u32 VERSION = 2;
+private:
+	/**
+	 * @brief モード
+	 */
+	Mode mode;
+	/**
+	 * @brief 記録したデータ
+	 */
+	u8* buffer;
+	/**
+	 * @brief 記録したデータのサイズ
+	 */
+	u32 size;
+	/**
+	 * @brief bufferのサイズ
+	 */
+	u32 capacity;
+	/**
+	 * @brief 再生している位置
+	 */
+	u32 position;
+	/**
+	 * @brief 記録／再生を開始した時のグローバルTick
+	 */
+	u64 startTick;
+	/**
+	 * @brief 再生中に同期がずれたかどうか
+	 */
+	bool desynced;
+
+	inline static void copy(u8* dst, const u8* src, u32 size) noexcept
+	{
+		while(size--) { *dst++ = *src++; }
+	}
+	bool reserve(const u32 required)
+	{
+		if(required <= capacity) {
+			return true;
+		}
+		u32 newCapacity = capacity ? capacity : 0x1000;
+		while(newCapacity < required) {
+			newCapacity *= 2;
+		}
+		u8* newBuffer = new u8[newCapacity];
+		if(!newBuffer) [[unlikely]] {
+			return false;
+		}
+		if(buffer) {
+			copy(newBuffer, buffer, size);
+			delete[] buffer;
+		}
+		buffer = newBuffer;
+		capacity = newCapacity;
+		return true;
+	}
+	bool append(const void* data, const u32 dataSize)
+	{
+		if(!reserve(size + dataSize)) [[unlikely]] {
+			return false;
+		}
+		copy(buffer + size, (const u8*)data, dataSize);
+		size += dataSize;
+		return true;
+	}
+public:
+	/**
+	 * @brief コンストラクタ
+	 */
+	CatInputTimeline() noexcept
+		: mode(Mode::Off)
+		, buffer(nullptr)
+		, size(0)
+		, capacity(0)
+		, position(0)
+		, startTick(0)
+		, desynced(false)
+	{
+	}
+	/**
+	 * @brief デストラクタ
+	 */
+	~CatInputTimeline()
+	{
+		if(buffer) {
+			delete[] buffer;
+			buffer = nullptr;
+		}
+	}
+
+	/**
+	 * @brief 記録を開始する
+	 *
+	 * 前に記録していたデータは捨てる。
+	 * @param[in]	now	現在のグローバルTick
+	 */
+	void startRecord(const u64 now)
+	{
+		size = 0;
+		position = 0;
+		startTick = now;
+		desynced = false;
+		const Header header { MAGIC, VERSION };
+		mode = append(&header, sizeof(header)) ? Mode::Record : Mode::Off;
+	}
+
+	/**
+	 * @brief 再生を開始する
+	 * @param[in]	data		記録したデータ(コピーする)
+	 * @param[in]	dataSize	記録したデータのサイズ
+	 * @param[in]	now			現在のグローバルTick
+	 * @return 再生を開始できたらtrue
+	 */
+	bool startReplay(const void* data, const u32 dataSize, const u64 now)
+	{
+		Header header;
+		if(dataSize < sizeof(header)) {
+			return false;
+		}
+		copy((u8*)&header, (const u8*)data, sizeof(header));
+		if(header.magic != MAGIC || header.version != VERSION) {
+			return false;
+		}
+		size = 0;
+		if(!append(data, dataSize)) {
+			mode = Mode::Off;
+			return false;
+		}
+		mode = Mode::Replay;
+		position = sizeof(header);
+		startTick = now;
+		desynced = false;
+		return true;
+	}
+
+	/**
+	 * @brief 記録／再生を終了する
+	 *
+	 * 記録したデータは、次に記録を開始するまで残しておく。
+	 */
+	void stop() noexcept { mode = Mode::Off; }
+
+	/**
+	 * @brief モードを取得する
+	 * @return モード
+	 */
+	Mode getMode() const noexcept { return mode; }
+	/**
+	 * @brief 再生中に同期がずれたかどうか
+	 * @return 記録した時と違う命令列を実行していたらtrue
+	 */
+	bool isDesynced() const noexcept { return desynced; }
+	/**
+	 * @brief 最後まで再生したかどうか
+	 * @return 最後まで再生したらtrue
+	 */
+	bool isEnd() const noexcept { return mode == Mode::Replay && size <= position; }
+	/**
+	 * @brief 記録したデータを取得する
+	 * @return 記録したデータ
+	 */
+	const u8* getBuffer() const noexcept { return buffer; }
+	/**
+	 * @brief 記録したデータのサイズを取得する
+	 * @return 記録したデータのサイズ
+	 */
+	u32 getSize() const noexcept { return size; }
+
+	/**
+	 * @brief イベントを記録する
+	 *
+	 * メモリが確保できなかったら、記録を止める。
+	 * @param[in]	now			現在のグローバルTick
+	 * @param[in]	type		イベントの種類
+	 * @param[in]	index		入力の番号
+	 * @param[in]	data		データ
+	 * @param[in]	dataSize	データのサイズ
+	 */
+	void record(const u64 now, const u16 type, const u16 index, const void* data, const u32 dataSize)
+	{
+		const EventHeader header { now - startTick, type, index, dataSize };
+		if(!reserve(size + sizeof(header) + dataSize)) [[unlikely]] {
+			mode = Mode::Off;
+			return;
+		}
+		append(&header, sizeof(header));
+		append(data, dataSize);
+	}
+
+	/**
+	 * @brief 次のイベントが、現在のクロックの指定した入力なら取り出す
+	 * @param[in]	now			現在のグローバルTick
+	 * @param[in]	type		イベントの種類
+	 * @param[in]	index		入力の番号
+	 * @param[out]	dataSize	データのサイズ
+	 * @return データ(nullptr:この入力のイベントはない)
+	 */
+	const u8* replay(const u64 now, const u16 type, const u16 index, u32& dataSize) noexcept
+	{
+		const u64 tick = now - startTick;
+		while(size - position >= sizeof(EventHeader)) {
+			EventHeader header;
+			copy((u8*)&header, buffer + position, sizeof(header));
+			if(size - position - sizeof(header) < header.size) [[unlikely]] {
+				// データが壊れている
+				desynced = true;
+				position = size;
+				break;
+			}
+			if(header.tick < tick) [[unlikely]] {
+				// 記録した時には、もう処理されていたはずのイベント
+				desynced = true;
+				position += sizeof(header) + header.size;
+				continue;
+			}
+			if(header.tick != tick || header.type != type || header.index != index) {
+				break;
+			}
+			const u8* data = buffer + position + sizeof(header);
+			position += sizeof(header) + header.size;
+			dataSize = header.size;
+			return data;
+		}
+		return nullptr;
+	}
+};
@@ -2,17 +2,115 @@
 
 #include "../cat/low/catLowBasicTypes.h"
 #include "catPratformTarget.h"
+#include "catSerializer.h"
+
+/**
+ * @brief 機種から呼び出すマシン側の処理
+ *
+ * 機種はグローバルな関数ではなく、これを経由して自分を持っているマシンにアクセスする。
+ */
+class CatPlatformHost {
+public:
+	/**
+	 * @brief キーボードマトリクスのサイズ(バイト)
+	 */
+	static constexpr u32 SCAN_KEY_SIZE = 10;
+
+	/**
+	 * @brief デストラクタ
+	 */
+	virtual ~CatPlatformHost() {}
+
+	/**
+	 * @brief IOの先頭アドレスを取得する
+	 * @return IOの先頭アドレス
+	 */
+	virtual u8* getIO() noexcept = 0;
+	/**
+	 * @brief VRAMが変更されたことにする
+	 */
+	virtual void setVRAMDirty() noexcept = 0;
+	/**
+	 * @brief IRQ割り込みを要求する
+	 * @param[in]	vector	割り込みベクタ
+	 */
+	virtual void generateIRQ(const u8 vector) noexcept = 0;
+	/**
+	 * @brief 実行中のexecute()をすぐに抜けるようにする
+	 */
+	virtual void requestBreak() noexcept = 0;
+	/**
+	 * @brief メモリの割り当てを更新する
+	 *
+	 * メモリのバンク切り替えなどで、同じアドレスから読み書きする先が変わった時に呼び出す。
+	 */
+	virtual void updateMemoryMap() = 0;
+	/**
+	 * @brief exeute(-1)でリセットされるTickを取得する
+	 * @return Tick(クロック)
+	 */
+	virtual u64 getGlobalTick() const noexcept = 0;
+	/**
+	 * @brief 初期化してからのTickを取得する
+	 * @return Tick(クロック)
+	 */
+	virtual u64 getGlobal2Tick() const noexcept = 0;
+	/**
+	 * @brief ゲームパッドの読み込み(入力の記録／再生を経由する)
+	 * @param[in]	index	読み込むゲームパッドの番号(0,1)
+	 * @return ゲームパッドの状態（ボタンは負論理）
+	 */
+	virtual u8 inputGamePad(const u8 index) = 0;
+	/**
+	 * @brief キーボードマトリクスの読み込み(入力の記録／再生を経由する)
+	 * @return キーボードマトリクス(SCAN_KEY_SIZEバイト)
+	 */
+	virtual const u8* inputScanKey() = 0;
+	/**
+	 * @brief サウンドチップへの書き込みを通知する
+	 * @param[in]	clock	書き込みが発生したときのクロック
+	 * @param[in]	no		サウンドデバイスの番号
+	 * @param[in]	reg		書き込まれたレジスタ番号
+	 * @param[in]	value	書き込まれた値
+	 */
+	virtual void writeSoundRegister(const s32 clock, const s32 no, const u8 reg, const u8 value) = 0;
+};
 
 /**
  * @brief 機種のベースクラス
  */
 class CatPlatformBase {
+protected:
+	/**
+	 * @brief この機種を持っているマシン
+	 */
+	CatPlatformHost* host = nullptr;
+
+	// マシン側の処理(派生クラスからはhostを意識せずに呼び出せるようにしておく)
+	u8* getIO() const noexcept { return host->getIO(); }
+	void setVRAMDirty() const noexcept { host->setVRAMDirty(); }
+	void generateIRQ(const u8 vector) const noexcept { host->generateIRQ(vector); }
+	void requestBreak() const noexcept { host->requestBreak(); }
+	void updateMemoryMap() const { host->updateMemoryMap(); }
+	u64 getGlobalTick() const noexcept { return host->getGlobalTick(); }
+	u64 getGlobal2Tick() const noexcept { return host->getGlobal2Tick(); }
+	u8 inputGamePad(const u8 index) const { return host->inputGamePad(index); }
+	const u8* inputScanKey() const { return host->inputScanKey(); }
+	void writeSoundRegister(const s32 clock, const s32 no, const u8 reg, const u8 value) const { host->writeSoundRegister(clock, no, reg, value); }
 public:
 	/**
 	 * @brief デストラクタ
 	 */
 	virtual ~CatPlatformBase() {}
 
+	/**
+	 * @brief この機種を持っているマシンを設定する
+	 *
+	 * initialize()より前に設定すること。
+	 * @param[in]	host	マシン
+	 */
+	void setHost(CatPlatformHost* host) noexcept { this->host = host; }
+
 	/**
 	 * @brief 機種ごとの初期化
 	 */
@@ -32,6 +130,38 @@ public:
 
 	virtual void platformWriteMemory(u8* mem, u16 address, u8 value) = 0;
 	virtual u8 platformReadMemory(u8* mem, u16 address) = 0;
+	/**
+	 * @brief アイドルループの検出で、読み込みに副作用がないとみなせるポートかどうか
+	 * 
+	 * 次のイベント(スケジューラに登録した時刻)まで読み込む値が変わらず、
+	 * 何度読み込んでも1回読み込んだのと同じ状態になるポートではtrueを返すこと。
+	 * trueを返したポートだけを読むループは、次のイベントまで読み飛ばされる。
+	 * @param[in]	port	IOポート
+	 * @return 副作用がなければtrue
+	 */
+	virtual bool isIdlePort(u16 port) = 0;
+	/**
+	 * @brief アイドルループの検出で、読み込みに副作用がないとみなせるアドレスかどうか
+	 * 
+	 * getMemoryPage()で直接読めないアドレスについて呼び出される。
+	 * 条件はisIdlePort()と同じ。
+	 * @param[in]	address	メモリアドレス
+	 * @return 副作用がなければtrue
+	 */
+	virtual bool isIdleMemory(u16 address) = 0;
+	/**
+	 * @brief 直接読み書きできるメモリのページを取得する
+	 * 
+	 * 256バイトのページ単位で、ページの先頭アドレスで呼び出される。
+	 * 読み書きに副作用がなければ、そのページの先頭のアドレスを返す。
+	 * メモリの割り当てを変えた時は、updateMemoryMap()を呼び出すこと。
+	 * @param[in]	mem		メモリ
+	 * @param[in]	address	メモリアドレス
+	 * @param[in]	write	書き込み用かどうか
+	 * @return ページの先頭のアドレス
+	 * @retval nullptr: platformReadMemory()/platformWriteMemory()を経由させる
+	 */
+	virtual u8* getMemoryPage(u8* mem, u16 address, bool write) = 0;
 
 	/**
 	 * @brief 機種毎のOUT処理
@@ -67,6 +197,15 @@ public:
 	 * @param[out]	data	PCGデータ
 	 */
 	virtual void readPCG(u32 ch, u8* data) = 0;
+
+	/**
+	 * @brief 機種毎の状態の保存／復元
+	 * 
+	 * メモリ(RAM)とIO、Z80のレジスタはSOS_Context側で保存しているので、それ以外の機種の状態を保存する。
+	 * 復元した後は、SOS_Context側でメモリのページテーブルを更新する。
+	 * @param[in,out]	serializer	シリアライザ
+	 */
+	virtual void serialize(CatSerializer& serializer) = 0;
 };
 
 class CatPlatformNull : public CatPlatformBase {
@@ -91,6 +230,9 @@ public:
 
 	virtual void platformWriteMemory(u8* mem, u16 address, u8 value) override { mem[address] = value; }
 	virtual u8 platformReadMemory(u8* mem, u16 address) override { return mem[address]; }
+	virtual bool isIdlePort(u16 port) override { return true; }
+	virtual bool isIdleMemory(u16 address) override { return true; }
+	virtual u8* getMemoryPage(u8* mem, u16 address, bool write) override { return &mem[address]; }
 	
 	/**
 	 * @brief 機種毎のOUT処理
@@ -126,4 +268,10 @@ public:
 	 * @param[out]	data	PCGデータ
 	 */
 	virtual void readPCG(u32 ch, u8* data) override {}
+
+	/**
+	 * @brief 機種毎の状態の保存／復元
+	 * @param[in,out]	serializer	シリアライザ
+	 */
+	virtual void serialize(CatSerializer& serializer) override {}
 };
@@ -8,24 +8,31 @@
 #endif // ENABLE_TARGET_MZ700
 
 CatPlatformBase*
-CatPlatformFactory::createPlatform(const PlatformID platformID)
+CatPlatformFactory::createPlatform(const PlatformID platformID, CatPlatformHost* host)
 {
+	CatPlatformBase* platform;
 	switch(platformID) {
 		case PlatformID::None:
 		default:
-			return new CatPlatformNull();
+			platform = new CatPlatformNull();
+			break;
 #if ENABLE_TARGET_X1
 		case PlatformID::WEB: // Web版
 		case PlatformID::X1:
 		case PlatformID::X1TURBO:
 		case PlatformID::X1TURBO_SPEEDUP:
-			return new CatPlatformX1();
+			platform = new CatPlatformX1();
+			break;
 #endif // ENABLE_TARGET_X1
 #if ENABLE_TARGET_MZ700
 		case PlatformID::MZ700:
 		case PlatformID::MZ1500:
-			return new CatPlatformMZ700();
+			platform = new CatPlatformMZ700();
+			break;
 #endif // ENABLE_TARGET_MZ700
 	}
-	return nullptr; // ここには来ない
+	if(platform) [[likely]] {
+		platform->setHost(host);
+	}
+	return platform;
 }
@@ -44,6 +44,7 @@ public:
 	/**
 	 * @brief 機種を作成する
 	 * @param[in]	platformID	作成する機種
+	 * @param[in]	host		作成した機種を持つマシン
 	 */
-	static class CatPlatformBase* createPlatform(const PlatformID platformID);
+	static class CatPlatformBase* createPlatform(const PlatformID platformID, class CatPlatformHost* host);
 };
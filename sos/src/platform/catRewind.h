@@ -0,0 +1,255 @@
+﻿#pragma once
+
+#include "../cat/low/catLowBasicTypes.h"
+#include "catSerializer.h"
+
+/**
+ * @brief 巻き戻し用の状態のリングバッファ
+ *
+ * 毎フレームの状態を記録しておき、指定したフレーム数だけ前の状態に戻せるようにする。
+ * キーフレームは状態を全て保存し(全て0のページは省く)、
+ * それ以外のフレームは直前のキーフレームと違うページだけを保存する。
+ * 一番古いフレームは常にキーフレームになるように、
+ * 古いキーフレームを捨てる時は、それに続く差分のフレームも一緒に捨てる。
+ */
+class CatRewind {
+	/**
+	 * @brief 記録した状態
+	 */
+	struct Entry {
+		u8* data;		// 保存したデータ
+		u32 size;		// 保存したデータのサイズ
+		u32 capacity;	// dataのサイズ
+		bool keyframe;	// キーフレームかどうか
+	};
+
+	/**
+	 * @brief 記録した状態のリングバッファ
+	 */
+	Entry* entries;
+	/**
+	 * @brief リングバッファのサイズ
+	 */
+	u32 capacity;
+	/**
+	 * @brief 一番古い状態の位置
+	 */
+	u32 head;
+	/**
+	 * @brief 記録している状態の数
+	 */
+	u32 count;
+	/**
+	 * @brief キーフレームの間隔(フレーム)
+	 */
+	u32 keyframeInterval;
+	/**
+	 * @brief 最後のキーフレームより後に記録した状態の数
+	 */
+	u32 sinceKeyframe;
+	/**
+	 * @brief 保存に必要な最大のサイズ
+	 */
+	u32 maxStateSize;
+	/**
+	 * @brief 差分の基準(最後のキーフレームのページ)
+	 */
+	u8* reference;
+	/**
+	 * @brief 差分の基準のサイズ
+	 */
+	u32 referenceSize;
+
+	Entry& at(const u32 index) noexcept { return entries[(head + index) % capacity]; }
+
+	/**
+	 * @brief 一番古いキーフレームと、それに続く差分のフレームを捨てる
+	 */
+	void dropOldest() noexcept
+	{
+		do {
+			head = (head + 1) % capacity;
+			--count;
+		} while(count && !entries[head].keyframe);
+	}
+	/**
+	 * @brief 保存先のサイズを広げる
+	 * @param[in,out]	entry	記録した状態
+	 * @return 広げられたらtrue
+	 */
+	bool grow(Entry& entry) noexcept
+	{
+		if(entry.capacity >= maxStateSize) {
+			return false;
+		}
+		u32 newCapacity = entry.capacity ? entry.capacity * 2 : 0x1000;
+		if(newCapacity > maxStateSize) {
+			newCapacity = maxStateSize;
+		}
+		delete[] entry.data;
+		entry.data = new u8[newCapacity];
+		entry.capacity = newCapacity;
+		return true;
+	}
+public:
+	/**
+	 * @brief コンストラクタ
+	 */
+	CatRewind() noexcept
+		: entries(nullptr)
+		, capacity(0)
+		, head(0)
+		, count(0)
+		, keyframeInterval(1)
+		, sinceKeyframe(0)
+		, maxStateSize(0)
+		, reference(nullptr)
+		, referenceSize(0)
+	{
+	}
+	/**
+	 * @brief デストラクタ
+	 */
+	~CatRewind() { release(); }
+
+	/**
+	 * @brief リングバッファを確保する
+	 *
+	 * 記録していた状態は全て捨てる。
+	 * @param[in]	frameCount			最低限記録しておくフレーム数
+	 * @param[in]	keyframeInterval	キーフレームの間隔(フレーム)
+	 * @param[in]	maxStateSize		保存に必要な最大のサイズ
+	 * @param[in]	referenceSize		差分の基準に必要なサイズ
+	 */
+	void setup(const u32 frameCount, const u32 keyframeInterval, const u32 maxStateSize, const u32 referenceSize)
+	{
+		release();
+		if(!frameCount) {
+			return;
+		}
+		this->keyframeInterval = keyframeInterval ? keyframeInterval : 1;
+		// キーフレームと一緒に差分を捨てても、frameCountは残るようにしておく
+		this->capacity = frameCount + this->keyframeInterval;
+		this->entries = new Entry[capacity];
+		for(u32 i = 0; i < capacity; ++i) {
+			entries[i] = Entry { nullptr, 0, 0, false };
+		}
+		this->maxStateSize = maxStateSize;
+		this->reference = new u8[referenceSize];
+		this->referenceSize = referenceSize;
+	}
+
+	/**
+	 * @brief リングバッファを解放する
+	 */
+	void release()
+	{
+		if(entries) {
+			for(u32 i = 0; i < capacity; ++i) {
+				delete[] entries[i].data;
+			}
+			delete[] entries;
+			entries = nullptr;
+		}
+		if(reference) {
+			delete[] reference;
+			reference = nullptr;
+		}
+		capacity = 0;
+		head = 0;
+		count = 0;
+		sinceKeyframe = 0;
+		referenceSize = 0;
+	}
+
+	/**
+	 * @brief 記録している状態の数を取得する
+	 * @return 記録している状態の数
+	 */
+	u32 getCount() const noexcept { return count; }
+
+	/**
+	 * @brief 使用しているメモリのサイズを取得する
+	 * @return 使用しているメモリのサイズ(バイト)
+	 */
+	u32 getMemorySize() const noexcept
+	{
+		u32 size = referenceSize + sizeof(Entry) * capacity;
+		for(u32 i = 0; i < capacity; ++i) {
+			size += entries[i].capacity;
+		}
+		return size;
+	}
+
+	/**
+	 * @brief 現在の状態を記録する
+	 * @param[in]	save	保存の処理 u32(u8* buffer, u32 size, CatSerializer::PageMode mode, u8* reference, u32 referenceSize)
+	 * @return 記録できたらtrue
+	 */
+	template<typename SaveFunctor>
+	bool push(SaveFunctor save)
+	{
+		if(!capacity) {
+			return false;
+		}
+		if(count == capacity) {
+			dropOldest();
+		}
+		const bool keyframe = !count || sinceKeyframe + 1 >= keyframeInterval;
+		const CatSerializer::PageMode mode = keyframe ? CatSerializer::PageMode::Capture : CatSerializer::PageMode::Delta;
+		Entry& entry = at(count);
+		for(;;) {
+			if(entry.capacity) {
+				if(const u32 size = save(entry.data, entry.capacity, mode, reference, referenceSize)) {
+					entry.size = size;
+					break;
+				}
+			}
+			// 保存先が足りないので、広げてやり直す
+			if(!grow(entry)) {
+				// 差分の基準が途中まで書き換わっているかもしれないので、次はキーフレームにする
+				sinceKeyframe = keyframeInterval;
+				return false;
+			}
+		}
+		entry.keyframe = keyframe;
+		sinceKeyframe = keyframe ? 0 : sinceKeyframe + 1;
+		++count;
+		return true;
+	}
+
+	/**
+	 * @brief 記録した状態に戻す
+	 *
+	 * 戻した状態より後に記録した状態は捨てる。
+	 * @param[in]	frames	戻すフレーム数(0:最後に記録した状態)
+	 * @param[in]	load	復元の処理 bool(const u8* buffer, u32 size, CatSerializer::PageMode mode)
+	 * @return 戻せたらtrue
+	 */
+	template<typename LoadFunctor>
+	bool rewind(const u32 frames, LoadFunctor load)
+	{
+		if(frames >= count) {
+			return false;
+		}
+		const u32 target = count - 1 - frames;
+		u32 key = target;
+		while(!at(key).keyframe) {
+			--key;
+		}
+		if(!load(at(key).data, at(key).size, CatSerializer::PageMode::Sparse)) {
+			return false;
+		}
+		if(key != target && !load(at(target).data, at(target).size, CatSerializer::PageMode::Delta)) {
+			return false;
+		}
+		bool droppedKeyframe = false;
+		for(u32 i = target + 1; i < count; ++i) {
+			droppedKeyframe |= at(i).keyframe;
+		}
+		// 差分の基準にしているキーフレームを捨てたら、次はキーフレームにする
+		sinceKeyframe = droppedKeyframe ? keyframeInterval : sinceKeyframe - frames;
+		count = target + 1;
+		return true;
+	}
+};
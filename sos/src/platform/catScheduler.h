@@ -0,0 +1,216 @@
+﻿#pragma once
+
+#include "../cat/low/catLowBasicTypes.h"
+#include "catSerializer.h"
+
+/**
+ * @brief デバイスのイベントのスケジューラ
+ *
+ * 各デバイスの次のイベントの時刻(クロック)を最小ヒープで管理する。
+ * CPUは一番近いイベントの時刻まで止まらずに実行し、
+ * イベントの時刻になったデバイスだけを処理する。
+ * @tparam	EVENT_COUNT	イベントの種類の数(イベントIDは0～EVENT_COUNT-1)
+ */
+template<s32 EVENT_COUNT>
+class CatScheduler {
+	/**
+	 * @brief イベント
+	 */
+	struct Event {
+		u64 time;
+		s32 id;
+	};
+
+	/**
+	 * @brief イベントの最小ヒープ
+	 */
+	Event heap[EVENT_COUNT];
+	/**
+	 * @brief イベントIDごとのヒープ内の位置(-1:登録されていない)
+	 */
+	s32 position[EVENT_COUNT];
+	/**
+	 * @brief 登録されているイベントの数
+	 */
+	s32 count;
+	/**
+	 * @brief 現在の時刻(クロック)
+	 */
+	u64 now;
+
+	inline void swap(s32 a, s32 b) noexcept
+	{
+		const Event tmp = heap[a];
+		heap[a] = heap[b];
+		heap[b] = tmp;
+		position[heap[a].id] = a;
+		position[heap[b].id] = b;
+	}
+	void up(s32 i) noexcept
+	{
+		while(i > 0) {
+			const s32 parent = (i - 1) / 2;
+			if(heap[parent].time <= heap[i].time) { break; }
+			swap(parent, i);
+			i = parent;
+		}
+	}
+	void down(s32 i) noexcept
+	{
+		for(;;) {
+			const s32 l = i * 2 + 1;
+			const s32 r = l + 1;
+			s32 m = i;
+			if(l < count && heap[l].time < heap[m].time) { m = l; }
+			if(r < count && heap[r].time < heap[m].time) { m = r; }
+			if(m == i) { break; }
+			swap(m, i);
+			i = m;
+		}
+	}
+	void remove(s32 i) noexcept
+	{
+		position[heap[i].id] = -1;
+		--count;
+		if(i != count) {
+			const s32 id = heap[count].id;
+			heap[i] = heap[count];
+			position[id] = i;
+			up(i);
+			down(position[id]);
+		}
+	}
+	/**
+	 * @brief ヒープとイベントIDごとの位置が対応しているか
+	 *
+	 * 復元したデータで、配列の範囲外を読み書きしないように確認する。
+	 * @return 対応していればtrue
+	 */
+	bool isConsistent() const noexcept
+	{
+		if(count < 0 || EVENT_COUNT < count) {
+			return false;
+		}
+		for(s32 i = 0; i < count; ++i) {
+			const s32 id = heap[i].id;
+			if(id < 0 || EVENT_COUNT <= id || position[id] != i) {
+				return false;
+			}
+		}
+		for(s32 id = 0; id < EVENT_COUNT; ++id) {
+			const s32 i = position[id];
+			if(i != -1 && (i < 0 || count <= i || heap[i].id != id)) {
+				return false;
+			}
+		}
+		return true;
+	}
+public:
+	/**
+	 * @brief コンストラクタ
+	 */
+	CatScheduler() { reset(); }
+
+	/**
+	 * @brief リセット
+	 *
+	 * 登録されているイベントを全て削除し、時刻を0に戻す。
+	 */
+	void reset() noexcept
+	{
+		count = 0;
+		now = 0;
+		for(auto& it : position) { it = -1; }
+	}
+
+	/**
+	 * @brief 状態を保存／復元する
+	 * @param[in,out]	serializer	シリアライザ
+	 */
+	void serialize(CatSerializer& serializer) noexcept
+	{
+		serializer.value(heap);
+		serializer.value(position);
+		serializer.value(count);
+		serializer.value(now);
+		if(serializer.isLoading() && !isConsistent()) [[unlikely]] {
+			serializer.fail();
+		}
+	}
+
+	/**
+	 * @brief 現在の時刻を取得する
+	 * @return 現在の時刻(クロック)
+	 */
+	u64 getNow() const noexcept { return now; }
+
+	/**
+	 * @brief イベントを登録する
+	 *
+	 * 既に登録されている場合は、時刻を変更する。
+	 * @param[in]	id		イベントID
+	 * @param[in]	time	イベントの時刻(クロック)
+	 */
+	void schedule(const s32 id, const u64 time) noexcept
+	{
+		s32 i = position[id];
+		if(i < 0) {
+			i = count++;
+			heap[i].id = id;
+			position[id] = i;
+		}
+		heap[i].time = time;
+		up(i);
+		down(position[id]);
+	}
+
+	/**
+	 * @brief イベントを削除する
+	 * @param[in]	id		イベントID
+	 */
+	void cancel(const s32 id) noexcept
+	{
+		if(const s32 i = position[id]; i >= 0) {
+			remove(i);
+		}
+	}
+
+	/**
+	 * @brief 次のイベントまでのクロック数で、実行するクロックを制限する
+	 * @param[in,out]	tick	実行するクロック
+	 */
+	void adjustTick(s32& tick) const noexcept
+	{
+		if(count) [[likely]] {
+			const u64 remain = (heap[0].time > now) ? (heap[0].time - now) : 1;
+			if(remain < (u64)tick) {
+				tick = (s32)remain;
+			}
+		}
+	}
+
+	/**
+	 * @brief 時刻を進める
+	 *
+	 * 指定した時刻までに発生するイベントを、時刻順に処理する。
+	 * イベントは処理される前にヒープから削除されるので、
+	 * 繰り返すイベントは、処理の中で次の時刻を登録し直すこと。
+	 * @param[in]	target	進める時刻(クロック)
+	 * @param[in]	func	イベントの処理 void(s32 id)
+	 */
+	template<typename Functor>
+	void progress(const u64 target, Functor func)
+	{
+		while(count && heap[0].time <= target) {
+			const s32 id = heap[0].id;
+			if(heap[0].time > now) {
+				now = heap[0].time;
+			}
+			remove(0);
+			func(id);
+		}
+		if(target > now) {
+			now = target;
+		}
+	}
+};
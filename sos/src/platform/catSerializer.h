@@ -0,0 +1,248 @@
+﻿#pragma once
+
+#include "../cat/low/catLowBasicTypes.h"
+
+/**
+ * @brief 状態の保存と復元
+ *
+ * 保存と復元で同じserialize()を使えるように、読み書きの向きを持ったストリームにしている。
+ * serialize()の中では、保存する時も復元する時も同じ順番で同じ変数を渡すこと。
+ * バッファがnullptrの時は、保存に必要な最大のサイズを数えるだけにする。
+ */
+class CatSerializer {
+public:
+	/**
+	 * @brief pages()で省く単位(バイト)
+	 */
+	static constexpr u32 PAGE_SIZE = 256;
+	/**
+	 * @brief pages()の保存のしかた
+	 */
+	enum class PageMode : u8 {
+		/**
+		 * @brief 全て0のページを省く
+		 */
+		Sparse,
+		/**
+		 * @brief Sparseと同じだが、全てのページを基準にコピーする(キーフレーム)
+		 */
+		Capture,
+		/**
+		 * @brief 基準と同じページを省く
+		 *
+		 * 復元する時は、省いたページには触らない。
+		 * 先にキーフレームを復元しておくこと。
+		 */
+		Delta,
+	};
+private:
+	/**
+	 * @brief バッファ(nullptr:サイズを数えるだけ)
+	 */
+	u8* buffer;
+	/**
+	 * @brief バッファのサイズ
+	 */
+	u32 capacity;
+	/**
+	 * @brief 現在の位置
+	 */
+	u32 position;
+	/**
+	 * @brief 復元かどうか
+	 */
+	bool loading;
+	/**
+	 * @brief バッファが足りなかったかどうか
+	 */
+	bool failed;
+	/**
+	 * @brief pages()の保存のしかた
+	 */
+	PageMode pageMode;
+	/**
+	 * @brief 差分の基準(pages()に渡される全てのページを順番に並べたもの)
+	 */
+	u8* reference;
+	/**
+	 * @brief 差分の基準のサイズ
+	 */
+	u32 referenceCapacity;
+	/**
+	 * @brief 差分の基準の現在の位置
+	 */
+	u32 referencePosition;
+
+	inline static void copy(u8* dst, const u8* src, u32 size) noexcept
+	{
+		while(size--) { *dst++ = *src++; }
+	}
+	inline static bool isZero(const u8* data, u32 size) noexcept
+	{
+		u8 bits = 0;
+		for(u32 i = 0; i < size; ++i) { bits |= data[i]; }
+		return bits == 0;
+	}
+	inline static bool isEqual(const u8* a, const u8* b, u32 size) noexcept
+	{
+		u8 bits = 0;
+		for(u32 i = 0; i < size; ++i) { bits |= a[i] ^ b[i]; }
+		return bits == 0;
+	}
+	/**
+	 * @brief ページを保存する必要があるかどうか
+	 * @param[in]	page			ページ
+	 * @param[in]	referenceOffset	差分の基準でのページの位置
+	 * @return 保存する必要があればtrue
+	 */
+	bool isUsedPage(const u8* page, const u32 referenceOffset) const noexcept
+	{
+		if(!buffer) {
+			// サイズを数えるだけの時は、最大のサイズにする
+			return true;
+		}
+		if(pageMode == PageMode::Delta) {
+			if(!reference || referenceCapacity < referenceOffset + PAGE_SIZE) [[unlikely]] {
+				return true;
+			}
+			return !isEqual(page, reference + referenceOffset, PAGE_SIZE);
+		}
+		return !isZero(page, PAGE_SIZE);
+	}
+public:
+	/**
+	 * @brief コンストラクタ
+	 * @param[in]	buffer		バッファ(nullptr:サイズを数えるだけ)
+	 * @param[in]	capacity	バッファのサイズ
+	 * @param[in]	loading		復元ならtrue、保存ならfalse
+	 */
+	CatSerializer(u8* buffer, const u32 capacity, const bool loading) noexcept
+		: buffer(buffer)
+		, capacity(capacity)
+		, position(0)
+		, loading(loading)
+		, failed(false)
+		, pageMode(PageMode::Sparse)
+		, reference(nullptr)
+		, referenceCapacity(0)
+		, referencePosition(0)
+	{
+	}
+
+	/**
+	 * @brief pages()の保存のしかたを設定する
+	 * @param[in]		mode		保存のしかた
+	 * @param[in,out]	reference	差分の基準(Sparseと、Deltaの復元の時は不要)
+	 * @param[in]		capacity	差分の基準のサイズ
+	 */
+	void setPageMode(const PageMode mode, u8* reference = nullptr, const u32 capacity = 0) noexcept
+	{
+		this->pageMode = mode;
+		this->reference = reference;
+		this->referenceCapacity = capacity;
+		this->referencePosition = 0;
+	}
+
+	/**
+	 * @brief 復元かどうか
+	 * @return 復元ならtrue
+	 */
+	bool isLoading() const noexcept { return loading; }
+	/**
+	 * @brief 失敗したかどうか
+	 * @return バッファが足りなかった、もしくは、データが壊れていたらtrue
+	 */
+	bool isFailed() const noexcept { return failed; }
+	/**
+	 * @brief 失敗したことにする
+	 *
+	 * 復元するデータの内容がおかしい時に呼び出す。
+	 */
+	void fail() noexcept { failed = true; }
+	/**
+	 * @brief 現在の位置を取得する
+	 * @return 保存したサイズ、または、復元したサイズ
+	 */
+	u32 getPosition() const noexcept { return position; }
+	/**
+	 * @brief pages()に渡されたページの合計のサイズを取得する
+	 * @return 差分の基準に必要なサイズ
+	 */
+	u32 getPageBytes() const noexcept { return referencePosition; }
+
+	/**
+	 * @brief メモリの内容をそのまま保存／復元する
+	 * @param[in,out]	data	メモリ
+	 * @param[in]		size	サイズ
+	 */
+	void bytes(void* data, const u32 size) noexcept
+	{
+		if(failed) [[unlikely]] { return; }
+		if(!buffer) {
+			position += size;
+			return;
+		}
+		if(capacity - position < size) [[unlikely]] {
+			failed = true;
+			return;
+		}
+		if(loading) {
+			copy((u8*)data, buffer + position, size);
+		} else {
+			copy(buffer + position, (const u8*)data, size);
+		}
+		position += size;
+	}
+
+	/**
+	 * @brief 変数を保存／復元する
+	 * @param[in,out]	data	変数(配列も可)
+	 */
+	template<typename T>
+	void value(T& data) noexcept
+	{
+		bytes(&data, sizeof(T));
+	}
+
+	/**
+	 * @brief 大きなメモリを保存／復元する
+	 *
+	 * PAGE_SIZE単位で、省けるページ(PageMode参照)は省いて保存する。
+	 * 8ページごとに、保存したページのビットマスクを1バイト置く。
+	 * @param[in,out]	data	メモリ
+	 * @param[in]		size	サイズ(PAGE_SIZEの倍数)
+	 */
+	void pages(u8* data, const u32 size) noexcept
+	{
+		const u32 pageCount = size / PAGE_SIZE;
+		for(u32 group = 0; group < pageCount; group += 8) {
+			if(failed) [[unlikely]] { return; }
+			const u32 count = (pageCount - group < 8) ? (pageCount - group) : 8;
+			u8* top = data + group * PAGE_SIZE;
+			u8 mask = 0;
+			if(!loading) {
+				for(u32 i = 0; i < count; ++i) {
+					if(isUsedPage(top + PAGE_SIZE * i, referencePosition + PAGE_SIZE * i)) { mask |= 1 << i; }
+				}
+			}
+			value(mask);
+			if(failed) [[unlikely]] { return; }
+			for(u32 i = 0; i < count; ++i) {
+				u8* page = top + PAGE_SIZE * i;
+				if(mask & (1 << i)) {
+					bytes(page, PAGE_SIZE);
+				} else if(loading && pageMode != PageMode::Delta) {
+					for(u32 j = 0; j < PAGE_SIZE; ++j) { page[j] = 0; }
+				}
+				if(pageMode == PageMode::Capture && !loading && reference) {
+					if(referenceCapacity - referencePosition < PAGE_SIZE) [[unlikely]] {
+						failed = true;
+						return;
+					}
+					copy(reference + referencePosition, page, PAGE_SIZE);
+				}
+				referencePosition += PAGE_SIZE;
+			}
+		}
+	}
+};
@@ -1,11 +1,13 @@
 ﻿#include "catCtc.h"
+#include "../catSerializer.h"
 
-CatCTC::CTC::CTC(s32 channel, CatCTC::CTC* chain)
+CatCTC::CTC::CTC(s32 channel, u8* vector, CatCTC::CTC* chain)
 	: state(State::IDLE)
 	, writeState(WriteState::NORMAL)
 	, channelCtrolWord(0)
 	, timeControlRegister(0)
 	, downCounter(0)
+	, vector(vector)
 	, channel(channel)
 	, chain(chain)
 {
@@ -52,7 +54,7 @@ CatCTC::CTC::writeNormal(const u8 value)
 {
 	if((value & CONTROL_OR_VECTOR) == 0) {
 		// 割り込みベクタ設定
-		vector = value;
+		*vector = value;
 		return;
 	}
 	channelCtrolWord = value;
@@ -96,24 +98,28 @@ CatCTC::CTC::hardReset()
 	channelCtrolWord = 0;
 	timeControlRegister = 0;
 	downCounter = 0;
-	vector = 0;
+	*vector = 0;
 }
 
-void
-CatCTC::CTC::adjustClock(s32& clock)
+s32
+CatCTC::CTC::getEventClock() const noexcept
 {
-	switch(state) {
-		case State::IDLE:
-			return;
-		case State::EXECUTE:
-			if(isTimerMode()) {
-				// タイマモード
-				if(downCounter >= 0) {
-					clock = (clock < downCounter) ? clock : downCounter;
-				}
-			}
-			return;
+	if(state != State::EXECUTE) {
+		return -1;
+	}
+	// 自分も繋がっている先も割り込みを発生させないなら、イベントは不要
+	// メモ）ダウンカウンタは、アクセスされた時にまとめて進める
+	if(!(channelCtrolWord & INTERRUPT) && !(chain && (chain->channelCtrolWord & INTERRUPT))) {
+		return -1;
+	}
+	const s32 counter = (downCounter > 0) ? downCounter : 1;
+	if(isCounterMode()) {
+		if(channel == 1 || channel == 2) {
+			return counter * 2 - 1; // 2MHzなので倍にする
+		}
+		return -1; // クロックではカウントしない
 	}
+	return counter;
 }
 
 s32
@@ -139,7 +145,7 @@ CatCTC::CTC::addPuls(s32 clock)
 					}
 				}
 				if((iniVector < 0) && (channelCtrolWord & INTERRUPT)) {
-					iniVector = vector + channel * 2; // 割り込み発生
+					iniVector = *vector + channel * 2; // 割り込み発生
 				}
 			}
 			break;
@@ -177,7 +183,7 @@ CatCTC::CTC::execute(s32 clock)
 					}
 				}
 				if((iniVector < 0) && (channelCtrolWord & INTERRUPT)) {
-					iniVector = vector + channel * 2; // 割り込み発生
+					iniVector = *vector + channel * 2; // 割り込み発生
 				}
 			}
 			break;
@@ -187,10 +193,10 @@ CatCTC::CTC::execute(s32 clock)
 
 CatCTC::CatCTC()
 {
-	ctc[3] = new CTC(3);
-	ctc[2] = new CTC(2);
-	ctc[1] = new CTC(1);
-	ctc[0] = new CTC(0, ctc[3]);
+	ctc[3] = new CTC(3, &vector);
+	ctc[2] = new CTC(2, &vector);
+	ctc[1] = new CTC(1, &vector);
+	ctc[0] = new CTC(0, &vector, ctc[3]);
 }
 
 CatCTC::~CatCTC()
@@ -234,15 +240,16 @@ CatCTC::write8(u8 no, u8 value)
 	ctc[no]->write8(value);
 }
 
-void
-CatCTC::adjustClock(s32& clock)
+s32
+CatCTC::getEventClock() const noexcept
 {
-//	for(s32 i = 0; i < 4; ++i) {
-//		ctc[i]->adjustClock(clock);
-//	}
-	if(clock > 16) {
-		clock = 16;
+	s32 clock = -1;
+	for(s32 i = 0; i < 4; ++i) {
+		if(const s32 tmp = ctc[i]->getEventClock(); tmp >= 0 && (clock < 0 || tmp < clock)) {
+			clock = tmp;
+		}
 	}
+	return clock;
 }
 
 s32
@@ -256,3 +263,22 @@ CatCTC::execute(s32 clock)
 	}
 	return iniVector;
 }
+
+void
+CatCTC::CTC::serialize(CatSerializer& serializer)
+{
+	serializer.value(state);
+	serializer.value(writeState);
+	serializer.value(channelCtrolWord);
+	serializer.value(timeControlRegister);
+	serializer.value(downCounter);
+	serializer.value(*vector);
+}
+
+void
+CatCTC::serialize(CatSerializer& serializer)
+{
+	for(s32 i = 0; i < 4; ++i) {
+		ctc[i]->serialize(serializer);
+	}
+}
@@ -2,6 +2,8 @@
 
 #include "../../cat/low/catLowBasicTypes.h"
 
+class CatSerializer;
+
 /**
  * @brief Z80 CTC
  * 
@@ -35,16 +37,19 @@ public:
 		u16 timeControlRegister;
 		s32 downCounter;
 		/**
-		 * @brief 割り込みが発生したときに使うベクタアドレス
+		 * @brief 割り込みが発生したときに使うベクタアドレス(CatCTC::vectorを指す)
 		 */
-		inline static u8  vector = 0;
+		u8* vector;
 		s32 channel;
 		CTC* chain;
 
 		/**
 		 * @brief コンストラクタ
+		 * @param[in]	channel	チャンネル
+		 * @param[in]	vector	4チャンネルで共有する割り込みベクタ
+		 * @param[in]	chain	TRGに繋がっているチャンネル
 		 */
-		CTC(s32 channel, CTC* chain = nullptr);
+		CTC(s32 channel, u8* vector, CTC* chain = nullptr);
 		/**
 		 * @brief 初期化
 		 * @return 処理結果
@@ -91,12 +96,19 @@ public:
 		u8 read8();
 		void write8(u8 value);
 		void hardReset();
-		void adjustClock(s32& clock);
+		s32 getEventClock() const noexcept;
 		s32 addPuls(s32 clock);
 		s32 execute(s32 clock);
+		void serialize(CatSerializer& serializer);
 	};
 
 	CTC* ctc[4] {0};
+	/**
+	 * @brief 割り込みが発生したときに使うベクタアドレス
+	 *
+	 * 4チャンネルで共有するが、CTC毎に持つ。
+	 */
+	u8 vector = 0;
 
 	/**
 	 * @brief コンストラクタ
@@ -119,6 +131,15 @@ public:
 
 	u8 read8(u8 no);
 	void write8(u8 no, u8 value);
-	void adjustClock(s32& clock);
+	/**
+	 * @brief 次に割り込みが発生するまでのクロック数を取得する
+	 * @return クロック数(-1:割り込みは発生しない)
+	 */
+	s32 getEventClock() const noexcept;
 	s32 execute(s32 clock);
+	/**
+	 * @brief 状態を保存／復元する
+	 * @param[in,out]	serializer	シリアライザ
+	 */
+	void serialize(CatSerializer& serializer);
 };
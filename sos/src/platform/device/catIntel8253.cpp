@@ -1,4 +1,5 @@
 ﻿#include "catIntel8253.h"
+#include "../catSerializer.h"
 namespace Intel8253 {
 
 namespace {
@@ -628,6 +629,23 @@ Counter::reset() noexcept
 	isCounterSet = false;
 }
 
+void
+Counter::serialize(CatSerializer& serializer)
+{
+	serializer.value(controlWord->format);
+	serializer.value(controlWord->mode);
+	serializer.value(controlWord->bcd);
+	serializer.value(counter);
+	serializer.value(currentCounter);
+	serializer.value(active);
+	serializer.value(gate);
+	serializer.value(counterAccess);
+	serializer.value(latchDataCount);
+	serializer.value(latchData);
+	serializer.value(out);
+	serializer.value(isCounterSet);
+}
+
 void
 Counter::setGateDirect(bool isGate) noexcept
 {
@@ -884,6 +902,7 @@ Counter::readCounter() noexcept
 
 CatIntel8253::CatIntel8253(void* userData)
 	: userData(userData)
+	, counters()
 {
 	reset();
 }
@@ -900,12 +919,9 @@ CatIntel8253::~CatIntel8253()
 void
 CatIntel8253::reset()
 {
-	for(auto counter : counters) { counter->reset(); }
-}
-
-void
-CatIntel8253::adjustTick(s32& tick)
-{
+	for(auto counter : counters) {
+		if(counter) { counter->reset(); }
+	}
 }
 
 void
@@ -949,4 +965,10 @@ CatIntel8253::read(const u32 address) noexcept
 	}
 }
 
+void
+CatIntel8253::serialize(CatSerializer& serializer)
+{
+	for(auto counter : counters) { counter->serialize(serializer); }
+}
+
 } // namespace Intel8253
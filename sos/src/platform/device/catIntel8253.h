@@ -1,6 +1,9 @@
 ﻿#pragma once
 
 #include "../../sos.h"
+
+class CatSerializer;
+
 namespace Intel8253 {
 
 using OUT_TRIGGER_CALLBACK = void (*)(const u8 channel, class Counter* chain, bool out, void* userData);
@@ -146,6 +149,12 @@ public:
 
 	void tick(s32 tick);
 	void adjustTick(s32& tick);
+
+	/**
+	 * @brief 状態を保存／復元する
+	 * @param[in,out]	serializer	シリアライザ
+	 */
+	void serialize(CatSerializer& serializer);
 };
 
 /**
@@ -181,12 +190,6 @@ public:
 	 */
 	virtual void reset();
 
-	/**
-	 * @brief チックを調整する
-	 * @param[in,out]	tick	チック
-	 */
-	void adjustTick(s32& tick);
-
 	/**
 	 * @brief カウンタを進める
 	 * @param[in]	tick	進める値
@@ -220,6 +223,12 @@ public:
 	 * @return 値
 	 */
 	u8 read(const u32 address) noexcept;
+
+	/**
+	 * @brief 状態を保存／復元する
+	 * @param[in,out]	serializer	シリアライザ
+	 */
+	virtual void serialize(CatSerializer& serializer);
 };
 
 } // namespace Intel8253
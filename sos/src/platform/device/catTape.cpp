@@ -1,4 +1,5 @@
 ﻿#include "catTape.h"
+#include "../catSerializer.h"
 
 namespace tape {
 
@@ -103,4 +104,12 @@ CatTape::seek()
 {
 }
 
+void
+CatTape::serialize(CatSerializer& serializer)
+{
+	// テープの位置は、モーターがonになった時刻からの経過時間で決まる
+	serializer.value(baseTimeStamp);
+	serializer.value(motorState);
+}
+
 } // namespace tape
@@ -2,6 +2,8 @@
 
 #include "../../cat/low/catLowBasicTypes.h"
 
+class CatSerializer;
+
 namespace tape {
 
 class CatTapeImage {
@@ -140,6 +142,12 @@ public:
 	bool readData(const u64 timeStamp);
 
 	void seek();
+
+	/**
+	 * @brief 状態(モーターとテープの位置)を保存／復元する
+	 * @param[in,out]	serializer	シリアライザ
+	 */
+	void serialize(CatSerializer& serializer);
 };
 
 } // namespace tape
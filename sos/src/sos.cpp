@@ -1,7 +1,15 @@
 ﻿#include "cat/low/catLowBasicTypes.h"
 #include "z80/z80.hpp"
 #include "sos.h"
+#include "sosMachine.h"
 #include "platform.h"
+#include "platform/catPlatformBase.h"
+#include "platform/catPlatformFactory.h"
+#include "platform/catSerializer.h"
+#include "platform/catRewind.h"
+#include "platform/catInputTimeline.h"
+#include "disk/catDiskImage.h"
+#include "disk/catFileIndex.h"
 
 #ifdef BUILD_WASM
 void setupHeap(void* heapBase, size_t heapSize);
@@ -112,38 +120,89 @@ void hoge( const c8* fmt, ...) {
 	va_end( args );
 }
 
-class SOS_Context {
+class SOS_Context : public CatPlatformHost {
 	static unsigned char readByte(void* arg, unsigned short addr) {
-		return platformReadMemory(((SOS_Context*)arg)->RAM, addr);
+		return ((SOS_Context*)arg)->platform->platformReadMemory(((SOS_Context*)arg)->RAM, addr);
 		//return ((SOS_Context*)arg)->RAM[addr];
 	}
 	static void writeByte(void* arg, unsigned short addr, unsigned char value) {
-		// S-OSのフック部分が書き換えられたら、フックを全部削除する
+		// S-OSのフック部分が書き換えられたら、フックを全部無効にする
 		// 以降、S-OSは使えなくなり、完全なZ80ワールドになる。
 		if(ADDRESS_JUMPTABLE <= addr && addr <= ADDRESS_JUMPTABLE_END) {
 			if(((SOS_Context*)arg)->RAM[addr] != value) {
-				((SOS_Context*)arg)->z80.removeAllBreakPoints();
+				((SOS_Context*)arg)->hookEnabled = false;
 			}
 		}
-		platformWriteMemory(((SOS_Context*)arg)->RAM, addr, value);
+		((SOS_Context*)arg)->platform->platformWriteMemory(((SOS_Context*)arg)->RAM, addr, value);
 		//((SOS_Context*)arg)->RAM[addr] = value;
 	}
 	static unsigned char inPort(void* arg, unsigned short port) {
-		return platformInPort(((SOS_Context*)arg)->IO, port);
+		return ((SOS_Context*)arg)->platform->platformInPort(((SOS_Context*)arg)->IO, port);
 	}
 	static void outPort(void* arg, unsigned short port, unsigned char value) {
-		platformOutPort(((SOS_Context*)arg)->IO, port, value);
+		((SOS_Context*)arg)->platform->platformOutPort(((SOS_Context*)arg)->IO, port, value);
+	}
+	static bool isIdlePort(void* arg, unsigned short port) {
+		CatPlatformBase* platform = ((SOS_Context*)arg)->platform;
+		return platform && platform->isIdlePort(port);
+	}
+	static bool isIdleMemory(void* arg, unsigned short addr) {
+		CatPlatformBase* platform = ((SOS_Context*)arg)->platform;
+		return platform && platform->isIdleMemory(addr);
+	}
+	static int trap(void* arg, unsigned short addr) {
+		SOS_Context* ctx = (SOS_Context*)arg;
+		if(addr < ADDRESS_JUMPTABLE || ADDRESS_JUMPTABLE_END < addr) {
+			return Z80::TRAP_NONE;
+		}
+		const Hook& hook = ctx->hooks[addr - ADDRESS_JUMPTABLE];
+		if(!hook.function) {
+			return Z80::TRAP_NONE;
+		}
+		if(!ctx->hookEnabled) {
+			// フックが無効なら、何もせずに戻る
+			return Z80::TRAP_RETURN;
+		}
+#if Z80_PROFILE
+		ctx->profile.hook[addr - ADDRESS_JUMPTABLE].count++;
+#endif
+		if(hook.input != HookInput::None && ctx->inputTimeline.getMode() != CatInputTimeline::Mode::Off) {
+			ctx->inputHook(addr, hook);
+		} else {
+			hook.function(arg);
+		}
+		if(!hook.js) {
+			return Z80::TRAP_RETURN;
+		}
+		// jsで処理が完了するまで待たせておく
+		// メモ）jsの処理が完了したら、PCを無理やり書き換えて次の命令を実行するようにしている。
+		// 入力を記録／再生している時は、記録した時と同じクロックで完了させるために、同じアドレスでループさせる
+		// 割り込みを受け付けられる時も止めない(このトラップの後に割り込み処理を実行させて、戻ってきたらもう一度フックを呼び出す)
+		if(ctx->z80.reg.PC == addr && ctx->inputTimeline.getMode() == CatInputTimeline::Mode::Off && !ctx->z80.isInterruptPending()) {
+			// Z80を止めて、resumeFromHost()が呼ばれるまでexecute()を抜けたままにする
+			ctx->status = SOS_STATUS_WAIT_HOST;
+			ctx->z80.requestBreak();
+		}
+		return Z80::TRAP_WAIT;
 	}
 
 	inline void WRITE_JP(u8*& dst, const u16 address) { *dst++ = 0xC3; *dst++ = address & 0xFF; *dst++ = (address >> 8) & 0xFF; }
 	inline void WRITE_CALL(u8*& dst, const u16 address) { *dst++ = 0xCD; *dst++ = address & 0xFF; *dst++ = (address >> 8) & 0xFF; }
 	inline void WRITE_RET(u8*& dst) { *dst++ = 0xC9; }
+	inline void WRITE_TRAP(u8*& dst) { *dst++ = 0xED; }
 
 	/**
 	 * @brief グローバルTick
+	 *
+	 * 前回のexecute()までに消費したクロック。
+	 * execute()の中では、Z80が消費したクロックを足したものになる(getGlobalTick()参照)。
 	 */
 	u64 globalTick;
 	u64 globalTick2;
+	/**
+	 * @brief Z80を実行中かどうか
+	 */
+	bool executing;
 
 	/**
 	 * @brief Z80エミュレータ
@@ -157,19 +216,166 @@ class SOS_Context {
 	 * @brief IO
 	 */
 	u8 IO[0x10000 * 2]; // 64KiB port x バンク２個
+	/**
+	 * @brief S-OS用特殊ワークエリア(#POKE、#PEEKなどで使う)
+	 */
+	u8 specialRAM[0x10000];
 
 	/**
-	 * @brief 状態
+	 * @brief 状態(SOS_STATUS_xxx)
 	 */
 	s32 status;
+	/**
+	 * @brief ホスト側のフックの処理を待っている間も、周辺機器のチックを進めるかどうか
+	 */
+	bool tickWhileWaiting;
 
 	s32 platformID;
+	/**
+	 * @brief 機種(周辺機器も含めて、このマシンが持っている)
+	 */
+	CatPlatformBase* platform;
+	/**
+	 * @brief サウンドチップへの書き込みを渡す先(nullptr:捨てる)
+	 */
+	SOS_Machine::SoundCallback soundCallback;
+	void* soundCallbackArg;
+	/**
+	 * @brief フレームの途中で、コンソールへの出力を渡す先(nullptr:捨てる)
+	 */
+	SOS_Machine::ConsoleCallback consoleCallback;
+	void* consoleCallbackArg;
 
 	/**
 	 * @brief VRAMが変更されたかどうかのフラグ
 	 */
 	bool bVRAMDirty;
 
+	/**
+	 * @brief フックの結果の種類(入力の記録／再生で使う)
+	 */
+	enum class HookInput : u8 {
+		None,		// 入力ではない(記録／再生中も呼び出す)
+		Register,	// 結果はレジスタ
+		Line,		// 結果はレジスタと、DEが指すバッファに入力した1行
+	};
+	/**
+	 * @brief S-OSのフック
+	 */
+	struct Hook {
+		void (*function)(void*);
+		bool js;
+		HookInput input;
+	};
+	/**
+	 * @brief ジャンプテーブルのアドレス毎のフック
+	 */
+	Hook hooks[ADDRESS_JUMPTABLE_END - ADDRESS_JUMPTABLE + 1];
+	/**
+	 * @brief フックが有効かどうか
+	 */
+	bool hookEnabled;
+	/**
+	 * @brief コンソールへの出力のリングバッファ
+	 *
+	 * ホスト側が1フレームに1回まとめて読み出す(sos.hのSOS_ConsoleRing参照)。
+	 */
+	SOS_ConsoleRing consoleRing;
+	/**
+	 * @brief カーソル位置
+	 */
+	struct ConsoleCursor {
+		s32 x;
+		s32 y;
+	};
+	/**
+	 * @brief 出力中のカーソル位置
+	 */
+	ConsoleCursor consoleCursor;
+	/**
+	 * @brief バッファを渡し終えた時のJavaScript側のカーソル位置
+	 */
+	ConsoleCursor consoleHostCursor;
+	/**
+	 * @brief consoleHostCursorが使えるかどうか
+	 */
+	bool consoleCursorValid;
+	/**
+	 * @brief 理論画面範囲(right、bottomは範囲外)
+	 */
+	struct ConsoleWindow {
+		s32 left;
+		s32 top;
+		s32 right;
+		s32 bottom;
+	} consoleWindow;
+	/**
+	 * @brief ネイティブでマウントしているディスク(A～E)
+	 *
+	 * マウントしていないドライブは、JavaScript側のディスクを使う。
+	 * @note	ホスト側が持っているものなので、状態の保存／復元には含めない
+	 */
+	disk::CatDiskImage disks[SOS_DISK_DRIVE_MAX];
+	/**
+	 * @brief ネイティブでマウントしているディスクの、ディレクトリとFATのキャッシュ
+	 */
+	disk::CatFileIndex fileIndexes[SOS_DISK_DRIVE_MAX];
+	/**
+	 * @brief 巻き戻し用の状態のリングバッファ
+	 */
+	CatRewind rewindBuffer;
+	/**
+	 * @brief 入力の記録／再生
+	 */
+	CatInputTimeline inputTimeline;
+	/**
+	 * @brief 最後に記録／再生したゲームパッドの状態
+	 */
+	u8 inputGamePadState[2];
+	/**
+	 * @brief 最後に記録／再生したキーボードマトリクス
+	 */
+	u8 inputKeyMatrix[SCAN_KEY_SIZE];
+	/**
+	 * @brief 入力系のフックの結果
+	 *
+	 * maskのビットが立っているレジスタのバイトを、valueの値で書き換える。
+	 */
+	struct InputHookResult {
+		u64 mask;
+		Z80::Register value;
+	};
+	static_assert(sizeof(Z80::Register) <= 64, "InputHookResult::mask is too small");
+	/**
+	 * @brief 最後に記録／再生した入力系のフックの結果(hooksと同じ並び)
+	 */
+	InputHookResult inputHookResult[ADDRESS_JUMPTABLE_END - ADDRESS_JUMPTABLE + 1];
+	/**
+	 * @brief 最後に記録／再生したexeute()で進めるクロック数(-1:まだない)
+	 */
+	s32 inputClock;
+	/**
+	 * @brief 記録するGETLの1行の最大のサイズ(終端の0も含む)
+	 */
+	static constexpr u32 INPUT_LINE_MAX = 256;
+#if Z80_PROFILE
+	/**
+	 * @brief フックの呼び出し回数
+	 */
+	struct HookProfile {
+		u16 address;	// S-OSのサブルーチンのアドレス(0:フックなし)
+		u16 reserved;
+		u32 count;		// 呼び出し回数
+	};
+	/**
+	 * @brief プロファイルの集計
+	 */
+	struct Profile {
+		Z80::ProfileEntry pc[0x10000];	// PC毎の実行したクロック数と命令数
+		HookProfile hook[ADDRESS_JUMPTABLE_END - ADDRESS_JUMPTABLE + 1];	// hooksと同じ並び
+	} profile;
+#endif
+
 private:
 	/**
 	 * @brief S-OSのサブルーチンアドレス
@@ -268,6 +474,7 @@ private:
 			u16 address;
 			JavaScriptFunction function;
 			bool js;
+			HookInput input;
 		};
 		SubroutineTable subroutineTable[] = {
 			{ COLD,  cold  },
@@ -284,11 +491,11 @@ private:
 			{ LPRNT, lprnt},
 			{ LPTON, lpton},
 			{ LPTOF, lptof},
-			{ GETL,	 getl , true },
-			{ GETKY, getky},
-			{ BRKEY, brkey},
-			{ INKEY, inkey, true },
-			{ PAUSE, pause, true },
+			{ GETL,	 getl , true, HookInput::Line },
+			{ GETKY, getky, false, HookInput::Register },
+			{ BRKEY, brkey, false, HookInput::Register },
+			{ INKEY, inkey, true, HookInput::Register },
+			{ PAUSE, pause, true, HookInput::Register },
 			{ BELL,  bell },
 			{ PRTHX, prthx},
 			{ PRTHL, prthl},
@@ -296,10 +503,10 @@ private:
 			{ HEX,	 hex  },
 			{ _2HEX, _2hex}, // 2HEX
 			{ HLHEX, hlhex},
-			{ WOPEN, wopen},
-			{ WRD,	 wrd  },
+			{ WOPEN, file_wopen},
+			{ WRD,	 file_wrd  },
 			{ FCB,	 fcb  },
-			{ RDD,   rdd  },
+			{ RDD,   file_rdd  },
 			{ FILE,	 file },
 			{ FSAME, fsame},
 			{ FPRNT, fprnt},
@@ -310,18 +517,18 @@ private:
 			{ MON,   mon, true },
 //			{ _HL_,  _hl_ }, // [HL]   メモ)Z80のコードで直接書く
 //			{ GETPC, getpc}, //        メモ)Z80のコードで直接書く
-			{ DRDSB, drdsb},
-			{ DWTSB, dwtsb},
+			{ DRDSB, disk_drdsb},
+			{ DWTSB, disk_dwtsb},
 			{ DIR,   dir  },
-			{ ROPEN, ropen},
-			{ SET,   set  },
-			{ RESET, reset},
-			{ NAME,	 name },
-			{ KILL,	 kill },
+			{ ROPEN, file_ropen},
+			{ SET,   file_set  },
+			{ RESET, file_reset},
+			{ NAME,	 file_name },
+			{ KILL,	 file_kill },
 			{ CSR,   csr  },
 			{ SCRN,	 scrn },
 			{ LOC,   loc  },
-			{ FLGET, flget, true },
+			{ FLGET, flget, true, HookInput::Register },
 			{ RDVSW, rdvsw},
 			{ SDVSW, sdvsw},
 			{ INP,   inp  },
@@ -344,8 +551,8 @@ private:
 			{ PARSC, parsc},
 			{ PARCS, parcs},
 			// ディスクI/O
-			{ DREAD, dread},
-			{ DWRITE, dwrite},
+			{ DREAD, disk_dread},
+			{ DWRITE, disk_dwrite},
 		};
 		u8* dst = &RAM[0];
 		WRITE_JP(dst, SubroutineAddress::COLD); // COLDにジャンプ
@@ -353,69 +560,78 @@ private:
 		WRITE_CALL(dst, SubroutineAddress::HOT); // Jコマンドの飛び先を呼び出す
 		WRITE_JP(dst, 0x3);
 		// JavaScriptの呼び出しを設定
-		// ・breakポイントで呼び出している
-		u16 index = ADDRESS_JUMPTABLE;
-		dst = &RAM[index];
-		for(const auto& it : subroutineTable) {
-			z80.addBreakPointFP(dst - RAM, it.function);
-			if(it.js) {
-				// jsで処理が完了するまでループさせておく
-				// メモ）jsの処理が完了したら、PCを無理やり書き換えて次の命令を実行するようにしている。
-				WRITE_JP(dst, dst - RAM);
-			}
-			WRITE_RET(dst);
+		// ・トラップ命令(ED ED)で呼び出している
+		// ・jsを使わないものは、EDを1バイトずつ並べて、最後に終端のEDを置く。
+		//   どこから実行してもED EDになり、呼び出すフックはアドレスで決まる。
+		// ・jsを使うものは、ED ED 00 C9。jsの処理が完了したらPC+3のRETに飛んでくる。
+		constexpr u32 subroutineCount = sizeof(subroutineTable) / sizeof(subroutineTable[0]);
+		u16 stubAddress[subroutineCount];
+		for(auto& it : hooks) {
+			it.function = nullptr;
+			it.js = false;
+			it.input = HookInput::None;
 		}
-		// S-OSのサブルーチン部分
-		for(const auto& it : subroutineTable) {
-			u8* dst = &RAM[it.address];
-			WRITE_JP(dst, index++);	// JavaScript呼び出し部分へ
-			if(it.js) {
-				index += 3; // JP xxxx
+#if Z80_PROFILE
+		for(auto& it : profile.hook) {
+			it.address = 0;
+			it.reserved = 0;
+			it.count = 0;
+		}
+#endif
+		hookEnabled = true;
+		dst = &RAM[ADDRESS_JUMPTABLE];
+		for(u32 i = 0; i < subroutineCount; ++i) {
+			if(!subroutineTable[i].js) {
+				stubAddress[i] = dst - RAM;
+				WRITE_TRAP(dst);
+			}
+		}
+		WRITE_TRAP(dst); // 終端
+		for(u32 i = 0; i < subroutineCount; ++i) {
+			if(subroutineTable[i].js) {
+				stubAddress[i] = dst - RAM;
+				WRITE_TRAP(dst);
+				WRITE_TRAP(dst);
+				*dst++ = 0x00;
+				WRITE_RET(dst);
 			}
 		}
+		catAssert(dst - RAM <= ADDRESS_JUMPTABLE_END + 1, "S-OS jump table overflow");
+		for(u32 i = 0; i < subroutineCount; ++i) {
+			Hook& hook = hooks[stubAddress[i] - ADDRESS_JUMPTABLE];
+			hook.function = subroutineTable[i].function;
+			hook.js = subroutineTable[i].js;
+			hook.input = subroutineTable[i].input;
+#if Z80_PROFILE
+			profile.hook[stubAddress[i] - ADDRESS_JUMPTABLE].address = subroutineTable[i].address;
+#endif
+		}
+		// S-OSのサブルーチン部分
+		for(u32 i = 0; i < subroutineCount; ++i) {
+			u8* dst = &RAM[subroutineTable[i].address];
+			WRITE_JP(dst, stubAddress[i]);	// JavaScript呼び出し部分へ
+		}
 	}
+	// JavaScript側のフック
+	// メモ）JavaScript側でも画面に表示したりカーソル位置を使うので、ためておいた出力を先に渡しておく
 #ifndef BUILD_WASM
-#define SOS_HOOK(NAME) static void NAME(void* ctx_) { SOS_Context* ctx = (SOS_Context*)ctx_; sos_##NAME(&ctx->z80.reg, sizeof(z80.reg), &ctx->RAM[0], &ctx->IO[0]); }
+#define SOS_HOOK(NAME) static void NAME(void* ctx_) { SOS_Context* ctx = (SOS_Context*)ctx_; ctx->flushConsole(); sos_##NAME(&ctx->z80.reg, sizeof(z80.reg), &ctx->RAM[0], &ctx->IO[0]); }
 #else
-#define SOS_HOOK(NAME) static void NAME(void* ctx_) { sos_##NAME(); }
+#define SOS_HOOK(NAME) static void NAME(void* ctx_) { ((SOS_Context*)ctx_)->flushConsole(); sos_##NAME(); }
 #endif
 	SOS_HOOK(cold )
 	SOS_HOOK(hot  )
-	SOS_HOOK(ver  )
-	SOS_HOOK(print)
-	SOS_HOOK(prnts)
-	SOS_HOOK(ltnl )
-	SOS_HOOK(nl   )
-	SOS_HOOK(msg  )
-	SOS_HOOK(msx  )
-	SOS_HOOK(mprnt)
-	SOS_HOOK(tab  )
-	SOS_HOOK(lprnt)
-	SOS_HOOK(lpton)
-	SOS_HOOK(lptof)
 	SOS_HOOK(getl )
 	SOS_HOOK(getky)
 	SOS_HOOK(brkey)
 	SOS_HOOK(inkey)
 	SOS_HOOK(pause)
 	SOS_HOOK(bell )
-	SOS_HOOK(prthx)
-	SOS_HOOK(prthl)
-	SOS_HOOK(asc  )
-	SOS_HOOK(hex  )
-	SOS_HOOK(_2hex)
-	SOS_HOOK(hlhex)
 	SOS_HOOK(wopen)
 	SOS_HOOK(wrd  )
 	SOS_HOOK(fcb  )
 	SOS_HOOK(rdd  )
 	SOS_HOOK(file )
-	SOS_HOOK(fsame)
-	SOS_HOOK(fprnt)
-	SOS_HOOK(poke )
-	SOS_HOOK(poke_)
-	SOS_HOOK(peek )
-	SOS_HOOK(peek_)
 	SOS_HOOK(mon  )
 //	SOS_HOOK(_hl_ ) // メモ)Z80のコードで直接書く
 //	SOS_HOOK(getpc) // メモ)Z80のコードで直接書く
@@ -427,12 +643,8 @@ private:
 	SOS_HOOK(reset)
 	SOS_HOOK(name )
 	SOS_HOOK(kill )
-	SOS_HOOK(csr  )
 	SOS_HOOK(scrn )
-	SOS_HOOK(loc  )
 	SOS_HOOK(flget)
-	SOS_HOOK(rdvsw)
-	SOS_HOOK(sdvsw)
 	SOS_HOOK(inp  )
 	SOS_HOOK(out  )
 	SOS_HOOK(widch)
@@ -457,220 +669,1979 @@ private:
 	SOS_HOOK(dwrite)
 #undef SOS_HOOK
 
+	// ネイティブで処理するフック
+	// メモ）レジスタとRAMしか使わないものは、JavaScript側を呼び出さずにここで処理する
+#define SOS_NATIVE_HOOK(NAME) static void NAME(void* ctx_) { ((SOS_Context*)ctx_)->sos_##NAME(); }
+	SOS_NATIVE_HOOK(ver  )
+	SOS_NATIVE_HOOK(print)
+	SOS_NATIVE_HOOK(prnts)
+	SOS_NATIVE_HOOK(ltnl )
+	SOS_NATIVE_HOOK(nl   )
+	SOS_NATIVE_HOOK(msg  )
+	SOS_NATIVE_HOOK(msx  )
+	SOS_NATIVE_HOOK(mprnt)
+	SOS_NATIVE_HOOK(tab  )
+	SOS_NATIVE_HOOK(lprnt)
+	SOS_NATIVE_HOOK(lpton)
+	SOS_NATIVE_HOOK(lptof)
+	SOS_NATIVE_HOOK(prthx)
+	SOS_NATIVE_HOOK(prthl)
+	SOS_NATIVE_HOOK(asc  )
+	SOS_NATIVE_HOOK(hex  )
+	SOS_NATIVE_HOOK(_2hex)
+	SOS_NATIVE_HOOK(hlhex)
+	SOS_NATIVE_HOOK(fsame)
+	SOS_NATIVE_HOOK(fprnt)
+	SOS_NATIVE_HOOK(poke )
+	SOS_NATIVE_HOOK(poke_)
+	SOS_NATIVE_HOOK(peek )
+	SOS_NATIVE_HOOK(peek_)
+	SOS_NATIVE_HOOK(csr  )
+	SOS_NATIVE_HOOK(loc  )
+	SOS_NATIVE_HOOK(rdvsw)
+	SOS_NATIVE_HOOK(sdvsw)
+#undef SOS_NATIVE_HOOK
+
+	// ディスクI/O
+	// メモ）ネイティブでマウントしているドライブはここで処理して、それ以外はJavaScript側のフックを呼び出す
+#define SOS_DISK_HOOK(NAME, FUNC) static void disk_##NAME(void* ctx_) { if(!((SOS_Context*)ctx_)->FUNC()) { NAME(ctx_); } }
+	SOS_DISK_HOOK(drdsb,  diskDrdsb )
+	SOS_DISK_HOOK(dwtsb,  diskDwtsb )
+	SOS_DISK_HOOK(dread,  diskDread )
+	SOS_DISK_HOOK(dwrite, diskDwrite)
+#undef SOS_DISK_HOOK
+
+	// ファイル
+	// メモ）ネイティブでマウントしているドライブの#ROPEN、#RDD、#WOPEN、#WRDは、ディレクトリとFATのキャッシュを使ってここで処理する。
+	//       JavaScript側で処理した時(#SET、#RESET、#NAME、#KILLも)は、書き換えたかもしれないので呼び出した後にキャッシュを作り直す。
+#define SOS_FILE_HOOK(NAME, FUNC) static void file_##NAME(void* ctx_) { if(!((SOS_Context*)ctx_)->FUNC()) { NAME(ctx_); ((SOS_Context*)ctx_)->invalidateFileIndexes(); } }
+	SOS_FILE_HOOK(ropen, fileRopen)
+	SOS_FILE_HOOK(rdd,   fileRdd  )
+	SOS_FILE_HOOK(wopen, fileWopen)
+	SOS_FILE_HOOK(wrd,   fileWrd  )
+#undef SOS_FILE_HOOK
+#define SOS_FILE_UPDATE_HOOK(NAME) static void file_##NAME(void* ctx_) { NAME(ctx_); ((SOS_Context*)ctx_)->invalidateFileIndexes(); }
+	SOS_FILE_UPDATE_HOOK(set  )
+	SOS_FILE_UPDATE_HOOK(reset)
+	SOS_FILE_UPDATE_HOOK(name )
+	SOS_FILE_UPDATE_HOOK(kill )
+#undef SOS_FILE_UPDATE_HOOK
+
 	inline void WRITE_U16(u16 addr, u16 value) {
 		RAM[addr    ] = value & 0xFF;
-		RAM[addr + 1] = value >> 8;
+		RAM[(u16)(addr + 1)] = value >> 8;
 	}
 	inline void WRITE_U8(u16 addr, u8 value) {
 		RAM[addr    ] = value;
 	}
+	inline u16 READ_U16(u16 addr) const {
+		return RAM[addr] | (RAM[(u16)(addr + 1)] << 8);
+	}
+	inline u8 READ_U8(u16 addr) const {
+		return RAM[addr];
+	}
 
-	void initWork()
+	//
+	// レジスタ
+	//
+	// メモ）RegisterPairのワードはバイトの並びが逆なので、バイト単位でアクセスする
+
+	u16 getBC() const noexcept { return z80.reg.pair.BC(); }
+	u16 getDE() const noexcept { return z80.reg.pair.DE(); }
+	u16 getHL() const noexcept { return z80.reg.pair.HL(); }
+	void setDE(const u16 value) noexcept { z80.reg.pair.DE() = value; }
+	void setHL(const u16 value) noexcept { z80.reg.pair.HL() = value; }
+	void setCY() noexcept { z80.reg.pair.F() |= 0x01; }
+	void clearCY() noexcept { z80.reg.pair.F() &= ~0x01; }
+	void setZ() noexcept { z80.reg.pair.F() |= 0x40; }
+	void clearZ() noexcept { z80.reg.pair.F() &= ~0x40; }
+
+	//
+	// コンソール
+	//
+	// 表示系のサブルーチンの出力は、consoleRingに追加しておき、ホスト側が1フレームに1回まとめて表示する。
+	// カーソル位置はS-OSのワーク(#XYADR)にあるので、JavaScript側と同じ規則でここで進めておく(js/cat/catTextScreenLayerControler.js参照)。
+
+	/**
+	 * @brief ためておいた出力を、すぐにホスト側に表示してもらう
+	 *
+	 * JavaScript側のフックを呼び出す前に使う。
+	 * 表示した後は、JavaScript側でカーソル位置が変えられているかもしれないので、次の出力の前にカーソル位置を設定し直す。
+	 */
+	void flushConsole()
 	{
-		WRITE_U16( WorkAddress::USR,    SubroutineAddress::HOT );
-		WRITE_U8(  WorkAddress::DVSW,   0 );
-		WRITE_U8(  WorkAddress::LPSW,   0 );
-		WRITE_U16( WorkAddress::PRCNT,  0 );
-		WRITE_U16( WorkAddress::XYADR,  ADDRESS_XYADR );
-		WRITE_U16( WorkAddress::KBFAD,  ADDRESS_KBFAD );
-		WRITE_U16( WorkAddress::IBFAD,  ADDRESS_IBFAD );
-		WRITE_U16( WorkAddress::SIZE,   0 );
-		WRITE_U16( WorkAddress::DTADR,  0 );
-		WRITE_U16( WorkAddress::EXADR,  0 );
-		WRITE_U16( WorkAddress::STKAD,  ADDRESS_STKAD );
-		WRITE_U16( WorkAddress::MEMAX,  ADDRESS_MEMAX );
-		WRITE_U16( WorkAddress::WKSIZ,  0xFFFF );
-		WRITE_U8(  WorkAddress::DIRNO,  0 );
-		WRITE_U8(  WorkAddress::MXTRK,  0x50 );
-		WRITE_U16( WorkAddress::DTBUF,  ADDRESS_DTBUF );
-		WRITE_U16( WorkAddress::FATBF,  ADDRESS_FATBF );
-		WRITE_U16( WorkAddress::DIRPS,  0x0010 );
-		WRITE_U16( WorkAddress::FATPOS, 0x000E );
-		WRITE_U8(  WorkAddress::DSK,    0x41 );
-		if(platformID == 0x00 || platformID == 0x01 || platformID == 0x02) {
-			// 0x00 MZ-80K
-			// 0x01 MZ-700
-			// 0x02 MZ-1500
-			WRITE_U8(  WorkAddress::WIDTH,  40 );
-		} else {
-			WRITE_U8(  WorkAddress::WIDTH,  80 );
+		if(consoleRing.read != consoleRing.write) {
+			emitConsole();
 		}
-		WRITE_U8(  WorkAddress::MAXLIN, 25 );
-		// 変身セット
-		WRITE_U8(  WorkAddress::ETRK,   80 ); // RAMディスクのクラスタ数
+		consoleCursorValid = false;
 	}
-public:
 	/**
-	 * @brief コンストラクタ
+	 * @brief ためておいた出力を、設定されている渡す先に渡す(なければ捨てる)
 	 */
-	SOS_Context(s32 platformID)
-		: globalTick(0)
-		, globalTick2(0)
-		, z80(SOS_Context::readByte, SOS_Context::writeByte, SOS_Context::inPort, SOS_Context::outPort, (void*)this, true)
-		, status(0)
-		, platformID(platformID)
+	void emitConsole()
 	{
-		init();
-		initWork();
-		initInterrupt();
-		setVRAMDirty();
-
-		z80.setConsumeClockCallback(callbackConsumeClock);
-		//z80.setDebugMessage(callbackZ80DebugMessage);
+		if(consoleCallback) {
+			consoleCallback(consoleCallbackArg, &consoleRing);
+		} else {
+			consoleRing.read = consoleRing.write;
+		}
 	}
-	static void callbackConsumeClock(void* arg, int clocks)
+	/**
+	 * @brief リングバッファに空きを作る
+	 *
+	 * 1フレームで読み出されるまでに溢れる時だけ、ホスト側に読み出してもらう。
+	 * @param[in]	size	書き込むサイズ
+	 */
+	void reserveConsole(const u32 size)
 	{
-		((SOS_Context*)arg)->consumeClock(clocks);
+		if(consoleRing.write - consoleRing.read + size > SOS_CONSOLE_RING_SIZE) [[unlikely]] {
+			emitConsole();
+		}
 	}
-	static void callbackZ80DebugMessage(void* arg, const char* msg)
+	/**
+	 * @brief リングバッファに1バイト追加する
+	 * @param[in]	value	追加する値
+	 */
+	void writeConsole(const u8 value)
 	{
-		((SOS_Context*)arg)->z80DebugMessage(msg);
+		consoleRing.data[consoleRing.write++ & (SOS_CONSOLE_RING_SIZE - 1)] = value;
 	}
-
-	void z80DebugMessage(const char* msg)
+	/**
+	 * @brief JavaScript側のカーソル位置を、今のカーソル位置に合わせる
+	 */
+	void locateConsole()
 	{
-		//printf("%s\n", msg);
+		if(consoleCursorValid && consoleHostCursor.x == consoleCursor.x && consoleHostCursor.y == consoleCursor.y) {
+			return;
+		}
+		// メモ）ホスト側がエスケープの途中で読み出さないように、まとめて空きを作っておく
+		reserveConsole(3);
+		writeConsole(SOS_CONSOLE_LOCATE);
+		writeConsole((u8)consoleCursor.x);
+		writeConsole((u8)consoleCursor.y);
+		consoleHostCursor = consoleCursor;
+		consoleCursorValid = true;
 	}
-	void consumeClock(int clocks)
+	/**
+	 * @brief S-OSのワークからカーソル位置を設定する
+	 */
+	void beginConsole()
 	{
-		globalTick += clocks;
-		globalTick2 += clocks;
+		const u16 position = READ_U16(READ_U16(WorkAddress::XYADR));
+		consoleCursor.x = position & 0xFF;
+		consoleCursor.y = position >> 8;
+		locateConsole();
 	}
-
 	/**
-	 * @brief リセットする
+	 * @brief カーソル位置をS-OSのワークに設定する
 	 */
-	void reset()
+	void endConsole()
 	{
-		z80.initialize();
-		globalTick = 0;
-		globalTick2 = 0;
-		z80.setConsumeClockCallback(callbackConsumeClock);
-		initInterrupt();
-		setVRAMDirty();
+		WRITE_U16(READ_U16(WorkAddress::XYADR), (consoleCursor.x & 0xFF) | ((consoleCursor.y & 0xFF) << 8));
 	}
-
 	/**
-	 * @brief 割り込み初期化
-	 * 
-	 * 割り込みモード:2  
-	 * 割り込み:有効  
-	 * Iレジスタ:$00に設定  
+	 * @brief 1文字出力する
+	 *
+	 * TaskContext.PRINT()と同じく、0x20未満で制御コードではないものは表示しない。
+	 * @param[in]	code	文字コード
 	 */
-	void initInterrupt()
+	void putConsole(const u8 code)
 	{
-		// 割り込みモードを2に
-		z80.reg.interrupt &= 0b11111100;
-		z80.reg.interrupt |= 2; // モード2に
-		// 割り込み有効に
-		z80.reg.IFF |= 0b00000101;
-		z80.reg.execEI = 1;
-		// Iレジスタ$00に設定
-		z80.reg.I = 0;
+		ConsoleCursor& cursor = consoleCursor;
+		const ConsoleWindow& window = consoleWindow;
+		if(code < 0x20 && code != 0x0C && code != 0x0D && code < 0x1C) {
+			return; // 表示しない
+		}
+		// putch32()と同じく、制御コードも含めて、画面下外ならスクロールしてから処理する
+		// メモ）CLSはputch32()を通らないが、カーソルは左上に戻るので同じ
+		if(cursor.y >= window.bottom) { cursor.y = window.bottom - 1; }
+		switch(code) {
+			case 0x0C: // CLS
+				cursor.x = window.left;
+				cursor.y = window.top;
+				break;
+			case 0x0D: // CR(画面下外ならスクロール)
+				cursor.x = window.left;
+				if(++cursor.y >= window.bottom) { cursor.y = window.bottom - 1; }
+				break;
+			case 0x1C: // →
+				if(++cursor.x >= window.right) {
+					cursor.x = window.left;
+					if(++cursor.y >= window.bottom) { cursor.y = window.bottom - 1; }
+				}
+				break;
+			case 0x1D: // ←(左端なら１つ上の行の右端に)
+				if(--cursor.x < window.left) {
+					cursor.x = window.right - 1;
+					if(cursor.y > window.top) { cursor.y--; }
+				}
+				break;
+			case 0x1E: // ↑
+				if(cursor.y > window.top) { cursor.y--; }
+				break;
+			case 0x1F: // ↓
+				if(++cursor.y >= window.bottom) { cursor.y = window.bottom - 1; }
+				break;
+			default:
+				// 表示して、１文字進める
+				// メモ）画面右外に出たら、次の行の先頭(範囲の左端ではなく0)に進む
+				if(++cursor.x >= window.right) {
+					cursor.x = 0;
+					cursor.y++;
+				}
+				break;
+		}
+		reserveConsole(1);
+		writeConsole(code);
+		consoleHostCursor = cursor;
 	}
-
 	/**
-	 * @brief 実行する
-	 * @param[in]	clock	進めるクロック数
-	 * @return 実際に進んだクロック数
+	 * @brief 終端文字コードまで表示する
+	 * @param[in]	address		文字列のアドレス
+	 * @param[in]	terminator	終端文字コード
+	 * @return 終端文字コードの次のアドレス
 	 */
-	int execute(int clock) {
-		return z80.execute(clock);
+	u16 putConsoleString(u16 address, const u8 terminator)
+	{
+		for(u8 ch; (ch = RAM[address++]) != terminator; ) {
+			putConsole(ch);
+		}
+		return address;
 	}
 
-	u8* getRAM() noexcept { return &RAM[0]; }
-	u8* getIO() noexcept { return &IO[0]; }
-	u8* getZ80Regs() noexcept { return (u8*)&z80.reg; }
-	s32 getZ80RegsSize() noexcept { return (s32)sizeof(z80.reg); }
-
-	int getStatus() const noexcept { return status; }
-	bool isVRAMDirty() const noexcept {return bVRAMDirty; }
-	void setVRAMDirty() noexcept { bVRAMDirty = true; }
-	void resetVRAMDirty() noexcept { bVRAMDirty = false; }
-
-	s32 getExecutedClock() const noexcept {return z80.getExecutedClock(); }
-	u64 getGlobalTick() const noexcept {return globalTick; }
-	void resetGlobalTick() { globalTick = 0; }
-	u64 getGlobal2Tick() const noexcept {return globalTick2; }
+	//
+	// ネイティブで処理するS-OSのサブルーチン
+	// メモ）js/sos/SOS.jsの同名の関数と同じ動作にしている
+	//
 
 	/**
-	 * @brief IRQ割り込み要求
+	 * @brief S-OSのエラーコード
 	 */
-	void generateIRQ(const u8 vector) noexcept { z80.generateIRQ(vector); }
-	void requestBreak() noexcept { z80.requestBreak(); }
-};
-
-/**
- * @brief 実態
- */
-SOS_Context* ctx = nullptr;
-
-void
-initialize(void* heapBase, size_t heapSize, s32 platformID)
-{
-#ifdef BUILD_WASM
-	setupHeap(heapBase, heapSize);
-#endif
-	delete ctx;
-	ctx = new SOS_Context(platformID);
-	initPlatform(platformID);
-
-	// 可変長引数のテスト
-	//hoge( u8"%d,%d,%d,%d", 1, 2, 4, 8 );
-}
-
-/**
- * @brief リセットする
- */
-void
-z80Reset(s32 platformID)
-{
-	delete ctx;
-	ctx = new SOS_Context(platformID);
-	initPlatform(platformID);
-	return ctx->reset();
-}
+	enum ErrorCode : u8 {
+		DeviceIOError		= 1,
+		BadFileDescripter	= 3,
+		WriteProtected		= 4,
+		BadRecord			= 5,
+		BadFileMode			= 6,
+		BadAllocationTable	= 7,
+		FileNotFound		= 8,
+		DeviceFull			= 9,
+		FileNotOpen			= 12,
+		BadData				= 14,
+	};
+	/**
+	 * @brief インフォメーションブロック
+	 */
+	enum InfomationBlock : u16 {
+		IB_ATTRIBUTE		= 0x00,
+		IB_FILENAME			= 0x01,
+		IB_EXTENSION		= 0x0E,
+		IB_FILENAME_SIZE	= 13,
+		IB_EXTENSION_SIZE	= 3,
+		IB_ATTRIBUTE_MASK	= 0x87,
+		IB_FILE_SIZE		= 0x12,
+		IB_START_ADDRESS	= 0x14,
+		IB_EXECUTE_ADDRESS	= 0x16,
+		IB_DATE				= 0x18,
+		IB_DATE_SIZE		= 5,
+		IB_CLUSTER_HIGH		= 0x1D,
+		IB_CLUSTER			= 0x1E,
+		IB_CLUSTER_MIDDLE	= 0x1F,
+		IB_BLOCK_SIZE		= 0x20,
+	};
 
-/**
- * @brief 実行する
- */
-int
-exeute(int clock)
-{
-	if(clock < 0) {
-		// 周辺機器のチックをリセット
-		resetPlatformTick();
-		ctx->resetGlobalTick();
-	}
-	s32 tick = 0;
-	while(tick < clock) {
-		s32 remain = clock - tick;
-		// 実行するクロックを調整する
-		// メモ）タイマ割り込み等で進むクロックを制限したい時など
-		if(!adjustPlatformClock(remain)) {
-			// CPUを実行
-			s32 executed = ctx->execute(remain);
-			if(executed > 0) {
-				tick += executed;
-			} else {
-				// CPUストールしている場合、進まなくなるので
-				tick += remain;
+	/**
+	 * @brief 値の下位4ビットを16進数の１文字に変換する
+	 */
+	static u8 toHexChar(u8 value) noexcept
+	{
+		value &= 0xF;
+		return (value <= 9) ? value + 0x30 : value + 0x41 - 10;
+	}
+	/**
+	 * @brief 16進数の１文字を値に変換する
+	 * @return 変換した値(-1:16進数の文字ではない)
+	 */
+	static s32 parseHexChar(const u8 ch) noexcept
+	{
+		if(0x30 <= ch && ch <= 0x39) { return ch - 0x30; }		// 0～9
+		if(0x41 <= ch && ch <= 0x46) { return ch - 0x41 + 10; }	// A～F
+		if(0x61 <= ch && ch <= 0x66) { return ch - 0x61 + 10; }	// a～f
+		return -1;
+	}
+	/**
+	 * @brief DEが指す16進数2桁を変換する(2HEX、HLHEXの下請け)
+	 *
+	 * DEは読んだ文字数だけ進める。エラーの時は、Aに14(BadData)を設定し、キャリフラグをセットする。
+	 * @param[out]	value	変換した値
+	 * @return 変換できたらtrue
+	 */
+	bool parseHex2(u8& value)
+	{
+		u16 address = getDE();
+		const s32 high = parseHexChar(RAM[address++]);
+		if(high >= 0) {
+			const s32 low = parseHexChar(RAM[address++]);
+			setDE(address);
+			if(low >= 0) {
+				value = (u8)((high << 4) | low);
+				return true;
 			}
 		} else {
-			tick += remain;
+			setDE(address);
 		}
-		// CPUが実行した所まで周辺機器のチックを進める
-		progressPlatformTick(tick);
+		// オリジナルでは不定となるが、BadDataを設定してことにする
+		z80.reg.pair.A() = BadData;
+		setCY();
+		return false;
 	}
-	return tick;
-}
 
-int
+	void sos_ver() { setHL(0x2820); }
+	void sos_print() { beginConsole(); putConsole(z80.reg.pair.A()); endConsole(); }
+	void sos_prnts() { beginConsole(); putConsole(0x20); endConsole(); }
+	void sos_ltnl() { beginConsole(); putConsole(0x0D); endConsole(); }
+	void sos_nl()
+	{
+		beginConsole();
+		if(consoleCursor.x != 0) {
+			putConsole(0x0D);
+			endConsole();
+		}
+	}
+	void sos_msg() { beginConsole(); putConsoleString(getDE(), 0x0D); endConsole(); }
+	void sos_msx() { beginConsole(); putConsoleString(getDE(), 0x00); endConsole(); }
+	void sos_mprnt()
+	{
+		beginConsole();
+		// 戻るアドレスの文字列を表示して、戻るアドレスを書き換える
+		WRITE_U16(z80.reg.SP, putConsoleString(READ_U16(z80.reg.SP), 0x00));
+		endConsole();
+	}
+	void sos_tab()
+	{
+		beginConsole();
+		// 指定位置の手前までスペース表示(元々オーバーしていたら何もしない)
+		for(s32 x = consoleCursor.x; x < z80.reg.pair.B(); ++x) {
+			putConsole(0x20);
+		}
+		endConsole();
+	}
+	void sos_lprnt()
+	{
+		// プリンタは無いのでエラー
+		WRITE_U8(WorkAddress::LPSW, 0);
+		setCY();
+	}
+	void sos_lpton() { WRITE_U8(WorkAddress::LPSW, 1); }
+	void sos_lptof() { WRITE_U8(WorkAddress::LPSW, 0); }
+	void sos_prthx()
+	{
+		const u8 value = z80.reg.pair.A();
+		beginConsole();
+		putConsole(toHexChar(value >> 4));
+		putConsole(toHexChar(value     ));
+		endConsole();
+	}
+	void sos_prthl()
+	{
+		const u16 value = getHL();
+		beginConsole();
+		putConsole(toHexChar(value >> 12));
+		putConsole(toHexChar(value >>  8));
+		putConsole(toHexChar(value >>  4));
+		putConsole(toHexChar(value      ));
+		endConsole();
+	}
+	void sos_asc() { z80.reg.pair.A() = toHexChar(z80.reg.pair.A()); }
+	void sos_hex()
+	{
+		const s32 value = parseHexChar(z80.reg.pair.A());
+		if(value >= 0) {
+			z80.reg.pair.A() = (u8)value;
+			clearCY();
+		} else {
+			setCY();
+		}
+	}
+	void sos__2hex()
+	{
+		u8 value;
+		if(parseHex2(value)) {
+			z80.reg.pair.A() = value;
+			clearCY();
+		}
+	}
+	void sos_hlhex()
+	{
+		u8 high, low;
+		if(!parseHex2(high)) { return; }
+		z80.reg.pair.H() = high;
+		if(!parseHex2(low)) { return; }
+		z80.reg.pair.L() = low;
+		clearCY();
+	}
+	void sos_fsame()
+	{
+		const u16 ib = READ_U16(WorkAddress::IBFAD);
+		// 属性
+		if((RAM[(u16)(ib + IB_ATTRIBUTE)] & IB_ATTRIBUTE_MASK) != (z80.reg.pair.A() & IB_ATTRIBUTE_MASK)) {
+			fsameError(BadFileMode);
+			return;
+		}
+		// ファイル名を分割(SOS.jsの#splitPath()と同じ)
+		u16 src = getDE();
+		u8 deviceName = RAM[WorkAddress::DSK];
+		u8 name[IB_FILENAME_SIZE + IB_EXTENSION_SIZE];
+		for(auto& it : name) { it = 0x20; }
+		while(RAM[src] == 0x20) { src++; }
+		if(RAM[(u16)(src + 1)] == 0x3A) { // ":"
+			const u8 device = RAM[src];
+			if(0x61 <= device && device <= 0x64) { // a～d
+				deviceName = device - 0x20;
+				src += 2;
+			} else if(0x41 <= device && device <= 0x44) { // A～D
+				deviceName = device;
+				src += 2;
+			}
+		}
+		for(u32 i = 0; i < IB_FILENAME_SIZE; ++i, ++src) {
+			const u8 ch = RAM[src];
+			if(ch == 0 || ch == 0x2E || ch == 0x3A) { break; } // "." ":"
+			if(ch != 0x0D) { name[i] = ch; }
+		}
+		while(RAM[src] != 0 && RAM[src] != 0x2E && RAM[src] != 0x3A) { src++; }
+		if(RAM[src] == 0x2E) { // "."
+			src++;
+			for(u32 i = 0; i < IB_EXTENSION_SIZE; ++i, ++src) {
+				const u8 ch = RAM[src];
+				if(ch == 0 || ch == 0x3A) { break; } // ":"
+				if(ch != 0x0D) { name[IB_FILENAME_SIZE + i] = ch; }
+			}
+		}
+		// デバイス名
+		if(RAM[WorkAddress::DSK] != deviceName) {
+			fsameError(BadFileDescripter);
+			return;
+		}
+		// ファイル名と拡張子(IBでも続けて並んでいる)
+		for(u32 i = 0; i < IB_FILENAME_SIZE + IB_EXTENSION_SIZE; ++i) {
+			if(RAM[(u16)(ib + IB_FILENAME + i)] != name[i]) {
+				fsameError(DeviceIOError);
+				return;
+			}
+		}
+		// 一致している
+		clearCY();
+		setZ();
+	}
+	void fsameError(const u8 errorCode)
+	{
+		setCY();
+		z80.reg.pair.A() = errorCode;
+		clearZ();
+	}
+	void sos_fprnt()
+	{
+		const u16 ib = READ_U16(WorkAddress::IBFAD);
+		beginConsole();
+		for(u32 i = 0; i < IB_FILENAME_SIZE; ++i) {
+			putConsole(RAM[(u16)(ib + IB_FILENAME + i)]);
+		}
+		putConsole(0x2E); // "."
+		for(u32 i = 0; i < IB_EXTENSION_SIZE; ++i) {
+			putConsole(RAM[(u16)(ib + IB_EXTENSION + i)]);
+		}
+		endConsole();
+	}
+	void sos_poke() { specialRAM[getHL()] = z80.reg.pair.A(); }
+	void sos_poke_()
+	{
+		u16 src = getHL();
+		u16 dst = getDE();
+		for(u32 size = getBC(); size; --size) {
+			specialRAM[dst++] = RAM[src++];
+		}
+	}
+	void sos_peek() { z80.reg.pair.A() = specialRAM[getHL()]; }
+	void sos_peek_()
+	{
+		u16 dst = getHL();
+		u16 src = getDE();
+		for(u32 size = getBC(); size; --size) {
+			RAM[dst++] = specialRAM[src++];
+		}
+	}
+	void sos_csr()
+	{
+		// メモ）JavaScript側のカーソル位置は、表示系のサブルーチンの後で#XYADRと同じになっている
+		setHL(READ_U16(READ_U16(WorkAddress::XYADR)));
+	}
+	void sos_loc()
+	{
+		const u8 x = z80.reg.pair.L();
+		const u8 y = z80.reg.pair.H();
+		if(x >= RAM[WorkAddress::WIDTH] || y >= RAM[WorkAddress::MAXLIN]) {
+			// エラー画面範囲外
+			setCY();
+			z80.reg.pair.A() = BadData;
+			return;
+		}
+		consoleCursor.x = x;
+		consoleCursor.y = y;
+		locateConsole();
+		endConsole();
+		clearCY();
+	}
+	void sos_rdvsw() { z80.reg.pair.A() = RAM[WorkAddress::DSK]; }
+	void sos_sdvsw()
+	{
+		const u8 device = z80.reg.pair.A();
+		WRITE_U8(WorkAddress::DSK, device);
+		switch(device) {
+			case 0x54: WRITE_U8(WorkAddress::DVSW, 0); break; // T
+			case 0x53: WRITE_U8(WorkAddress::DVSW, 1); break; // S
+			case 0x51: WRITE_U8(WorkAddress::DVSW, 3); break; // Q
+		}
+	}
+
+	/**
+	 * @brief ネイティブでマウントしているディスクを取得する
+	 * @param[in]	unit	ユニット番号(0:A ～ 4:E)
+	 * @return ディスク(nullptr:マウントしていないので、JavaScript側で処理する)
+	 */
+	disk::CatDiskImage* getNativeDisk(const u32 unit) noexcept
+	{
+		return (unit < SOS_DISK_DRIVE_MAX && disks[unit].isMounted()) ? &disks[unit] : nullptr;
+	}
+	/**
+	 * @brief 連続セクタリード(SOS.jsの#js_disk_dread()と同じ)
+	 *
+	 * エラーの時は、Aにエラーコードを設定し、キャリフラグをセットする。
+	 * @param[in]	disk	ディスク
+	 * @param[in]	buffer	読み込み先(HL)
+	 * @param[in]	record	先頭レコード(DE)
+	 * @param[in]	count	レコード数(A)
+	 * @return 読み込めたらtrue
+	 */
+	bool readRecords(const disk::CatDiskImage& disk, u16 buffer, const u32 record, const u32 count)
+	{
+		for(u32 i = 0; i < count; ++i) {
+			const u8* data = disk.readRecord(record + i);
+			if(!data) {
+				z80.reg.pair.A() = BadRecord;
+				setCY();
+				return false;
+			}
+			for(u32 j = 0; j < disk::RECORD_SIZE; ++j) {
+				RAM[buffer++] = data[j];
+			}
+		}
+		z80.reg.pair.A() = 0;
+		clearCY();
+		setZ();
+		return true;
+	}
+	/**
+	 * @brief 連続セクタライト(SOS.jsの#js_disk_dwrite()と同じ)
+	 *
+	 * 書き込んだレコードは、ディレクトリとFATのキャッシュにも知らせる。
+	 * エラーの時は、Aにエラーコードを設定し、キャリフラグをセットする。
+	 * @param[in]	unit	ユニット番号(ネイティブでマウントしているもの)
+	 * @param[in]	buffer	書き込むデータ(HL)
+	 * @param[in]	record	先頭レコード(DE)
+	 * @param[in]	count	レコード数(A)
+	 * @return 書き込めたらtrue
+	 */
+	bool writeRecords(const u32 unit, u16 buffer, const u32 record, const u32 count)
+	{
+		disk::CatDiskImage& disk = disks[unit];
+		if(disk.isWriteProtected()) {
+			z80.reg.pair.A() = WriteProtected;
+			setCY();
+			return false;
+		}
+		for(u32 i = 0; i < count; ++i) {
+			u8* data = disk.writeRecord(record + i);
+			if(!data) {
+				z80.reg.pair.A() = BadRecord;
+				setCY();
+				return false;
+			}
+			for(u32 j = 0; j < disk::RECORD_SIZE; ++j) {
+				data[j] = RAM[buffer++];
+			}
+			fileIndexes[unit].onWrite(record + i);
+		}
+		z80.reg.pair.A() = 0;
+		clearCY();
+		setZ();
+		return true;
+	}
+	/**
+	 * @brief #DREAD(ユニットはUNITNO)
+	 * @return 処理したらtrue(false:JavaScript側で処理する)
+	 */
+	bool diskDread()
+	{
+		const disk::CatDiskImage* disk = getNativeDisk(RAM[WorkAddress::UNITNO]);
+		if(!disk) {
+			return false;
+		}
+		readRecords(*disk, getHL(), getDE(), z80.reg.pair.A());
+		return true;
+	}
+	/**
+	 * @brief #DWRITE(ユニットはUNITNO)
+	 * @return 処理したらtrue(false:JavaScript側で処理する)
+	 */
+	bool diskDwrite()
+	{
+		const u32 unit = RAM[WorkAddress::UNITNO];
+		if(!getNativeDisk(unit)) {
+			return false;
+		}
+		writeRecords(unit, getHL(), getDE(), z80.reg.pair.A());
+		return true;
+	}
+	/**
+	 * @brief #DRDSB(デバイスは#DSK)
+	 *
+	 * デバイスのエラーの確認は、JavaScript側に任せる。
+	 * @return 処理したらtrue(false:JavaScript側で処理する)
+	 */
+	bool diskDrdsb()
+	{
+		const u32 unit = (u32)RAM[WorkAddress::DSK] - 0x41;
+		const disk::CatDiskImage* disk = getNativeDisk(unit);
+		if(!disk) {
+			return false;
+		}
+		WRITE_U8(WorkAddress::UNITNO, (u8)unit);
+		readRecords(*disk, getHL(), getDE(), z80.reg.pair.A());
+		return true;
+	}
+	/**
+	 * @brief #DWTSB(デバイスは#DSK)
+	 *
+	 * デバイスのエラーの確認は、JavaScript側に任せる。
+	 * @return 処理したらtrue(false:JavaScript側で処理する)
+	 */
+	bool diskDwtsb()
+	{
+		const u32 unit = (u32)RAM[WorkAddress::DSK] - 0x41;
+		if(!getNativeDisk(unit)) {
+			return false;
+		}
+		WRITE_U8(WorkAddress::UNITNO, (u8)unit);
+		writeRecords(unit, getHL(), getDE(), z80.reg.pair.A());
+		return true;
+	}
+
+	//
+	// ファイル
+	// メモ）js/sos/SOS.jsの#dos_xxx()(S-OSのDOSモジュール)と同じ動作にしている。
+	//       ディレクトリとFATは、読み込んだことにして#DTBUF、#FATBFも同じ内容にしておく。
+	//
+
+	/**
+	 * @brief ディレクトリとFATのキャッシュを全て作り直すようにする
+	 */
+	void invalidateFileIndexes() noexcept
+	{
+		for(auto& it : fileIndexes) {
+			it.invalidate();
+		}
+	}
+	/**
+	 * @brief FATのレコード数を取得する
+	 *
+	 * SOS.jsの#dos_fatred()のWeb版の拡張と同じく、#FATBFがデフォルトで128クラスタ以上のディスクなら2レコード。
+	 */
+	u32 getFatRecords(const u32 unit) const
+	{
+		return (READ_U16(WorkAddress::FATBF) == ADDRESS_FATBF && disk::CatFileIndex::getMaxCluster(disks[unit].getDiskType()) >= 0x80) ? 2 : 1;
+	}
+	/**
+	 * @brief #FATBFで空きを探すクラスタ数を取得する(SOS.jsの#dos_freclu()、#dos_fcget()と同じ)
+	 */
+	u32 getFatClusters(const u32 unit) const
+	{
+		return (getFatRecords(unit) == 2) ? disk::CatFileIndex::getMaxCluster(disks[unit].getDiskType()) : 0x80;
+	}
+	/**
+	 * @brief ネイティブで処理するファイルのユニットを取得する
+	 *
+	 * #DSKがネイティブでマウントしているドライブ(A～E)なら、ディレクトリとFATのキャッシュを使えるようにしておく。
+	 * @return ユニット番号(-1:JavaScript側で処理する)
+	 */
+	s32 prepareFileUnit()
+	{
+		const u32 unit = (u32)RAM[WorkAddress::DSK] - 0x41;
+		const disk::CatDiskImage* disk = getNativeDisk(unit);
+		if(!disk || !disk::CatFileIndex::getMaxCluster(disk->getDiskType())) {
+			return -1;
+		}
+		if(!fileIndexes[unit].prepare(*disk, READ_U16(WorkAddress::DIRPS), READ_U16(WorkAddress::FATPOS), getFatRecords(unit))) {
+			// 読めないレコードがあるので、エラーの処理はJavaScript側に任せる
+			return -1;
+		}
+		return (s32)unit;
+	}
+	/**
+	 * @brief セクタリード(SOS.jsの#dos_dskred()と同じ)
+	 */
+	bool fileRead(const u32 unit, const u16 buffer, const u32 record, const u32 count)
+	{
+		WRITE_U8(WorkAddress::UNITNO, (u8)unit);
+		return readRecords(disks[unit], buffer, record, count);
+	}
+	/**
+	 * @brief セクタライト(SOS.jsの#dos_dskwrt()と同じ)
+	 */
+	bool fileWrite(const u32 unit, const u16 buffer, const u32 record, const u32 count)
+	{
+		WRITE_U8(WorkAddress::UNITNO, (u8)unit);
+		return writeRecords(unit, buffer, record, count);
+	}
+	bool fileFatRead(const u32 unit) { return fileRead(unit, READ_U16(WorkAddress::FATBF), READ_U16(WorkAddress::FATPOS), getFatRecords(unit)); }
+	bool fileFatWrite(const u32 unit) { return fileWrite(unit, READ_U16(WorkAddress::FATBF), READ_U16(WorkAddress::FATPOS), getFatRecords(unit)); }
+	void fileOpen() { WRITE_U8(WorkAddress::OPNFG, 1); }
+	void fileClose() { WRITE_U8(WorkAddress::OPNFG, 0); }
+	bool isFileOpen() const { return READ_U8(WorkAddress::OPNFG) != 0; }
+	/**
+	 * @brief IBバッファの情報をワークに設定する(SOS.jsの#dos_parsc()と同じ)
+	 */
+	void fileParsc()
+	{
+		const u16 ib = READ_U16(WorkAddress::IBFAD);
+		WRITE_U16(WorkAddress::SIZE,  READ_U16(ib + IB_FILE_SIZE));
+		WRITE_U16(WorkAddress::DTADR, READ_U16(ib + IB_START_ADDRESS));
+		WRITE_U16(WorkAddress::EXADR, READ_U16(ib + IB_EXECUTE_ADDRESS));
+	}
+	/**
+	 * @brief ワークの情報をIBバッファに設定する(SOS.jsの#dos_parcs()と同じ)
+	 */
+	void fileParcs()
+	{
+		const u16 ib = READ_U16(WorkAddress::IBFAD);
+		WRITE_U16(ib + IB_FILE_SIZE,       READ_U16(WorkAddress::SIZE));
+		WRITE_U16(ib + IB_START_ADDRESS,   READ_U16(WorkAddress::DTADR));
+		WRITE_U16(ib + IB_EXECUTE_ADDRESS, READ_U16(WorkAddress::EXADR));
+	}
+	/**
+	 * @brief ライトプロテクトの確認(SOS.jsの#dos_wpchk()と同じ)
+	 */
+	bool fileWriteProtectCheck(const u8 attribute)
+	{
+		if(!(attribute & 0x40)) {
+			return true;
+		}
+		z80.reg.pair.A() = WriteProtected;
+		setCY();
+		return false;
+	}
+	/**
+	 * @brief ファイルモードの確認(SOS.jsの#dos_fmchk()と同じ)
+	 */
+	bool fileModeCheck(const u8 attribute)
+	{
+		if(READ_U8(WorkAddress::FTYPE) == (attribute & IB_ATTRIBUTE_MASK)) {
+			return true;
+		}
+		z80.reg.pair.A() = BadFileMode;
+		setCY();
+		return false;
+	}
+	/**
+	 * @brief #DTBUF内のエントリのアドレスを取得する
+	 */
+	u16 getEntryAddress(const u32 entry) const
+	{
+		return READ_U16(WorkAddress::DTBUF) + (entry % disk::CatFileIndex::ENTRIES_PER_RECORD) * disk::CatFileIndex::ENTRY_SIZE;
+	}
+	/**
+	 * @brief IBバッファのファイルを探す(SOS.jsの#dos_fcbsch()と同じ)
+	 *
+	 * 順番に読み込んだ時と同じく、最後に読み込むディレクトリのレコードを#DTBUFに読み込んでおく。
+	 * @return エントリの番号(NOT_FOUND:見つからなかった)
+	 */
+	s32 fileSearch(const u32 unit)
+	{
+		const disk::CatFileIndex& index = fileIndexes[unit];
+		u8 name[disk::CatFileIndex::NAME_SIZE];
+		const u16 ib = READ_U16(WorkAddress::IBFAD);
+		for(u32 i = 0; i < disk::CatFileIndex::NAME_SIZE; ++i) {
+			name[i] = RAM[(u16)(ib + IB_FILENAME + i)];
+		}
+		const s32 entry = index.find(name);
+		u32 last = disk::CatFileIndex::ENTRY_MAX - 1;
+		if(entry != disk::CatFileIndex::NOT_FOUND) {
+			last = (u32)entry;
+		} else if(index.getEntryCount() < disk::CatFileIndex::ENTRY_MAX) {
+			last = index.getEntryCount(); // 終わりのマーカー
+		}
+		// メモ）読めることは、キャッシュを作った時に確認している
+		fileRead(unit, READ_U16(WorkAddress::DTBUF), index.getEntryRecord(last), 1);
+		return entry;
+	}
+	/**
+	 * @brief 空きのエントリを探す(SOS.jsの#dos_fresch()と同じ)
+	 *
+	 * 順番に読み込んだ時と同じく、最後に読み込むディレクトリのレコードを#DTBUFに読み込んでおく。
+	 * @return エントリの番号(NOT_FOUND:空きが無い)
+	 */
+	s32 fileFreeSearch(const u32 unit)
+	{
+		const disk::CatFileIndex& index = fileIndexes[unit];
+		const s32 entry = index.getFreeEntry();
+		const u32 last = (entry != disk::CatFileIndex::NOT_FOUND) ? (u32)entry : disk::CatFileIndex::ENTRY_MAX - 1;
+		fileRead(unit, READ_U16(WorkAddress::DTBUF), index.getEntryRecord(last), 1);
+		return entry;
+	}
+	/**
+	 * @brief #FATBFから空きクラスタ数を取得する(SOS.jsの#dos_freclu()と同じ)
+	 */
+	u32 fileFreeClusters(const u32 unit) const
+	{
+		const u16 fatbf = READ_U16(WorkAddress::FATBF);
+		const u32 clusters = getFatClusters(unit);
+		u32 count = 0;
+		for(u32 i = 0; i < clusters; ++i) {
+			if(!RAM[(u16)(fatbf + i)]) {
+				count++;
+			}
+		}
+		return count;
+	}
+	/**
+	 * @brief #FATBFから空きクラスタの位置を取得する(SOS.jsの#dos_fcget()と同じ)
+	 * @return 空きクラスタの位置(-1:空きが無い)
+	 */
+	s32 fileFreeCluster(const u32 unit) const
+	{
+		const u16 fatbf = READ_U16(WorkAddress::FATBF);
+		const u32 clusters = getFatClusters(unit);
+		for(u32 i = 0; i < clusters; ++i) {
+			if(!RAM[(u16)(fatbf + i)]) {
+				return (s32)i;
+			}
+		}
+		return -1;
+	}
+	/**
+	 * @brief #FATBFから、連鎖しているクラスタを消す(SOS.jsの#dos_erafat()と同じ)
+	 */
+	bool fileEraseFat(u8 next)
+	{
+		const u16 fatbf = READ_U16(WorkAddress::FATBF);
+		// メモ）繋がりが輪になっていると終わらないので、クラスタ数で打ち切ってBad allocation tableにする
+		for(u32 i = 0; i < 0x100; ++i) {
+			const u16 address = fatbf + next;
+			next = RAM[address];
+			RAM[address] = 0;
+			if(next < 0x80) {
+				continue;
+			}
+			if(next < 0x90) {
+				return true;
+			}
+			break;
+		}
+		z80.reg.pair.A() = BadAllocationTable;
+		setCY();
+		return false;
+	}
+	/**
+	 * @brief ファイルを読み込む(SOS.jsの#dos_dload()と同じ)
+	 *
+	 * FATをたどる代わりに、キャッシュしたクラスタの繋がりを使う。
+	 */
+	void fileLoad(const u32 unit)
+	{
+		const u16 dtbuf = READ_U16(WorkAddress::DTBUF);
+		u16 loadAddress = READ_U16(WorkAddress::DTADR);
+		s32 dataSize = READ_U16(WorkAddress::SIZE);
+		u8 current = READ_U8(READ_U16(WorkAddress::IBFAD) + IB_CLUSTER);
+		WRITE_U8(WorkAddress::NXCLST, current);
+		u32 length;
+		const u8* chain = fileIndexes[unit].getChain(current, length);
+		if(!chain) {
+			z80.reg.pair.A() = BadRecord;
+			setCY();
+			return;
+		}
+		// メモ）64KiBまでなので、CHAIN_MAX個の繋がりで足りる
+		for(u32 i = 1; dataSize > 0 && i < length; ++i) {
+			const u8 next = chain[i];
+			WRITE_U8(WorkAddress::NXCLST, next);
+			u32 record = current * disk::CatFileIndex::CLUSTER_RECORDS;
+			if(next < 0x80) {
+				// 続きがある
+				if(!fileRead(unit, loadAddress, record, disk::CatFileIndex::CLUSTER_RECORDS)) {
+					return;
+				}
+				loadAddress += disk::CatFileIndex::CLUSTER_RECORDS * disk::RECORD_SIZE;
+				dataSize -= disk::CatFileIndex::CLUSTER_RECORDS * disk::RECORD_SIZE;
+				current = next;
+				continue;
+			}
+			// 最後のクラスタ(最後の1レコードは、#DTBUFに読み込んでから残りのサイズだけコピーする)
+			const u32 count = next - 0x7F;
+			if(count > 1) {
+				if(!fileRead(unit, loadAddress, record, count - 1)) {
+					return;
+				}
+				loadAddress += (count - 1) * disk::RECORD_SIZE;
+				dataSize -= (count - 1) * disk::RECORD_SIZE;
+				record += count - 1;
+			}
+			if(!fileRead(unit, dtbuf, record, 1)) {
+				return;
+			}
+			if(dataSize > (s32)disk::RECORD_SIZE) {
+				// 最後の1レコードなのに、残りのサイズが大きい
+				z80.reg.pair.A() = BadAllocationTable;
+				setCY();
+				return;
+			}
+			for(s32 j = 0; j < dataSize; ++j) {
+				RAM[(u16)(loadAddress + j)] = RAM[(u16)(dtbuf + j)];
+			}
+			dataSize = 0;
+			break;
+		}
+		if(dataSize > 0) {
+			// 繋がりが途中で終わっている(CHAIN_MAX個で打ち切られた)のに、まだ読み込むデータが残っている
+			z80.reg.pair.A() = BadAllocationTable;
+			setCY();
+			return;
+		}
+		z80.reg.pair.A() = 0;
+		clearCY();
+	}
+	/**
+	 * @brief ファイルを書き込む(SOS.jsの#dos_dsave()と同じ)
+	 */
+	void fileSave(const u32 unit)
+	{
+		const u32 dataSize = READ_U16(WorkAddress::SIZE);
+		const u32 needCluster = ((((dataSize - 1) & 0xFFFF) >> 4) + 0x100) >> 8;
+		if(fileFreeClusters(unit) < needCluster) {
+			z80.reg.pair.A() = DeviceFull;
+			setCY();
+			return;
+		}
+		const u16 ib = READ_U16(WorkAddress::IBFAD);
+		for(u32 i = 0; i < IB_DATE_SIZE; ++i) {
+			WRITE_U8(ib + IB_DATE + i, 0);
+		}
+		// 開始クラスタ
+		s32 freePos = fileFreeCluster(unit);
+		if(freePos < 0) {
+			// メモ）空きを確認しているので、ここには来ない
+			z80.reg.pair.A() = DeviceFull;
+			setCY();
+			return;
+		}
+		WRITE_U8(ib + IB_CLUSTER_HIGH,   (u8)(freePos >> 16));
+		WRITE_U8(ib + IB_CLUSTER,        (u8)freePos);
+		WRITE_U8(ib + IB_CLUSTER_MIDDLE, (u8)(freePos >> 8));
+		u16 saveAddress = READ_U16(WorkAddress::DTADR);
+		u32 remain = dataSize ? ((dataSize - 1) >> 8) + 1 : 1; // 0バイトの時は1レコードにする
+		while(remain > 0) {
+			const u32 count = (remain < disk::CatFileIndex::CLUSTER_RECORDS) ? remain : disk::CatFileIndex::CLUSTER_RECORDS;
+			if(!fileWrite(unit, saveAddress, (u32)freePos * disk::CatFileIndex::CLUSTER_RECORDS, count)) {
+				return;
+			}
+			saveAddress += count * disk::RECORD_SIZE;
+			remain -= count;
+			// FATの繋がり
+			const u16 currentFat = READ_U16(WorkAddress::FATBF) + freePos;
+			if(remain == 0) {
+				WRITE_U8(currentFat, (u8)(count + 0x7F));
+			} else {
+				WRITE_U8(currentFat, 0x80); // 次の空きクラスタを探すので、一旦使用中にする
+				freePos = fileFreeCluster(unit);
+				if(freePos < 0) {
+					z80.reg.pair.A() = DeviceFull;
+					setCY();
+					return;
+				}
+				WRITE_U8(currentFat, (u8)freePos);
+			}
+		}
+		if(!fileFatWrite(unit)) {
+			return;
+		}
+		// IBをディレクトリのレコードに書き戻す
+		const u16 hlbuf = READ_U16(WorkAddress::HLBUF);
+		for(u32 i = 0; i < IB_BLOCK_SIZE; ++i) {
+			WRITE_U8(hlbuf + i, READ_U8(ib + i));
+		}
+		if(!fileWrite(unit, READ_U16(WorkAddress::DTBUF), READ_U16(WorkAddress::DEBUF), 1)) {
+			return;
+		}
+		z80.reg.pair.A() = 0;
+		setZ();
+		clearCY();
+	}
+	/**
+	 * @brief #ROPEN(SOS.jsの#dos_ropen()と同じ)
+	 * @return 処理したらtrue(false:JavaScript側で処理する)
+	 */
+	bool fileRopen()
+	{
+		const s32 unit = prepareFileUnit();
+		if(unit < 0) {
+			return false;
+		}
+		fileClose();
+		const s32 entry = fileSearch(unit);
+		if(entry == disk::CatFileIndex::NOT_FOUND) {
+			z80.reg.pair.A() = FileNotFound;
+			setCY();
+			return true;
+		}
+		// 見つけたIBを、IBバッファにコピーする
+		const u16 src = getEntryAddress(entry);
+		const u16 ib = READ_U16(WorkAddress::IBFAD);
+		for(u32 i = 0; i < IB_BLOCK_SIZE; ++i) {
+			WRITE_U8(ib + i, READ_U8(src + i));
+		}
+		if(!fileModeCheck(READ_U8(src + IB_ATTRIBUTE))) {
+			return true;
+		}
+		fileParsc();
+		fileOpen();
+		z80.reg.pair.A() = 0;
+		clearCY();
+		return true;
+	}
+	/**
+	 * @brief #RDD(SOS.jsの#dos_rdd()と同じ)
+	 * @return 処理したらtrue(false:JavaScript側で処理する)
+	 */
+	bool fileRdd()
+	{
+		const s32 unit = prepareFileUnit();
+		if(unit < 0) {
+			return false;
+		}
+		// 開始クラスタが0x80以上の時や、読み込み先が#FATBFと重なってFATの値が途中で変わる時は、JavaScript側でFATをたどる
+		if(READ_U8(READ_U16(WorkAddress::IBFAD) + IB_CLUSTER) >= 0x80) {
+			return false;
+		}
+		const u32 loadSize = (READ_U16(WorkAddress::SIZE) + 0x0FFF) & ~0x0FFF;
+		const u32 fatSize = getFatRecords(unit) * disk::RECORD_SIZE;
+		const u16 dtadr = READ_U16(WorkAddress::DTADR);
+		const u16 fatbf = READ_U16(WorkAddress::FATBF);
+		if((u16)(fatbf - dtadr) < loadSize || (u16)(dtadr - fatbf) < fatSize) {
+			return false;
+		}
+		WRITE_U8(WorkAddress::DIRNO, 0);
+		if(!isFileOpen()) {
+			z80.reg.pair.A() = FileNotOpen;
+			setCY();
+			return true;
+		}
+		fileClose();
+		if(!fileFatRead(unit)) {
+			return true;
+		}
+		fileLoad(unit);
+		return true;
+	}
+	/**
+	 * @brief #WOPEN(SOS.jsの#dos_wopen()と同じ)
+	 * @return 処理したらtrue(false:JavaScript側で処理する)
+	 */
+	bool fileWopen()
+	{
+		const s32 unit = prepareFileUnit();
+		if(unit < 0) {
+			return false;
+		}
+		fileClose();
+		if(!fileFatRead(unit)) {
+			return true;
+		}
+		s32 entry = fileSearch(unit);
+		if(entry != disk::CatFileIndex::NOT_FOUND) {
+			// 既にあるファイルに上書きするので、FATの繋がりを消しておく
+			const u16 src = getEntryAddress(entry);
+			const u8 attribute = READ_U8(src + IB_ATTRIBUTE);
+			if(!fileWriteProtectCheck(attribute) || !fileModeCheck(attribute) || !fileEraseFat(READ_U8(src + IB_CLUSTER))) {
+				return true;
+			}
+		} else {
+			entry = fileFreeSearch(unit);
+			if(entry == disk::CatFileIndex::NOT_FOUND) {
+				z80.reg.pair.A() = DeviceFull;
+				setCY();
+				return true;
+			}
+		}
+		WRITE_U16(WorkAddress::DEBUF, (u16)fileIndexes[unit].getEntryRecord(entry));	// ディレクトリのレコード
+		WRITE_U16(WorkAddress::HLBUF, getEntryAddress(entry));							// #DTBUF内のIBのアドレス
+		fileParcs();
+		fileOpen();
+		z80.reg.pair.A() = 0;
+		setZ();
+		clearCY();
+		return true;
+	}
+	/**
+	 * @brief #WRD(SOS.jsの#dos_wrd()と同じ)
+	 * @return 処理したらtrue(false:JavaScript側で処理する)
+	 */
+	bool fileWrd()
+	{
+		const s32 unit = prepareFileUnit();
+		if(unit < 0) {
+			return false;
+		}
+		if(!isFileOpen()) {
+			z80.reg.pair.A() = FileNotOpen;
+			setCY();
+			return true;
+		}
+		fileClose();
+		fileSave(unit);
+		return true;
+	}
+
+	void initWork()
+	{
+		WRITE_U16( WorkAddress::USR,    SubroutineAddress::HOT );
+		WRITE_U8(  WorkAddress::DVSW,   0 );
+		WRITE_U8(  WorkAddress::LPSW,   0 );
+		WRITE_U16( WorkAddress::PRCNT,  0 );
+		WRITE_U16( WorkAddress::XYADR,  ADDRESS_XYADR );
+		WRITE_U16( WorkAddress::KBFAD,  ADDRESS_KBFAD );
+		WRITE_U16( WorkAddress::IBFAD,  ADDRESS_IBFAD );
+		WRITE_U16( WorkAddress::SIZE,   0 );
+		WRITE_U16( WorkAddress::DTADR,  0 );
+		WRITE_U16( WorkAddress::EXADR,  0 );
+		WRITE_U16( WorkAddress::STKAD,  ADDRESS_STKAD );
+		WRITE_U16( WorkAddress::MEMAX,  ADDRESS_MEMAX );
+		WRITE_U16( WorkAddress::WKSIZ,  0xFFFF );
+		WRITE_U8(  WorkAddress::DIRNO,  0 );
+		WRITE_U8(  WorkAddress::MXTRK,  0x50 );
+		WRITE_U16( WorkAddress::DTBUF,  ADDRESS_DTBUF );
+		WRITE_U16( WorkAddress::FATBF,  ADDRESS_FATBF );
+		WRITE_U16( WorkAddress::DIRPS,  0x0010 );
+		WRITE_U16( WorkAddress::FATPOS, 0x000E );
+		WRITE_U8(  WorkAddress::DSK,    0x41 );
+		if(platformID == 0x00 || platformID == 0x01 || platformID == 0x02) {
+			// 0x00 MZ-80K
+			// 0x01 MZ-700
+			// 0x02 MZ-1500
+			WRITE_U8(  WorkAddress::WIDTH,  40 );
+		} else {
+			WRITE_U8(  WorkAddress::WIDTH,  80 );
+		}
+		WRITE_U8(  WorkAddress::MAXLIN, 25 );
+		// 変身セット
+		WRITE_U8(  WorkAddress::ETRK,   80 ); // RAMディスクのクラスタ数
+	}
+public:
+	/**
+	 * @brief コンストラクタ
+	 */
+	SOS_Context(s32 platformID)
+		: globalTick(0)
+		, globalTick2(0)
+		, executing(false)
+		, z80(SOS_Context::readByte, SOS_Context::writeByte, SOS_Context::inPort, SOS_Context::outPort, (void*)this, true)
+		, status(SOS_STATUS_RUNNING)
+		, tickWhileWaiting(true)
+		, platformID(platformID)
+		, platform(nullptr)
+		, soundCallback(SOS_Context::defaultSoundCallback)
+		, soundCallbackArg(nullptr)
+		, consoleCallback(SOS_Context::defaultConsoleCallback)
+		, consoleCallbackArg(nullptr)
+	{
+		// 前に使っていたメモリの内容に左右されないように
+		for(auto& it : RAM) { it = 0; }
+		for(auto& it : IO) { it = 0; }
+		for(auto& it : specialRAM) { it = 0; }
+		init();
+		initWork();
+		initInterrupt();
+		setVRAMDirty();
+		// 画面範囲は、JavaScript側から設定されるまではS-OSのワークの画面サイズにしておく
+		consoleRing.read = 0;
+		consoleRing.write = 0;
+		consoleCursor = { 0, 0 };
+		consoleHostCursor = { 0, 0 };
+		consoleCursorValid = false;
+		setConsoleWindow(0, 0, RAM[WorkAddress::WIDTH], RAM[WorkAddress::MAXLIN]);
+
+		z80.setTrapCallback(SOS_Context::trap);
+		z80.setIdleReadCallback(SOS_Context::isIdlePort, SOS_Context::isIdleMemory);
+#if Z80_PROFILE
+		resetProfile();
+		z80.setProfileBuffer(profile.pc);
+#endif
+		//z80.setDebugMessage(callbackZ80DebugMessage);
+
+		// 機種ごとの初期化
+		platform = CatPlatformFactory::createPlatform((CatPlatformFactory::PlatformID)platformID, this);
+		if(platform) [[likely]] {
+			platform->initialize(nullptr);
+			updateMemoryMap();
+		}
+	}
+	/**
+	 * @brief デストラクタ
+	 */
+	~SOS_Context()
+	{
+		if(platform) {
+			delete platform;
+			platform = nullptr;
+		}
+	}
+	SOS_Context(const SOS_Context&) = delete;
+	SOS_Context& operator=(const SOS_Context&) = delete;
+
+	/**
+	 * @brief 使える状態かどうか
+	 * @return 機種を作れていればtrue
+	 */
+	bool isValid() const noexcept { return platform != nullptr; }
+
+	/**
+	 * @brief サウンドチップへの書き込みを渡す先を設定する
+	 * @param[in]	callback	渡す先(nullptr:捨てる)
+	 * @param[in]	arg			callbackに渡す引数
+	 */
+	void setSoundCallback(SOS_Machine::SoundCallback callback, void* arg) noexcept
+	{
+		soundCallback = callback;
+		soundCallbackArg = arg;
+	}
+	/**
+	 * @brief サウンドチップへの書き込みを、JavaScript側(writeSoundRegister)に渡す
+	 */
+	static void defaultSoundCallback(void* arg, s32 clock, s32 no, u8 reg, u8 value)
+	{
+		::writeSoundRegister(clock, no, reg, value);
+	}
+	/**
+	 * @brief フレームの途中で、コンソールへの出力を渡す先を設定する
+	 * @param[in]	callback	渡す先(nullptr:捨てる)
+	 * @param[in]	arg			callbackに渡す引数
+	 */
+	void setConsoleCallback(SOS_Machine::ConsoleCallback callback, void* arg) noexcept
+	{
+		consoleCallback = callback;
+		consoleCallbackArg = arg;
+	}
+	/**
+	 * @brief コンソールへの出力を、JavaScript側(sos_flushConsole)に渡す
+	 */
+	static void defaultConsoleCallback(void* arg, SOS_ConsoleRing* ring)
+	{
+		::sos_flushConsole(ring);
+	}
+	static void callbackZ80DebugMessage(void* arg, const char* msg)
+	{
+		((SOS_Context*)arg)->z80DebugMessage(msg);
+	}
+
+	void z80DebugMessage(const char* msg)
+	{
+		//printf("%s\n", msg);
+	}
+
+	/**
+	 * @brief リセットする
+	 */
+	void reset()
+	{
+		z80.initialize();
+		globalTick = 0;
+		globalTick2 = 0;
+		status = SOS_STATUS_RUNNING;
+		initInterrupt();
+		setVRAMDirty();
+	}
+
+	/**
+	 * @brief 割り込み初期化
+	 * 
+	 * 割り込みモード:2  
+	 * 割り込み:有効  
+	 * Iレジスタ:$00に設定  
+	 */
+	void initInterrupt()
+	{
+		// 割り込みモードを2に
+		z80.reg.interrupt &= 0b11111100;
+		z80.reg.interrupt |= 2; // モード2に
+		// 割り込み有効に
+		z80.reg.IFF |= 0b00000101;
+		z80.reg.execEI = 1;
+		// Iレジスタ$00に設定
+		z80.reg.I = 0;
+	}
+
+	/**
+	 * @brief 実行する
+	 * @param[in]	clock	進めるクロック数
+	 * @return 実際に進んだクロック数
+	 */
+	int execute(int clock) {
+		executing = true;
+		const int executed = z80.execute(clock);
+		executing = false;
+		// メモリアクセス毎に加算せずに、実行し終わってからまとめて進める
+		// メモ）最後に受け付けた割り込みの分は戻り値に含まれないので、消費したクロックで進める
+		const int consumed = z80.getConsumedClock();
+		globalTick += consumed;
+		globalTick2 += consumed;
+		return executed;
+	}
+
+	/**
+	 * @brief 周辺機器も含めて実行する
+	 * @param[in]	clock	実行するクロック(負の値:周辺機器のチックとグローバルTickをリセットする)
+	 * @return 実際に実行されたクロック
+	 */
+	s32 run(s32 clock)
+	{
+		if(clock < 0) {
+			// 周辺機器のチックをリセット
+			platform->resetTick();
+			resetGlobalTick();
+		}
+		if(0 <= clock) {
+			// 入力を再生している時は、記録した時と同じクロック数で区切る
+			clock = inputExecuteClock(clock);
+		}
+		// 前のフレームの出力を表示した後で、JavaScript側でカーソル位置が変えられているかもしれないので
+		consoleCursorValid = false;
+		if(status == SOS_STATUS_WAIT_HOST && inputTimeline.getMode() != CatInputTimeline::Mode::Off) {
+			// 待っている間に入力の記録／再生を始めた時は、フックの呼び出しを繰り返す動作に戻す
+			status = SOS_STATUS_RUNNING;
+		}
+		if(status == SOS_STATUS_WAIT_HOST && !tickWhileWaiting) {
+			// 周辺機器も止めておくので、何もしないで戻る
+			return 0;
+		}
+		s32 tick = 0;
+		while(tick < clock) {
+			s32 remain = clock - tick;
+			// 実行するクロックを調整する
+			// メモ）タイマ割り込み等で進むクロックを制限したい時など
+			if(!platform->adjustTick(remain)) {
+				if(status == SOS_STATUS_WAIT_HOST) {
+					// ホスト側のフックの処理を待っている間は、CPUを実行せずに時間だけ進める
+					globalTick += remain;
+					globalTick2 += remain;
+					tick += remain;
+				} else {
+					// CPUを実行
+					s32 executed = execute(remain);
+					if(executed > 0) {
+						tick += executed;
+					} else {
+						// CPUストールしている場合、進まなくなるので
+						tick += remain;
+					}
+				}
+			} else {
+				tick += remain;
+			}
+			// CPUが実行した所まで周辺機器のチックを進める
+			platform->tick(tick);
+			if(status == SOS_STATUS_WAIT_HOST && z80.isInterruptPending()) {
+				// 割り込みを処理させる
+				// メモ）再開して最初に実行するのはフックのトラップだが、割り込みを受け付けられる間は止まらないので、
+				//       続けて割り込み処理を実行する。戻ってきたらフックをもう一度呼び出して、また待つ。
+				status = SOS_STATUS_RUNNING;
+			}
+		}
+		return tick;
+	}
+
+	/**
+	 * @brief ホスト側のフックの処理を待っているのをやめて、実行を再開する
+	 *
+	 * 次のrun()で、待っていたフックがもう一度呼び出される。
+	 */
+	void resumeFromHost() noexcept
+	{
+		if(status == SOS_STATUS_WAIT_HOST) {
+			status = SOS_STATUS_RUNNING;
+		}
+	}
+	/**
+	 * @brief ホスト側のフックの処理を待っている間も、周辺機器のチックを進めるかどうかを設定する
+	 * @param[in]	enable	trueなら進める(falseならrun()は何もしないで戻る)
+	 */
+	void setTickWhileWaiting(const bool enable) noexcept { tickWhileWaiting = enable; }
+
+	/**
+	 * @brief ドライブのディスクを取得する
+	 * @param[in]	drive	ドライブ(0:A ～ 4:E)
+	 * @return ディスク(nullptr:範囲外)
+	 */
+	disk::CatDiskImage* getDisk(const s32 drive) noexcept
+	{
+		return (0 <= drive && drive < (s32)SOS_DISK_DRIVE_MAX) ? &disks[drive] : nullptr;
+	}
+
+	/**
+	 * @brief 理論画面範囲を設定する
+	 *
+	 * 表示系のサブルーチンでカーソル位置を進める時に使う。JavaScript側の画面範囲が変わったら設定すること。
+	 * @param[in]	left	左端
+	 * @param[in]	top		上端
+	 * @param[in]	right	右端(範囲外)
+	 * @param[in]	bottom	下端(範囲外)
+	 */
+	void setConsoleWindow(const s32 left, const s32 top, const s32 right, const s32 bottom) noexcept
+	{
+		consoleWindow = { left, top, right, bottom };
+	}
+
+	/**
+	 * @brief 表示用に変換されたVRAMイメージを取得する
+	 * @return 表示用に変換されたVRAMイメージ(nullptr:VRAMが変更されていない)
+	 */
+	void* getVRAMImage()
+	{
+		if(!isVRAMDirty()) {
+			return nullptr;
+		}
+		resetVRAMDirty();
+		return platform->render();
+	}
+	void writeIO(const u16 port, const u8 value) { platform->platformOutPort(IO, port, value); }
+	u8 readIO(const u16 port) { return platform->platformInPort(IO, port); }
+	CatPlatformBase* getPlatform() noexcept { return platform; }
+
+	u8* getRAM() noexcept { return &RAM[0]; }
+	u8* getIO() noexcept override { return &IO[0]; }
+	SOS_ConsoleRing* getConsoleRing() noexcept { return &consoleRing; }
+	u8* getZ80Regs() noexcept { return (u8*)&z80.reg; }
+	s32 getZ80RegsSize() noexcept { return (s32)sizeof(z80.reg); }
+#if Z80_PROFILE
+	void* getProfileBuffer() noexcept { return &profile; }
+	u32 getProfileBufferSize() const noexcept { return sizeof(profile); }
+	void resetProfile() noexcept
+	{
+		for(auto& it : profile.pc) {
+			it.clocks = 0;
+			it.count = 0;
+		}
+		for(auto& it : profile.hook) {
+			it.count = 0;
+		}
+	}
+#else
+	void* getProfileBuffer() noexcept { return nullptr; }
+	u32 getProfileBufferSize() const noexcept { return 0; }
+	void resetProfile() noexcept {}
+#endif
+#if Z80_TRACE
+	void* getTraceBuffer() noexcept { return (void*)z80.getTraceBuffer(); }
+	u32 getTraceBufferSize() const noexcept { return sizeof(Z80::TraceEntry) * Z80_TRACE_SIZE; }
+	u32 getTraceCount() const noexcept { return z80.getTraceCount(); }
+	void resetTrace() noexcept { z80.resetTrace(); }
+#ifndef BUILD_WASM
+	void dumpTrace(::FILE* fp) const { z80.dumpTrace(fp); }
+#endif
+#else
+	void* getTraceBuffer() noexcept { return nullptr; }
+	u32 getTraceBufferSize() const noexcept { return 0; }
+	u32 getTraceCount() const noexcept { return 0; }
+	void resetTrace() noexcept {}
+#ifndef BUILD_WASM
+	void dumpTrace(::FILE* fp) const {}
+#endif
+#endif
+	u32 getIdleLoopDetectCount() const noexcept { return z80.getIdleLoopDetectCount(); }
+	u32 getIdleLoopSkipCount() const noexcept { return z80.getIdleLoopSkipCount(); }
+
+	int getStatus() const noexcept { return status; }
+	bool isVRAMDirty() const noexcept {return bVRAMDirty; }
+	void setVRAMDirty() noexcept override { bVRAMDirty = true; }
+	void resetVRAMDirty() noexcept { bVRAMDirty = false; }
+
+	s32 getExecutedClock() const noexcept {return z80.getExecutedClock(); }
+	u64 getGlobalTick() const noexcept override { return executing ? globalTick + z80.getConsumedClock() : globalTick; }
+	void resetGlobalTick() { globalTick = 0; }
+	u64 getGlobal2Tick() const noexcept override { return executing ? globalTick2 + z80.getConsumedClock() : globalTick2; }
+
+	/**
+	 * @brief IRQ割り込み要求
+	 */
+	void generateIRQ(const u8 vector) noexcept override { z80.generateIRQ(vector); }
+	void requestBreak() noexcept override { z80.requestBreak(); }
+	void writeSoundRegister(const s32 clock, const s32 no, const u8 reg, const u8 value) override
+	{
+		if(soundCallback) {
+			soundCallback(soundCallbackArg, clock, no, reg, value);
+		}
+	}
+
+	/**
+	 * @brief 状態の保存データのヘッダ
+	 */
+	struct StateHeader {
+		u32 magic;		// STATE_MAGIC
+		u32 version;	// STATE_VERSION
+		s32 platformID;	// 機種
+		u32 size;		// ヘッダも含めた全体のサイズ
+	};
+	static constexpr u32 STATE_MAGIC = 'S' | ('O' << 8) | ('S' << 16) | ('S' << 24);
+	/**
+	 * @brief 状態の保存データのバージョン
+	 * 
+	 * 保存する内容を変えたら上げること。違うバージョンのデータは復元しない。
+	 */
+	static constexpr u32 STATE_VERSION = 4;
+
+	/**
+	 * @brief 状態を保存／復元する
+	 * @param[in,out]	serializer	シリアライザ
+	 */
+	void serialize(CatSerializer& serializer)
+	{
+		serializer.value(globalTick);
+		serializer.value(globalTick2);
+		serializer.value(status);
+		serializer.value(hookEnabled);
+		serializer.value(z80.reg);
+		serializer.value(z80.wtc);
+		serializer.pages(RAM, sizeof(RAM));
+		serializer.pages(IO, sizeof(IO));
+		serializer.pages(specialRAM, sizeof(specialRAM));
+		platform->serialize(serializer);
+		if(serializer.isLoading()) {
+			// バンクの状態が変わっているかもしれないので
+			updateMemoryMap();
+			setVRAMDirty();
+		}
+	}
+
+	/**
+	 * @brief 状態を保存する
+	 * @param[out]		buffer			保存先(nullptr:サイズを数えるだけ)
+	 * @param[in]		size			保存先のサイズ
+	 * @param[in]		mode			メモリのページの保存のしかた
+	 * @param[in,out]	reference		差分の基準
+	 * @param[in]		referenceSize	差分の基準のサイズ
+	 * @return 保存したサイズ(0:失敗)
+	 */
+	u32 saveState(u8* buffer, const u32 size, const CatSerializer::PageMode mode = CatSerializer::PageMode::Sparse, u8* reference = nullptr, const u32 referenceSize = 0)
+	{
+		CatSerializer serializer(buffer, size, false);
+		serializer.setPageMode(mode, reference, referenceSize);
+		StateHeader header { STATE_MAGIC, STATE_VERSION, platformID, 0 };
+		serializer.value(header);
+		serialize(serializer);
+		if(serializer.isFailed()) {
+			return 0;
+		}
+		if(buffer) {
+			// 全体のサイズが決まったので、ヘッダを書き直す
+			header.size = serializer.getPosition();
+			CatSerializer(buffer, size, false).value(header);
+		}
+		return serializer.getPosition();
+	}
+
+	/**
+	 * @brief 状態を復元する
+	 *
+	 * 壊れたデータでも、復元する前の状態に戻す。
+	 * @param[in]	buffer	保存したデータ
+	 * @param[in]	size	データのサイズ
+	 * @return 復元できたらtrue
+	 */
+	bool loadState(const u8* buffer, const u32 size)
+	{
+		return restoreOnFailure([&]() { return readState(buffer, size, CatSerializer::PageMode::Sparse); });
+	}
+
+	/**
+	 * @brief 状態を復元し、失敗したら復元する前の状態に戻す
+	 *
+	 * 途中で壊れていると分かっても、中途半端に復元した状態にならないように、先に今の状態を保存しておく。
+	 * @param[in]	load	復元の処理 bool()
+	 * @return 復元できたらtrue
+	 */
+	template<typename LoadFunctor>
+	bool restoreOnFailure(LoadFunctor load)
+	{
+		const u32 capacity = saveState(nullptr, 0);
+		u8* backup = new u8[capacity];
+		const u32 backupSize = saveState(backup, capacity);
+		const bool succeeded = load();
+		if(!succeeded) {
+			readState(backup, backupSize, CatSerializer::PageMode::Sparse);
+		}
+		delete[] backup;
+		return succeeded;
+	}
+
+	/**
+	 * @brief 状態を読み込む
+	 *
+	 * 失敗した時は、途中まで読み込んだ状態になっている。
+	 * @param[in]	buffer	保存したデータ
+	 * @param[in]	size	データのサイズ
+	 * @param[in]	mode	保存した時のメモリのページの保存のしかた
+	 * @return 読み込めたらtrue
+	 */
+	bool readState(const u8* buffer, const u32 size, const CatSerializer::PageMode mode)
+	{
+		CatSerializer serializer((u8*)buffer, size, true);
+		serializer.setPageMode(mode);
+		StateHeader header {};
+		serializer.value(header);
+		if(serializer.isFailed()
+			|| header.magic != STATE_MAGIC
+			|| header.version != STATE_VERSION
+			|| header.platformID != platformID
+			|| header.size != size)
+		{
+			return false;
+		}
+		serialize(serializer);
+		return !serializer.isFailed() && serializer.getPosition() == size;
+	}
+
+	/**
+	 * @brief 巻き戻し用のリングバッファを確保する
+	 * @param[in]	frameCount			記録するフレーム数(0:巻き戻しを使用しない)
+	 * @param[in]	keyframeInterval	キーフレームの間隔(フレーム)
+	 */
+	void setupRewind(const u32 frameCount, const u32 keyframeInterval)
+	{
+		CatSerializer serializer(nullptr, 0, false);
+		StateHeader header {};
+		serializer.value(header);
+		serialize(serializer);
+		rewindBuffer.setup(frameCount, keyframeInterval, serializer.getPosition(), serializer.getPageBytes());
+	}
+	/**
+	 * @brief 現在の状態を巻き戻し用に記録する
+	 * @return 記録できたらtrue
+	 */
+	bool recordRewind()
+	{
+		return rewindBuffer.push([this](u8* buffer, u32 size, CatSerializer::PageMode mode, u8* reference, u32 referenceSize) {
+			return saveState(buffer, size, mode, reference, referenceSize);
+		});
+	}
+	/**
+	 * @brief 記録した状態に巻き戻す
+	 * @param[in]	frames	戻すフレーム数(0:最後に記録した状態)
+	 * @return 戻せたらtrue
+	 */
+	bool rewindState(const u32 frames)
+	{
+		// キーフレームを復元してから差分で失敗しても、巻き戻す前の状態に戻す
+		return restoreOnFailure([&]() {
+			return rewindBuffer.rewind(frames, [this](const u8* buffer, u32 size, CatSerializer::PageMode mode) {
+				return readState(buffer, size, mode);
+			});
+		});
+	}
+	u32 getRewindCount() const noexcept { return rewindBuffer.getCount(); }
+	u32 getRewindMemorySize() const noexcept { return rewindBuffer.getMemorySize(); }
+
+	/**
+	 * @brief 入力の記録を開始する
+	 */
+	void startInputRecord()
+	{
+		resetInputState();
+		inputTimeline.startRecord(getGlobal2Tick());
+	}
+	/**
+	 * @brief 記録した入力の再生を開始する
+	 * @param[in]	buffer	記録した入力のデータ
+	 * @param[in]	size	データのサイズ
+	 * @return 再生を開始できたらtrue
+	 */
+	bool startInputReplay(const void* buffer, const u32 size)
+	{
+		resetInputState();
+		return inputTimeline.startReplay(buffer, size, getGlobal2Tick());
+	}
+	void stopInputTimeline() noexcept { inputTimeline.stop(); }
+	const void* getInputTimeline() const noexcept { return inputTimeline.getBuffer(); }
+	u32 getInputTimelineSize() const noexcept { return inputTimeline.getSize(); }
+	bool isInputReplayEnd() const noexcept { return inputTimeline.isEnd(); }
+	bool isInputReplayDesynced() const noexcept { return inputTimeline.isDesynced(); }
+
+	/**
+	 * @brief ゲームパッドの読み込み(入力の記録／再生を経由する)
+	 *
+	 * 記録する時は、状態が変わった時だけ記録する。
+	 * @param[in]	index	読み込むゲームパッドの番号(0,1)
+	 * @return ゲームパッドの状態
+	 */
+	u8 inputGamePad(const u8 index) override
+	{
+		const CatInputTimeline::Mode mode = inputTimeline.getMode();
+		if(mode == CatInputTimeline::Mode::Off || 2 <= index) {
+			return readGamePad(index);
+		}
+		u8& state = inputGamePadState[index];
+		if(mode == CatInputTimeline::Mode::Replay) {
+			u32 size;
+			if(const u8* data = inputTimeline.replay(getGlobal2Tick(), CatInputTimeline::GamePad, index, size); data && size == 1) {
+				state = *data;
+			}
+			return state;
+		}
+		const u8 value = readGamePad(index);
+		if(value != state) {
+			state = value;
+			inputTimeline.record(getGlobal2Tick(), CatInputTimeline::GamePad, index, &value, 1);
+		}
+		return value;
+	}
+	/**
+	 * @brief キーボードマトリクスの読み込み(入力の記録／再生を経由する)
+	 *
+	 * 記録する時は、マトリクスが変わった時だけ記録する。
+	 * @return キーボードマトリクス
+	 */
+	const u8* inputScanKey() override
+	{
+		const CatInputTimeline::Mode mode = inputTimeline.getMode();
+		if(mode == CatInputTimeline::Mode::Off) {
+			return (const u8*)scanKey();
+		}
+		if(mode == CatInputTimeline::Mode::Replay) {
+			u32 size;
+			if(const u8* data = inputTimeline.replay(getGlobal2Tick(), CatInputTimeline::ScanKey, 0, size); data && size == sizeof(inputKeyMatrix)) {
+				copyBytes(inputKeyMatrix, data, size);
+			}
+			return inputKeyMatrix;
+		}
+		const u8* scan = (const u8*)scanKey();
+		if(!isEqualBytes(scan, inputKeyMatrix, sizeof(inputKeyMatrix))) {
+			copyBytes(inputKeyMatrix, scan, sizeof(inputKeyMatrix));
+			inputTimeline.record(getGlobal2Tick(), CatInputTimeline::ScanKey, 0, inputKeyMatrix, sizeof(inputKeyMatrix));
+		}
+		return scan;
+	}
+	/**
+	 * @brief exeute()で進めるクロック数を記録／再生する
+	 *
+	 * JavaScript側は経過時間に合わせてクロック数を変えているので、
+	 * 再生する時は、記録した時と同じ区切りで実行しないと同じ結果にならない。
+	 * クロック数が変わった時だけ記録する。
+	 * @param[in]	clock	進めるクロック数
+	 * @return 実際に進めるクロック数
+	 */
+	s32 inputExecuteClock(const s32 clock)
+	{
+		const CatInputTimeline::Mode mode = inputTimeline.getMode();
+		if(mode == CatInputTimeline::Mode::Record) {
+			if(clock != inputClock) {
+				inputClock = clock;
+				inputTimeline.record(getGlobal2Tick(), CatInputTimeline::Execute, 0, &clock, sizeof(clock));
+			}
+		} else if(mode == CatInputTimeline::Mode::Replay) {
+			u32 size;
+			if(const u8* data = inputTimeline.replay(getGlobal2Tick(), CatInputTimeline::Execute, 0, size); data && size == sizeof(inputClock)) {
+				copyBytes((u8*)&inputClock, data, sizeof(inputClock));
+			}
+			if(0 <= inputClock) {
+				return inputClock;
+			}
+		}
+		return clock;
+	}
+	/**
+	 * @brief フックの結果をレジスタに反映する
+	 * @param[in]		result	フックの結果
+	 * @param[in,out]	reg		レジスタ
+	 */
+	static void applyHookResult(const InputHookResult& result, Z80::Register& reg) noexcept
+	{
+		const u8* src = (const u8*)&result.value;
+		u8* dst = (u8*)&reg;
+		for(u32 i = 0; i < sizeof(reg); ++i) {
+			if(result.mask & (1ull << i)) { dst[i] = src[i]; }
+		}
+	}
+	/**
+	 * @brief 入力系のフックを記録／再生する
+	 *
+	 * フックが書き換えたレジスタのバイトと値を結果として覚えておき、
+	 * 次に呼び出した時も同じ結果になるなら記録しない(ポーリングで何度も呼び出されるので)。
+	 * 再生する時はフックを呼び出さずに、記録した結果か、最後に再生した結果を書き戻す。
+	 * jsの処理を待っている間の結果も記録するので、記録した時と同じクロックで処理が完了する。
+	 * @param[in]	addr	フックのアドレス
+	 * @param[in]	hook	フック
+	 */
+	void inputHook(const u16 addr, const Hook& hook)
+	{
+		InputHookResult& result = inputHookResult[addr - ADDRESS_JUMPTABLE];
+		if(inputTimeline.getMode() == CatInputTimeline::Mode::Replay) {
+			u32 size;
+			if(const u8* data = inputTimeline.replay(getGlobal2Tick(), CatInputTimeline::Hook, addr, size); data && sizeof(result) <= size) {
+				copyBytes((u8*)&result, data, sizeof(result));
+				if(hook.input == HookInput::Line && sizeof(result) + 2 <= size) {
+					u16 address;
+					copyBytes((u8*)&address, data + sizeof(result), 2);
+					const u8* line = data + sizeof(result) + 2;
+					const u32 length = size - sizeof(result) - 2;
+					for(u32 i = 0; i < length; ++i) {
+						RAM[(u16)(address + i)] = line[i];
+					}
+				}
+			}
+			applyHookResult(result, z80.reg);
+			return;
+		}
+		const Z80::Register before = z80.reg;
+		hook.function(this);
+		const bool changed = !isEqualBytes((const u8*)&before, (const u8*)&z80.reg, sizeof(z80.reg));
+		Z80::Register expected = before;
+		applyHookResult(result, expected);
+		if(isEqualBytes((const u8*)&expected, (const u8*)&z80.reg, sizeof(z80.reg)) && !(changed && hook.input == HookInput::Line)) {
+			// 前と同じ結果(GETLは1行の入力が終わっていない)
+			return;
+		}
+		// 前の結果で書き換えていたバイトも含めて、書き換えたバイトを結果にする
+		const u8* src = (const u8*)&before;
+		const u8* dst = (const u8*)&z80.reg;
+		for(u32 i = 0; i < sizeof(z80.reg); ++i) {
+			if(src[i] != dst[i]) { result.mask |= 1ull << i; }
+		}
+		result.value = z80.reg;
+		u8 data[sizeof(result) + 2 + INPUT_LINE_MAX];
+		u32 size = 0;
+		copyBytes(data, (const u8*)&result, sizeof(result));
+		size += sizeof(result);
+		if(hook.input == HookInput::Line && changed) {
+			// DEが指すバッファに入力した1行(終端の0まで)
+			const u16 address = before.pair.DE();
+			copyBytes(data + size, (const u8*)&address, 2);
+			size += 2;
+			for(u32 i = 0; i < INPUT_LINE_MAX; ++i) {
+				const u8 ch = RAM[(u16)(address + i)];
+				data[size++] = ch;
+				if(!ch) { break; }
+			}
+		}
+		inputTimeline.record(getGlobal2Tick(), CatInputTimeline::Hook, addr, data, size);
+	}
+
+	/**
+	 * @brief 最後に記録／再生した入力の状態を、何も入力していない状態にする
+	 */
+	void resetInputState() noexcept
+	{
+		for(auto& it : inputGamePadState) { it = 0xFF; }
+		for(auto& it : inputKeyMatrix) { it = 0xFF; }
+		for(auto& it : inputHookResult) { it.mask = 0; }
+		inputClock = -1;
+	}
+	inline static void copyBytes(u8* dst, const u8* src, u32 size) noexcept
+	{
+		while(size--) { *dst++ = *src++; }
+	}
+	inline static bool isEqualBytes(const u8* a, const u8* b, u32 size) noexcept
+	{
+		u8 bits = 0;
+		for(u32 i = 0; i < size; ++i) { bits |= a[i] ^ b[i]; }
+		return bits == 0;
+	}
+
+	/**
+	 * @brief Z80のメモリのページテーブルを機種側の割り当てに合わせて更新する
+	 */
+	void updateMemoryMap() override
+	{
+		for(s32 page = 0; page < 0x100; ++page) {
+			const u16 address = (u16)(page << 8);
+			const u8* read = platform ? platform->getMemoryPage(RAM, address, false) : nullptr;
+			u8* write = platform ? platform->getMemoryPage(RAM, address, true) : nullptr;
+			if((ADDRESS_JUMPTABLE >> 8) <= page && page <= (ADDRESS_JUMPTABLE_END >> 8)) {
+				// S-OSのフック部分は書き換えを監視するので、必ずwriteByte()を経由させる
+				write = nullptr;
+			}
+			z80.setMemoryPage(page, read, write);
+		}
+	}
+};
+
+/**
+ * @brief 実態
+ */
+SOS_Context* ctx = nullptr;
+
+void
+initialize(void* heapBase, size_t heapSize, s32 platformID)
+{
+#ifdef BUILD_WASM
+	setupHeap(heapBase, heapSize);
+#endif
+	delete ctx;
+	ctx = new SOS_Context(platformID);
+
+	// 可変長引数のテスト
+	//hoge( u8"%d,%d,%d,%d", 1, 2, 4, 8 );
+}
+
+/**
+ * @brief リセットする
+ */
+void
+z80Reset(s32 platformID)
+{
+	delete ctx;
+	ctx = new SOS_Context(platformID);
+	return ctx->reset();
+}
+
+/**
+ * @brief 実行する
+ */
+int
+exeute(int clock)
+{
+	return ctx->run(clock);
+}
+
+CatPlatformBase*
+getDefaultPlatform()
+{
+	return ctx->getPlatform();
+}
+
+int
 getStatus()
 {
 	return ctx->getStatus();
 }
 
+void
+resumeFromHost()
+{
+	ctx->resumeFromHost();
+}
+
+void
+setTickWhileWaiting(int enable)
+{
+	ctx->setTickWhileWaiting(enable != 0);
+}
+
 void*
 getRAM()
 {
@@ -683,6 +2654,12 @@ getIO()
 	return ctx->getIO();
 }
 
+void*
+getConsoleRing()
+{
+	return ctx->getConsoleRing();
+}
+
 void*
 getZ80Regs()
 {
@@ -693,6 +2670,55 @@ getZ80RegsSize()
 {
 	return ctx->getZ80RegsSize();
 }
+s32
+getZ80PairHighOffset()
+{
+	return Z80::RegisterPair::HIGH;
+}
+
+void*
+getProfileBuffer()
+{
+	return ctx->getProfileBuffer();
+}
+u32
+getProfileBufferSize()
+{
+	return ctx->getProfileBufferSize();
+}
+void
+resetProfile()
+{
+	ctx->resetProfile();
+}
+
+void*
+getTraceBuffer()
+{
+	return ctx->getTraceBuffer();
+}
+u32
+getTraceBufferSize()
+{
+	return ctx->getTraceBufferSize();
+}
+u32
+getTraceCount()
+{
+	return ctx->getTraceCount();
+}
+void
+resetTrace()
+{
+	ctx->resetTrace();
+}
+#ifndef BUILD_WASM
+void
+dumpTrace(FILE* fp)
+{
+	ctx->dumpTrace(fp);
+}
+#endif // BUILD_WASM
 
 bool
 isVRAMDirty()
@@ -709,53 +2735,319 @@ setVRAMDirty()
 void*
 getVRAMImage()
 {
-	if(!ctx->isVRAMDirty()) {
-		return nullptr;
+	return ctx->getVRAMImage();
+}
+
+u32
+getIdleLoopDetectCount()
+{
+	return ctx->getIdleLoopDetectCount();
+}
+
+u32
+getIdleLoopSkipCount()
+{
+	return ctx->getIdleLoopSkipCount();
+}
+
+u32
+getStateSize()
+{
+	return ctx->saveState(nullptr, 0);
+}
+
+u32
+saveState(void* buffer, u32 size)
+{
+	return ctx->saveState((u8*)buffer, size);
+}
+
+bool
+loadState(const void* buffer, u32 size)
+{
+	return ctx->loadState((const u8*)buffer, size);
+}
+
+void*
+allocateStateBuffer(u32 size)
+{
+	return new u8[size];
+}
+
+void
+freeStateBuffer(void* buffer)
+{
+	delete[] (u8*)buffer;
+}
+
+void*
+allocateDiskImage(u32 size)
+{
+	return new u8[size];
+}
+
+bool
+mountDisk(s32 drive, void* image, u32 size)
+{
+	disk::CatDiskImage* disk = ctx->getDisk(drive);
+	if(!disk) {
+		delete[] (u8*)image;
+		return false;
 	}
-	ctx->resetVRAMDirty();
-	return getPlatformVRAMImage();
+	return disk->mount((u8*)image, size);
 }
 
 void
-writeIO(u16 port, u8 value)
+unmountDisk(s32 drive)
 {
-	platformOutPort(ctx->getIO(), port, value);
+	if(disk::CatDiskImage* disk = ctx->getDisk(drive)) {
+		disk->unmount();
+	}
 }
 
-u8
-readIO(u16 port)
+bool
+isDiskMounted(s32 drive)
 {
-	return platformInPort(ctx->getIO(), port);
+	const disk::CatDiskImage* disk = ctx->getDisk(drive);
+	return disk && disk->isMounted();
 }
 
-s32
-getExecutedClock()
+u32
+getDiskRecordCount(s32 drive)
+{
+	const disk::CatDiskImage* disk = ctx->getDisk(drive);
+	return disk ? disk->getRecordCount() : 0;
+}
+
+void*
+getDiskRecord(s32 drive, u32 record)
+{
+	disk::CatDiskImage* disk = ctx->getDisk(drive);
+	return disk ? disk->getRecordData(record) : nullptr;
+}
+
+u32
+getDiskRecordSize(s32 drive, u32 record)
+{
+	const disk::CatDiskImage* disk = ctx->getDisk(drive);
+	return disk ? disk->getRecordSize(record) : 0;
+}
+
+u32
+getDiskDirtyCount(s32 drive)
+{
+	const disk::CatDiskImage* disk = ctx->getDisk(drive);
+	return disk ? disk->getDirtyCount() : 0;
+}
+
+bool
+isDiskRecordDirty(s32 drive, u32 record)
+{
+	const disk::CatDiskImage* disk = ctx->getDisk(drive);
+	return disk && disk->isDirty(record);
+}
+
+void
+clearDiskDirty(s32 drive)
+{
+	if(disk::CatDiskImage* disk = ctx->getDisk(drive)) {
+		disk->clearDirty();
+	}
+}
+
+void
+touchDisk(s32 drive)
+{
+	if(disk::CatDiskImage* disk = ctx->getDisk(drive)) {
+		disk->touch();
+	}
+}
+
+const void*
+getDiskImage(s32 drive)
+{
+	const disk::CatDiskImage* disk = ctx->getDisk(drive);
+	return disk ? disk->getImage() : nullptr;
+}
+
+u32
+getDiskImageSize(s32 drive)
+{
+	const disk::CatDiskImage* disk = ctx->getDisk(drive);
+	return disk ? disk->getImageSize() : 0;
+}
+
+void
+setupRewind(u32 frameCount, u32 keyframeInterval)
+{
+	ctx->setupRewind(frameCount, keyframeInterval);
+}
+
+bool
+recordRewind()
+{
+	return ctx->recordRewind();
+}
+
+bool
+rewindState(u32 frames)
+{
+	return ctx->rewindState(frames);
+}
+
+u32
+getRewindCount()
+{
+	return ctx->getRewindCount();
+}
+
+u32
+getRewindMemorySize()
+{
+	return ctx->getRewindMemorySize();
+}
+
+void
+startInputRecord()
+{
+	ctx->startInputRecord();
+}
+
+bool
+startInputReplay(const void* buffer, u32 size)
+{
+	return ctx->startInputReplay(buffer, size);
+}
+
+void
+stopInputTimeline()
+{
+	ctx->stopInputTimeline();
+}
+
+const void*
+getInputTimeline()
 {
-	return ctx->getExecutedClock();
+	return ctx->getInputTimeline();
 }
 
-u64
-getGlobalTick()
+u32
+getInputTimelineSize()
 {
-	return ctx->getGlobalTick();
+	return ctx->getInputTimelineSize();
 }
-u64
-getGlobal2Tick()
+
+bool
+isInputReplayEnd()
 {
-	return ctx->getGlobal2Tick();
+	return ctx->isInputReplayEnd();
 }
 
+bool
+isInputReplayDesynced()
+{
+	return ctx->isInputReplayDesynced();
+}
 
 void
-generateIRQ(const u8 vector)
+writeIO(u16 port, u8 value)
+{
+	ctx->writeIO(port, value);
+}
+
+u8
+readIO(u16 port)
 {
-	ctx->generateIRQ(vector);
+	return ctx->readIO(port);
 }
+
 void
-requestBreak()
+setConsoleWindow(s32 left, s32 top, s32 right, s32 bottom)
+{
+	ctx->setConsoleWindow(left, top, right, bottom);
+}
+
+//
+// マシン
+//
+
+SOS_Machine::SOS_Machine(s32 platformID)
+	: ctx(new SOS_Context(platformID))
+{
+	if(ctx && !ctx->isValid()) [[unlikely]] {
+		delete ctx;
+		ctx = nullptr;
+	}
+	if(ctx) [[likely]] {
+		// 複数のマシンの音や表示が混ざらないように、設定されるまでは捨てる
+		ctx->setSoundCallback(nullptr, nullptr);
+		ctx->setConsoleCallback(nullptr, nullptr);
+	}
+}
+
+SOS_Machine::~SOS_Machine()
+{
+	if(ctx) {
+		delete ctx;
+		ctx = nullptr;
+	}
+}
+
+void SOS_Machine::reset() { ctx->reset(); }
+s32 SOS_Machine::execute(s32 clock) { return ctx->run(clock); }
+s32 SOS_Machine::getStatus() const noexcept { return ctx->getStatus(); }
+void SOS_Machine::resumeFromHost() noexcept { ctx->resumeFromHost(); }
+void SOS_Machine::setTickWhileWaiting(bool enable) noexcept { ctx->setTickWhileWaiting(enable); }
+u8* SOS_Machine::getRAM() noexcept { return ctx->getRAM(); }
+u8* SOS_Machine::getIO() noexcept { return ctx->getIO(); }
+SOS_ConsoleRing* SOS_Machine::getConsoleRing() noexcept { return ctx->getConsoleRing(); }
+Z80::Register* SOS_Machine::getZ80Regs() noexcept { return (Z80::Register*)ctx->getZ80Regs(); }
+s32 SOS_Machine::getZ80RegsSize() const noexcept { return ctx->getZ80RegsSize(); }
+void* SOS_Machine::getVRAMImage() { return ctx->getVRAMImage(); }
+void SOS_Machine::writeIO(u16 port, u8 value) { ctx->writeIO(port, value); }
+u8 SOS_Machine::readIO(u16 port) { return ctx->readIO(port); }
+void SOS_Machine::setSoundCallback(SoundCallback callback, void* arg) noexcept { ctx->setSoundCallback(callback, arg); }
+void SOS_Machine::setConsoleCallback(ConsoleCallback callback, void* arg) noexcept { ctx->setConsoleCallback(callback, arg); }
+u32 SOS_Machine::getIdleLoopDetectCount() const noexcept { return ctx->getIdleLoopDetectCount(); }
+u32 SOS_Machine::getIdleLoopSkipCount() const noexcept { return ctx->getIdleLoopSkipCount(); }
+u32 SOS_Machine::getStateSize() { return ctx->saveState(nullptr, 0); }
+u32 SOS_Machine::saveState(void* buffer, u32 size) { return ctx->saveState((u8*)buffer, size); }
+bool SOS_Machine::loadState(const void* buffer, u32 size) { return ctx->loadState((const u8*)buffer, size); }
+void SOS_Machine::startInputRecord() { ctx->startInputRecord(); }
+bool SOS_Machine::startInputReplay(const void* buffer, u32 size) { return ctx->startInputReplay(buffer, size); }
+void SOS_Machine::stopInputTimeline() noexcept { ctx->stopInputTimeline(); }
+const void* SOS_Machine::getInputTimeline() const noexcept { return ctx->getInputTimeline(); }
+u32 SOS_Machine::getInputTimelineSize() const noexcept { return ctx->getInputTimelineSize(); }
+bool SOS_Machine::isInputReplayEnd() const noexcept { return ctx->isInputReplayEnd(); }
+bool SOS_Machine::isInputReplayDesynced() const noexcept { return ctx->isInputReplayDesynced(); }
+bool SOS_Machine::mountDisk(s32 drive, const void* image, u32 size)
+{
+	disk::CatDiskImage* disk = ctx->getDisk(drive);
+	if(!disk) {
+		return false;
+	}
+	u8* copy = new u8[size];
+	if(!copy) {
+		return false;
+	}
+	for(u32 i = 0; i < size; ++i) {
+		copy[i] = ((const u8*)image)[i];
+	}
+	return disk->mount(copy, size);
+}
+bool SOS_Machine::mountDiskCopyOnWrite(s32 drive, const void* image, u32 size)
 {
-	ctx->requestBreak();
+	disk::CatDiskImage* disk = ctx->getDisk(drive);
+	return disk && disk->mountCopyOnWrite((const u8*)image, size);
 }
+void SOS_Machine::unmountDisk(s32 drive) { if(disk::CatDiskImage* disk = ctx->getDisk(drive)) { disk->unmount(); } }
+bool SOS_Machine::isDiskMounted(s32 drive) const noexcept { const disk::CatDiskImage* disk = ctx->getDisk(drive); return disk && disk->isMounted(); }
+u32 SOS_Machine::getDiskDirtyCount(s32 drive) const noexcept { const disk::CatDiskImage* disk = ctx->getDisk(drive); return disk ? disk->getDirtyCount() : 0; }
+const void* SOS_Machine::getDiskImage(s32 drive) const noexcept { const disk::CatDiskImage* disk = ctx->getDisk(drive); return disk ? disk->getImage() : nullptr; }
+u32 SOS_Machine::getDiskImageSize(s32 drive) const noexcept { const disk::CatDiskImage* disk = ctx->getDisk(drive); return disk ? disk->getImageSize() : 0; }
+bool SOS_Machine::copyDiskImage(s32 drive, void* buffer, u32 size) const noexcept { const disk::CatDiskImage* disk = ctx->getDisk(drive); return disk && disk->copyImage((u8*)buffer, size); }
+u32 SOS_Machine::getDiskOverlayCount(s32 drive) const noexcept { const disk::CatDiskImage* disk = ctx->getDisk(drive); return disk ? disk->getOverlayCount() : 0; }
+void SOS_Machine::discardDiskOverlay(s32 drive) { if(disk::CatDiskImage* disk = ctx->getDisk(drive)) { disk->discardOverlay(); } }
 
 
 u8 scratchMemory[256];
@@ -53,10 +53,30 @@ extern "C" size_t getScratchMemorySize();
  * @return 状態
  * @retval	0: 実行中
  * @retval	1: 停止中
+ * @retval	2: ホスト側(JavaScript側)のフックの処理を待っている(SOS_STATUS_WAIT_HOST)
  */
 WASM_EXPORT
 extern "C" int getStatus();
 
+/**
+ * @brief ホスト側のフックの処理を待っているのをやめて、実行を再開する
+ *
+ * 待っている間、exeute()はCPUを実行しない。
+ * 次のexeute()で待っていたフックがもう一度呼び出されるので、フックの処理が終わっていなければまた待つ。
+ */
+WASM_EXPORT
+extern "C" void resumeFromHost();
+
+/**
+ * @brief ホスト側のフックの処理を待っている間も、周辺機器のチックを進めるかどうかを設定する
+ *
+ * 進める時は、割り込みが発生したらCPUを実行して割り込みを処理させる(初期値)。
+ * 進めない時は、待っている間のexeute()は何もしないで0を返す。
+ * @param[in]	enable	0以外なら進める
+ */
+WASM_EXPORT
+extern "C" void setTickWhileWaiting(int enable);
+
 /**
  * @brief メモリの先頭アドレスを取得する
  * @return メモリの先頭アドレス
@@ -71,6 +91,15 @@ extern "C" void* getRAM();
 WASM_EXPORT
 extern "C" void* getIO();
 
+/**
+ * @brief コンソールへの出力のリングバッファを取得する
+ *
+ * ホスト側は1フレームに1回、readからwriteまでを表示して、readをwriteに進めること(SOS_ConsoleRing参照)。
+ * @return コンソールへの出力のリングバッファ
+ */
+WASM_EXPORT
+extern "C" void* getConsoleRing();
+
 /**
  * @brief Z80のレジスタの先頭アドレスを取得する
  * @return Z80のレジスタの先頭アドレス
@@ -85,6 +114,80 @@ extern "C" void* getZ80Regs();
 WASM_EXPORT
 extern "C" s32 getZ80RegsSize();
 
+/**
+ * @brief Z80のペアのレジスタの中で、上位のレジスタ(A, B, D, H)のバイトの位置を取得する
+ *
+ * ペアはホストのバイトオーダーで持っているので、リトルエンディアンなら1、ビッグエンディアンなら0になる。
+ * @return 上位のレジスタの、ペアの先頭からのオフセット
+ */
+WASM_EXPORT
+extern "C" s32 getZ80PairHighOffset();
+
+/**
+ * @brief プロファイルの集計を取得する
+ * 
+ * Z80_PROFILEを有効にしてビルドした時だけ集計する。
+ * 先頭から、PC毎の集計(実行したクロック数u32、実行した命令数u32)が0x10000個、
+ * 続いて、フック毎の集計(S-OSのサブルーチンのアドレスu16、予約u16、呼び出し回数u32)が並ぶ。
+ * @return プロファイルの集計
+ * @retval nullptr: プロファイルが無効
+ */
+WASM_EXPORT
+extern "C" void* getProfileBuffer();
+
+/**
+ * @brief プロファイルの集計のサイズを取得する
+ * @return プロファイルの集計のサイズ(バイト)
+ */
+WASM_EXPORT
+extern "C" u32 getProfileBufferSize();
+
+/**
+ * @brief プロファイルの集計を0に戻す
+ */
+WASM_EXPORT
+extern "C" void resetProfile();
+
+/**
+ * @brief 実行トレースのリングバッファを取得する
+ * 
+ * Z80_TRACEを有効にしてビルドした時だけ記録する。
+ * 1命令毎に、クロックu64、PC・AF・BC・DE・HL・SP(各u16)、PCからの命令コード4バイトが並ぶ。
+ * 書き込む位置はgetTraceCount()をgetTraceBufferSize()の個数で割った余り。
+ * @return 実行トレースのリングバッファ
+ * @retval nullptr: 実行トレースが無効
+ */
+WASM_EXPORT
+extern "C" void* getTraceBuffer();
+
+/**
+ * @brief 実行トレースのリングバッファのサイズを取得する
+ * @return リングバッファのサイズ(バイト)
+ */
+WASM_EXPORT
+extern "C" u32 getTraceBufferSize();
+
+/**
+ * @brief 実行トレースに記録した命令の数を取得する
+ * @return 記録した命令の数(リングバッファに収まらなかった分も含む)
+ */
+WASM_EXPORT
+extern "C" u32 getTraceCount();
+
+/**
+ * @brief 実行トレースを消去する
+ */
+WASM_EXPORT
+extern "C" void resetTrace();
+
+#ifndef BUILD_WASM
+/**
+ * @brief 実行トレースを古い順にテキストで出力する
+ * @param[in]	fp	出力先
+ */
+extern "C" void dumpTrace(FILE* fp);
+#endif // BUILD_WASM
+
 /**
  * @brief VRAMが更新されているかどうか
  * @return VRAMが更新されているかどうか
@@ -107,12 +210,312 @@ extern "C" void setVRAMDirty();
 WASM_EXPORT
 extern "C" void* getVRAMImage();
 
+/**
+ * @brief 検出したアイドルループの数を取得する
+ * @return 検出したアイドルループの数
+ */
+WASM_EXPORT
+extern "C" u32 getIdleLoopDetectCount();
+
+/**
+ * @brief 読み飛ばしたアイドルループの回数を取得する
+ * @return 読み飛ばしたアイドルループの回数
+ */
+WASM_EXPORT
+extern "C" u32 getIdleLoopSkipCount();
+
+/**
+ * @brief 状態の保存に必要なサイズを取得する
+ * @return 保存に必要な最大のサイズ(バイト)
+ */
+WASM_EXPORT
+extern "C" u32 getStateSize();
+
+/**
+ * @brief 状態を保存する
+ * 
+ * Z80のレジスタ、RAM、IO、グローバルTickと、機種毎の状態を保存する。
+ * 全て0のメモリのページは省くので、保存したサイズはgetStateSize()より小さくなる。
+ * @param[out]	buffer	保存先
+ * @param[in]	size	保存先のサイズ
+ * @return 保存したサイズ
+ * @retval 0: 保存先のサイズが足りない
+ */
+WASM_EXPORT
+extern "C" u32 saveState(void* buffer, u32 size);
+
+/**
+ * @brief 状態を復元する
+ * 
+ * saveState()で保存した時と同じ機種で、初期化済みであること。
+ * @param[in]	buffer	saveState()で保存したデータ
+ * @param[in]	size	データのサイズ
+ * @return 復元できたらtrue
+ */
+WASM_EXPORT
+extern "C" bool loadState(const void* buffer, u32 size);
+
+/**
+ * @brief 巻き戻し用のリングバッファを確保する
+ * 
+ * 記録していた状態は全て捨てる。
+ * keyframeIntervalフレーム毎に状態を全て保存し、その間のフレームは
+ * キーフレームと違うメモリのページ(256バイト単位)だけを保存する。
+ * @param[in]	frameCount			記録するフレーム数(0:巻き戻しを使用しない)
+ * @param[in]	keyframeInterval	キーフレームの間隔(フレーム)
+ */
+WASM_EXPORT
+extern "C" void setupRewind(u32 frameCount, u32 keyframeInterval);
+
+/**
+ * @brief 現在の状態を巻き戻し用に記録する
+ * 
+ * 1フレーム毎に呼び出すこと。
+ * 記録したフレーム数がsetupRewind()で指定した数を超えたら、古いものから捨てる。
+ * @return 記録できたらtrue
+ */
+WASM_EXPORT
+extern "C" bool recordRewind();
+
+/**
+ * @brief 記録した状態に巻き戻す
+ * 
+ * 戻した状態より後に記録した状態は捨てる。
+ * @param[in]	frames	戻すフレーム数(0:最後に記録した状態)
+ * @return 戻せたらtrue
+ */
+WASM_EXPORT
+extern "C" bool rewindState(u32 frames);
+
+/**
+ * @brief 巻き戻し用に記録している状態の数を取得する
+ * @return 記録している状態の数(フレーム)
+ */
+WASM_EXPORT
+extern "C" u32 getRewindCount();
+
+/**
+ * @brief 巻き戻し用のリングバッファが使用しているメモリのサイズを取得する
+ * @return 使用しているメモリのサイズ(バイト)
+ */
+WASM_EXPORT
+extern "C" u32 getRewindMemorySize();
+
+/**
+ * @brief 入力の記録を開始する
+ * 
+ * ゲームパッド・キーボードマトリクス・S-OSの入力系のフック(GETL,GETKY,BRKEY,INKEY,PAUSE,FLGET)の結果と、
+ * exeute()で進めたクロック数を、グローバルTickと一緒に記録する。
+ * 前に記録していたデータは捨てる。メモリが足りなくなったら、そこで記録を止める。
+ * @note	再生する時は、記録を開始した時と同じ状態から始めること。
+ *			記録を開始する直前にsaveState()で保存しておき、loadState()で戻してから再生を開始するなど。
+ */
+WASM_EXPORT
+extern "C" void startInputRecord();
+
+/**
+ * @brief 記録した入力の再生を開始する
+ * 
+ * 再生している間は、ゲームパッドなどの入力とフックは呼び出さずに、記録した結果を使う。
+ * exeute()で進めるクロック数も、記録した時の値を使う。
+ * @param[in]	buffer	getInputTimeline()で取得したデータ(コピーする)
+ * @param[in]	size	データのサイズ
+ * @return 再生を開始できたらtrue
+ */
+WASM_EXPORT
+extern "C" bool startInputReplay(const void* buffer, u32 size);
+
+/**
+ * @brief 入力の記録／再生を終了する
+ */
+WASM_EXPORT
+extern "C" void stopInputTimeline();
+
+/**
+ * @brief 記録した入力のデータを取得する
+ * @return 記録した入力のデータ
+ */
+WASM_EXPORT
+extern "C" const void* getInputTimeline();
+
+/**
+ * @brief 記録した入力のデータのサイズを取得する
+ * @return 記録した入力のデータのサイズ
+ */
+WASM_EXPORT
+extern "C" u32 getInputTimelineSize();
+
+/**
+ * @brief 記録した入力を最後まで再生したかどうか
+ * @return 最後まで再生したらtrue
+ */
+WASM_EXPORT
+extern "C" bool isInputReplayEnd();
+
+/**
+ * @brief 再生中に同期がずれたかどうか
+ * @return 記録した時と違う命令列を実行していたらtrue
+ */
+WASM_EXPORT
+extern "C" bool isInputReplayDesynced();
+
+/**
+ * @brief 状態の保存用のバッファを確保する
+ * 
+ * JavaScript側から保存／復元する時に使用する。
+ * @param[in]	size	サイズ
+ * @return バッファ
+ */
+WASM_EXPORT
+extern "C" void* allocateStateBuffer(u32 size);
+
+/**
+ * @brief 状態の保存用のバッファを解放する
+ * @param[in]	buffer	allocateStateBuffer()で確保したバッファ
+ */
+WASM_EXPORT
+extern "C" void freeStateBuffer(void* buffer);
+
+/**
+ * @brief ディスクイメージ用のバッファを確保する
+ * 
+ * JavaScript側からmountDisk()に渡すイメージを置くのに使用する。
+ * @param[in]	size	サイズ
+ * @return バッファ
+ */
+WASM_EXPORT
+extern "C" void* allocateDiskImage(u32 size);
+
+/**
+ * @brief ディスクイメージをマウントする
+ * 
+ * マウントしたドライブの#DREAD、#DWRITE、#DRDSB、#DWTSBは、JavaScript側を呼び出さずにWASM側で処理する。
+ * D88形式と、2Dの生イメージ(327680バイト)に対応。
+ * @param[in]	drive	ドライブ(0:A ～ 4:E)
+ * @param[in]	image	allocateDiskImage()で確保したイメージ(マウントできなくても、WASM側で解放する)
+ * @param[in]	size	イメージのサイズ
+ * @return マウントできたらtrue
+ */
+WASM_EXPORT
+extern "C" bool mountDisk(s32 drive, void* image, u32 size);
+
+/**
+ * @brief ディスクイメージをアンマウントする
+ * 
+ * アンマウントしたドライブは、JavaScript側のフックで処理する。
+ * @param[in]	drive	ドライブ(0:A ～ 4:E)
+ */
+WASM_EXPORT
+extern "C" void unmountDisk(s32 drive);
+
+/**
+ * @brief ディスクイメージをマウントしているかどうか
+ * @param[in]	drive	ドライブ(0:A ～ 4:E)
+ * @return マウントしていればtrue
+ */
+WASM_EXPORT
+extern "C" bool isDiskMounted(s32 drive);
+
+/**
+ * @brief ディスクイメージのレコードの数を取得する
+ * 
+ * レコード番号は、イメージに入っているセクタを順番に数えたもの(JavaScript側のDiskImageのセクタと同じ)。
+ * @param[in]	drive	ドライブ(0:A ～ 4:E)
+ * @return レコードの数
+ */
+WASM_EXPORT
+extern "C" u32 getDiskRecordCount(s32 drive);
+
+/**
+ * @brief ディスクイメージのレコードのデータを取得する
+ * 
+ * JavaScript側のセクタのデータとして、そのまま参照するのに使う(書き込んだレコードとしては覚えない)。
+ * @param[in]	drive	ドライブ(0:A ～ 4:E)
+ * @param[in]	record	レコード番号
+ * @return レコードのデータ(nullptr:範囲外)
+ */
+WASM_EXPORT
+extern "C" void* getDiskRecord(s32 drive, u32 record);
+
+/**
+ * @brief ディスクイメージのレコードのデータのサイズを取得する
+ * @param[in]	drive	ドライブ(0:A ～ 4:E)
+ * @param[in]	record	レコード番号
+ * @return データのサイズ(0:範囲外)
+ */
+WASM_EXPORT
+extern "C" u32 getDiskRecordSize(s32 drive, u32 record);
+
+/**
+ * @brief #DWRITE、#DWTSBで書き込んだレコードの数を取得する
+ * @param[in]	drive	ドライブ(0:A ～ 4:E)
+ * @return 書き込んだレコードの数
+ */
+WASM_EXPORT
+extern "C" u32 getDiskDirtyCount(s32 drive);
+
+/**
+ * @brief #DWRITE、#DWTSBで書き込んだレコードかどうか
+ * @param[in]	drive	ドライブ(0:A ～ 4:E)
+ * @param[in]	record	レコード番号
+ * @return 書き込んだレコードならtrue
+ */
+WASM_EXPORT
+extern "C" bool isDiskRecordDirty(s32 drive, u32 record);
+
+/**
+ * @brief 書き込んだレコードを忘れる
+ * 
+ * JavaScript側で保存が必要なことを処理した後に呼び出す。
+ * @param[in]	drive	ドライブ(0:A ～ 4:E)
+ */
+WASM_EXPORT
+extern "C" void clearDiskDirty(s32 drive);
+
+/**
+ * @brief JavaScript側でディスクイメージを書き換えたことを知らせる
+ * 
+ * レコードのデータは共有しているので、書き換えた内容はそのまま見える。
+ * WASM側で持っているディレクトリとFATのキャッシュを作り直させるのに使う。
+ * @param[in]	drive	ドライブ(0:A ～ 4:E)
+ */
+WASM_EXPORT
+extern "C" void touchDisk(s32 drive);
+
+/**
+ * @brief ディスクイメージを取得する
+ * @param[in]	drive	ドライブ(0:A ～ 4:E)
+ * @return 書き込んだ内容も入っているイメージ(nullptr:マウントしていない)
+ */
+WASM_EXPORT
+extern "C" const void* getDiskImage(s32 drive);
+
+/**
+ * @brief ディスクイメージのサイズを取得する
+ * @param[in]	drive	ドライブ(0:A ～ 4:E)
+ * @return イメージのサイズ
+ */
+WASM_EXPORT
+extern "C" u32 getDiskImageSize(s32 drive);
+
 WASM_EXPORT
 extern "C" void writeIO(u16 port, u8 value);
 
 WASM_EXPORT
 extern "C" u8 readIO(u16 port);
 
+/**
+ * @brief 理論画面範囲を設定する
+ *
+ * 表示系のサブルーチンでカーソル位置を進める時に使う。JavaScript側の画面範囲が変わったら設定すること。
+ * @param[in]	left	左端
+ * @param[in]	top		上端
+ * @param[in]	right	右端(範囲外)
+ * @param[in]	bottom	下端(範囲外)
+ */
+WASM_EXPORT
+extern "C" void setConsoleWindow(s32 left, s32 top, s32 right, s32 bottom);
+
 /**
  * @brief サウンドデバイスの番号
  */
@@ -164,22 +567,6 @@ extern "C" u8 readGamePad(u8 index);
 WASM_IMPORT("io", "scanKey")
 extern "C" void* scanKey();
 
-/**
- * @brief 実行されたクロック数を取得する
- * 
- * execute()で実行されたクロックを取得する。
- * 内部用の関数で、RAMやIOに書き込んだ時のクロックを取得したい時などに使用する。
- * 同期などを正確に取りたい時など。
- * @return 実行されたクロック数
- */
-s32 getExecutedClock();
-u64 getGlobalTick();	// @todo サウンド用
-u64 getGlobal2Tick(); // @todo 本物　んにゃ～～～整理すること
-
-
-void generateIRQ(const u8 vector);
-void requestBreak();
-
 /**
  * @brief S-OSワークアドレス
  */
@@ -216,6 +603,9 @@ enum WorkAddress : u16 {
 	ETRK    = 0x20FF,
 
 	// DOSモジュール ワーク
+	NXCLST  = 0x27DE,
+	DEBUF   = 0x27DF,
+	HLBUF   = 0x27E1,
 	OPNFG   = 0x291e, 
 	FTYPE   = 0x291f,
 	DFDV    = 0x2920,
@@ -263,10 +653,57 @@ static constexpr u16 ADDRESS_STKAD     = 0x0800; // 0x0600 ～ 0x07FF
  */
 static constexpr u16 ADDRESS_MEMAX     = 0xFFFF;
 
+/**
+ * @brief 状態(getStatus()の戻り値)
+ */
+static constexpr s32 SOS_STATUS_RUNNING   = 0;	// 実行中
+static constexpr s32 SOS_STATUS_STOPPED   = 1;	// 停止中
+static constexpr s32 SOS_STATUS_WAIT_HOST = 2;	// ホスト側のフックの処理を待っている(resumeFromHost()で再開)
+
+/**
+ * @brief ディスクのドライブの数(A～E)
+ */
+static constexpr u32 SOS_DISK_DRIVE_MAX = 5;
+
+/**
+ * @brief コンソールへの出力のリングバッファのサイズ(2のべき乗)
+ */
+static constexpr u32 SOS_CONSOLE_RING_SIZE = 0x4000;
+/**
+ * @brief コンソールへの出力のカーソル位置の設定(後ろにx,yの2バイトが続く)
+ *
+ * 0x00はPRINTしても表示されないので、区切りに使っている。
+ */
+static constexpr u8 SOS_CONSOLE_LOCATE = 0x00;
+/**
+ * @brief コンソールへの出力のリングバッファ
+ *
+ * S-OSの表示系のサブルーチン(#PRINT、#MSGなど)の出力を、コア側が追加していく。
+ * SOS_CONSOLE_LOCATEならカーソル位置の設定、それ以外はPRINTする文字コード(制御コードも含む)。
+ * read、writeは通算のバイト数で、SOS_CONSOLE_RING_SIZEで割った余りがdataの位置になる。
+ */
+struct SOS_ConsoleRing {
+	u32 read;	// 読み出す位置(ホスト側が進める)
+	u32 write;	// 書き込む位置(コア側が進める)
+	u8 data[SOS_CONSOLE_RING_SIZE];
+};
+
 //
 // S-OSサブルーチンの関数定義
 //
 // WASM_IMPORT()は、JavaScript側の関数を呼び出す設定
+// メモ）レジスタとRAMしか使わないもの(#PRINT、#MSG、#HEX、#PEEKなど)は、sos.cppで処理している
+
+/**
+ * @brief コンソールへの出力をすぐに表示してもらう
+ *
+ * 普段はホスト側が1フレームに1回、getConsoleRing()のリングバッファを読み出す。
+ * JavaScript側のフックを呼び出す前と、リングバッファが溢れそうな時だけ呼び出す。
+ * 呼び出された側は、readからwriteまでを表示して、readをwriteに進めること。
+ * @param[in,out]	ring	コンソールへの出力のリングバッファ
+ */
+WASM_IMPORT("sos", "flushConsole")
+extern "C" void sos_flushConsole(SOS_ConsoleRing* ring);
 
 #ifndef BUILD_WASM
 #define SOS_ARGS Z80::Register* z80Regs, int z80RegsSize, u8* ram, u8* io
@@ -276,41 +713,17 @@ static constexpr u16 ADDRESS_MEMAX     = 0xFFFF;
 #define SOS_FUNC(NAME) WASM_IMPORT("sos", #NAME) extern "C" void sos_##NAME(SOS_ARGS);
 	SOS_FUNC(cold )
 	SOS_FUNC(hot  )
-	SOS_FUNC(ver  )
-	SOS_FUNC(print)
-	SOS_FUNC(prnts)
-	SOS_FUNC(ltnl )
-	SOS_FUNC(nl   )
-	SOS_FUNC(msg  )
-	SOS_FUNC(msx  )
-	SOS_FUNC(mprnt)
-	SOS_FUNC(tab  )
-	SOS_FUNC(lprnt)
-	SOS_FUNC(lpton)
-	SOS_FUNC(lptof)
 	SOS_FUNC(getl )
 	SOS_FUNC(getky)
 	SOS_FUNC(brkey)
 	SOS_FUNC(inkey)
 	SOS_FUNC(pause)
 	SOS_FUNC(bell )
-	SOS_FUNC(prthx)
-	SOS_FUNC(prthl)
-	SOS_FUNC(asc  )
-	SOS_FUNC(hex  )
-	SOS_FUNC(_2hex)
-	SOS_FUNC(hlhex)
 	SOS_FUNC(wopen)
 	SOS_FUNC(wrd  )
 	SOS_FUNC(fcb  )
 	SOS_FUNC(rdd  )
 	SOS_FUNC(file )
-	SOS_FUNC(fsame)
-	SOS_FUNC(fprnt)
-	SOS_FUNC(poke )
-	SOS_FUNC(poke_)
-	SOS_FUNC(peek )
-	SOS_FUNC(peek_)
 	SOS_FUNC(mon  )
 //	SOS_FUNC(_hl_ ) メモ)Z80のコードで直接書く
 //	SOS_FUNC(getpc) メモ)Z80のコードで直接書く
@@ -322,12 +735,8 @@ static constexpr u16 ADDRESS_MEMAX     = 0xFFFF;
 	SOS_FUNC(reset)
 	SOS_FUNC(name )
 	SOS_FUNC(kill )
-	SOS_FUNC(csr  )
 	SOS_FUNC(scrn )
-	SOS_FUNC(loc  )
 	SOS_FUNC(flget)
-	SOS_FUNC(rdvsw)
-	SOS_FUNC(sdvsw)
 	SOS_FUNC(inp  )
 	SOS_FUNC(out  )
 	SOS_FUNC(widch)
@@ -0,0 +1,291 @@
+﻿#pragma once
+
+#include "cat/low/catLowBasicTypes.h"
+#include "z80/z80.hpp"
+
+class SOS_Context;
+struct SOS_ConsoleRing;
+
+/**
+ * @brief S-OSのマシン
+ *
+ * Z80・RAM・IOと、機種(周辺機器も含む)を1台分持つ。
+ * マシンごとに状態を持っているので、1つのプロセスで何台でも同時に動かせる。
+ * sos.hのエクスポート関数は、デフォルトのマシンに対する薄いラッパーになっている。
+ * @note	ホスト側の入力(readGamePad()、scanKey())とS-OSのフック(sos_xxx())は、全てのマシンで共有する。
+ *			入力をマシンごとに分けたい時は、入力の記録／再生を使うこと。
+ */
+class SOS_Machine {
+public:
+	/**
+	 * @brief サウンドチップへ書き込みがされた時に呼び出される関数
+	 * @param[in]	arg		setSoundCallback()で指定した引数
+	 * @param[in]	clock	書き込みが発生したときのクロック
+	 * @param[in]	no		サウンドデバイスの番号(SoundDeviceNo)
+	 * @param[in]	reg		書き込まれたレジスタ番号
+	 * @param[in]	value	書き込まれた値
+	 */
+	using SoundCallback = void (*)(void* arg, s32 clock, s32 no, u8 reg, u8 value);
+	/**
+	 * @brief コンソールへの出力を、すぐに表示してほしい時に呼び出される関数
+	 *
+	 * ホスト側のフックを呼び出す前と、リングバッファが溢れそうな時に呼び出される。
+	 * ring->readからring->writeまでを読み出して、ring->readを進めること。
+	 * @param[in]	arg		setConsoleCallback()で指定した引数
+	 * @param[in]	ring	コンソールへの出力のリングバッファ
+	 */
+	using ConsoleCallback = void (*)(void* arg, SOS_ConsoleRing* ring);
+private:
+	/**
+	 * @brief マシンの実体
+	 */
+	SOS_Context* ctx;
+public:
+	/**
+	 * @brief コンストラクタ
+	 *
+	 * 初期化まで行う。サウンドチップへの書き込みは、setSoundCallback()で設定するまで捨てる。
+	 * フレームの途中で表示しなければならないコンソールへの出力も、setConsoleCallback()で設定するまで捨てる。
+	 * @param[in]	platformID	機種の識別子
+	 */
+	explicit SOS_Machine(s32 platformID);
+	/**
+	 * @brief デストラクタ
+	 */
+	~SOS_Machine();
+	SOS_Machine(const SOS_Machine&) = delete;
+	SOS_Machine& operator=(const SOS_Machine&) = delete;
+
+	/**
+	 * @brief 使える状態かどうか
+	 * @return メモリが確保でき、機種を作れていればtrue
+	 */
+	bool isValid() const noexcept { return ctx != nullptr; }
+
+	/**
+	 * @brief リセット
+	 */
+	void reset();
+	/**
+	 * @brief 実行する
+	 * @param[in]	clock	実行するクロック(負の値:周辺機器のチックとグローバルTickをリセットする)
+	 * @return 実際に実行されたクロック
+	 */
+	s32 execute(s32 clock);
+	/**
+	 * @brief 状態を取得する
+	 * @return 状態(0:実行中、1:停止中、2:ホスト側のフックの処理を待っている)
+	 */
+	s32 getStatus() const noexcept;
+	/**
+	 * @brief ホスト側のフックの処理を待っているのをやめて、実行を再開する
+	 *
+	 * 次のexecute()で、待っていたフックがもう一度呼び出される。
+	 */
+	void resumeFromHost() noexcept;
+	/**
+	 * @brief ホスト側のフックの処理を待っている間も、周辺機器のチックを進めるかどうかを設定する
+	 * @param[in]	enable	trueなら進める(初期値)
+	 */
+	void setTickWhileWaiting(bool enable) noexcept;
+
+	/**
+	 * @brief メモリの先頭アドレスを取得する
+	 * @return メモリの先頭アドレス(64KiB)
+	 */
+	u8* getRAM() noexcept;
+	/**
+	 * @brief IOの先頭アドレスを取得する
+	 * @return IOの先頭アドレス(64KiB x バンク２個)
+	 */
+	u8* getIO() noexcept;
+	/**
+	 * @brief コンソールへの出力のリングバッファを取得する
+	 *
+	 * S-OSの表示系のサブルーチンの出力がたまる。1フレームに1回読み出すこと(sos.hのSOS_ConsoleRing参照)。
+	 * @return コンソールへの出力のリングバッファ
+	 */
+	SOS_ConsoleRing* getConsoleRing() noexcept;
+	/**
+	 * @brief Z80のレジスタを取得する
+	 * @return Z80のレジスタ
+	 */
+	Z80::Register* getZ80Regs() noexcept;
+	/**
+	 * @brief Z80のレジスタのサイズを取得する
+	 * @return Z80のレジスタのサイズ
+	 */
+	s32 getZ80RegsSize() const noexcept;
+	/**
+	 * @brief 表示用に変換されたVRAMイメージを取得する
+	 * @return 表示用に変換されたVRAMイメージ(nullptr:VRAMが変更されていない)
+	 */
+	void* getVRAMImage();
+	/**
+	 * @brief IOポートに書き込む
+	 * @param[in]	port	IOポート
+	 * @param[in]	value	書き込む値
+	 */
+	void writeIO(u16 port, u8 value);
+	/**
+	 * @brief IOポートから読み込む
+	 * @param[in]	port	IOポート
+	 * @return ポートの値
+	 */
+	u8 readIO(u16 port);
+
+	/**
+	 * @brief サウンドチップへの書き込みを渡す先を設定する
+	 * @param[in]	callback	渡す先(nullptr:捨てる)
+	 * @param[in]	arg			callbackに渡す引数
+	 */
+	void setSoundCallback(SoundCallback callback, void* arg) noexcept;
+	/**
+	 * @brief フレームの途中で表示しなければならないコンソールへの出力を渡す先を設定する
+	 *
+	 * 1フレームに1回getConsoleRing()から読み出す分は、ここで設定した先には渡されない。
+	 * @param[in]	callback	渡す先(nullptr:捨てる)
+	 * @param[in]	arg			callbackに渡す引数
+	 */
+	void setConsoleCallback(ConsoleCallback callback, void* arg) noexcept;
+
+	/**
+	 * @brief 検出したアイドルループの数を取得する
+	 * @return 検出したアイドルループの数
+	 */
+	u32 getIdleLoopDetectCount() const noexcept;
+	/**
+	 * @brief 読み飛ばしたアイドルループの回数を取得する
+	 * @return 読み飛ばしたアイドルループの回数
+	 */
+	u32 getIdleLoopSkipCount() const noexcept;
+
+	/**
+	 * @brief 状態の保存に必要なサイズを取得する
+	 * @return 保存に必要な最大のサイズ(バイト)
+	 */
+	u32 getStateSize();
+	/**
+	 * @brief 状態を保存する
+	 * @param[out]	buffer	保存先
+	 * @param[in]	size	保存先のサイズ
+	 * @return 保存したサイズ(0:保存先のサイズが足りない)
+	 */
+	u32 saveState(void* buffer, u32 size);
+	/**
+	 * @brief 状態を復元する
+	 * @param[in]	buffer	saveState()で保存したデータ
+	 * @param[in]	size	データのサイズ
+	 * @return 復元できたらtrue
+	 */
+	bool loadState(const void* buffer, u32 size);
+
+	/**
+	 * @brief 入力の記録を開始する
+	 */
+	void startInputRecord();
+	/**
+	 * @brief 記録した入力の再生を開始する
+	 * @param[in]	buffer	getInputTimeline()で取得したデータ(コピーする)
+	 * @param[in]	size	データのサイズ
+	 * @return 再生を開始できたらtrue
+	 */
+	bool startInputReplay(const void* buffer, u32 size);
+	/**
+	 * @brief 入力の記録／再生を終了する
+	 */
+	void stopInputTimeline() noexcept;
+	/**
+	 * @brief 記録した入力のデータを取得する
+	 * @return 記録した入力のデータ
+	 */
+	const void* getInputTimeline() const noexcept;
+	/**
+	 * @brief 記録した入力のデータのサイズを取得する
+	 * @return 記録した入力のデータのサイズ
+	 */
+	u32 getInputTimelineSize() const noexcept;
+	/**
+	 * @brief 記録した入力を最後まで再生したかどうか
+	 * @return 最後まで再生したらtrue
+	 */
+	bool isInputReplayEnd() const noexcept;
+	/**
+	 * @brief 再生中に同期がずれたかどうか
+	 * @return 記録した時と違う命令列を実行していたらtrue
+	 */
+	bool isInputReplayDesynced() const noexcept;
+
+	/**
+	 * @brief ディスクイメージをマウントする
+	 *
+	 * マウントしたドライブの#DREAD、#DWRITE、#DRDSB、#DWTSBは、フック(sos_xxx())を呼び出さずにマシンの中で処理する。
+	 * D88形式と、2Dの生イメージ(327680バイト)に対応。
+	 * @param[in]	drive	ドライブ(0:A ～ 4:E)
+	 * @param[in]	image	イメージ(コピーする)
+	 * @param[in]	size	イメージのサイズ
+	 * @return マウントできたらtrue
+	 */
+	bool mountDisk(s32 drive, const void* image, u32 size);
+	/**
+	 * @brief ディスクイメージをコピーオンライトでマウントする
+	 *
+	 * イメージはコピーせずに共有する(メモリマップしたファイルなど)。書き込んだレコードだけを、マシンごとのオーバーレイに持つ。
+	 * 同じイメージを、何台ものマシンで同時にマウントできる。
+	 * @param[in]	drive	ドライブ(0:A ～ 4:E)
+	 * @param[in]	image	イメージ(書き換えない。アンマウントするまで解放しないこと)
+	 * @param[in]	size	イメージのサイズ
+	 * @return マウントできたらtrue
+	 */
+	bool mountDiskCopyOnWrite(s32 drive, const void* image, u32 size);
+	/**
+	 * @brief ディスクイメージをアンマウントする
+	 * @param[in]	drive	ドライブ(0:A ～ 4:E)
+	 */
+	void unmountDisk(s32 drive);
+	/**
+	 * @brief ディスクイメージをマウントしているかどうか
+	 * @param[in]	drive	ドライブ(0:A ～ 4:E)
+	 * @return マウントしていればtrue
+	 */
+	bool isDiskMounted(s32 drive) const noexcept;
+	/**
+	 * @brief #DWRITE、#DWTSBで書き込んだレコードの数を取得する
+	 * @param[in]	drive	ドライブ(0:A ～ 4:E)
+	 * @return 書き込んだレコードの数
+	 */
+	u32 getDiskDirtyCount(s32 drive) const noexcept;
+	/**
+	 * @brief ディスクイメージを取得する
+	 * @param[in]	drive	ドライブ(0:A ～ 4:E)
+	 * @return 書き込んだ内容も入っているイメージ(nullptr:マウントしていない)
+	 */
+	const void* getDiskImage(s32 drive) const noexcept;
+	/**
+	 * @brief ディスクイメージのサイズを取得する
+	 * @param[in]	drive	ドライブ(0:A ～ 4:E)
+	 * @return イメージのサイズ
+	 */
+	u32 getDiskImageSize(s32 drive) const noexcept;
+	/**
+	 * @brief 書き込んだ内容も入れたディスクイメージをコピーする
+	 *
+	 * コピーオンライトでマウントしている時は、オーバーレイを重ねたイメージになる。
+	 * @param[in]	drive	ドライブ(0:A ～ 4:E)
+	 * @param[out]	buffer	コピー先
+	 * @param[in]	size	コピー先のサイズ(getDiskImageSize()以上)
+	 * @return コピーできたらtrue
+	 */
+	bool copyDiskImage(s32 drive, void* buffer, u32 size) const noexcept;
+	/**
+	 * @brief コピーオンライトのオーバーレイに持っているレコードの数を取得する
+	 * @param[in]	drive	ドライブ(0:A ～ 4:E)
+	 * @return オーバーレイに持っているレコードの数
+	 */
+	u32 getDiskOverlayCount(s32 drive) const noexcept;
+	/**
+	 * @brief コピーオンライトのオーバーレイを捨てて、マウントした時のイメージに戻す
+	 * @param[in]	drive	ドライブ(0:A ～ 4:E)
+	 */
+	void discardDiskOverlay(s32 drive);
+};
@@ -34,6 +34,84 @@
 
 #define R800 (1)
 
+// 命令ディスパッチの方式
+//   1: 各命令をexecute()のループ内へ展開して分岐する(GCC/Clangはcomputed goto、それ以外はswitch)
+//   0: 関数ポインタのテーブル経由で呼び出す
+#ifndef Z80_THREADED_DISPATCH
+#define Z80_THREADED_DISPATCH (1)
+#endif
+
+#if Z80_THREADED_DISPATCH
+#if defined(__GNUC__) || defined(__clang__)
+#define Z80_COMPUTED_GOTO (1)
+#else
+#define Z80_COMPUTED_GOTO (0)
+#endif
+// M(0x00) ～ M(0xFF) に展開する
+#define Z80_REPEAT16(M, H) \
+    M(H##0) M(H##1) M(H##2) M(H##3) M(H##4) M(H##5) M(H##6) M(H##7) \
+    M(H##8) M(H##9) M(H##A) M(H##B) M(H##C) M(H##D) M(H##E) M(H##F)
+#define Z80_REPEAT256(M) \
+    Z80_REPEAT16(M, 0x0) Z80_REPEAT16(M, 0x1) Z80_REPEAT16(M, 0x2) Z80_REPEAT16(M, 0x3) \
+    Z80_REPEAT16(M, 0x4) Z80_REPEAT16(M, 0x5) Z80_REPEAT16(M, 0x6) Z80_REPEAT16(M, 0x7) \
+    Z80_REPEAT16(M, 0x8) Z80_REPEAT16(M, 0x9) Z80_REPEAT16(M, 0xA) Z80_REPEAT16(M, 0xB) \
+    Z80_REPEAT16(M, 0xC) Z80_REPEAT16(M, 0xD) Z80_REPEAT16(M, 0xE) Z80_REPEAT16(M, 0xF)
+#endif // Z80_THREADED_DISPATCH
+
+// HALT中の早送り
+//   1: HALT中は、execute()に指定されたクロックの終わりまでNOPの繰り返しをまとめて進める
+//   0: HALT中もNOPを1回ずつ実行する
+#ifndef Z80_HALT_FAST_FORWARD
+#define Z80_HALT_FAST_FORWARD (1)
+#endif
+
+// ブロック命令の一括実行
+//   1: LDIR/LDDR/CPIR/CPDR/INIR/INDR/OTIR/OTDRの繰り返しを、割り込みを受け付けるかexecute()に指定されたクロックを使い切るまで命令ディスパッチに戻らずに続ける
+//      (LDIR/LDDRは、読み書きがページテーブルのメモリならページ単位でまとめて転送する)
+//   0: 1回繰り返す度に命令ディスパッチに戻る
+#ifndef Z80_BLOCK_FAST_FORWARD
+#define Z80_BLOCK_FAST_FORWARD (1)
+#endif
+
+// アイドルループ(ポーリングのループ)の早送り
+//   1: 副作用のない読み込みだけで同じ状態を繰り返す短いループを検出して、execute()に指定されたクロックの終わりまでまとめて進める
+//   0: ループも1命令ずつ実行する
+#ifndef Z80_IDLE_LOOP_FAST_FORWARD
+#define Z80_IDLE_LOOP_FAST_FORWARD (1)
+#endif
+
+// プロファイル
+//   1: PC毎に実行したクロック数と命令数を、setProfileBuffer()で設定したテーブルに加算する
+//   0: 集計しない(集計のコードも生成しない)
+#ifndef Z80_PROFILE
+#define Z80_PROFILE (0)
+#endif
+
+// メモリアクセスのウェイト
+//   1: wtcに設定したウェイトを、命令フェッチ・メモリの読み書き毎に消費する
+//   0: ウェイトなし(wtcは無視する。ウェイトの判定のコードも生成しない)
+#ifndef Z80_WAIT_CLOCKS
+#define Z80_WAIT_CLOCKS (0)
+#endif
+
+// クロック消費のコールバック
+//   1: クロックを消費する度に、setConsumeClockCallback()で設定したコールバックを呼び出す
+//   0: 呼び出さない(ホストはgetConsumedClock()で、execute()の開始から消費したクロックを取得する)
+#ifndef Z80_CONSUME_CLOCK_CALLBACK
+#define Z80_CONSUME_CLOCK_CALLBACK (0)
+#endif
+
+// 実行トレース
+//   1: 命令毎にPC・命令コード・レジスタ・クロックを固定長のリングバッファに記録する(整形はしない)
+//   0: 記録しない(記録のコードも生成しない)
+#ifndef Z80_TRACE
+#define Z80_TRACE (0)
+#endif
+// 実行トレースのリングバッファの個数(2のべき乗)
+#ifndef Z80_TRACE_SIZE
+#define Z80_TRACE_SIZE (4096)
+#endif
+
 #ifndef BUILD_WASM
 #include <functional>
 #include <limits.h>
@@ -58,26 +136,88 @@ using ReadFuncType = unsigned char(*)(void*, unsigned short);
 using WriteFuncType = void(*)(void*, unsigned short, unsigned char);
 using DeviceInType = unsigned char(*)(void*, unsigned short);
 using DeviceOutType = void(*)(void*, unsigned short, unsigned char);
+using TrapFuncType = int(*)(void*, unsigned short);
+using IdleReadFuncType = bool(*)(void*, unsigned short);
+
+// フラグの計算表(コンパイル時に作る)
+//   ALU命令のフラグを1ビットずつ設定せずに、結果の値から表を引いてまとめて作る
+struct Z80FlagTable {
+    unsigned char sz[256];  // S, Z, Y, X
+    unsigned char szp[256]; // S, Z, Y, X, P(パリティ偶数)
+    unsigned char inc[256]; // INCの結果から: S, Z, Y, H, X, V (Nは0)
+    unsigned char dec[256]; // DECの結果から: S, Z, Y, H, X, V, N
+
+    constexpr Z80FlagTable() : sz(), szp(), inc(), dec()
+    {
+        for (int i = 0; i < 256; i++) {
+            int bits = 0;
+            for (int b = i; b; b >>= 1) bits += b & 1;
+            sz[i] = (unsigned char)((i & 0b10101000) | (i ? 0 : 0b01000000));
+            szp[i] = (unsigned char)(sz[i] | ((bits & 1) ? 0 : 0b00000100));
+            inc[i] = (unsigned char)(sz[i] | ((i & 0x0F) == 0x00 ? 0b00010000 : 0) | (i == 0x80 ? 0b00000100 : 0));
+            dec[i] = (unsigned char)(sz[i] | ((i & 0x0F) == 0x0F ? 0b00010000 : 0) | (i == 0x7F ? 0b00000100 : 0) | 0b00000010);
+        }
+    }
+};
+inline constexpr Z80FlagTable z80FlagTable;
 
 class Z80
 {
   public: // Interface data types
     struct WaitClocks {
+        // メモ）Z80_WAIT_CLOCKSが0の時は使わない(状態の保存のために残してある)
         int fetch; // Wait T-cycle (Hz) before fetching instruction (default is 0 = no wait)
         int read;  // Wait T-cycle (Hz) before to read memory (default is 0 = no wait)
         int write; // Wait T-cycle (Hz) before to write memory (default is 0 = no wait)
     } wtc;
 
-    struct RegisterPair {
-        unsigned char A;
-        unsigned char F;
-        unsigned char B;
-        unsigned char C;
-        unsigned char D;
-        unsigned char E;
-        unsigned char H;
-        unsigned char L;
+    // ペアのレジスタ(AF, BC, DE, HL)
+    //   ペアはホストのバイトオーダーの16ビットのワードで持ち、8ビットのレジスタはワードの上位／下位のバイトとして読み書きする
+    //   JS側(z80Emu.js)は、上位のレジスタ(A, B, D, H)がワードのどちらのバイトかをgetZ80PairHighOffset()で確認している
+    class RegisterPair {
+      public:
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        static constexpr int HIGH = 0; // 上位のレジスタのバイトの位置
+#else
+        static constexpr int HIGH = 1; // 上位のレジスタのバイトの位置
+#endif
+        static constexpr int LOW = HIGH ^ 1; // 下位のレジスタのバイトの位置
+
+        inline unsigned short& AF() { return af; }
+        inline unsigned short& BC() { return bc; }
+        inline unsigned short& DE() { return de; }
+        inline unsigned short& HL() { return hl; }
+        inline unsigned short AF() const { return af; }
+        inline unsigned short BC() const { return bc; }
+        inline unsigned short DE() const { return de; }
+        inline unsigned short HL() const { return hl; }
+
+        inline unsigned char& A() { return byteOf(af, HIGH); }
+        inline unsigned char& F() { return byteOf(af, LOW); }
+        inline unsigned char& B() { return byteOf(bc, HIGH); }
+        inline unsigned char& C() { return byteOf(bc, LOW); }
+        inline unsigned char& D() { return byteOf(de, HIGH); }
+        inline unsigned char& E() { return byteOf(de, LOW); }
+        inline unsigned char& H() { return byteOf(hl, HIGH); }
+        inline unsigned char& L() { return byteOf(hl, LOW); }
+        inline unsigned char A() const { return (unsigned char)(af >> 8); }
+        inline unsigned char F() const { return (unsigned char)af; }
+        inline unsigned char B() const { return (unsigned char)(bc >> 8); }
+        inline unsigned char C() const { return (unsigned char)bc; }
+        inline unsigned char D() const { return (unsigned char)(de >> 8); }
+        inline unsigned char E() const { return (unsigned char)de; }
+        inline unsigned char H() const { return (unsigned char)(hl >> 8); }
+        inline unsigned char L() const { return (unsigned char)hl; }
+
+      private:
+        static inline unsigned char& byteOf(unsigned short& word, int index) { return reinterpret_cast<unsigned char*>(&word)[index]; }
+
+        unsigned short af;
+        unsigned short bc;
+        unsigned short de;
+        unsigned short hl;
     };
+    static_assert(sizeof(RegisterPair) == 8, "RegisterPair must stay 4 words, the JS side reads PC at offset 16");
 
     struct Register {
         struct RegisterPair pair;
@@ -99,6 +239,26 @@ class Z80
         unsigned char reserved8[2];
     } reg;
 
+#if Z80_PROFILE
+    struct ProfileEntry {
+        unsigned int clocks; // 実行したクロック数
+        unsigned int count;  // 実行した命令数
+    };
+#endif
+
+#if Z80_TRACE
+    struct TraceEntry {
+        unsigned long long clock;   // 命令の実行を開始した時のクロック(execute()を跨いで通算)
+        unsigned short PC;
+        unsigned short AF;
+        unsigned short BC;
+        unsigned short DE;
+        unsigned short HL;
+        unsigned short SP;
+        unsigned char opcode[4];    // PCからの4バイト(ページテーブルにないメモリは0)
+    };
+#endif
+
     inline unsigned char flagS() { return 0b10000000; }
     inline unsigned char flagZ() { return 0b01000000; }
     inline unsigned char flagY() { return 0b00100000; }
@@ -108,31 +268,54 @@ class Z80
     inline unsigned char flagN() { return 0b00000010; }
     inline unsigned char flagC() { return 0b00000001; }
 
+    // ウェイト(Z80_WAIT_CLOCKSが0の時は定数の0になるので、判定ごと消える)
+    inline int waitFetch() const { return Z80_WAIT_CLOCKS ? wtc.fetch : 0; }
+    inline int waitRead() const { return Z80_WAIT_CLOCKS ? wtc.read : 0; }
+    inline int waitWrite() const { return Z80_WAIT_CLOCKS ? wtc.write : 0; }
+
     inline unsigned char readByte(unsigned short addr, int clock = 4)
     {
-        if (clock && wtc.read) consumeClock(wtc.read);
-        unsigned char byte = CB.read(CB.arg, addr);
+        if (clock && waitRead()) consumeClock(waitRead());
+        const unsigned char* page = readPage[addr >> 8];
+#if Z80_IDLE_LOOP_FAST_FORWARD
+        if (!page && !idleLoop.impure) {
+            idleLoop.impure = !CB.isIdleMemory || !CB.isIdleMemory(CB.arg, addr);
+        }
+#endif
+        unsigned char byte = page ? page[addr & 0xFF] : CB.read(CB.arg, addr);
         if (clock) consumeClock(clock);
         return byte;
     }
 
     inline void writeByte(unsigned short addr, unsigned char value, int clock = 4)
     {
-        if (wtc.write) consumeClock(wtc.write);
-        CB.write(CB.arg, addr, value);
+        if (waitWrite()) consumeClock(waitWrite());
+        unsigned char* page = writePage[addr >> 8];
+        if (page) {
+#if Z80_IDLE_LOOP_FAST_FORWARD
+            // 同じ値の書き込み(CALLで積む戻りアドレスなど)は、何度繰り返しても同じ
+            if (page[addr & 0xFF] != value) idleLoop.impure = true;
+#endif
+            page[addr & 0xFF] = value;
+        } else {
+#if Z80_IDLE_LOOP_FAST_FORWARD
+            idleLoop.impure = true;
+#endif
+            CB.write(CB.arg, addr, value);
+        }
         consumeClock(clock);
     }
 
   private: // Internal functions & variables
     // flag setter
-    inline void setFlagS(bool on) { on ? reg.pair.F |= flagS() : reg.pair.F &= ~flagS(); }
-    inline void setFlagZ(bool on) { on ? reg.pair.F |= flagZ() : reg.pair.F &= ~flagZ(); }
-    inline void setFlagY(bool on) { on ? reg.pair.F |= flagY() : reg.pair.F &= ~flagY(); }
-    inline void setFlagH(bool on) { on ? reg.pair.F |= flagH() : reg.pair.F &= ~flagH(); }
-    inline void setFlagX(bool on) { on ? reg.pair.F |= flagX() : reg.pair.F &= ~flagX(); }
-    inline void setFlagPV(bool on) { on ? reg.pair.F |= flagPV() : reg.pair.F &= ~flagPV(); }
-    inline void setFlagN(bool on) { on ? reg.pair.F |= flagN() : reg.pair.F &= ~flagN(); }
-    inline void setFlagC(bool on) { on ? reg.pair.F |= flagC() : reg.pair.F &= ~flagC(); }
+    inline void setFlagS(bool on) { on ? reg.pair.F() |= flagS() : reg.pair.F() &= ~flagS(); }
+    inline void setFlagZ(bool on) { on ? reg.pair.F() |= flagZ() : reg.pair.F() &= ~flagZ(); }
+    inline void setFlagY(bool on) { on ? reg.pair.F() |= flagY() : reg.pair.F() &= ~flagY(); }
+    inline void setFlagH(bool on) { on ? reg.pair.F() |= flagH() : reg.pair.F() &= ~flagH(); }
+    inline void setFlagX(bool on) { on ? reg.pair.F() |= flagX() : reg.pair.F() &= ~flagX(); }
+    inline void setFlagPV(bool on) { on ? reg.pair.F() |= flagPV() : reg.pair.F() &= ~flagPV(); }
+    inline void setFlagN(bool on) { on ? reg.pair.F() |= flagN() : reg.pair.F() &= ~flagN(); }
+    inline void setFlagC(bool on) { on ? reg.pair.F() |= flagC() : reg.pair.F() &= ~flagC(); }
 
     inline void setFlagXY(unsigned char value)
     {
@@ -141,12 +324,12 @@ class Z80
     }
 
     // flag checker
-    inline bool isFlagS() { return reg.pair.F & flagS(); }
-    inline bool isFlagZ() { return reg.pair.F & flagZ(); }
-    inline bool isFlagH() { return reg.pair.F & flagH(); }
-    inline bool isFlagPV() { return reg.pair.F & flagPV(); }
-    inline bool isFlagN() { return reg.pair.F & flagN(); }
-    inline bool isFlagC() { return reg.pair.F & flagC(); }
+    inline bool isFlagS() { return reg.pair.F() & flagS(); }
+    inline bool isFlagZ() { return reg.pair.F() & flagZ(); }
+    inline bool isFlagH() { return reg.pair.F() & flagH(); }
+    inline bool isFlagPV() { return reg.pair.F() & flagPV(); }
+    inline bool isFlagN() { return reg.pair.F() & flagN(); }
+    inline bool isFlagC() { return reg.pair.F() & flagC(); }
 
     inline bool checkConditionFlag(unsigned char c)
     {
@@ -298,9 +481,13 @@ class Z80
         bool debugMessageEnabled;
         void(*consumeClock)(void*, int);
         bool consumeClockEnabled;
+        TrapFuncType trap; // トラップ命令(ED ED)のコールバック
+        IdleReadFuncType isIdlePort;   // 次のイベントまで値が変わらず、読み込みに副作用のないポートかどうか(nullptr:全て副作用あり)
+        IdleReadFuncType isIdleMemory; // 次のイベントまで値が変わらず、読み込みに副作用のないアドレスかどうか(nullptr:全て副作用あり)
         //std::map<int, std::vector<BreakPoint*>*> breakPoints;
         static constexpr int MAX_BREAK_POINTS = 64;
         BreakPoint breakPoints[MAX_BREAK_POINTS];
+        int breakPointCount = 0;
 #ifndef DISABLE_BREAK_OPERANDS
         std::map<int, std::vector<BreakOperand*>*> breakOperands;
 #endif // DISABLE_BREAK_OPERANDS
@@ -313,8 +500,130 @@ class Z80
 
     bool requestBreakFlag;
 
+    /**
+     * メモリのページテーブル(256バイト単位)
+     *
+     * 副作用のないページは、ホスト側のメモリを直接読み書きする。
+     * nullptrのページはCB.read/CB.writeを経由する。
+     */
+    const unsigned char* readPage[256];
+    unsigned char* writePage[256];
+
+#if Z80_IDLE_LOOP_FAST_FORWARD
+    /**
+     * アイドルループの検出
+     *
+     * 短い後方ジャンプの飛び先で状態を記録しておき、次に同じ飛び先へ戻って来た時に
+     * その間に副作用のある処理(書き込み・OUT・副作用のある読み込み・割り込みなど)がなく、
+     * レジスタ(Rを除く)も同じなら、次のイベントまで同じループを繰り返すだけなので読み飛ばす。
+     * メモ）VBlankやキー入力のポーリング、S-OSのjs側のフックの待ち(TRAP_WAIT)など
+     */
+    static constexpr int IDLE_LOOP_MAX_BYTES = 32; // 検出するループの最大の長さ(バイト)
+    struct IdleLoop {
+        bool valid;                 // 状態を記録済みか
+        bool impure;                // 記録してから副作用のある処理をしたか
+        unsigned short head;        // ループの先頭(後方ジャンプの飛び先)
+        int executed;               // 記録した時の実行済みクロック
+        Register reg;               // 記録した時のレジスタ
+        unsigned int detectCount;   // 検出したループの数
+        unsigned int skipCount;     // 読み飛ばしたループの回数
+    } idleLoop;
+
+    inline void resetIdleLoop()
+    {
+        z80_memset(&idleLoop, 0, sizeof(idleLoop));
+    }
+
+    inline bool isSameIdleLoopRegister() const
+    {
+        const Register& a = reg;
+        const Register& b = idleLoop.reg;
+        return z80_memcmp(&a.pair, &b.pair, sizeof(a.pair)) == 0
+            && z80_memcmp(&a.back, &b.back, sizeof(a.back)) == 0
+            && a.SP == b.SP && a.IX == b.IX && a.IY == b.IY && a.WZ == b.WZ
+            && a.interruptVector == b.interruptVector && a.interruptAddrN == b.interruptAddrN
+            && a.I == b.I && a.IFF == b.IFF && a.interrupt == b.interrupt && a.execEI == b.execEI;
+    }
+
+    // 後方ジャンプした時(PCが前に戻った時)に呼び出す
+    inline void checkIdleLoop(int& clock)
+    {
+        if (idleLoop.valid && idleLoop.head == reg.PC && !idleLoop.impure && isSameIdleLoopRegister()) {
+            // 前回からの1周分は、次のイベントまで何度繰り返しても同じ結果になるので、
+            // クロックを使い切る直前まで一気に進める(最後の1周は普通に実行する)
+            const int cycle = executed - idleLoop.executed;
+            idleLoop.valid = false;
+            if (0 < cycle && cycle < clock && !CB.breakPointCount && !isDebug()) {
+                const int count = (clock - 1) / cycle;
+                const int hz = count * cycle;
+                const int r = (reg.R - idleLoop.reg.R) & 0x7F;
+                reg.R = ((reg.R + r * count) & 0x7F) | (reg.R & 0x80);
+#if Z80_CONSUME_CLOCK_CALLBACK
+                if (CB.consumeClockEnabled) CB.consumeClock(CB.arg, hz);
+#endif
+#if Z80_PROFILE
+                // 読み飛ばした分は、命令毎には分からないのでループの先頭のクロック数にだけ加算する
+                addProfile(reg.PC, hz, 0);
+#endif
+                executed += hz;
+                clock -= hz;
+                idleLoop.detectCount++;
+                idleLoop.skipCount += count;
+            }
+            return;
+        }
+        idleLoop.valid = true;
+        idleLoop.impure = false;
+        idleLoop.head = reg.PC;
+        idleLoop.executed = executed;
+        idleLoop.reg = reg;
+    }
+#endif // Z80_IDLE_LOOP_FAST_FORWARD
+
+#if Z80_PROFILE
+    ProfileEntry* profile; // PC毎の集計(0x10000個、nullptr:集計しない)
+
+    inline void addProfile(unsigned short pc, int clocks, unsigned int count)
+    {
+        if (profile) {
+            profile[pc].clocks += clocks;
+            profile[pc].count += count;
+        }
+    }
+#endif // Z80_PROFILE
+
+#if Z80_TRACE
+    static_assert((Z80_TRACE_SIZE & (Z80_TRACE_SIZE - 1)) == 0, "Z80_TRACE_SIZE must be a power of 2");
+    struct Trace {
+        TraceEntry buffer[Z80_TRACE_SIZE];  // リングバッファ
+        unsigned int count;                 // 記録した命令の数(次に書き込む位置はcount % Z80_TRACE_SIZE)
+        unsigned long long clock;           // 前回までのexecute()で実行したクロックの合計
+    } trace;
+
+    inline void addTrace()
+    {
+        TraceEntry& entry = trace.buffer[trace.count++ & (Z80_TRACE_SIZE - 1)];
+        entry.clock = trace.clock + executed;
+        entry.PC = reg.PC;
+        entry.AF = reg.pair.AF();
+        entry.BC = reg.pair.BC();
+        entry.DE = reg.pair.DE();
+        entry.HL = reg.pair.HL();
+        entry.SP = reg.SP;
+        // 読み込みに副作用のあるメモリは読まない
+        for (int i = 0; i < 4; i++) {
+            const unsigned short addr = reg.PC + i;
+            const unsigned char* page = readPage[addr >> 8];
+            entry.opcode[i] = page ? page[addr & 0xFF] : 0;
+        }
+    }
+#endif // Z80_TRACE
+
     inline void checkBreakPoint()
     {
+        if (!CB.breakPointCount) {
+            return;
+        }
         for(auto& it : CB.breakPoints) {
             if(it.addr == reg.PC && it.callback) {
                 it.callback(CB.arg);
@@ -418,23 +727,23 @@ class Z80
 #endif
     }
 
-    inline unsigned short getAF() { return make16BitsFromLE(reg.pair.F, reg.pair.A); }
-    inline unsigned short getAF2() { return make16BitsFromLE(reg.back.F, reg.back.A); }
-    inline unsigned short getBC() { return make16BitsFromLE(reg.pair.C, reg.pair.B); }
-    inline unsigned short getBC2() { return make16BitsFromLE(reg.back.C, reg.back.B); }
-    inline unsigned short getDE() { return make16BitsFromLE(reg.pair.E, reg.pair.D); }
-    inline unsigned short getDE2() { return make16BitsFromLE(reg.back.E, reg.back.D); }
-    inline unsigned short getHL() { return make16BitsFromLE(reg.pair.L, reg.pair.H); }
-    inline unsigned short getHL2() { return make16BitsFromLE(reg.back.L, reg.back.H); }
-
-    inline void setAF(unsigned short value) { splitTo8BitsPair(value, &reg.pair.A, &reg.pair.F); }
-    inline void setAF2(unsigned short value) { splitTo8BitsPair(value, &reg.back.A, &reg.back.F); }
-    inline void setBC(unsigned short value) { splitTo8BitsPair(value, &reg.pair.B, &reg.pair.C); }
-    inline void setBC2(unsigned short value) { splitTo8BitsPair(value, &reg.back.B, &reg.back.C); }
-    inline void setDE(unsigned short value) { splitTo8BitsPair(value, &reg.pair.D, &reg.pair.E); }
-    inline void setDE2(unsigned short value) { splitTo8BitsPair(value, &reg.back.D, &reg.back.E); }
-    inline void setHL(unsigned short value) { splitTo8BitsPair(value, &reg.pair.H, &reg.pair.L); }
-    inline void setHL2(unsigned short value) { splitTo8BitsPair(value, &reg.back.H, &reg.back.L); }
+    inline unsigned short getAF() { return reg.pair.AF(); }
+    inline unsigned short getAF2() { return reg.back.AF(); }
+    inline unsigned short getBC() { return reg.pair.BC(); }
+    inline unsigned short getBC2() { return reg.back.BC(); }
+    inline unsigned short getDE() { return reg.pair.DE(); }
+    inline unsigned short getDE2() { return reg.back.DE(); }
+    inline unsigned short getHL() { return reg.pair.HL(); }
+    inline unsigned short getHL2() { return reg.back.HL(); }
+
+    inline void setAF(unsigned short value) { reg.pair.AF() = value; }
+    inline void setAF2(unsigned short value) { reg.back.AF() = value; }
+    inline void setBC(unsigned short value) { reg.pair.BC() = value; }
+    inline void setBC2(unsigned short value) { reg.back.BC() = value; }
+    inline void setDE(unsigned short value) { reg.pair.DE() = value; }
+    inline void setDE2(unsigned short value) { reg.back.DE() = value; }
+    inline void setHL(unsigned short value) { reg.pair.HL() = value; }
+    inline void setHL2(unsigned short value) { reg.back.HL() = value; }
 
     inline unsigned short getRP(unsigned char rp)
     {
@@ -491,59 +800,73 @@ class Z80
     inline void setIYH(unsigned char v) { reg.IY = (reg.IY & 0x00FF) + v * 256; }
     inline void setIYL(unsigned char v) { reg.IY = (reg.IY & 0xFF00) + v; }
 
-    inline bool isEvenNumberBits(unsigned char value)
-    {
-        int on = 0;
-        int off = 0;
-        value & 0b10000000 ? on++ : off++;
-        value & 0b01000000 ? on++ : off++;
-        value & 0b00100000 ? on++ : off++;
-        value & 0b00010000 ? on++ : off++;
-        value & 0b00001000 ? on++ : off++;
-        value & 0b00000100 ? on++ : off++;
-        value & 0b00000010 ? on++ : off++;
-        value & 0b00000001 ? on++ : off++;
-        return (on & 1) == 0;
-    }
-
     inline int consumeClock(int hz)
     {
         reg.consumeClockCounter += hz;
+#if Z80_CONSUME_CLOCK_CALLBACK
         if (CB.consumeClockEnabled && hz) CB.consumeClock(CB.arg, hz);
+#endif
         return hz;
     }
 
-    inline unsigned short getPort16WithB(unsigned char c) { return make16BitsFromLE(c, reg.pair.B); }
-    inline unsigned short getPort16WithA(unsigned char c) { return make16BitsFromLE(c, reg.pair.A); }
+    inline unsigned short getPort16WithB(unsigned char c) { return make16BitsFromLE(c, reg.pair.B()); }
+    inline unsigned short getPort16WithA(unsigned char c) { return make16BitsFromLE(c, reg.pair.A()); }
+
+#if Z80_IDLE_LOOP_FAST_FORWARD
+    inline void checkIdlePort(unsigned short port)
+    {
+        if (!idleLoop.impure) {
+            idleLoop.impure = !CB.isIdlePort || !CB.isIdlePort(CB.arg, port);
+        }
+    }
+#endif
 
     inline unsigned char inPortWithB(unsigned char port, int clock = 4)
     {
-        unsigned char byte = CB.in(CB.arg, CB.returnPortAs16Bits ? getPort16WithB(port) : port);
+        const unsigned short addr = CB.returnPortAs16Bits ? getPort16WithB(port) : port;
+#if Z80_IDLE_LOOP_FAST_FORWARD
+        checkIdlePort(addr);
+#endif
+        unsigned char byte = CB.in(CB.arg, addr);
         consumeClock(clock);
         return byte;
     }
     inline unsigned char inPort16(unsigned short port, int clock = 4)
     {
-        unsigned char byte = CB.in(CB.arg, CB.returnPortAs16Bits ? port : (port & 0xFF));
+        const unsigned short addr = CB.returnPortAs16Bits ? port : (port & 0xFF);
+#if Z80_IDLE_LOOP_FAST_FORWARD
+        checkIdlePort(addr);
+#endif
+        unsigned char byte = CB.in(CB.arg, addr);
         consumeClock(clock);
         return byte;
     }
 
     inline unsigned char inPortWithA(unsigned char port, int clock = 4)
     {
-        unsigned char byte = CB.in(CB.arg, CB.returnPortAs16Bits ? getPort16WithA(port) : port);
+        const unsigned short addr = CB.returnPortAs16Bits ? getPort16WithA(port) : port;
+#if Z80_IDLE_LOOP_FAST_FORWARD
+        checkIdlePort(addr);
+#endif
+        unsigned char byte = CB.in(CB.arg, addr);
         consumeClock(clock);
         return byte;
     }
 
     inline void outPortWithB(unsigned char port, unsigned char value, int clock = 4)
     {
+#if Z80_IDLE_LOOP_FAST_FORWARD
+        idleLoop.impure = true;
+#endif
         CB.out(CB.arg, CB.returnPortAs16Bits ? getPort16WithB(port) : port, value);
         consumeClock(clock);
     }
 
     inline void outPortWithA(unsigned char port, unsigned char value, int clock = 4)
     {
+#if Z80_IDLE_LOOP_FAST_FORWARD
+        idleLoop.impure = true;
+#endif
         CB.out(CB.arg, CB.returnPortAs16Bits ? getPort16WithA(port) : port, value);
         consumeClock(clock);
     }
@@ -585,8 +908,8 @@ class Z80
     static inline void LD_A_I_(Z80* ctx) { ctx->LD_A_I(); }
     inline void LD_A_I()
     {
-        if (isDebug()) log("[%04X] LD A<$%02X>, I<$%02X>", reg.PC - 2, reg.pair.A, reg.I);
-        reg.pair.A = reg.I;
+        if (isDebug()) log("[%04X] LD A<$%02X>, I<$%02X>", reg.PC - 2, reg.pair.A(), reg.I);
+        reg.pair.A() = reg.I;
         setFlagPV(reg.IFF & IFF2());
         consumeClock(1);
     }
@@ -594,16 +917,20 @@ class Z80
     static inline void LD_I_A_(Z80* ctx) { ctx->LD_I_A(); }
     inline void LD_I_A()
     {
-        if (isDebug()) log("[%04X] LD I<$%02X>, A<$%02X>", reg.PC - 2, reg.I, reg.pair.A);
-        reg.I = reg.pair.A;
+        if (isDebug()) log("[%04X] LD I<$%02X>, A<$%02X>", reg.PC - 2, reg.I, reg.pair.A());
+        reg.I = reg.pair.A();
         consumeClock(1);
     }
 
     static inline void LD_A_R_(Z80* ctx) { ctx->LD_A_R(); }
     inline void LD_A_R()
     {
-        if (isDebug()) log("[%04X] LD A<$%02X>, R<$%02X>", reg.PC - 2, reg.pair.A, reg.R);
-        reg.pair.A = reg.R;
+        if (isDebug()) log("[%04X] LD A<$%02X>, R<$%02X>", reg.PC - 2, reg.pair.A(), reg.R);
+#if Z80_IDLE_LOOP_FAST_FORWARD
+        // Rはループを読み飛ばすと値が変わるので
+        idleLoop.impure = true;
+#endif
+        reg.pair.A() = reg.R;
         setFlagPV(reg.IFF & IFF1());
         consumeClock(1);
     }
@@ -611,8 +938,8 @@ class Z80
     static inline void LD_R_A_(Z80* ctx) { ctx->LD_R_A(); }
     inline void LD_R_A()
     {
-        if (isDebug()) log("[%04X] LD R<$%02X>, A<$%02X>", reg.PC - 2, reg.R, reg.pair.A);
-        reg.R = reg.pair.A;
+        if (isDebug()) log("[%04X] LD R<$%02X>, A<$%02X>", reg.PC - 2, reg.R, reg.pair.A());
+        reg.R = reg.pair.A();
         consumeClock(1);
     }
 
@@ -620,7 +947,45 @@ class Z80
     {
         unsigned char operandNumber = ctx->fetch(4);
         ctx->checkBreakOperandCB(operandNumber);
+#if Z80_THREADED_DISPATCH
+        ctx->dispatchCB(operandNumber);
+#else
         ctx->opSetCB[operandNumber](ctx);
+#endif
+    }
+
+    // ED ED : トラップ(Z80では未定義命令)
+    // HLE(S-OSのサブルーチンなど)の呼び出しに使う。
+    // コールバックからはPCがトラップ命令の先頭を指しているように見え、
+    // コールバック内でPCを書き換えると、そのアドレスから実行を続ける。
+    static inline void TRAP_(Z80* ctx) { ctx->TRAP(); }
+    inline void TRAP()
+    {
+        if (!CB.trap) {
+            return;
+        }
+        const unsigned short addr = reg.PC - 2;
+        reg.PC = addr;
+        const int result = CB.trap(CB.arg, addr);
+#if Z80_IDLE_LOOP_FAST_FORWARD
+        // 待っている間(TRAP_WAIT)のjs側の状態は、execute()を抜けるまで変わらない
+        // それ以外は、コールバックで何をしているかわからないので
+        if (result != TRAP_WAIT) idleLoop.impure = true;
+#endif
+        if (result == TRAP_NONE) {
+            if (reg.PC == addr) reg.PC = addr + 2;
+            return;
+        }
+        // トラップ命令自体はクロックを消費しないように、2バイト目のフェッチ分を戻す
+        if (reg.PC != addr) {
+            consumeClock(-(4 + waitRead()));
+        } else if (result == TRAP_RETURN) {
+            consumeClock(-(4 + waitRead()));
+            RET(this);
+        } else {
+            // 待っている間は JP $ と同じだけクロックを消費する
+            consumeClock((3 + waitRead()) * 2 - (4 + waitRead()));
+        }
     }
 
     static inline void OP_ED(Z80* ctx)
@@ -634,7 +999,11 @@ class Z80
 #endif 
         }
         ctx->checkBreakOperandED(operandNumber);
+#if Z80_THREADED_DISPATCH
+        ctx->dispatchED(operandNumber);
+#else
         ctx->opSetED[operandNumber](ctx);
+#endif
     }
 
     static inline void OP_IX(Z80* ctx)
@@ -648,7 +1017,11 @@ class Z80
 #endif
         }
         ctx->checkBreakOperandIX(operandNumber);
+#if Z80_THREADED_DISPATCH
+        ctx->dispatchIX(operandNumber);
+#else
         ctx->opSetIX[operandNumber](ctx);
+#endif
     }
 
     static inline void OP_IY(Z80* ctx)
@@ -662,7 +1035,11 @@ class Z80
 #endif
         }
         ctx->checkBreakOperandIY(operandNumber);
+#if Z80_THREADED_DISPATCH
+        ctx->dispatchIY(operandNumber);
+#else
         ctx->opSetIY[operandNumber](ctx);
+#endif
     }
 
     static inline void OP_IX4(Z80* ctx)
@@ -670,7 +1047,11 @@ class Z80
         signed char op3 = (signed char)ctx->fetch(4);
         unsigned char op4 = ctx->fetch(4);
         ctx->checkBreakOperandIX4(op4);
+#if Z80_THREADED_DISPATCH
+        ctx->dispatchIX4(op4, op3);
+#else
         ctx->opSetIX4[op4](ctx, op3);
+#endif
     }
 
     static inline void OP_IY4(Z80* ctx)
@@ -678,7 +1059,11 @@ class Z80
         signed char op3 = (signed char)ctx->fetch(4);
         unsigned char op4 = ctx->fetch(4);
         ctx->checkBreakOperandIY4(op4);
+#if Z80_THREADED_DISPATCH
+        ctx->dispatchIY4(op4, op3);
+#else
         ctx->opSetIY4[op4](ctx, op3);
+#endif
     }
 
     // Load location (HL) with value n
@@ -695,8 +1080,8 @@ class Z80
     {
         unsigned short addr = ctx->getBC();
         unsigned char n = ctx->readByte(addr, 3);
-        if (ctx->isDebug()) ctx->log("[%04X] LD A, (BC<$%02X%02X>) = $%02X", ctx->reg.PC - 1, ctx->reg.pair.B, ctx->reg.pair.C, n);
-        ctx->reg.pair.A = n;
+        if (ctx->isDebug()) ctx->log("[%04X] LD A, (BC<$%02X%02X>) = $%02X", ctx->reg.PC - 1, ctx->reg.pair.B(), ctx->reg.pair.C(), n);
+        ctx->reg.pair.A() = n;
     }
 
     // Load Acc. wth location (DE)
@@ -704,8 +1089,8 @@ class Z80
     {
         unsigned short addr = ctx->getDE();
         unsigned char n = ctx->readByte(addr, 3);
-        if (ctx->isDebug()) ctx->log("[%04X] LD A, (DE<$%02X%02X>) = $%02X", ctx->reg.PC - 1, ctx->reg.pair.D, ctx->reg.pair.E, n);
-        ctx->reg.pair.A = n;
+        if (ctx->isDebug()) ctx->log("[%04X] LD A, (DE<$%02X%02X>) = $%02X", ctx->reg.PC - 1, ctx->reg.pair.D(), ctx->reg.pair.E(), n);
+        ctx->reg.pair.A() = n;
     }
 
     // Load Acc. wth location (nn)
@@ -716,15 +1101,15 @@ class Z80
         unsigned short addr = ctx->make16BitsFromLE(l, h);
         unsigned char n = ctx->readByte(addr, 3);
         if (ctx->isDebug()) ctx->log("[%04X] LD A, ($%04X) = $%02X", ctx->reg.PC - 3, addr, n);
-        ctx->reg.pair.A = n;
+        ctx->reg.pair.A() = n;
     }
 
     // Load location (BC) wtih Acc.
     static inline void LD_BC_A(Z80* ctx)
     {
         unsigned short addr = ctx->getBC();
-        unsigned char n = ctx->reg.pair.A;
-        if (ctx->isDebug()) ctx->log("[%04X] LD (BC<$%02X%02X>), A<$%02X>", ctx->reg.PC - 1, ctx->reg.pair.B, ctx->reg.pair.C, n);
+        unsigned char n = ctx->reg.pair.A();
+        if (ctx->isDebug()) ctx->log("[%04X] LD (BC<$%02X%02X>), A<$%02X>", ctx->reg.PC - 1, ctx->reg.pair.B(), ctx->reg.pair.C(), n);
         ctx->writeByte(addr, n, 3);
     }
 
@@ -732,8 +1117,8 @@ class Z80
     static inline void LD_DE_A(Z80* ctx)
     {
         unsigned short addr = ctx->getDE();
-        unsigned char n = ctx->reg.pair.A;
-        if (ctx->isDebug()) ctx->log("[%04X] LD (DE<$%02X%02X>), A<$%02X>", ctx->reg.PC - 1, ctx->reg.pair.D, ctx->reg.pair.E, n);
+        unsigned char n = ctx->reg.pair.A();
+        if (ctx->isDebug()) ctx->log("[%04X] LD (DE<$%02X%02X>), A<$%02X>", ctx->reg.PC - 1, ctx->reg.pair.D(), ctx->reg.pair.E(), n);
         ctx->writeByte(addr, n, 3);
     }
 
@@ -743,7 +1128,7 @@ class Z80
         unsigned char l = ctx->fetch(3);
         unsigned char h = ctx->fetch(3);
         unsigned short addr = ctx->make16BitsFromLE(l, h);
-        unsigned char n = ctx->reg.pair.A;
+        unsigned char n = ctx->reg.pair.A();
         if (ctx->isDebug()) ctx->log("[%04X] LD ($%04X), A<$%02X>", ctx->reg.PC - 3, addr, n);
         ctx->writeByte(addr, n, 3);
     }
@@ -755,8 +1140,8 @@ class Z80
         unsigned char h = ctx->fetch(3);
         unsigned short addr = ctx->make16BitsFromLE(l, h);
         unsigned short hl = ctx->getHL();
-        ctx->reg.pair.L = ctx->readByte(addr, 3);
-        ctx->reg.pair.H = ctx->readByte(addr + 1, 3);
+        ctx->reg.pair.L() = ctx->readByte(addr, 3);
+        ctx->reg.pair.H() = ctx->readByte(addr + 1, 3);
         if (ctx->isDebug()) ctx->log("[%04X] LD HL<$%04X>, ($%04X) = $%04X", ctx->reg.PC - 3, hl, addr, ctx->getHL());
     }
 
@@ -767,8 +1152,8 @@ class Z80
         unsigned char h = ctx->fetch(3);
         unsigned short addr = ctx->make16BitsFromLE(l, h);
         if (ctx->isDebug()) ctx->log("[%04X] LD ($%04X), %s", ctx->reg.PC - 3, addr, ctx->registerPairDump(0b10));
-        ctx->writeByte(addr, ctx->reg.pair.L, 3);
-        ctx->writeByte(addr + 1, ctx->reg.pair.H, 3);
+        ctx->writeByte(addr, ctx->reg.pair.L(), 3);
+        ctx->writeByte(addr + 1, ctx->reg.pair.H(), 3);
     }
 
     // Load SP with HL.
@@ -782,21 +1167,19 @@ class Z80
     // Exchange H and L with D and E
     static inline void EX_DE_HL(Z80* ctx)
     {
-        unsigned short de = ctx->getDE();
-        unsigned short hl = ctx->getHL();
+        unsigned short de = ctx->reg.pair.DE();
         if (ctx->isDebug()) ctx->log("[%04X] EX %s, %s", ctx->reg.PC - 1, ctx->registerPairDump(0b01), ctx->registerPairDump(0b10));
-        ctx->setDE(hl);
-        ctx->setHL(de);
+        ctx->reg.pair.DE() = ctx->reg.pair.HL();
+        ctx->reg.pair.HL() = de;
     }
 
     // Exchange A and F with A' and F'
     static inline void EX_AF_AF2(Z80* ctx)
     {
-        unsigned short af = ctx->getAF();
-        unsigned short af2 = ctx->getAF2();
-        if (ctx->isDebug()) ctx->log("[%04X] EX AF<$%02X%02X>, AF'<$%02X%02X>", ctx->reg.PC - 1, ctx->reg.pair.A, ctx->reg.pair.F, ctx->reg.back.A, ctx->reg.back.F);
-        ctx->setAF(af2);
-        ctx->setAF2(af);
+        unsigned short af = ctx->reg.pair.AF();
+        if (ctx->isDebug()) ctx->log("[%04X] EX AF<$%02X%02X>, AF'<$%02X%02X>", ctx->reg.PC - 1, ctx->reg.pair.A(), ctx->reg.pair.F(), ctx->reg.back.A(), ctx->reg.back.F());
+        ctx->reg.pair.AF() = ctx->reg.back.AF();
+        ctx->reg.back.AF() = af;
     }
 
     static inline void EX_SP_HL(Z80* ctx)
@@ -806,27 +1189,25 @@ class Z80
         unsigned char h = ctx->pop(4);
         unsigned short hl = ctx->getHL();
         if (ctx->isDebug()) ctx->log("[%04X] EX (SP<$%04X>) = $%02X%02X, HL<$%04X>", ctx->reg.PC - 1, sp, h, l, hl);
-        ctx->push(ctx->reg.pair.H, 4);
-        ctx->reg.pair.H = h;
-        ctx->push(ctx->reg.pair.L, 3);
-        ctx->reg.pair.L = l;
+        ctx->push(ctx->reg.pair.H(), 4);
+        ctx->reg.pair.H() = h;
+        ctx->push(ctx->reg.pair.L(), 3);
+        ctx->reg.pair.L() = l;
     }
 
     static inline void EXX(Z80* ctx)
     {
         if (ctx->isDebug()) ctx->log("[%04X] EXX", ctx->reg.PC - 1);
-        unsigned short bc = ctx->getBC();
-        unsigned short bc2 = ctx->getBC2();
-        unsigned short de = ctx->getDE();
-        unsigned short de2 = ctx->getDE2();
-        unsigned short hl = ctx->getHL();
-        unsigned short hl2 = ctx->getHL2();
-        ctx->setBC(bc2);
-        ctx->setBC2(bc);
-        ctx->setDE(de2);
-        ctx->setDE2(de);
-        ctx->setHL(hl2);
-        ctx->setHL2(hl);
+        // ワードのまま入れ替える
+        unsigned short bc = ctx->reg.pair.BC();
+        unsigned short de = ctx->reg.pair.DE();
+        unsigned short hl = ctx->reg.pair.HL();
+        ctx->reg.pair.BC() = ctx->reg.back.BC();
+        ctx->reg.pair.DE() = ctx->reg.back.DE();
+        ctx->reg.pair.HL() = ctx->reg.back.HL();
+        ctx->reg.back.BC() = bc;
+        ctx->reg.back.DE() = de;
+        ctx->reg.back.HL() = hl;
     }
 
     inline void push(unsigned char value, int clocks)
@@ -844,29 +1225,29 @@ class Z80
 
     static inline void PUSH_AF(Z80* ctx)
     {
-        if (ctx->isDebug()) ctx->log("[%04X] PUSH AF<$%02X%02X> <SP:$%04X>", ctx->reg.PC - 1, ctx->reg.pair.A, ctx->reg.pair.F, ctx->reg.SP);
-        ctx->push(ctx->reg.pair.A, 4);
-        ctx->push(ctx->reg.pair.F, 3);
+        if (ctx->isDebug()) ctx->log("[%04X] PUSH AF<$%02X%02X> <SP:$%04X>", ctx->reg.PC - 1, ctx->reg.pair.A(), ctx->reg.pair.F(), ctx->reg.SP);
+        ctx->push(ctx->reg.pair.A(), 4);
+        ctx->push(ctx->reg.pair.F(), 3);
     }
 
     static inline void POP_AF(Z80* ctx)
     {
-        ctx->reg.pair.F = ctx->pop(3);
-        ctx->reg.pair.A = ctx->pop(3);
+        ctx->reg.pair.F() = ctx->pop(3);
+        ctx->reg.pair.A() = ctx->pop(3);
         if (ctx->isDebug()) ctx->log("[%04X] POP AF <SP:$%04X> = $%04X", ctx->reg.PC - 1, ctx->reg.SP - 2, ctx->getAF());
     }
 
     inline unsigned char* getRegisterPointer(unsigned char r)
     {
         switch (r) {
-            case 0b111: return &reg.pair.A;
-            case 0b000: return &reg.pair.B;
-            case 0b001: return &reg.pair.C;
-            case 0b010: return &reg.pair.D;
-            case 0b011: return &reg.pair.E;
-            case 0b100: return &reg.pair.H;
-            case 0b101: return &reg.pair.L;
-            case 0b110: return &reg.pair.F;
+            case 0b111: return &reg.pair.A();
+            case 0b000: return &reg.pair.B();
+            case 0b001: return &reg.pair.C();
+            case 0b010: return &reg.pair.D();
+            case 0b011: return &reg.pair.E();
+            case 0b100: return &reg.pair.H();
+            case 0b101: return &reg.pair.L();
+            case 0b110: return &reg.pair.F();
         }
         if (isDebug()) log("detected an unknown register number: $%02X", r);
         return nullptr;
@@ -875,14 +1256,14 @@ class Z80
     inline unsigned char getRegister(unsigned char r)
     {
         switch (r) {
-            case 0b111: return reg.pair.A;
-            case 0b000: return reg.pair.B;
-            case 0b001: return reg.pair.C;
-            case 0b010: return reg.pair.D;
-            case 0b011: return reg.pair.E;
-            case 0b100: return reg.pair.H;
-            case 0b101: return reg.pair.L;
-            case 0b110: return reg.pair.F;
+            case 0b111: return reg.pair.A();
+            case 0b000: return reg.pair.B();
+            case 0b001: return reg.pair.C();
+            case 0b010: return reg.pair.D();
+            case 0b011: return reg.pair.E();
+            case 0b100: return reg.pair.H();
+            case 0b101: return reg.pair.L();
+            case 0b110: return reg.pair.F();
         }
         if (isDebug()) log("detected an unknown register number: $%02X", r);
         return 0xFF;
@@ -901,14 +1282,14 @@ class Z80
         static char unknown[2];
 #ifndef BUILD_WASM
         switch (r & 0b111) {
-            case 0b111: snprintf(A, sizeof(A), "A<$%02X>", reg.pair.A); return A;
-            case 0b000: snprintf(B, sizeof(B), "B<$%02X>", reg.pair.B); return B;
-            case 0b001: snprintf(C, sizeof(C), "C<$%02X>", reg.pair.C); return C;
-            case 0b010: snprintf(D, sizeof(D), "D<$%02X>", reg.pair.D); return D;
-            case 0b011: snprintf(E, sizeof(E), "E<$%02X>", reg.pair.E); return E;
-            case 0b100: snprintf(H, sizeof(H), "H<$%02X>", reg.pair.H); return H;
-            case 0b101: snprintf(L, sizeof(L), "L<$%02X>", reg.pair.L); return L;
-            case 0b110: snprintf(F, sizeof(F), "F<$%02X>", reg.pair.F); return F;
+            case 0b111: snprintf(A, sizeof(A), "A<$%02X>", reg.pair.A()); return A;
+            case 0b000: snprintf(B, sizeof(B), "B<$%02X>", reg.pair.B()); return B;
+            case 0b001: snprintf(C, sizeof(C), "C<$%02X>", reg.pair.C()); return C;
+            case 0b010: snprintf(D, sizeof(D), "D<$%02X>", reg.pair.D()); return D;
+            case 0b011: snprintf(E, sizeof(E), "E<$%02X>", reg.pair.E()); return E;
+            case 0b100: snprintf(H, sizeof(H), "H<$%02X>", reg.pair.H()); return H;
+            case 0b101: snprintf(L, sizeof(L), "L<$%02X>", reg.pair.L()); return L;
+            case 0b110: snprintf(F, sizeof(F), "F<$%02X>", reg.pair.F()); return F;
         }
 #endif
         unknown[0] = '?';
@@ -968,13 +1349,13 @@ class Z80
         static char unknown[2] = "?";
         switch (r) {
 #ifndef BUILD_WASM
-            case 0b111: snprintf(A, sizeof(A), "A'<$%02X>", reg.back.A); return A;
-            case 0b000: snprintf(B, sizeof(B), "B'<$%02X>", reg.back.B); return B;
-            case 0b001: snprintf(C, sizeof(C), "C'<$%02X>", reg.back.C); return C;
-            case 0b010: snprintf(D, sizeof(D), "D'<$%02X>", reg.back.D); return D;
-            case 0b011: snprintf(E, sizeof(E), "E'<$%02X>", reg.back.E); return E;
-            case 0b100: snprintf(H, sizeof(H), "H'<$%02X>", reg.back.H); return H;
-            case 0b101: snprintf(L, sizeof(L), "L'<$%02X>", reg.back.L); return L;
+            case 0b111: snprintf(A, sizeof(A), "A'<$%02X>", reg.back.A()); return A;
+            case 0b000: snprintf(B, sizeof(B), "B'<$%02X>", reg.back.B()); return B;
+            case 0b001: snprintf(C, sizeof(C), "C'<$%02X>", reg.back.C()); return C;
+            case 0b010: snprintf(D, sizeof(D), "D'<$%02X>", reg.back.D()); return D;
+            case 0b011: snprintf(E, sizeof(E), "E'<$%02X>", reg.back.E()); return E;
+            case 0b100: snprintf(H, sizeof(H), "H'<$%02X>", reg.back.H()); return H;
+            case 0b101: snprintf(L, sizeof(L), "L'<$%02X>", reg.back.L()); return L;
 #endif
             default: return unknown;
         }
@@ -989,9 +1370,9 @@ class Z80
         static char unknown[2] = "?";
         switch (ptn & 0b11) {
 #ifndef BUILD_WASM
-            case 0b00: snprintf(BC, sizeof(BC), "BC<$%02X%02X>", reg.pair.B, reg.pair.C); return BC;
-            case 0b01: snprintf(DE, sizeof(DE), "DE<$%02X%02X>", reg.pair.D, reg.pair.E); return DE;
-            case 0b10: snprintf(HL, sizeof(HL), "HL<$%02X%02X>", reg.pair.H, reg.pair.L); return HL;
+            case 0b00: snprintf(BC, sizeof(BC), "BC<$%02X%02X>", reg.pair.B(), reg.pair.C()); return BC;
+            case 0b01: snprintf(DE, sizeof(DE), "DE<$%02X%02X>", reg.pair.D(), reg.pair.E()); return DE;
+            case 0b10: snprintf(HL, sizeof(HL), "HL<$%02X%02X>", reg.pair.H(), reg.pair.L()); return HL;
             case 0b11: snprintf(SP, sizeof(SP), "SP<$%04X>", reg.SP); return SP;
 #endif
             default: return unknown;
@@ -1007,8 +1388,8 @@ class Z80
         static char unknown[2] = "?";
         switch (ptn & 0b11) {
 #ifndef BUILD_WASM
-            case 0b00: snprintf(BC, sizeof(BC), "BC<$%02X%02X>", reg.pair.B, reg.pair.C); return BC;
-            case 0b01: snprintf(DE, sizeof(DE), "DE<$%02X%02X>", reg.pair.D, reg.pair.E); return DE;
+            case 0b00: snprintf(BC, sizeof(BC), "BC<$%02X%02X>", reg.pair.B(), reg.pair.C()); return BC;
+            case 0b01: snprintf(DE, sizeof(DE), "DE<$%02X%02X>", reg.pair.D(), reg.pair.E()); return DE;
             case 0b10: snprintf(IX, sizeof(IX), "IX<$%04X>", reg.IX); return IX;
             case 0b11: snprintf(SP, sizeof(SP), "SP<$%04X>", reg.SP); return SP;
 #endif
@@ -1025,8 +1406,8 @@ class Z80
         static char unknown[2] = "?";
         switch (ptn & 0b11) {
 #ifndef BUILD_WASM
-            case 0b00: snprintf(BC, sizeof(BC), "BC<$%02X%02X>", reg.pair.B, reg.pair.C); return BC;
-            case 0b01: snprintf(DE, sizeof(DE), "DE<$%02X%02X>", reg.pair.D, reg.pair.E); return DE;
+            case 0b00: snprintf(BC, sizeof(BC), "BC<$%02X%02X>", reg.pair.B(), reg.pair.C()); return BC;
+            case 0b01: snprintf(DE, sizeof(DE), "DE<$%02X%02X>", reg.pair.D(), reg.pair.E()); return DE;
             case 0b10: snprintf(IY, sizeof(IY), "IY<$%04X>", reg.IY); return IY;
             case 0b11: snprintf(SP, sizeof(SP), "SP<$%04X>", reg.SP); return SP;
 #endif
@@ -1477,16 +1858,16 @@ class Z80
         unsigned char* rL;
         switch (rp) {
             case 0b00:
-                rH = &reg.pair.B;
-                rL = &reg.pair.C;
+                rH = &reg.pair.B();
+                rL = &reg.pair.C();
                 break;
             case 0b01:
-                rH = &reg.pair.D;
-                rL = &reg.pair.E;
+                rH = &reg.pair.D();
+                rL = &reg.pair.E();
                 break;
             case 0b10:
-                rH = &reg.pair.H;
-                rL = &reg.pair.L;
+                rH = &reg.pair.H();
+                rL = &reg.pair.L();
                 break;
             case 0b11: {
                 // SP is not managed in pair structure, so calculate directly
@@ -1541,16 +1922,16 @@ class Z80
         unsigned char* rH;
         switch (rp) {
             case 0:
-                rH = &reg.pair.B;
-                rL = &reg.pair.C;
+                rH = &reg.pair.B();
+                rL = &reg.pair.C();
                 break;
             case 1:
-                rH = &reg.pair.D;
-                rL = &reg.pair.E;
+                rH = &reg.pair.D();
+                rL = &reg.pair.E();
                 break;
             case 2:
-                rH = &reg.pair.H;
-                rL = &reg.pair.L;
+                rH = &reg.pair.H();
+                rL = &reg.pair.L();
                 break;
             case 3: {
                 const char* dump = isDebug() ? registerPairDump(rp) : "";
@@ -1587,16 +1968,16 @@ class Z80
         if (isDebug()) log("[%04X] LD ($%04X), %s", reg.PC - 4, addr, registerPairDump(rp));
         switch (rp) {
             case 0b00:
-                h = reg.pair.B;
-                l = reg.pair.C;
+                h = reg.pair.B();
+                l = reg.pair.C();
                 break;
             case 0b01:
-                h = reg.pair.D;
-                l = reg.pair.E;
+                h = reg.pair.D();
+                l = reg.pair.E();
                 break;
             case 0b10:
-                h = reg.pair.H;
-                l = reg.pair.L;
+                h = reg.pair.H();
+                l = reg.pair.L();
                 break;
             case 0b11:
                 splitTo8BitsPair(reg.SP, &h, &l);
@@ -1679,6 +2060,124 @@ class Z80
         consumeClock(2);
     }
 
+#if Z80_BLOCK_FAST_FORWARD
+    // ブロック命令(ED opcode)の繰り返しを、命令ディスパッチに戻らずに続けられるかどうか
+    //   execute()のループに戻っても、同じ命令をフェッチし直すだけの時にtrue
+    inline bool isBlockRepeatable(unsigned char opcode)
+    {
+#if Z80_TRACE
+        return false;
+#else
+        if (requestBreakFlag || CB.breakPointCount || isDebug()) return false;
+#ifndef DISABLE_BREAK_OPERANDS
+        if (!CB.breakOperands.empty()) return false;
+#endif
+        // 割り込みを受け付けるなら戻る
+        if (isInterruptPending()) return false;
+        // 次の繰り返しを始める前に、クロックを使い切っているなら戻る
+        if (executeClock - executed - reg.consumeClockCounter <= 0) return false;
+        // 命令コードが副作用なく読めて、ブロック命令自体が書き換えられていないこと
+        const unsigned short pc1 = reg.PC + 1;
+        const unsigned char* page0 = readPage[reg.PC >> 8];
+        const unsigned char* page1 = readPage[pc1 >> 8];
+        return page0 && page1 && page0[reg.PC & 0xFF] == 0xED && page1[pc1 & 0xFF] == opcode;
+#endif
+    }
+
+    // 次の繰り返しの命令フェッチ(ED opcode)と同じだけクロックとRを進める
+    inline void fetchBlockRepeat()
+    {
+        // ここまでの分はexecute()のループと同じく1命令として加算する
+#if Z80_PROFILE
+        addProfile(reg.PC, reg.consumeClockCounter, 1);
+#endif
+        executed += reg.consumeClockCounter;
+        reg.consumeClockCounter = 0;
+        if (waitFetch()) consumeClock(waitFetch());
+        consumeClock(waitRead() + 2);
+        updateRefreshRegister();
+        consumeClock(waitRead() + 4);
+        reg.PC += 2;
+    }
+
+    // ブロック命令を1回実行して、繰り返すなら続けて実行する
+    //   繰り返しの途中で読み書きやIOのコールバックが割り込みを発生させたら、次の繰り返しの前に戻る
+    template <typename Functor>
+    inline void repeatBlock(unsigned char opcode, Functor body)
+    {
+        const unsigned short pc = reg.PC - 2;
+        body();
+        while (reg.PC == pc && isBlockRepeatable(opcode)) {
+            fetchBlockRepeat();
+            body();
+        }
+    }
+
+    // LDIR/LDDRの繰り返しを、読み書きのページの境界までまとめて転送する
+    //   読み込みも書き込みもページテーブルのメモリなら、コールバックが呼ばれないので割り込みの状態も変わらない
+    //   まとめて転送できなかったらfalse
+    inline bool repeatBlockLD(bool isIncDEHL)
+    {
+        const unsigned short pc = reg.PC;
+        unsigned short bc = getBC();
+        const unsigned short de = getDE();
+        const unsigned short hl = getHL();
+        const unsigned char* src = readPage[hl >> 8];
+        unsigned char* dst = writePage[de >> 8];
+        if (!src || !dst) return false;
+        // 1回分のクロック(最後の1回は繰り返さないので-5)
+        const int cycle = waitFetch() + waitRead() * 3 + waitWrite() + 21;
+        // 残りのクロックで始められる回数まで
+        const int remain = executeClock - executed - reg.consumeClockCounter;
+        int count = (remain + cycle - 1) / cycle;
+        if (bc < count) count = bc;
+        // どちらかのページの境界まで
+        const int srcLeft = isIncDEHL ? 0x100 - (hl & 0xFF) : (hl & 0xFF) + 1;
+        const int dstLeft = isIncDEHL ? 0x100 - (de & 0xFF) : (de & 0xFF) + 1;
+        if (srcLeft < count) count = srcLeft;
+        if (dstLeft < count) count = dstLeft;
+        // ブロック命令自体を書き換える手前まで(書き換える回は普通に実行する)
+        for (int i = 0; i < 2; i++) {
+            const int distance = (unsigned short)(isIncDEHL ? pc + i - de : de - pc - i);
+            if (distance < count) count = distance;
+        }
+        if (count <= 0) return false;
+        // 重なっていても1回ずつ実行した時と同じになるように、1バイトずつ転送する
+        src += hl & 0xFF;
+        dst += de & 0xFF;
+        unsigned char n;
+        if (isIncDEHL) {
+            for (int i = 0; i < count; i++) dst[i] = src[i];
+            n = src[count - 1];
+        } else {
+            for (int i = 0; i < count; i++) dst[-i] = src[-i];
+            n = src[1 - count];
+        }
+#if Z80_IDLE_LOOP_FAST_FORWARD
+        idleLoop.impure = true;
+#endif
+        bc -= count;
+        setBC(bc);
+        setDE((unsigned short)(isIncDEHL ? de + count : de - count));
+        setHL((unsigned short)(isIncDEHL ? hl + count : hl - count));
+        reg.R = ((reg.R + count) & 0x7F) | (reg.R & 0x80);
+        setFlagPV(bc != 0);
+        unsigned char an = reg.pair.A() + n;
+        setFlagY(an & 0b00000010);
+        setFlagX(an & 0b00001000);
+        const int hz = count * cycle - (bc ? 0 : 5);
+#if Z80_CONSUME_CLOCK_CALLBACK
+        if (CB.consumeClockEnabled) CB.consumeClock(CB.arg, hz);
+#endif
+#if Z80_PROFILE
+        addProfile(pc, hz, count);
+#endif
+        executed += hz;
+        if (!bc) reg.PC = pc + 2;
+        return true;
+    }
+#endif // Z80_BLOCK_FAST_FORWARD
+
     // Load location (DE) with Loacation (HL), increment/decrement DE, HL, decrement BC
     inline void repeatLD(bool isIncDEHL, bool isRepeat)
     {
@@ -1708,7 +2207,7 @@ class Z80
         setFlagH(false);
         setFlagPV(bc != 0);
         setFlagN(false);
-        unsigned char an = reg.pair.A + n;
+        unsigned char an = reg.pair.A() + n;
         setFlagY(an & 0b00000010);
         setFlagX(an & 0b00001000);
         if (isRepeat && 0 != bc) {
@@ -1717,15 +2216,31 @@ class Z80
         }
     }
     static inline void LDI(Z80* ctx) { ctx->repeatLD(true, false); }
-    static inline void LDIR(Z80* ctx) { ctx->repeatLD(true, true); }
     static inline void LDD(Z80* ctx) { ctx->repeatLD(false, false); }
+#if Z80_BLOCK_FAST_FORWARD
+    inline void repeatLDBlock(bool isIncDEHL, unsigned char opcode)
+    {
+        const unsigned short pc = reg.PC - 2;
+        repeatLD(isIncDEHL, true);
+        while (reg.PC == pc && isBlockRepeatable(opcode)) {
+            if (repeatBlockLD(isIncDEHL)) continue;
+            // ページテーブルにないメモリは1回ずつ
+            fetchBlockRepeat();
+            repeatLD(isIncDEHL, true);
+        }
+    }
+    static inline void LDIR(Z80* ctx) { ctx->repeatLDBlock(true, 0xB0); }
+    static inline void LDDR(Z80* ctx) { ctx->repeatLDBlock(false, 0xB8); }
+#else
+    static inline void LDIR(Z80* ctx) { ctx->repeatLD(true, true); }
     static inline void LDDR(Z80* ctx) { ctx->repeatLD(false, true); }
+#endif
 #if R800
     // multiply
     inline void mulub(unsigned char r)
     {
-        unsigned short value = static_cast<unsigned short>(reg.pair.A) * static_cast<unsigned short>(getRegister(r));
-        if (isDebug()) log("[%04X] MULUB A<$%02X>, %s", reg.PC - 2, reg.pair.A, registerDump(r));
+        unsigned short value = static_cast<unsigned short>(reg.pair.A()) * static_cast<unsigned short>(getRegister(r));
+        if (isDebug()) log("[%04X] MULUB A<$%02X>, %s", reg.PC - 2, reg.pair.A(), registerDump(r));
         setHL(value);
         setFlagS(false);
         setFlagPV(false);
@@ -1801,16 +2316,16 @@ class Z80
         if (isDebug()) log("[%04X] PUSH %s <SP:$%04X>", reg.PC - 1, registerPairDump(rp), reg.SP);
         switch (rp) {
             case 0b00:
-                push(reg.pair.B, 4);
-                push(reg.pair.C, 3);
+                push(reg.pair.B(), 4);
+                push(reg.pair.C(), 3);
                 break;
             case 0b01:
-                push(reg.pair.D, 4);
-                push(reg.pair.E, 3);
+                push(reg.pair.D(), 4);
+                push(reg.pair.E(), 3);
                 break;
             case 0b10:
-                push(reg.pair.H, 4);
-                push(reg.pair.L, 3);
+                push(reg.pair.H(), 4);
+                push(reg.pair.L(), 3);
                 break;
             default:
                 if (isDebug()) log("invalid register pair has specified: $%02X", rp);
@@ -1831,18 +2346,18 @@ class Z80
         unsigned short after;
         switch (rp) {
             case 0b00:
-                reg.pair.C = pop(3);
-                reg.pair.B = pop(3);
+                reg.pair.C() = pop(3);
+                reg.pair.B() = pop(3);
                 after = getBC();
                 break;
             case 0b01:
-                reg.pair.E = pop(3);
-                reg.pair.D = pop(3);
+                reg.pair.E() = pop(3);
+                reg.pair.D() = pop(3);
                 after = getDE();
                 break;
             case 0b10:
-                reg.pair.L = pop(3);
-                reg.pair.H = pop(3);
+                reg.pair.L() = pop(3);
+                reg.pair.H() = pop(3);
                 after = getHL();
                 break;
             default:
@@ -1895,14 +2410,11 @@ class Z80
 
     inline void setFlagByRotate(unsigned char n, bool carry, bool isA = false)
     {
-        setFlagC(carry);
-        setFlagH(false);
-        setFlagN(false);
-        setFlagXY(n);
-        if (!isA) {
-            setFlagS(n & 0x80);
-            setFlagZ(0 == n);
-            setFlagPV(isEvenNumberBits(n));
+        if (isA) {
+            // RLCA/RLA/RRCA/RRAはS, Z, PVを変えない
+            reg.pair.F() = (reg.pair.F() & (flagS() | flagZ() | flagPV())) | (n & (flagX() | flagY())) | (carry ? flagC() : 0);
+        } else {
+            reg.pair.F() = z80FlagTable.szp[n] | (carry ? flagC() : 0);
         }
     }
 
@@ -1987,26 +2499,26 @@ class Z80
 
     static inline void RLCA(Z80* ctx)
     {
-        if (ctx->isDebug()) ctx->log("[%04X] RLCA <A:$%02X, C:%s>", ctx->reg.PC - 1, ctx->reg.pair.A, ctx->isFlagC() ? "ON" : "OFF");
-        ctx->reg.pair.A = ctx->RLC(ctx->reg.pair.A, true);
+        if (ctx->isDebug()) ctx->log("[%04X] RLCA <A:$%02X, C:%s>", ctx->reg.PC - 1, ctx->reg.pair.A(), ctx->isFlagC() ? "ON" : "OFF");
+        ctx->reg.pair.A() = ctx->RLC(ctx->reg.pair.A(), true);
     }
 
     static inline void RRCA(Z80* ctx)
     {
-        if (ctx->isDebug()) ctx->log("[%04X] RRCA <A:$%02X, C:%s>", ctx->reg.PC - 1, ctx->reg.pair.A, ctx->isFlagC() ? "ON" : "OFF");
-        ctx->reg.pair.A = ctx->RRC(ctx->reg.pair.A, true);
+        if (ctx->isDebug()) ctx->log("[%04X] RRCA <A:$%02X, C:%s>", ctx->reg.PC - 1, ctx->reg.pair.A(), ctx->isFlagC() ? "ON" : "OFF");
+        ctx->reg.pair.A() = ctx->RRC(ctx->reg.pair.A(), true);
     }
 
     static inline void RLA(Z80* ctx)
     {
-        if (ctx->isDebug()) ctx->log("[%04X] RLA <A:$%02X, C:%s>", ctx->reg.PC - 1, ctx->reg.pair.A, ctx->isFlagC() ? "ON" : "OFF");
-        ctx->reg.pair.A = ctx->RL(ctx->reg.pair.A, true);
+        if (ctx->isDebug()) ctx->log("[%04X] RLA <A:$%02X, C:%s>", ctx->reg.PC - 1, ctx->reg.pair.A(), ctx->isFlagC() ? "ON" : "OFF");
+        ctx->reg.pair.A() = ctx->RL(ctx->reg.pair.A(), true);
     }
 
     static inline void RRA(Z80* ctx)
     {
-        if (ctx->isDebug()) ctx->log("[%04X] RRA <A:$%02X, C:%s>", ctx->reg.PC - 1, ctx->reg.pair.A, ctx->isFlagC() ? "ON" : "OFF");
-        ctx->reg.pair.A = ctx->RR(ctx->reg.pair.A, true);
+        if (ctx->isDebug()) ctx->log("[%04X] RRA <A:$%02X, C:%s>", ctx->reg.PC - 1, ctx->reg.pair.A(), ctx->isFlagC() ? "ON" : "OFF");
+        ctx->reg.pair.A() = ctx->RR(ctx->reg.pair.A(), true);
     }
 
     // Rotate register Left Circular
@@ -2791,44 +3303,32 @@ class Z80
     inline void subtract8(int subtract, int carry, bool setCarry = true, bool setResult = true) { arithmetic8(true, subtract, carry, setCarry, setResult); }
     inline void arithmetic8(bool negative, int addition, int carry, bool setCarry, bool setResult)
     {
-        int before = reg.pair.A;
+        int before = reg.pair.A();
         int result = before + (negative ? -addition - carry : addition + carry);
         int carryX = before ^ addition ^ result;
         unsigned char finalResult = result & 0xFF;
-        setFlagZ(0 == finalResult);
-        setFlagN(negative);
-        setFlagS(0x80 & finalResult);
-        setFlagH(carryX & 0x10);
-        setFlagPV(((carryX << 1) ^ carryX) & 0x100);
-        if (setCarry) setFlagC(carryX & 0x100);
+        // H: ビット3からの桁上がり, V: ビット6からとビット7からの桁上がりが異なる, C: ビット7からの桁上がり
+        unsigned char f = (carryX & flagH()) | (((carryX >> 6) ^ (carryX >> 5)) & flagPV()) | (negative ? flagN() : 0);
+        f |= setCarry ? (carryX >> 8) & flagC() : reg.pair.F() & flagC();
         if (setResult) {
-            reg.pair.A = finalResult;
-            setFlagXY(reg.pair.A);
+            reg.pair.A() = finalResult;
+            reg.pair.F() = f | z80FlagTable.sz[finalResult];
         } else {
-            setFlagXY(addition);
+            // CPのX, Yは比較した値から
+            reg.pair.F() = f | (z80FlagTable.sz[finalResult] & (flagS() | flagZ())) | (addition & (flagX() | flagY()));
         }
     }
 
     inline void setFlagByIncrement(unsigned char before)
     {
         unsigned char finalResult = before + 1;
-        setFlagN(false);
-        setFlagZ(0 == finalResult);
-        setFlagS(0x80 & finalResult);
-        setFlagH((finalResult & 0x0F) == 0x00);
-        setFlagPV(finalResult == 0x80);
-        setFlagXY(finalResult);
+        reg.pair.F() = (reg.pair.F() & flagC()) | z80FlagTable.inc[finalResult];
     }
 
     inline void setFlagByDecrement(unsigned char before)
     {
         unsigned char finalResult = before - 1;
-        setFlagN(true);
-        setFlagZ(0 == finalResult);
-        setFlagS(0x80 & finalResult);
-        setFlagH((finalResult & 0x0F) == 0x0F);
-        setFlagPV(finalResult == 0x7F);
-        setFlagXY(finalResult);
+        reg.pair.F() = (reg.pair.F() & flagC()) | z80FlagTable.dec[finalResult];
     }
 
     // Add Reg. r to Acc.
@@ -3582,30 +4082,24 @@ class Z80
 
     inline void setFlagByLogical(bool h)
     {
-        setFlagS(reg.pair.A & 0x80);
-        setFlagZ(reg.pair.A == 0);
-        setFlagXY(reg.pair.A);
-        setFlagH(h);
-        setFlagPV(isEvenNumberBits(reg.pair.A));
-        setFlagN(false);
-        setFlagC(false);
+        reg.pair.F() = z80FlagTable.szp[reg.pair.A()] | (h ? flagH() : 0);
     }
 
     inline void and8(unsigned char n)
     {
-        reg.pair.A &= n;
+        reg.pair.A() &= n;
         setFlagByLogical(true);
     }
 
     inline void or8(unsigned char n)
     {
-        reg.pair.A |= n;
+        reg.pair.A() |= n;
         setFlagByLogical(false);
     }
 
     inline void xor8(unsigned char n)
     {
-        reg.pair.A ^= n;
+        reg.pair.A() ^= n;
         setFlagByLogical(false);
     }
 
@@ -3683,7 +4177,7 @@ class Z80
     {
         signed char d = (signed char)fetch(4);
         unsigned char n = readByte((unsigned short)(reg.IX + d));
-        if (isDebug()) log("[%04X] AND %s, (IX+d<$%04X>) = $%02X", reg.PC - 3, registerDump(0b111), (unsigned short)(reg.IX + d), reg.pair.A & n);
+        if (isDebug()) log("[%04X] AND %s, (IX+d<$%04X>) = $%02X", reg.PC - 3, registerDump(0b111), (unsigned short)(reg.IX + d), reg.pair.A() & n);
         and8(n);
         consumeClock(3);
     }
@@ -3694,7 +4188,7 @@ class Z80
     {
         signed char d = (signed char)fetch(4);
         unsigned char n = readByte((unsigned short)(reg.IY + d));
-        if (isDebug()) log("[%04X] AND %s, (IY+d<$%04X>) = $%02X", reg.PC - 3, registerDump(0b111), (unsigned short)(reg.IY + d), reg.pair.A & n);
+        if (isDebug()) log("[%04X] AND %s, (IY+d<$%04X>) = $%02X", reg.PC - 3, registerDump(0b111), (unsigned short)(reg.IY + d), reg.pair.A() & n);
         and8(n);
         consumeClock(3);
     }
@@ -3762,7 +4256,7 @@ class Z80
     static inline void OR_HL(Z80* ctx)
     {
         unsigned char n = ctx->readByte(ctx->getHL(), 3);
-        if (ctx->isDebug()) ctx->log("[%04X] OR %s, (%s) = $%02X", ctx->reg.PC - 1, ctx->registerDump(0b111), ctx->registerPairDump(0b10), ctx->reg.pair.A | n);
+        if (ctx->isDebug()) ctx->log("[%04X] OR %s, (%s) = $%02X", ctx->reg.PC - 1, ctx->registerDump(0b111), ctx->registerPairDump(0b10), ctx->reg.pair.A() | n);
         ctx->or8(n);
     }
 
@@ -3772,7 +4266,7 @@ class Z80
     {
         signed char d = (signed char)fetch(4);
         unsigned char n = readByte((unsigned short)(reg.IX + d));
-        if (isDebug()) log("[%04X] OR %s, (IX+d<$%04X>) = $%02X", reg.PC - 3, registerDump(0b111), (unsigned short)(reg.IX + d), reg.pair.A | n);
+        if (isDebug()) log("[%04X] OR %s, (IX+d<$%04X>) = $%02X", reg.PC - 3, registerDump(0b111), (unsigned short)(reg.IX + d), reg.pair.A() | n);
         or8(n);
         consumeClock(3);
     }
@@ -3783,7 +4277,7 @@ class Z80
     {
         signed char d = (signed char)fetch(4);
         unsigned char n = readByte((unsigned short)(reg.IY + d));
-        if (isDebug()) log("[%04X] OR %s, (IY+d<$%04X>) = $%02X", reg.PC - 3, registerDump(0b111), (unsigned short)(reg.IY + d), reg.pair.A | n);
+        if (isDebug()) log("[%04X] OR %s, (IY+d<$%04X>) = $%02X", reg.PC - 3, registerDump(0b111), (unsigned short)(reg.IY + d), reg.pair.A() | n);
         or8(n);
         consumeClock(3);
     }
@@ -3851,7 +4345,7 @@ class Z80
     static inline void XOR_HL(Z80* ctx)
     {
         unsigned char n = ctx->readByte(ctx->getHL(), 3);
-        if (ctx->isDebug()) ctx->log("[%04X] XOR %s, (%s) = $%02X", ctx->reg.PC - 1, ctx->registerDump(0b111), ctx->registerPairDump(0b10), ctx->reg.pair.A ^ n);
+        if (ctx->isDebug()) ctx->log("[%04X] XOR %s, (%s) = $%02X", ctx->reg.PC - 1, ctx->registerDump(0b111), ctx->registerPairDump(0b10), ctx->reg.pair.A() ^ n);
         ctx->xor8(n);
     }
 
@@ -3861,7 +4355,7 @@ class Z80
     {
         signed char d = (signed char)fetch(4);
         unsigned char n = readByte((unsigned short)(reg.IX + d));
-        if (isDebug()) log("[%04X] XOR %s, (IX+d<$%04X>) = $%02X", reg.PC - 3, registerDump(0b111), (unsigned short)(reg.IX + d), reg.pair.A ^ n);
+        if (isDebug()) log("[%04X] XOR %s, (IX+d<$%04X>) = $%02X", reg.PC - 3, registerDump(0b111), (unsigned short)(reg.IX + d), reg.pair.A() ^ n);
         xor8(n);
         consumeClock(3);
     }
@@ -3872,7 +4366,7 @@ class Z80
     {
         signed char d = (signed char)fetch(4);
         unsigned char n = readByte((unsigned short)(reg.IY + d));
-        if (isDebug()) log("[%04X] XOR %s, (IY+d<$%04X>) = $%02X", reg.PC - 3, registerDump(0b111), (unsigned short)(reg.IY + d), reg.pair.A ^ n);
+        if (isDebug()) log("[%04X] XOR %s, (IY+d<$%04X>) = $%02X", reg.PC - 3, registerDump(0b111), (unsigned short)(reg.IY + d), reg.pair.A() ^ n);
         xor8(n);
         consumeClock(3);
     }
@@ -3881,10 +4375,10 @@ class Z80
     static inline void CPL(Z80* ctx)
     {
         if (ctx->isDebug()) ctx->log("[%04X] CPL %s", ctx->reg.PC - 1, ctx->registerDump(0b111));
-        ctx->reg.pair.A = ~ctx->reg.pair.A;
+        ctx->reg.pair.A() = ~ctx->reg.pair.A();
         ctx->setFlagH(true);
         ctx->setFlagN(true);
-        ctx->setFlagXY(ctx->reg.pair.A);
+        ctx->setFlagXY(ctx->reg.pair.A());
     }
 
     // Negate Acc. (2's Comp.)
@@ -3892,8 +4386,8 @@ class Z80
     inline void NEG()
     {
         if (isDebug()) log("[%04X] NEG %s", reg.PC - 2, registerDump(0b111));
-        unsigned char a = reg.pair.A;
-        reg.pair.A = 0;
+        unsigned char a = reg.pair.A();
+        reg.pair.A() = 0;
         subtract8(a, 0);
     }
 
@@ -3904,7 +4398,7 @@ class Z80
         ctx->setFlagH(ctx->isFlagC());
         ctx->setFlagN(false);
         ctx->setFlagC(!ctx->isFlagC());
-        ctx->setFlagXY(ctx->reg.pair.A);
+        ctx->setFlagXY(ctx->reg.pair.A());
     }
 
     // Set Carry Flag
@@ -3914,7 +4408,7 @@ class Z80
         ctx->setFlagH(false);
         ctx->setFlagN(false);
         ctx->setFlagC(true);
-        ctx->setFlagXY(ctx->reg.pair.A);
+        ctx->setFlagXY(ctx->reg.pair.A());
     }
 
     // Test BIT b of register r
@@ -4708,7 +5202,7 @@ class Z80
             }
         }
         subtract8(n, 0, false, false);
-        int nn = reg.pair.A;
+        int nn = reg.pair.A();
         nn -= n;
         nn -= isFlagH() ? 1 : 0;
         setFlagY(nn & 0b00000010);
@@ -4725,9 +5219,14 @@ class Z80
         reg.WZ += isIncHL ? 1 : -1;
     }
     static inline void CPI(Z80* ctx) { ctx->repeatCP(true, false); }
-    static inline void CPIR(Z80* ctx) { ctx->repeatCP(true, true); }
     static inline void CPD(Z80* ctx) { ctx->repeatCP(false, false); }
+#if Z80_BLOCK_FAST_FORWARD
+    static inline void CPIR(Z80* ctx) { ctx->repeatBlock(0xB1, [ctx] { ctx->repeatCP(true, true); }); }
+    static inline void CPDR(Z80* ctx) { ctx->repeatBlock(0xB9, [ctx] { ctx->repeatCP(false, true); }); }
+#else
+    static inline void CPIR(Z80* ctx) { ctx->repeatCP(true, true); }
     static inline void CPDR(Z80* ctx) { ctx->repeatCP(false, true); }
+#endif
 
     // Compare Register
     static inline void CP_B(Z80* ctx) { ctx->CP_R(0b000); }
@@ -4899,8 +5398,8 @@ class Z80
     {
         signed char e = (signed char)ctx->fetch(4);
         if (ctx->isDebug()) ctx->log("[%04X] DJNZ %s (%s)", ctx->reg.PC - 2, ctx->relativeDump(ctx->reg.PC - 2, e), ctx->registerDump(0b000));
-        ctx->reg.pair.B--;
-        if (ctx->reg.pair.B) {
+        ctx->reg.pair.B()--;
+        if (ctx->reg.pair.B()) {
             ctx->reg.PC += e;
             ctx->consumeClock(5);
         }
@@ -5048,7 +5547,7 @@ class Z80
         unsigned char n = ctx->fetch(3);
         unsigned char i = ctx->inPortWithA(n);
         if (ctx->isDebug()) ctx->log("[%04X] IN %s, ($%02X) = $%02X", ctx->reg.PC - 2, ctx->registerDump(0b111), n, i);
-        ctx->reg.pair.A = i;
+        ctx->reg.pair.A() = i;
     }
 
     static inline void IN0_B_N(Z80* ctx) { ctx->IN0_B_N_(); }
@@ -5068,39 +5567,34 @@ class Z80
     inline void IN_R_C(unsigned char r, bool setRegister = true)
     {
         unsigned char* rp = setRegister ? getRegisterPointer(r) : nullptr;
-        unsigned char i = inPortWithB(reg.pair.C);
+        unsigned char i = inPortWithB(reg.pair.C());
         if (rp) {
             if (isDebug()) log("[%04X] IN %s, (%s) = $%02X", reg.PC - 2, registerDump(r), registerDump(0b001), i);
             *rp = i;
         } else {
             if (isDebug()) log("[%04X] IN (%s) = $%02X", reg.PC - 2, registerDump(0b001), i);
         }
-        setFlagS(i & 0x80);
-        setFlagZ(i == 0);
-        setFlagH(false);
-        setFlagPV(isEvenNumberBits(i));
-        setFlagN(false);
-        setFlagXY(i);
+        reg.pair.F() = (reg.pair.F() & flagC()) | z80FlagTable.szp[i];
     }
 
     inline void decrementB_forRepeatIO()
     {
-        reg.pair.B--;
-        reg.pair.F = 0;
+        reg.pair.B()--;
+        reg.pair.F() = 0;
         setFlagC(isFlagC());
         setFlagN(true);
-        setFlagZ(reg.pair.B == 0);
-        setFlagXY(reg.pair.B);
-        setFlagS(reg.pair.B & 0x80);
-        setFlagH((reg.pair.B & 0x0F) == 0x0F);
-        setFlagPV(reg.pair.B == 0x7F);
+        setFlagZ(reg.pair.B() == 0);
+        setFlagXY(reg.pair.B());
+        setFlagS(reg.pair.B() & 0x80);
+        setFlagH((reg.pair.B() & 0x0F) == 0x0F);
+        setFlagPV(reg.pair.B() == 0x7F);
     }
 
     // Load location (HL) with input from port (C); or increment/decrement HL and decrement B
     inline void repeatIN(bool isIncHL, bool isRepeat)
     {
         reg.WZ = (unsigned short)(getBC() + (isIncHL ? 1 : -1));
-        unsigned char i = inPortWithB(reg.pair.C);
+        unsigned char i = inPortWithB(reg.pair.C());
         decrementB_forRepeatIO();
         unsigned short hl = getHL();
         if (isDebug()) {
@@ -5113,27 +5607,32 @@ class Z80
         writeByte(hl, i);
         hl += isIncHL ? 1 : -1;
         setHL(hl);
-        setFlagZ(reg.pair.B == 0);
+        setFlagZ(reg.pair.B() == 0);
         setFlagN(i & 0x80);                                               // NOTE: undocumented
-        setFlagC(0xFF < i + ((reg.pair.C + 1) & 0xFF));                   // NOTE: undocumented
+        setFlagC(0xFF < i + ((reg.pair.C() + 1) & 0xFF));                   // NOTE: undocumented
         setFlagH(isFlagC());                                              // NOTE: undocumented
-        setFlagPV((i + (((reg.pair.C + 1) & 0xFF) & 0x07)) ^ reg.pair.B); // NOTE: undocumented
-        if (isRepeat && 0 != reg.pair.B) {
+        setFlagPV((i + (((reg.pair.C() + 1) & 0xFF) & 0x07)) ^ reg.pair.B()); // NOTE: undocumented
+        if (isRepeat && 0 != reg.pair.B()) {
             reg.PC -= 2;
             consumeClock(5);
         }
     }
     static inline void INI(Z80* ctx) { ctx->repeatIN(true, false); }
-    static inline void INIR(Z80* ctx) { ctx->repeatIN(true, true); }
     static inline void IND(Z80* ctx) { ctx->repeatIN(false, false); }
+#if Z80_BLOCK_FAST_FORWARD
+    static inline void INIR(Z80* ctx) { ctx->repeatBlock(0xB2, [ctx] { ctx->repeatIN(true, true); }); }
+    static inline void INDR(Z80* ctx) { ctx->repeatBlock(0xBA, [ctx] { ctx->repeatIN(false, true); }); }
+#else
+    static inline void INIR(Z80* ctx) { ctx->repeatIN(true, true); }
     static inline void INDR(Z80* ctx) { ctx->repeatIN(false, true); }
+#endif
 
     // Load Output port (n) with Acc.
     static inline void OUT_N_A(Z80* ctx)
     {
         unsigned char n = ctx->fetch(3);
         if (ctx->isDebug()) ctx->log("[%04X] OUT ($%02X), %s", ctx->reg.PC - 2, n, ctx->registerDump(0b111));
-        ctx->outPortWithA(n, ctx->reg.pair.A);
+        ctx->outPortWithA(n, ctx->reg.pair.A());
     }
 
     // Output a byte to device (C) form register.
@@ -5149,10 +5648,10 @@ class Z80
     {
         if (zero) {
             if (isDebug()) log("[%04X] OUT (%s), 0", reg.PC - 2, registerDump(0b001));
-            outPortWithB(reg.pair.C, 0);
+            outPortWithB(reg.pair.C(), 0);
         } else {
             if (isDebug()) log("[%04X] OUT (%s), %s", reg.PC - 2, registerDump(0b001), registerDump(r));
-            outPortWithB(reg.pair.C, getRegister(r));
+            outPortWithB(reg.pair.C(), getRegister(r));
         }
     }
 
@@ -5168,42 +5667,42 @@ class Z80
             }
         }
         decrementB_forRepeatIO();
-        outPortWithB(reg.pair.C, o);
+        outPortWithB(reg.pair.C(), o);
         reg.WZ = (unsigned short)(getBC() + (isIncHL ? 1 : -1));
         setHL((unsigned short)(getHL() + (isIncHL ? 1 : -1)));
-        setFlagZ(reg.pair.B == 0);
+        setFlagZ(reg.pair.B() == 0);
         setFlagN(o & 0x80);                                // NOTE: ACTUAL FLAG CONDITION IS UNKNOWN
-        setFlagH(reg.pair.L + o > 0xFF);                   // NOTE: ACTUAL FLAG CONDITION IS UNKNOWN
+        setFlagH(reg.pair.L() + o > 0xFF);                   // NOTE: ACTUAL FLAG CONDITION IS UNKNOWN
         setFlagC(isFlagH());                               // NOTE: ACTUAL FLAG CONDITION IS UNKNOWN
-        setFlagPV(((reg.pair.H + o) & 0x07) ^ reg.pair.B); // NOTE: ACTUAL FLAG CONDITION IS UNKNOWN
-        if (isRepeat && 0 != reg.pair.B) {
+        setFlagPV(((reg.pair.H() + o) & 0x07) ^ reg.pair.B()); // NOTE: ACTUAL FLAG CONDITION IS UNKNOWN
+        if (isRepeat && 0 != reg.pair.B()) {
             reg.PC -= 2;
             consumeClock(5);
         }
     }
     static inline void OUTI(Z80* ctx) { ctx->repeatOUT(true, false); }
-    static inline void OUTIR(Z80* ctx) { ctx->repeatOUT(true, true); }
     static inline void OUTD(Z80* ctx) { ctx->repeatOUT(false, false); }
+#if Z80_BLOCK_FAST_FORWARD
+    static inline void OUTIR(Z80* ctx) { ctx->repeatBlock(0xB3, [ctx] { ctx->repeatOUT(true, true); }); }
+    static inline void OUTDR(Z80* ctx) { ctx->repeatBlock(0xBB, [ctx] { ctx->repeatOUT(false, true); }); }
+#else
+    static inline void OUTIR(Z80* ctx) { ctx->repeatOUT(true, true); }
     static inline void OUTDR(Z80* ctx) { ctx->repeatOUT(false, true); }
+#endif
 
     // Decimal Adjust Accumulator
     static inline void DAA(Z80* ctx) { ctx->daa(); }
     inline void daa()
     {
-        int a = reg.pair.A;
+        int a = reg.pair.A();
         bool c = isFlagC();
-        bool ac = reg.pair.A > 0x99;
+        bool ac = reg.pair.A() > 0x99;
         int add = (isFlagH() || (a & 0x0F) > 9 ? 0x06 : 0x00) + (c || ac ? 0x60 : 0x00);
         a += isFlagN() ? -add : add;
         a &= 0xFF;
-        setFlagS(a & 0x80);
-        setFlagXY(a);
-        setFlagZ(0 == a);
-        setFlagH((a ^ reg.pair.A) & flagH());
-        setFlagPV(isEvenNumberBits(a));
-        setFlagC(c | ac);
-        if (isDebug()) log("[%04X] DAA ... A: $%02X -> $%02X", reg.PC - 1, reg.pair.A, a);
-        reg.pair.A = a;
+        reg.pair.F() = z80FlagTable.szp[a] | ((a ^ reg.pair.A()) & flagH()) | (reg.pair.F() & flagN()) | (c || ac ? flagC() : 0);
+        if (isDebug()) log("[%04X] DAA ... A: $%02X -> $%02X", reg.PC - 1, reg.pair.A(), a);
+        reg.pair.A() = a;
     }
 
     // Rotate digit Left and right between Acc. and location (HL)
@@ -5214,20 +5713,15 @@ class Z80
         unsigned char beforeN = readByte(hl);
         unsigned char nH = (beforeN & 0b11110000) >> 4;
         unsigned char nL = beforeN & 0b00001111;
-        unsigned char aH = (reg.pair.A & 0b11110000) >> 4;
-        unsigned char aL = reg.pair.A & 0b00001111;
-        unsigned char beforeA = reg.pair.A;
+        unsigned char aH = (reg.pair.A() & 0b11110000) >> 4;
+        unsigned char aL = reg.pair.A() & 0b00001111;
+        unsigned char beforeA = reg.pair.A();
         unsigned char afterA = (aH << 4) | nH;
         unsigned char afterN = (nL << 4) | aL;
         if (isDebug()) log("[%04X] RLD ... A: $%02X -> $%02X, ($%04X): $%02X -> $%02X", reg.PC - 2, beforeA, afterA, hl, beforeN, afterN);
-        reg.pair.A = afterA;
+        reg.pair.A() = afterA;
         writeByte(hl, afterN);
-        setFlagS(reg.pair.A & 0x80);
-        setFlagXY(reg.pair.A);
-        setFlagZ(reg.pair.A == 0);
-        setFlagH(false);
-        setFlagPV(isEvenNumberBits(reg.pair.A));
-        setFlagN(false);
+        reg.pair.F() = (reg.pair.F() & flagC()) | z80FlagTable.szp[reg.pair.A()];
         consumeClock(2);
     }
 
@@ -5239,20 +5733,15 @@ class Z80
         unsigned char beforeN = readByte(hl);
         unsigned char nH = (beforeN & 0b11110000) >> 4;
         unsigned char nL = beforeN & 0b00001111;
-        unsigned char aH = (reg.pair.A & 0b11110000) >> 4;
-        unsigned char aL = reg.pair.A & 0b00001111;
-        unsigned char beforeA = reg.pair.A;
+        unsigned char aH = (reg.pair.A() & 0b11110000) >> 4;
+        unsigned char aL = reg.pair.A() & 0b00001111;
+        unsigned char beforeA = reg.pair.A();
         unsigned char afterA = (aH << 4) | nL;
         unsigned char afterN = (aL << 4) | nH;
         if (isDebug()) log("[%04X] RRD ... A: $%02X -> $%02X, ($%04X): $%02X -> $%02X", reg.PC - 2, beforeA, afterA, hl, beforeN, afterN);
-        reg.pair.A = afterA;
+        reg.pair.A() = afterA;
         writeByte(hl, afterN);
-        setFlagS(reg.pair.A & 0x80);
-        setFlagXY(reg.pair.A);
-        setFlagZ(reg.pair.A == 0);
-        setFlagH(false);
-        setFlagPV(isEvenNumberBits(reg.pair.A));
-        setFlagN(false);
+        reg.pair.F() = (reg.pair.F() & flagC()) | z80FlagTable.szp[reg.pair.A()];
         consumeClock(2);
     }
 
@@ -5327,7 +5816,7 @@ class Z80
         0, 2, 0, 2, 0, 2, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, // E0 ~ EF
         0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0  // F0 ~ FF
     };
-    void (*opSet1[256])(Z80* ctx) = {
+    static constexpr void (*opSet1[256])(Z80* ctx) = {
         NOP, LD_BC_NN, LD_BC_A, INC_RP_BC, INC_B, DEC_B, LD_B_N, RLCA, EX_AF_AF2, ADD_HL_BC, LD_A_BC, DEC_RP_BC, INC_C, DEC_C, LD_C_N, RRCA,
         DJNZ_E, LD_DE_NN, LD_DE_A, INC_RP_DE, INC_D, DEC_D, LD_D_N, RLA, JR_E, ADD_HL_DE, LD_A_DE, DEC_RP_DE, INC_E, DEC_E, LD_E_N, RRA,
         JR_NZ_E, LD_HL_NN, LD_ADDR_HL, INC_RP_HL, INC_H, DEC_H, LD_H_N, DAA, JR_Z_E, ADD_HL_HL, LD_HL_ADDR, DEC_RP_HL, INC_L, DEC_L, LD_L_N, CPL,
@@ -5344,7 +5833,7 @@ class Z80
         RET_C2, POP_DE, JP_C2_NN, OUT_N_A, CALL_C2_NN, PUSH_DE, SUB_N, RST10, RET_C3, EXX, JP_C3_NN, IN_A_N, CALL_C3_NN, OP_IX, SBC_N, RST18,
         RET_C4, POP_HL, JP_C4_NN, EX_SP_HL, CALL_C4_NN, PUSH_HL, AND_N, RST20, RET_C5, JP_HL, JP_C5_NN, EX_DE_HL, CALL_C5_NN, OP_ED, XOR_N, RST28,
         RET_C6, POP_AF, JP_C6_NN, DI, CALL_C6_NN, PUSH_AF, OR_N, RST30, RET_C7, LD_SP_HL, JP_C7_NN, EI, CALL_C7_NN, OP_IY, CP_N, RST38};
-    void (*opSetCB[256])(Z80* ctx) = {
+    static constexpr void (*opSetCB[256])(Z80* ctx) = {
         RLC_B, RLC_C, RLC_D, RLC_E, RLC_H, RLC_L, RLC_HL_, RLC_A,
         RRC_B, RRC_C, RRC_D, RRC_E, RRC_H, RRC_L, RRC_HL_, RRC_A,
         RL_B, RL_C, RL_D, RL_E, RL_H, RL_L, RL_HL_, RL_A,
@@ -5377,7 +5866,7 @@ class Z80
         SET_B_5, SET_C_5, SET_D_5, SET_E_5, SET_H_5, SET_L_5, SET_HL_5, SET_A_5,
         SET_B_6, SET_C_6, SET_D_6, SET_E_6, SET_H_6, SET_L_6, SET_HL_6, SET_A_6,
         SET_B_7, SET_C_7, SET_D_7, SET_E_7, SET_H_7, SET_L_7, SET_HL_7, SET_A_7};
-    void (*opSetED[256])(Z80* ctx) = {
+    static constexpr void (*opSetED[256])(Z80* ctx) = {
         IN0_B_N, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
         nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
         nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
@@ -5410,12 +5899,21 @@ class Z80
 /* D0 */
         nullptr, MULUB_A_D, nullptr, nullptr,     nullptr, nullptr, nullptr, nullptr, nullptr, MULUB_A_E, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
 /* E0 */
-        nullptr, nullptr,   nullptr, nullptr,     nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,   nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+        nullptr, nullptr,   nullptr, nullptr,     nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,   nullptr, nullptr, nullptr, TRAP_,   nullptr, nullptr,
 /* F0 */
         nullptr, nullptr,   nullptr, MULUW_HL_SP, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,   nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+#else
+/* C0 */
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+/* D0 */
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+/* E0 */
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, TRAP_,   nullptr, nullptr,
+/* F0 */
+        nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
 #endif
         };
-    void (*opSetIX[256])(Z80* ctx) = {
+    static constexpr void (*opSetIX[256])(Z80* ctx) = {
         nullptr, nullptr, nullptr, nullptr, INC_B_2, DEC_B_2, LD_B_N_3, nullptr,
         nullptr, ADD_IX_BC, nullptr, nullptr, INC_C_2, DEC_C_2, LD_C_N_3, nullptr,
         nullptr, nullptr, nullptr, nullptr, INC_D_2, DEC_D_2, LD_D_N_3, nullptr,
@@ -5448,7 +5946,7 @@ class Z80
         nullptr, JP_IX, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
         nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
         nullptr, LD_SP_IX_, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
-    void (*opSetIY[256])(Z80* ctx) = {
+    static constexpr void (*opSetIY[256])(Z80* ctx) = {
         nullptr, nullptr, nullptr, nullptr, INC_B_2, DEC_B_2, LD_B_N_3, nullptr,
         nullptr, ADD_IY_BC, nullptr, nullptr, INC_C_2, DEC_C_2, LD_C_N_3, nullptr,
         nullptr, nullptr, nullptr, nullptr, INC_D_2, DEC_D_2, LD_D_N_3, nullptr,
@@ -5481,7 +5979,7 @@ class Z80
         nullptr, JP_IY, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
         nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
         nullptr, LD_SP_IY_, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
-    void (*opSetIX4[256])(Z80* ctx, signed char d) = {
+    static constexpr void (*opSetIX4[256])(Z80* ctx, signed char d) = {
         RLC_IX_with_LD_B, RLC_IX_with_LD_C, RLC_IX_with_LD_D, RLC_IX_with_LD_E, RLC_IX_with_LD_H, RLC_IX_with_LD_L, RLC_IX_, RLC_IX_with_LD_A,
         RRC_IX_with_LD_B, RRC_IX_with_LD_C, RRC_IX_with_LD_D, RRC_IX_with_LD_E, RRC_IX_with_LD_H, RRC_IX_with_LD_L, RRC_IX_, RRC_IX_with_LD_A,
         RL_IX_with_LD_B, RL_IX_with_LD_C, RL_IX_with_LD_D, RL_IX_with_LD_E, RL_IX_with_LD_H, RL_IX_with_LD_L, RL_IX_, RL_IX_with_LD_A,
@@ -5514,7 +6012,7 @@ class Z80
         SET_IX_5_with_LD_B, SET_IX_5_with_LD_C, SET_IX_5_with_LD_D, SET_IX_5_with_LD_E, SET_IX_5_with_LD_H, SET_IX_5_with_LD_L, SET_IX_5, SET_IX_5_with_LD_A,
         SET_IX_6_with_LD_B, SET_IX_6_with_LD_C, SET_IX_6_with_LD_D, SET_IX_6_with_LD_E, SET_IX_6_with_LD_H, SET_IX_6_with_LD_L, SET_IX_6, SET_IX_6_with_LD_A,
         SET_IX_7_with_LD_B, SET_IX_7_with_LD_C, SET_IX_7_with_LD_D, SET_IX_7_with_LD_E, SET_IX_7_with_LD_H, SET_IX_7_with_LD_L, SET_IX_7, SET_IX_7_with_LD_A};
-    void (*opSetIY4[256])(Z80* ctx, signed char d) = {
+    static constexpr void (*opSetIY4[256])(Z80* ctx, signed char d) = {
         RLC_IY_with_LD_B, RLC_IY_with_LD_C, RLC_IY_with_LD_D, RLC_IY_with_LD_E, RLC_IY_with_LD_H, RLC_IY_with_LD_L, RLC_IY_, RLC_IY_with_LD_A,
         RRC_IY_with_LD_B, RRC_IY_with_LD_C, RRC_IY_with_LD_D, RRC_IY_with_LD_E, RRC_IY_with_LD_H, RRC_IY_with_LD_L, RRC_IY_, RRC_IY_with_LD_A,
         RL_IY_with_LD_B, RL_IY_with_LD_C, RL_IY_with_LD_D, RL_IY_with_LD_E, RL_IY_with_LD_H, RL_IY_with_LD_L, RL_IY_, RL_IY_with_LD_A,
@@ -5548,6 +6046,62 @@ class Z80
         SET_IY_6_with_LD_B, SET_IY_6_with_LD_C, SET_IY_6_with_LD_D, SET_IY_6_with_LD_E, SET_IY_6_with_LD_H, SET_IY_6_with_LD_L, SET_IY_6, SET_IY_6_with_LD_A,
         SET_IY_7_with_LD_B, SET_IY_7_with_LD_C, SET_IY_7_with_LD_D, SET_IY_7_with_LD_E, SET_IY_7_with_LD_H, SET_IY_7_with_LD_L, SET_IY_7, SET_IY_7_with_LD_A};
 
+#if Z80_THREADED_DISPATCH
+    // プレフィクス命令の2バイト目の分岐
+    // テーブルが空(nullptr)の命令は従来どおりテーブル経由で呼び出す
+#define Z80_DISPATCH_CASE(TABLE, N) \
+    case N: if constexpr (TABLE[N] != nullptr) { TABLE[N](this); return; } break;
+#define Z80_DISPATCH_CASE4(TABLE, N) \
+    case N: TABLE[N](this, d); return;
+#define Z80_DISPATCH_CASE_CB(N) Z80_DISPATCH_CASE(opSetCB, N)
+#define Z80_DISPATCH_CASE_ED(N) Z80_DISPATCH_CASE(opSetED, N)
+#define Z80_DISPATCH_CASE_IX(N) Z80_DISPATCH_CASE(opSetIX, N)
+#define Z80_DISPATCH_CASE_IY(N) Z80_DISPATCH_CASE(opSetIY, N)
+#define Z80_DISPATCH_CASE_IX4(N) Z80_DISPATCH_CASE4(opSetIX4, N)
+#define Z80_DISPATCH_CASE_IY4(N) Z80_DISPATCH_CASE4(opSetIY4, N)
+    inline void dispatchCB(unsigned char operandNumber)
+    {
+        switch (operandNumber) { Z80_REPEAT256(Z80_DISPATCH_CASE_CB) }
+        opSetCB[operandNumber](this);
+    }
+
+    inline void dispatchED(unsigned char operandNumber)
+    {
+        switch (operandNumber) { Z80_REPEAT256(Z80_DISPATCH_CASE_ED) }
+        opSetED[operandNumber](this);
+    }
+
+    inline void dispatchIX(unsigned char operandNumber)
+    {
+        switch (operandNumber) { Z80_REPEAT256(Z80_DISPATCH_CASE_IX) }
+        opSetIX[operandNumber](this);
+    }
+
+    inline void dispatchIY(unsigned char operandNumber)
+    {
+        switch (operandNumber) { Z80_REPEAT256(Z80_DISPATCH_CASE_IY) }
+        opSetIY[operandNumber](this);
+    }
+
+    inline void dispatchIX4(unsigned char operandNumber, signed char d)
+    {
+        switch (operandNumber) { Z80_REPEAT256(Z80_DISPATCH_CASE_IX4) }
+    }
+
+    inline void dispatchIY4(unsigned char operandNumber, signed char d)
+    {
+        switch (operandNumber) { Z80_REPEAT256(Z80_DISPATCH_CASE_IY4) }
+    }
+#undef Z80_DISPATCH_CASE_IY4
+#undef Z80_DISPATCH_CASE_IX4
+#undef Z80_DISPATCH_CASE_IY
+#undef Z80_DISPATCH_CASE_IX
+#undef Z80_DISPATCH_CASE_ED
+#undef Z80_DISPATCH_CASE_CB
+#undef Z80_DISPATCH_CASE4
+#undef Z80_DISPATCH_CASE
+#endif // Z80_THREADED_DISPATCH
+
     inline void checkInterrupt()
     {
         // Interrupt processing is not executed by the instruction immediately after executing EI.
@@ -5625,7 +6179,14 @@ class Z80
         bool returnPortAs16Bits = false)
     {
         this->CB.arg = arg;
+        this->CB.trap = nullptr;
+        this->CB.isIdlePort = nullptr;
+        this->CB.isIdleMemory = nullptr;
+#if Z80_PROFILE
+        this->profile = nullptr;
+#endif
         initialize();
+        resetMemoryPages();
         setupCallback(read, write, in, out, returnPortAs16Bits);
     }
 
@@ -5633,7 +6194,14 @@ class Z80
     Z80(void* arg)
     {
         this->CB.arg = arg;
+        this->CB.trap = nullptr;
+        this->CB.isIdlePort = nullptr;
+        this->CB.isIdleMemory = nullptr;
+#if Z80_PROFILE
+        this->profile = nullptr;
+#endif
         initialize();
+        resetMemoryPages();
     }
 
     void setupCallback(ReadFuncType read,
@@ -5695,15 +6263,30 @@ class Z80
         while(size-- > 0) { *d++ = c; }
     }
 
+    static inline int z80_memcmp(const void* a, const void* b, int size) noexcept {
+        auto l = (const unsigned char*)a;
+        auto r = (const unsigned char*)b;
+        for(; size > 0; --size, ++l, ++r) {
+            if(*l != *r) { return *l - *r; }
+        }
+        return 0;
+    }
+
     void initialize()
     {
         resetConsumeClockCallback();
         resetDebugMessage();
         z80_memset(&reg, 0, sizeof(reg));
-        reg.pair.A = 0xff;
-        reg.pair.F = 0xff;
+        reg.pair.A() = 0xff;
+        reg.pair.F() = 0xff;
         reg.SP = 0xffff;
         z80_memset(&wtc, 0, sizeof(wtc));
+#if Z80_IDLE_LOOP_FAST_FORWARD
+        resetIdleLoop();
+#endif
+#if Z80_TRACE
+        resetTrace();
+#endif
     }
 
     ~Z80()
@@ -5771,6 +6354,7 @@ class Z80
             if(it.addr == 0 && it.callback == nullptr) {
                 it.addr = addr;
                 it.callback = callback;
+                CB.breakPointCount++;
                 break;
             }
         }
@@ -5779,9 +6363,10 @@ class Z80
     void removeBreakPoint(unsigned short addr)
     {
         for(auto& it : CB.breakPoints) {
-            if(it.addr == addr) {
+            if(it.addr == addr && it.callback) {
                 it.addr = 0;
                 it.callback = nullptr;
+                CB.breakPointCount--;
                 break;
             }
         }
@@ -5793,6 +6378,7 @@ class Z80
             it.addr = 0;
             it.callback = nullptr;
         }
+        CB.breakPointCount = 0;
     }
 
     void addBreakOperand_(int prefixNumber, int operandNumber, const void(*callback)(void*, unsigned char*, int))
@@ -5932,6 +6518,7 @@ class Z80
 #endif
     }
 
+    // メモ）Z80_CONSUME_CLOCK_CALLBACKが0の時は、設定しても呼び出されない
     template <typename Functor>
     void setConsumeClockCallback(Functor consumeClock_)
     {
@@ -5951,11 +6538,144 @@ class Z80
         CB.consumeClockEnabled = false;
     }
 
+    /**
+     * メモリのページを設定する
+     * @param page  ページ番号(アドレスの上位8ビット)
+     * @param read  読み込み時に直接参照するページの先頭(nullptr:CB.readを使う)
+     * @param write 書き込み時に直接参照するページの先頭(nullptr:CB.writeを使う)
+     */
+    void setMemoryPage(int page, const unsigned char* read, unsigned char* write)
+    {
+        readPage[page & 0xFF] = read;
+        writePage[page & 0xFF] = write;
+    }
+
+    /**
+     * 全てのページをCB.read/CB.write経由に戻す
+     */
+    void resetMemoryPages()
+    {
+        for (int i = 0; i < 256; i++) {
+            readPage[i] = nullptr;
+            writePage[i] = nullptr;
+        }
+    }
+
+    /**
+     * トラップの結果
+     */
+    enum TrapResult {
+        TRAP_NONE = 0,  // トラップではない(NOPとして扱う)
+        TRAP_RETURN,    // 処理が終わったのでRETする
+        TRAP_WAIT,      // 処理が終わるまで同じアドレスで待つ
+    };
+
+    /**
+     * トラップ命令(ED ED)のコールバックを設定する
+     * トラップ命令のアドレスで呼び出され、TrapResultを返すこと。
+     */
+    void setTrapCallback(TrapFuncType trap)
+    {
+        CB.trap = trap;
+    }
+
+    /**
+     * アイドルループの検出で使う、読み込みの判定のコールバックを設定する
+     * ポート番号(またはアドレス)で呼び出される。次のイベントまで読み込む値が変わらず、
+     * 何度読み込んでも1回読み込んだのと同じ状態になるならtrueを返すこと。
+     * nullptrなら、IN命令(またはページテーブルにないメモリの読み込み)を含むループは読み飛ばさない。
+     */
+    void setIdleReadCallback(IdleReadFuncType isIdlePort, IdleReadFuncType isIdleMemory)
+    {
+        CB.isIdlePort = isIdlePort;
+        CB.isIdleMemory = isIdleMemory;
+    }
+
+    /**
+     * 検出したアイドルループの数を取得する
+     */
+    inline unsigned int getIdleLoopDetectCount() const
+    {
+#if Z80_IDLE_LOOP_FAST_FORWARD
+        return idleLoop.detectCount;
+#else
+        return 0;
+#endif
+    }
+
+    /**
+     * 読み飛ばしたアイドルループの回数を取得する
+     */
+    inline unsigned int getIdleLoopSkipCount() const
+    {
+#if Z80_IDLE_LOOP_FAST_FORWARD
+        return idleLoop.skipCount;
+#else
+        return 0;
+#endif
+    }
+
+#if Z80_TRACE
+    /**
+     * 実行トレースのリングバッファを取得する
+     * Z80_TRACE_SIZE個で、getTraceCount() % Z80_TRACE_SIZEの位置が一番古い(次に書き込む)記録。
+     */
+    inline const TraceEntry* getTraceBuffer() const { return trace.buffer; }
+
+    /**
+     * 実行トレースに記録した命令の数を取得する(Z80_TRACE_SIZEを超えた分は上書きされている)
+     */
+    inline unsigned int getTraceCount() const { return trace.count; }
+
+    /**
+     * 実行トレースを消去する
+     */
+    void resetTrace()
+    {
+        z80_memset(&trace, 0, sizeof(trace));
+    }
+
+#ifndef BUILD_WASM
+    /**
+     * 実行トレースを古い順にテキストで出力する
+     */
+    void dumpTrace(FILE* fp) const
+    {
+        const unsigned int count = trace.count < Z80_TRACE_SIZE ? trace.count : Z80_TRACE_SIZE;
+        for (unsigned int i = trace.count - count; i != trace.count; i++) {
+            const TraceEntry& e = trace.buffer[i & (Z80_TRACE_SIZE - 1)];
+            fprintf(fp, "%12llu %04X: %02X %02X %02X %02X  AF=%04X BC=%04X DE=%04X HL=%04X SP=%04X\n",
+                    e.clock, e.PC, e.opcode[0], e.opcode[1], e.opcode[2], e.opcode[3],
+                    e.AF, e.BC, e.DE, e.HL, e.SP);
+        }
+    }
+#endif
+#endif // Z80_TRACE
+
+#if Z80_PROFILE
+    /**
+     * プロファイルの集計先のテーブルを設定する
+     * PCをインデックスにした0x10000個のテーブルで、実行する度に加算する。
+     * nullptrなら集計しない。
+     */
+    void setProfileBuffer(ProfileEntry* buffer)
+    {
+        profile = buffer;
+    }
+#endif
+
     void requestBreak()
     {
         requestBreakFlag = true;
     }
 
+    // 次の命令の前に受け付ける割り込みがあるかどうか(checkInterrupt()と同じ条件)
+    inline bool isInterruptPending()
+    {
+        if ((reg.interrupt & 0b10000000) && !(reg.IFF & IFF_NMI())) return true;
+        return (reg.interrupt & 0b01000000) && (reg.IFF & IFF1());
+    }
+
     void generateIRQ(const unsigned char vector)
     {
         reg.interrupt |= 0b01000000;
@@ -5973,6 +6693,8 @@ class Z80
         reg.interruptAddrN = addr;
     }
 
+    // メモ）命令コードのキャッシュやプリデコードはしない。
+    //       PC毎に引く手間と、書き込みの度にページを無効化する手間の方が、省けるメモリの読み込みより高くつく
     inline unsigned char fetch(int clocks)
     {
         unsigned char result = readByte(reg.PC, clocks);
@@ -5981,35 +6703,103 @@ class Z80
     }
 
     int executed;
+    int executeClock; // execute()に指定されたクロック
     inline int getExecutedClock() const noexcept { return executed; }
+    // execute()の開始から消費したクロックを取得する
+    //   execute()の中(コールバックの中)では、実行中の命令がそこまでに消費したクロックも含む。
+    //   execute()から戻った後は、最後に受け付けた割り込みの分も含む(戻り値には含まれない)。
+    //   Z80_CONSUME_CLOCK_CALLBACKが0の時は、コールバックで合計する代わりにこれを使う。
+    inline int getConsumedClock() const noexcept { return executed + reg.consumeClockCounter; }
     inline int execute(int clock)
     {
         executed = 0;
+        executeClock = clock;
         requestBreakFlag = false;
         reg.consumeClockCounter = 0;
+#if Z80_IDLE_LOOP_FAST_FORWARD
+        // 前回の実行から周辺機器の状態が変わっているかもしれないので
+        idleLoop.valid = false;
+#endif
+#if Z80_THREADED_DISPATCH && Z80_COMPUTED_GOTO
+#define Z80_OP_LABEL_ADDRESS(N) &&op_##N,
+        static void* const opLabels[256] = { Z80_REPEAT256(Z80_OP_LABEL_ADDRESS) };
+#undef Z80_OP_LABEL_ADDRESS
+#endif
         while (0 < clock && !requestBreakFlag) {
+#if Z80_IDLE_LOOP_FAST_FORWARD || Z80_PROFILE
+            const unsigned short pc = reg.PC;
+#endif
             // execute NOP while halt
             if (reg.IFF & IFF_HALT()) {
                 reg.execEI = 0;
+#if Z80_HALT_FAST_FORWARD
+                // 割り込みが確認済み(最初のループ以外)で、読み込みに副作用がなければ、
+                // HALTが解除されることはないので、クロックを使い切るまで一気に進める。
+                // メモ）次の割り込みの発生源のイベントまでのクロックが指定されている
+                if (executed && readPage[reg.PC >> 8]) {
+                    const int cycle = 4 + waitRead();
+                    const int hz = (clock + cycle - 1) / cycle * cycle;
+#if Z80_CONSUME_CLOCK_CALLBACK
+                    if (CB.consumeClockEnabled) CB.consumeClock(CB.arg, hz);
+#endif
+#if Z80_PROFILE
+                    addProfile(pc, hz, hz / cycle);
+#endif
+                    executed += hz;
+                    clock -= hz;
+                    continue;
+                }
+#endif
                 readByte(reg.PC); // NOTE: read and discard (to be consumed 4Hz)
             } else {
-                if (wtc.fetch) consumeClock(wtc.fetch);
+                if (waitFetch()) consumeClock(waitFetch());
                 checkBreakPoint();
                 if(requestBreakFlag) {
                     // ブレイク中...
                     break;
                 }
+#if Z80_TRACE
+                addTrace();
+#endif
                 reg.execEI = 0;
                 int operandNumber = fetch(2);
                 updateRefreshRegister();
                 checkBreakOperand(operandNumber);
+#if Z80_THREADED_DISPATCH
+#if Z80_COMPUTED_GOTO
+                goto *opLabels[operandNumber];
+#define Z80_OP_EXECUTE(N) op_##N: opSet1[N](this); goto dispatched;
+                Z80_REPEAT256(Z80_OP_EXECUTE)
+#undef Z80_OP_EXECUTE
+#else
+#define Z80_OP_EXECUTE(N) case N: opSet1[N](this); break;
+                switch (operandNumber) { Z80_REPEAT256(Z80_OP_EXECUTE) }
+#undef Z80_OP_EXECUTE
+#endif
+#else
                 opSet1[operandNumber](this);
+#endif
             }
+#if Z80_THREADED_DISPATCH && Z80_COMPUTED_GOTO
+        dispatched:
+#endif
+#if Z80_PROFILE
+            addProfile(pc, reg.consumeClockCounter, 1);
+#endif
             executed += reg.consumeClockCounter;
-            clock -= reg.consumeClockCounter;
+            // ブロック命令の一括実行でexecutedに加算した分も含めて、残りのクロックを求める
+            clock = executeClock - executed;
             reg.consumeClockCounter = 0;
             checkInterrupt();
+#if Z80_IDLE_LOOP_FAST_FORWARD
+            if ((unsigned short)(pc - reg.PC) < IDLE_LOOP_MAX_BYTES) {
+                checkIdleLoop(clock);
+            }
+#endif
         }
+#if Z80_TRACE
+        trace.clock += executed;
+#endif
         return executed;
     }
 
@@ -6028,14 +6818,14 @@ class Z80
         if (isDebug()) log("===== REGISTER DUMP : START =====");
         if (isDebug()) log("PAIR: %s %s %s %s %s %s %s", registerDump(0b111), registerDump(0b000), registerDump(0b001), registerDump(0b010), registerDump(0b011), registerDump(0b100), registerDump(0b101));
         if (isDebug()) log("PAIR: F<$%02X> ... S:%s, Z:%s, H:%s, P/V:%s, N:%s, C:%s",
-                           reg.pair.F,
+                           reg.pair.F(),
                            isFlagS() ? "ON" : "OFF",
                            isFlagZ() ? "ON" : "OFF",
                            isFlagH() ? "ON" : "OFF",
                            isFlagPV() ? "ON" : "OFF",
                            isFlagN() ? "ON" : "OFF",
                            isFlagC() ? "ON" : "OFF");
-        if (isDebug()) log("BACK: %s %s %s %s %s %s %s F'<$%02X>", registerDump2(0b111), registerDump2(0b000), registerDump2(0b001), registerDump2(0b010), registerDump2(0b011), registerDump2(0b100), registerDump2(0b101), reg.back.F);
+        if (isDebug()) log("BACK: %s %s %s %s %s %s %s F'<$%02X>", registerDump2(0b111), registerDump2(0b000), registerDump2(0b001), registerDump2(0b010), registerDump2(0b011), registerDump2(0b100), registerDump2(0b101), reg.back.F());
         if (isDebug()) log("PC<$%04X> SP<$%04X> IX<$%04X> IY<$%04X>", reg.PC, reg.SP, reg.IX, reg.IY);
         if (isDebug()) log("R<$%02X> I<$%02X> IFF<$%02X>", reg.R, reg.I, reg.IFF);
         if (isDebug()) log("isHalt: %s, interrupt: $%02X", reg.IFF & IFF_HALT() ? "YES" : "NO", reg.interrupt);
@@ -0,0 +1,203 @@
+﻿#include "../src/cat/low/catLowBasicTypes.h"
+#include "../src/z80/z80.hpp"
+#include "../src/sos.h"
+#include "../src/sosMachine.h"
+#include "../src/platform/catPlatformFactory.h"
+#include "../src/disk/catDiskImage.h"
+#include "../src/disk/catFileIndex.h"
+
+#include <stdio.h>
+#include <vector>
+
+/**
+ * @brief FATが壊れているファイルの#ROPEN、#RDDのテスト
+ *
+ * 2Dの生イメージをメモリ上に作ってネイティブでマウントし、#ROPEN、#RDDを呼び出すプログラムを実行する。
+ *   SHORT  FATの繋がりがファイルのサイズより先に終わっている → Bad allocation table(7)
+ *   CYCLE  FATの繋がりが輪になっている → SOS.jsの#dos_dload()と同じく、サイズの分だけ繋がりをたどって読み込む
+ */
+namespace {
+	constexpr s32 FRAMES = 10;
+	constexpr s32 CLOCK = 4000000 / 60;
+
+	/**
+	 * @brief 2Dのディレクトリ、FATのレコード(S-OSのワークの初期値)
+	 */
+	constexpr u32 DIRPS = 16;
+	constexpr u32 FATPOS = 14;
+	constexpr u32 CLUSTER_SIZE = 16 * disk::RECORD_SIZE;
+
+	constexpr u16 ADDRESS_PROGRAM = 0x3000;
+	constexpr u16 ADDRESS_RESULT = 0x6000;
+	constexpr u16 ADDRESS_LOAD = 0x8000;
+
+	constexpr u8 BAD_ALLOCATION_TABLE = 7;
+
+	/**
+	 * @brief テストするファイル
+	 */
+	struct TestFile {
+		const char* name;	// ファイル名(拡張子なし)
+		u8 cluster;			// 開始クラスタ
+		u16 size;			// ファイルサイズ
+		u8 error;			// #RDDのエラーコード(0:正常)
+	};
+	constexpr TestFile FILES[] = {
+		{ "SHORT", 0x04, 0x2000, BAD_ALLOCATION_TABLE },
+		{ "CYCLE", 0x02, 0x5000, 0 },
+	};
+	/**
+	 * @brief CYCLEで読み込まれるクラスタ(2→3→2→…)
+	 */
+	constexpr u8 CYCLE_CLUSTERS[] = { 0x02, 0x03, 0x02, 0x03, 0x02 };
+
+	/**
+	 * @brief クラスタの内容(どのクラスタか分かるように)
+	 */
+	u8 getClusterData(const u32 cluster, const u32 offset) { return (u8)(cluster * 0x31 + offset + (offset >> 8)); }
+
+	/**
+	 * @brief ファイル名をS-OSの形式(名前13文字(0x0Dで終わり、空白で埋める)、拡張子3文字)にする
+	 */
+	void makeName(u8* dst, const char* name)
+	{
+		u32 i = 0;
+		for(; name[i]; ++i) { dst[i] = (u8)name[i]; }
+		dst[i++] = 0x0D;
+		for(; i < 13; ++i) { dst[i] = ' '; }
+		dst[13] = 'B'; dst[14] = 'I'; dst[15] = 'N';
+	}
+
+	/**
+	 * @brief ディスクイメージを作る
+	 */
+	std::vector<u8> makeDisk()
+	{
+		std::vector<u8> image(disk::RAW_2D_SIZE, 0);
+		u8* fat = &image[FATPOS * disk::RECORD_SIZE];
+		fat[0x00] = 0x01;
+		fat[0x01] = 0x8F;
+		fat[0x02] = 0x03;
+		fat[0x03] = 0x02;	// 輪になっている
+		fat[0x04] = 0x80;	// 1レコードで終わり
+		for(u32 cluster = 0x02; cluster <= 0x04; ++cluster) {
+			for(u32 i = 0; i < CLUSTER_SIZE; ++i) {
+				image[cluster * CLUSTER_SIZE + i] = getClusterData(cluster, i);
+			}
+		}
+		u8* entry = &image[DIRPS * disk::RECORD_SIZE];
+		for(const auto& it : FILES) {
+			entry[0x00] = 0x01;	// バイナリ
+			makeName(&entry[0x01], it.name);
+			entry[0x12] = (u8)it.size;
+			entry[0x13] = (u8)(it.size >> 8);
+			entry[0x15] = (u8)(ADDRESS_LOAD >> 8);
+			entry[0x17] = (u8)(ADDRESS_LOAD >> 8);
+			entry[0x1E] = it.cluster;
+			entry += disk::CatFileIndex::ENTRY_SIZE;
+		}
+		entry[0x00] = 0xFF;	// 終わり
+		return image;
+	}
+
+	/**
+	 * @brief Z80のプログラムを作る
+	 */
+	class Program {
+	public:
+		std::vector<u8> code;
+
+		void byte(const u8 value) { code.push_back(value); }
+		void word(const u16 value) { byte((u8)value); byte((u8)(value >> 8)); }
+		void loadA(const u8 value, const u16 address) { byte(0x3E); byte(value); byte(0x32); word(address); }		// LD A,n / LD (nn),A
+		void loadHL(const u16 value, const u16 address) { byte(0x21); word(value); byte(0x22); word(address); }	// LD HL,nn / LD (nn),HL
+		void call(const u16 address) { byte(0xCD); word(address); }
+		void storeAF(const u16 address) { byte(0xF5); byte(0xC1); byte(0xED); byte(0x43); word(address); }		// PUSH AF / POP BC / LD (nn),BC
+		/**
+		 * @brief ファイル名をIBバッファにコピーする(LD HL,nn / LD DE,(#IBFAD) / INC DE / LD BC,16 / LDIR)
+		 * @return ファイル名のアドレスを書き込む位置
+		 */
+		size_t copyName()
+		{
+			byte(0x21);
+			const size_t position = code.size();
+			word(0);
+			byte(0xED); byte(0x5B); word(WorkAddress::IBFAD);
+			byte(0x13);
+			byte(0x01); word(disk::CatFileIndex::NAME_SIZE);
+			byte(0xED); byte(0xB0);
+			return position;
+		}
+	};
+
+	std::vector<u8> makeProgram()
+	{
+		constexpr u16 ROPEN = 0x2009;
+		constexpr u16 RDD = 0x1FA6;
+		Program program;
+		program.loadA('A', WorkAddress::DSK);
+		program.loadA(0x01, WorkAddress::FTYPE);
+		size_t positions[sizeof(FILES) / sizeof(FILES[0])];
+		u16 result = ADDRESS_RESULT;
+		for(size_t i = 0; i < sizeof(FILES) / sizeof(FILES[0]); ++i) {
+			positions[i] = program.copyName();
+			program.call(ROPEN);
+			program.storeAF(result);
+			program.loadHL(ADDRESS_LOAD, WorkAddress::DTADR);
+			program.call(RDD);
+			program.storeAF(result + 2);
+			result += 4;
+		}
+		program.byte(0x18); program.byte(0xFE);	// JR $
+		for(size_t i = 0; i < sizeof(FILES) / sizeof(FILES[0]); ++i) {
+			const u16 address = (u16)(ADDRESS_PROGRAM + program.code.size());
+			program.code[positions[i]] = (u8)address;
+			program.code[positions[i] + 1] = (u8)(address >> 8);
+			program.code.resize(program.code.size() + disk::CatFileIndex::NAME_SIZE);
+			makeName(&program.code[program.code.size() - disk::CatFileIndex::NAME_SIZE], FILES[i].name);
+		}
+		return program.code;
+	}
+} // namespace
+
+int
+main()
+{
+	SOS_Machine machine((s32)CatPlatformFactory::PlatformID::X1);
+	const std::vector<u8> image = makeDisk();
+	if(!machine.isValid() || !machine.mountDisk(0, image.data(), (u32)image.size())) {
+		fprintf(stderr, "cannot mount the disk image\n");
+		return 1;
+	}
+	const std::vector<u8> program = makeProgram();
+	u8* ram = machine.getRAM();
+	for(size_t i = 0; i < program.size(); ++i) {
+		ram[ADDRESS_PROGRAM + i] = program[i];
+	}
+	for(u32 i = 0; i < 0x10; ++i) {
+		ram[ADDRESS_RESULT + i] = 0xEE;
+	}
+	machine.getZ80Regs()->PC = ADDRESS_PROGRAM;
+	for(s32 frame = 0; frame < FRAMES; ++frame) {
+		machine.execute(-1);
+		machine.execute(CLOCK);
+	}
+	s32 failed = 0;
+	for(size_t i = 0; i < sizeof(FILES) / sizeof(FILES[0]); ++i) {
+		const u8* result = &ram[ADDRESS_RESULT + i * 4];
+		const bool opened = result[1] == 0 && !(result[0] & 0x01);
+		const u8 error = (result[2] & 0x01) ? result[3] : 0;
+		bool ok = opened && error == FILES[i].error;
+		if(ok && !FILES[i].error) {
+			// 読み込んだ内容が、SOS.jsでたどるクラスタの順番と同じか(正常に読めるのはCYCLEだけ)
+			for(u32 j = 0; ok && j < FILES[i].size; ++j) {
+				ok = ram[ADDRESS_LOAD + j] == getClusterData(CYCLE_CLUSTERS[j / CLUSTER_SIZE], j % CLUSTER_SIZE);
+			}
+		}
+		printf("%-5s: ropen %02X rdd %02X %s\n", FILES[i].name, result[1], error, ok ? "ok" : "NG");
+		if(!ok) {
+			failed++;
+		}
+	}
+	return failed ? 1 : 0;
+}
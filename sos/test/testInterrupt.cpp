@@ -0,0 +1,88 @@
+﻿#include "../src/cat/low/catLowBasicTypes.h"
+#include "../src/z80/z80.hpp"
+#include "../src/sos.h"
+#include "../src/sosMachine.h"
+#include "../src/platform/catPlatformFactory.h"
+#include "../bench/benchUtil.h"
+
+#include <stdio.h>
+
+/**
+ * @brief ホスト側のフックを待っている間の割り込みのテスト
+ *
+ * test/testCTC.binは、CTCの割り込み(約31Hz)で#GADDを1つずつ進めて、S-OSの#HOTに戻る。
+ * #HOTはホスト側のフックなので、CPUはSOS_STATUS_WAIT_HOSTで止まっている。
+ * その間も割り込み処理が最後まで実行されて、#GADDが進むことを確認する。
+ * resumeFromHost()を呼ばない時(以前のSOSBench、SOSBatch)と、1フレームに1回呼ぶ時(js/z80Emu.js)の両方で確認する。
+ */
+namespace {
+	using namespace bench;
+
+	constexpr s32 FRAME_RATE = 60;
+	constexpr s32 CLOCK = 4000000;
+	constexpr s32 FRAMES = FRAME_RATE * 2;
+	/**
+	 * @brief 割り込み処理が書き換えるアドレス(test/testCTC.lstのGADD)
+	 */
+	constexpr u16 ADDRESS_GADD = 0x80F8;
+	constexpr u16 GADD_START = 0x4000;
+	/**
+	 * @brief 2秒で受け付ける割り込みの最小の数(CTCは約31Hzなので、余裕を見ておく)
+	 */
+	constexpr u32 MIN_INTERRUPTS = 50;
+
+	/**
+	 * @brief 割り込み処理を実行した回数を数える
+	 * @param[in]	path		test/testCTC.bin
+	 * @param[in]	resume		1フレームに1回resumeFromHost()を呼ぶかどうか
+	 * @param[out]	interrupts	割り込み処理を実行した回数
+	 * @return 実行できたらtrue
+	 */
+	bool countInterrupts(const char* path, const bool resume, u32& interrupts)
+	{
+		SOS_Machine machine((s32)CatPlatformFactory::PlatformID::X1);
+		if(!machine.isValid() || !loadProgram(path, 0x8000, machine)) {
+			return false;
+		}
+		bool waited = false;
+		for(s32 frame = 0; frame < FRAMES; ++frame) {
+			machine.execute(-1);
+			if(resume && machine.getStatus() == SOS_STATUS_WAIT_HOST) {
+				machine.resumeFromHost();
+			}
+			machine.execute(CLOCK / FRAME_RATE);
+			waited |= machine.getStatus() == SOS_STATUS_WAIT_HOST;
+		}
+		if(!waited) {
+			// #HOTで待っていないので、テストになっていない
+			fprintf(stderr, "never waited for the host\n");
+			return false;
+		}
+		const u8* ram = machine.getRAM();
+		interrupts = (u32)(ram[ADDRESS_GADD] | (ram[ADDRESS_GADD + 1] << 8)) - GADD_START;
+		return true;
+	}
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+	if(argc < 2) {
+		fprintf(stderr, "usage: SOSTestInterrupt testCTC.bin\n");
+		return 1;
+	}
+	s32 failed = 0;
+	for(const bool resume : { false, true }) {
+		u32 interrupts = 0;
+		if(!countInterrupts(argv[1], resume, interrupts)) {
+			fprintf(stderr, "cannot run %s\n", argv[1]);
+			return 1;
+		}
+		const bool ok = MIN_INTERRUPTS <= interrupts;
+		printf("resume %-3s: %u interrupts in %d frames %s\n", resume ? "on" : "off", interrupts, FRAMES, ok ? "ok" : "NG");
+		if(!ok) {
+			failed++;
+		}
+	}
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,424 @@
+﻿#include "../src/cat/low/catLowBasicTypes.h"
+#include "../src/z80/z80.hpp"
+
+#include <stdio.h>
+
+/**
+ * @brief Z80のフラグの計算表(Z80FlagTable)のテスト
+ *
+ * 表を引いて作ったフラグが、表を使う前のフラグを1ビットずつ設定する計算と同じになることを、全ての入力で確認する。
+ * 命令を1つずつZ80で実行して、その後のFを、ここに残しておいた以前の計算(Reference)と比べる。
+ * ・8ビットの算術／論理演算(ADD, ADC, SUB, SBC, AND, XOR, OR, CP)は、A x 値 x 実行前のF
+ * ・INC, DEC, NEG, DAA, RLCA, RRCA, RLA, RRA, ローテート／シフト(CB), IN r,(C)は、値 x 実行前のF
+ * ・RLD, RRDは、A x (HL) x 実行前のF
+ */
+namespace {
+	constexpr unsigned char FLAG_S  = 0b10000000;
+	constexpr unsigned char FLAG_Z  = 0b01000000;
+	constexpr unsigned char FLAG_Y  = 0b00100000;
+	constexpr unsigned char FLAG_H  = 0b00010000;
+	constexpr unsigned char FLAG_X  = 0b00001000;
+	constexpr unsigned char FLAG_PV = 0b00000100;
+	constexpr unsigned char FLAG_N  = 0b00000010;
+	constexpr unsigned char FLAG_C  = 0b00000001;
+
+	/**
+	 * @brief 表を使う前のフラグの計算(z80.hppから、そのまま残しておいたもの)
+	 */
+	struct Reference {
+		unsigned char A;
+		unsigned char F;
+
+		void setFlag(const unsigned char flag, const bool on) { on ? F |= flag : F &= ~flag; }
+		void setFlagS(bool on) { setFlag(FLAG_S, on); }
+		void setFlagZ(bool on) { setFlag(FLAG_Z, on); }
+		void setFlagH(bool on) { setFlag(FLAG_H, on); }
+		void setFlagPV(bool on) { setFlag(FLAG_PV, on); }
+		void setFlagN(bool on) { setFlag(FLAG_N, on); }
+		void setFlagC(bool on) { setFlag(FLAG_C, on); }
+		void setFlagXY(unsigned char value)
+		{
+			setFlag(FLAG_X, value & FLAG_X);
+			setFlag(FLAG_Y, value & FLAG_Y);
+		}
+		bool isFlagC() const { return F & FLAG_C; }
+		bool isFlagH() const { return F & FLAG_H; }
+		bool isFlagN() const { return F & FLAG_N; }
+
+		static bool isEvenNumberBits(unsigned char value)
+		{
+			int on = 0;
+			int off = 0;
+			value & 0b10000000 ? on++ : off++;
+			value & 0b01000000 ? on++ : off++;
+			value & 0b00100000 ? on++ : off++;
+			value & 0b00010000 ? on++ : off++;
+			value & 0b00001000 ? on++ : off++;
+			value & 0b00000100 ? on++ : off++;
+			value & 0b00000010 ? on++ : off++;
+			value & 0b00000001 ? on++ : off++;
+			return (on & 1) == 0;
+		}
+
+		void setFlagByRotate(unsigned char n, bool carry, bool isA = false)
+		{
+			setFlagC(carry);
+			setFlagH(false);
+			setFlagN(false);
+			setFlagXY(n);
+			if (!isA) {
+				setFlagS(n & 0x80);
+				setFlagZ(0 == n);
+				setFlagPV(isEvenNumberBits(n));
+			}
+		}
+
+		void arithmetic8(bool negative, int addition, int carry, bool setCarry, bool setResult)
+		{
+			int before = A;
+			int result = before + (negative ? -addition - carry : addition + carry);
+			int carryX = before ^ addition ^ result;
+			unsigned char finalResult = result & 0xFF;
+			setFlagZ(0 == finalResult);
+			setFlagN(negative);
+			setFlagS(0x80 & finalResult);
+			setFlagH(carryX & 0x10);
+			setFlagPV(((carryX << 1) ^ carryX) & 0x100);
+			if (setCarry) setFlagC(carryX & 0x100);
+			if (setResult) {
+				A = finalResult;
+				setFlagXY(A);
+			} else {
+				setFlagXY(addition);
+			}
+		}
+
+		void setFlagByIncrement(unsigned char before)
+		{
+			unsigned char finalResult = before + 1;
+			setFlagN(false);
+			setFlagZ(0 == finalResult);
+			setFlagS(0x80 & finalResult);
+			setFlagH((finalResult & 0x0F) == 0x00);
+			setFlagPV(finalResult == 0x80);
+			setFlagXY(finalResult);
+		}
+
+		void setFlagByDecrement(unsigned char before)
+		{
+			unsigned char finalResult = before - 1;
+			setFlagN(true);
+			setFlagZ(0 == finalResult);
+			setFlagS(0x80 & finalResult);
+			setFlagH((finalResult & 0x0F) == 0x0F);
+			setFlagPV(finalResult == 0x7F);
+			setFlagXY(finalResult);
+		}
+
+		void setFlagByLogical(bool h)
+		{
+			setFlagS(A & 0x80);
+			setFlagZ(A == 0);
+			setFlagXY(A);
+			setFlagH(h);
+			setFlagPV(isEvenNumberBits(A));
+			setFlagN(false);
+			setFlagC(false);
+		}
+
+		void daa()
+		{
+			int a = A;
+			bool c = isFlagC();
+			bool ac = A > 0x99;
+			int add = (isFlagH() || (a & 0x0F) > 9 ? 0x06 : 0x00) + (c || ac ? 0x60 : 0x00);
+			a += isFlagN() ? -add : add;
+			a &= 0xFF;
+			setFlagS(a & 0x80);
+			setFlagXY(a);
+			setFlagZ(0 == a);
+			setFlagH((a ^ A) & FLAG_H);
+			setFlagPV(isEvenNumberBits(a));
+			setFlagC(c | ac);
+			A = a;
+		}
+
+		// RLD, RRD, IN r,(C)
+		void setFlagByDigit(unsigned char n)
+		{
+			setFlagS(n & 0x80);
+			setFlagXY(n);
+			setFlagZ(n == 0);
+			setFlagH(false);
+			setFlagPV(isEvenNumberBits(n));
+			setFlagN(false);
+		}
+	};
+
+	/**
+	 * @brief 1命令だけ実行するZ80
+	 */
+	struct Machine {
+		unsigned char memory[0x10000];
+		unsigned char input;
+		Z80 z80;
+
+		static unsigned char readByte(void* arg, unsigned short addr) { return ((Machine*)arg)->memory[addr]; }
+		static void writeByte(void* arg, unsigned short addr, unsigned char value) { ((Machine*)arg)->memory[addr] = value; }
+		static unsigned char inPort(void* arg, unsigned short port) { return ((Machine*)arg)->input; }
+		static void outPort(void* arg, unsigned short port, unsigned char value) {}
+
+		Machine() : memory(), input(0), z80(readByte, writeByte, inPort, outPort, this) {}
+
+		/**
+		 * @brief 0番地に命令を置く
+		 */
+		void setCode(const unsigned char op0, const int op1 = -1)
+		{
+			memory[0] = op0;
+			memory[1] = (unsigned char)op1;
+		}
+		/**
+		 * @brief 命令を1つ実行する
+		 */
+		void step()
+		{
+			z80.reg.PC = 0;
+			z80.execute(1);
+		}
+	};
+
+	/**
+	 * @brief 比べた結果
+	 */
+	struct Result {
+		const char* name;
+		unsigned long long cases = 0;
+		unsigned long long failed = 0;
+
+		void check(const unsigned char expectedA, const unsigned char expectedF, const Machine& m, const int a, const int n, const int f)
+		{
+			cases++;
+			if(m.z80.reg.pair.F() == expectedF && m.z80.reg.pair.A() == expectedA) {
+				return;
+			}
+			if(failed++ < 8) {
+				fprintf(stderr, "%s: A=%02X n=%02X F=%02X -> A=%02X F=%02X (expected A=%02X F=%02X)\n", name, a, n, f, m.z80.reg.pair.A(), m.z80.reg.pair.F(), expectedA, expectedF);
+			}
+		}
+	};
+
+	/**
+	 * @brief 8ビットの算術／論理演算(ADD A,B ～ CP B)
+	 */
+	Result testALU(Machine& m, const unsigned char op, const char* name)
+	{
+		Result result{ name };
+		m.setCode(op);
+		for(int a = 0; a < 256; ++a) {
+			for(int n = 0; n < 256; ++n) {
+				for(int f = 0; f < 256; ++f) {
+					Reference ref{ (unsigned char)a, (unsigned char)f };
+					const int c = ref.isFlagC() ? 1 : 0;
+					switch(op) {
+						case 0x80: ref.arithmetic8(false, n, 0, true, true); break;	// ADD
+						case 0x88: ref.arithmetic8(false, n, c, true, true); break;	// ADC
+						case 0x90: ref.arithmetic8(true,  n, 0, true, true); break;	// SUB
+						case 0x98: ref.arithmetic8(true,  n, c, true, true); break;	// SBC
+						case 0xA0: ref.A &= n; ref.setFlagByLogical(true);  break;	// AND
+						case 0xA8: ref.A ^= n; ref.setFlagByLogical(false); break;	// XOR
+						case 0xB0: ref.A |= n; ref.setFlagByLogical(false); break;	// OR
+						case 0xB8: ref.arithmetic8(true, n, 0, true, false); break;	// CP
+					}
+					m.z80.reg.pair.A() = (unsigned char)a;
+					m.z80.reg.pair.B() = (unsigned char)n;
+					m.z80.reg.pair.F() = (unsigned char)f;
+					m.step();
+					result.check(ref.A, ref.F, m, a, n, f);
+				}
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * @brief Aだけを使う命令(INC A, DEC A, NEG, DAA, RLCA, RRCA, RLA, RRA)
+	 */
+	Result testAccumulator(Machine& m, const unsigned char op0, const int op1, const char* name)
+	{
+		Result result{ name };
+		m.setCode(op0, op1);
+		for(int a = 0; a < 256; ++a) {
+			for(int f = 0; f < 256; ++f) {
+				Reference ref{ (unsigned char)a, (unsigned char)f };
+				const bool c = ref.isFlagC();
+				switch(op0) {
+					case 0x3C: ref.setFlagByIncrement(ref.A); ref.A++; break;
+					case 0x3D: ref.setFlagByDecrement(ref.A); ref.A--; break;
+					case 0xED: ref.A = 0; ref.arithmetic8(true, a, 0, true, true); break;	// NEG
+					case 0x27: ref.daa(); break;
+					case 0x07: ref.A = (unsigned char)((a << 1) | (a >> 7)); ref.setFlagByRotate(ref.A, a & 0x80, true); break;	// RLCA
+					case 0x0F: ref.A = (unsigned char)((a >> 1) | (a << 7)); ref.setFlagByRotate(ref.A, a & 0x01, true); break;	// RRCA
+					case 0x17: ref.A = (unsigned char)((a << 1) | (c ? 1 : 0)); ref.setFlagByRotate(ref.A, a & 0x80, true); break;	// RLA
+					case 0x1F: ref.A = (unsigned char)((a >> 1) | (c ? 0x80 : 0)); ref.setFlagByRotate(ref.A, a & 0x01, true); break;	// RRA
+				}
+				m.z80.reg.pair.A() = (unsigned char)a;
+				m.z80.reg.pair.F() = (unsigned char)f;
+				m.step();
+				result.check(ref.A, ref.F, m, a, 0, f);
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * @brief ローテート／シフト(CB 00+x*8 : RLC B ～ SRL B)
+	 */
+	Result testRotate(Machine& m, const int x, const char* name)
+	{
+		Result result{ name };
+		m.setCode(0xCB, x * 8);
+		for(int n = 0; n < 256; ++n) {
+			for(int f = 0; f < 256; ++f) {
+				Reference ref{ 0, (unsigned char)f };
+				const bool c = ref.isFlagC();
+				unsigned char r = 0;
+				bool carry = false;
+				switch(x) {
+					case 0: r = (unsigned char)((n << 1) | (n >> 7)); carry = n & 0x80; break;		// RLC
+					case 1: r = (unsigned char)((n >> 1) | (n << 7)); carry = n & 0x01; break;		// RRC
+					case 2: r = (unsigned char)((n << 1) | (c ? 1 : 0)); carry = n & 0x80; break;	// RL
+					case 3: r = (unsigned char)((n >> 1) | (c ? 0x80 : 0)); carry = n & 0x01; break;	// RR
+					case 4: r = (unsigned char)(n << 1); carry = n & 0x80; break;					// SLA
+					case 5: r = (unsigned char)((n >> 1) | (n & 0x80)); carry = n & 0x01; break;	// SRA
+					case 6: r = (unsigned char)((n << 1) | 1); carry = n & 0x80; break;				// SLL
+					case 7: r = (unsigned char)(n >> 1); carry = n & 0x01; break;					// SRL
+				}
+				ref.setFlagByRotate(r, carry);
+				m.z80.reg.pair.A() = 0;
+				m.z80.reg.pair.B() = (unsigned char)n;
+				m.z80.reg.pair.F() = (unsigned char)f;
+				m.step();
+				result.check(0, ref.F, m, 0, n, f);
+				if(m.z80.reg.pair.B() != r && result.failed++ < 8) {
+					fprintf(stderr, "%s: B=%02X -> %02X (expected %02X)\n", name, n, m.z80.reg.pair.B(), r);
+				}
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * @brief INC B, DEC B
+	 */
+	Result testIncDec(Machine& m, const unsigned char op, const char* name)
+	{
+		Result result{ name };
+		m.setCode(op);
+		for(int n = 0; n < 256; ++n) {
+			for(int f = 0; f < 256; ++f) {
+				Reference ref{ 0, (unsigned char)f };
+				op == 0x04 ? ref.setFlagByIncrement((unsigned char)n) : ref.setFlagByDecrement((unsigned char)n);
+				m.z80.reg.pair.A() = 0;
+				m.z80.reg.pair.B() = (unsigned char)n;
+				m.z80.reg.pair.F() = (unsigned char)f;
+				m.step();
+				result.check(0, ref.F, m, 0, n, f);
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * @brief RLD, RRD
+	 */
+	Result testDigit(Machine& m, const bool left, const char* name)
+	{
+		Result result{ name };
+		m.setCode(0xED, left ? 0x6F : 0x67);
+		constexpr unsigned char H = 0x80;
+		for(int a = 0; a < 256; ++a) {
+			for(int n = 0; n < 256; ++n) {
+				for(int f = 0; f < 256; ++f) {
+					Reference ref{ (unsigned char)a, (unsigned char)f };
+					ref.A = (unsigned char)((a & 0xF0) | (left ? (n >> 4) : (n & 0x0F)));
+					ref.setFlagByDigit(ref.A);
+					m.z80.reg.pair.A() = (unsigned char)a;
+					m.z80.reg.pair.F() = (unsigned char)f;
+					m.z80.reg.pair.H() = H;
+					m.z80.reg.pair.L() = 0;
+					m.memory[H << 8] = (unsigned char)n;
+					m.step();
+					result.check(ref.A, ref.F, m, a, n, f);
+				}
+			}
+		}
+		return result;
+	}
+
+	/**
+	 * @brief IN B,(C)
+	 */
+	Result testIn(Machine& m, const char* name)
+	{
+		Result result{ name };
+		m.setCode(0xED, 0x40);
+		for(int n = 0; n < 256; ++n) {
+			for(int f = 0; f < 256; ++f) {
+				Reference ref{ 0, (unsigned char)f };
+				ref.setFlagByDigit((unsigned char)n);
+				m.input = (unsigned char)n;
+				m.z80.reg.pair.A() = 0;
+				m.z80.reg.pair.F() = (unsigned char)f;
+				m.step();
+				result.check(0, ref.F, m, 0, n, f);
+			}
+		}
+		return result;
+	}
+} // namespace
+
+int
+main()
+{
+	static Machine m;
+	const Result results[] = {
+		testALU(m, 0x80, "ADD A,B"),
+		testALU(m, 0x88, "ADC A,B"),
+		testALU(m, 0x90, "SUB B"),
+		testALU(m, 0x98, "SBC A,B"),
+		testALU(m, 0xA0, "AND B"),
+		testALU(m, 0xA8, "XOR B"),
+		testALU(m, 0xB0, "OR B"),
+		testALU(m, 0xB8, "CP B"),
+		testAccumulator(m, 0x3C, -1, "INC A"),
+		testAccumulator(m, 0x3D, -1, "DEC A"),
+		testAccumulator(m, 0xED, 0x44, "NEG"),
+		testAccumulator(m, 0x27, -1, "DAA"),
+		testAccumulator(m, 0x07, -1, "RLCA"),
+		testAccumulator(m, 0x0F, -1, "RRCA"),
+		testAccumulator(m, 0x17, -1, "RLA"),
+		testAccumulator(m, 0x1F, -1, "RRA"),
+		testIncDec(m, 0x04, "INC B"),
+		testIncDec(m, 0x05, "DEC B"),
+		testRotate(m, 0, "RLC B"),
+		testRotate(m, 1, "RRC B"),
+		testRotate(m, 2, "RL B"),
+		testRotate(m, 3, "RR B"),
+		testRotate(m, 4, "SLA B"),
+		testRotate(m, 5, "SRA B"),
+		testRotate(m, 6, "SLL B"),
+		testRotate(m, 7, "SRL B"),
+		testDigit(m, true, "RLD"),
+		testDigit(m, false, "RRD"),
+		testIn(m, "IN B,(C)"),
+	};
+	int failed = 0;
+	for(const Result& it : results) {
+		printf("%-9s: %9llu cases %s\n", it.name, it.cases, it.failed ? "NG" : "ok");
+		if(it.failed) {
+			failed++;
+		}
+	}
+	return failed ? 1 : 0;
+}